@@ -0,0 +1,193 @@
+/*
+ * arenabench.cpp - pin latency and data TLB misses of the buffer
+ *                  manager at large pool sizes, with the pages of the
+ *                  pool on ordinary pages, transparent huge pages and
+ *                  reserved huge pages.
+ *
+ * Each pin reads a word of the page, as any user of the page would, so
+ * the page's TLB entry counts along with those of the frame and the
+ * page table.  TLB misses are counted with perf_event_open, and are
+ * "n/a" where the kernel does not allow it.  Reserved huge pages need
+ * vm.nr_hugepages set; without them the pool falls back to transparent
+ * ones, and the huge MB column shows which it got.
+ *
+ * Usage: arenabench [maxFrames [pinsPerSize]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "bufmgr.h"
+#include "db.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+#define BENCH_DB_NAME  "ARENABENCH"
+
+// Pages below this are left to the database's own directory and map.
+#define FIRST_BENCH_PAGE  64
+
+
+// A counter of this thread's data TLB read misses, -1 if there is none.
+static int OpenTLBCounter()
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+// Kilobytes of the process's memory on transparent huge pages.
+static long AnonHugeKB()
+{
+	FILE *file = fopen("/proc/self/smaps_rollup", "r");
+	char line[256];
+	long kb = 0;
+
+	if (file == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), file) != NULL)
+		if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+			break;
+	fclose(file);
+	return kb;
+}
+
+
+//-------------------------------------------------------------------
+// PinRead
+//
+// Input   : pool - a pool holding every page in pids.
+//           pids - pages to pin, in order.
+//           counter - TLB miss counter, -1 if none.
+// Output  : misses - TLB misses per pin, -1 if not counted.
+// Purpose : Pin each page, check the word its fill left in it, and
+//           unpin it.
+// Return  : Nanoseconds per pin, 0 on an error.
+//-------------------------------------------------------------------
+
+static double PinRead(BufMgr *pool, const std::vector<PageID>& pids, int counter,
+					  double& misses)
+{
+	long long count = 0;
+	Page *page;
+
+	misses = -1;
+	if (counter >= 0)
+	{
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < pids.size(); i++)
+	{
+		if (pool->PinPage(pids[i], page) != OK || *(PageID *)page != pids[i] ||
+			pool->UnpinPage(pids[i], false) != OK)
+		{
+			fprintf(stderr, "Pin of page %d failed\n", pids[i]);
+			return 0;
+		}
+	}
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	if (counter >= 0)
+	{
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counter, &count, sizeof(count)) == sizeof(count))
+			misses = (double)count / pids.size();
+	}
+	return elapsed.count() / pids.size();
+}
+
+
+int main(int argc, char *argv[])
+{
+	int maxFrames = argc > 1 ? atoi(argv[1]) : 262144;
+	int numPins = argc > 2 ? atoi(argv[2]) : 2000000;
+	static const int sizes[] = { 16384, 65536, 262144, 1048576 };
+	static const HugePages modes[] = { HUGE_PAGES_OFF, HUGE_PAGES_TRANSPARENT,
+									   HUGE_PAGES_RESERVED };
+	static const char *modeNames[] = { "off", "transparent", "reserved" };
+	std::mt19937 rng(42);
+	Status status;
+
+	minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL,
+									  FIRST_BENCH_PAGE + maxFrames, 500, 50, "Clock");
+	if (status != OK)
+	{
+		minibase_errors.show_errors();
+		return 1;
+	}
+
+	int counter = OpenTLBCounter();
+	printf("%10s %12s %9s %10s %14s\n", "frames", "huge pages", "huge MB", "ns/pin",
+		   "dTLB miss/pin");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxFrames; s++)
+	{
+		int frames = sizes[s];
+		std::uniform_int_distribution<int> resident(0, frames - 1);
+		std::vector<PageID> pids(numPins);
+
+		for (int i = 0; i < numPins; i++)
+			pids[i] = FIRST_BENCH_PAGE + resident(rng);
+
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		{
+			long hugeBefore = AnonHugeKB();
+			BufMgr *pool = new BufMgr(frames, "Clock", 0, modes[m]);
+			Page *page;
+
+			// Fill the pool without reading: each page gets its id.
+			for (int i = 0; i < frames; i++)
+			{
+				PageID pid = FIRST_BENCH_PAGE + i;
+				if (pool->PinPage(pid, page, true) != OK)
+				{
+					minibase_errors.show_errors();
+					return 1;
+				}
+				*(PageID *)page = pid;
+				pool->UnpinPage(pid, false);
+			}
+
+			long bytes, reservedBytes;
+			pool->GetMemoryStat(bytes, reservedBytes);
+			long hugeMB = (reservedBytes / 1024 + AnonHugeKB() - hugeBefore) / 1024;
+
+			double misses;
+			double ns = PinRead(pool, pids, counter, misses);
+			if (misses < 0)
+				printf("%10d %12s %9ld %10.1f %14s\n", frames, modeNames[m], hugeMB, ns, "n/a");
+			else
+				printf("%10d %12s %9ld %10.1f %14.3f\n", frames, modeNames[m], hugeMB, ns,
+					   misses);
+
+			delete pool;
+		}
+	}
+
+	if (counter >= 0)
+		close(counter);
+	delete minibase_globals;
+	remove(BENCH_DB_NAME);
+	remove(BENCH_DB_NAME "-hot");
+	return 0;
+}
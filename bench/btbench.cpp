@@ -0,0 +1,328 @@
+/*
+ * btbench.cpp - timings of the basic B+ tree operations, with buffer
+ *               pool hit rates, for profiling the index and the storage
+ *               layer under it.
+ *
+ * Usage: btbench [numKeys [bufPages [dbPages [replacementPolicy [cleanPercent]]]]]
+ *        cleanPercent: start the background writer, keeping that share
+ *        of the next victims clean.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "bufmgr.h"
+#include "db.h"
+#include "btfile.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+#define BENCH_DB_NAME  "BTBENCH"
+
+
+static std::chrono::steady_clock::time_point phaseStart;
+static BufMetrics phaseMetrics;
+
+
+static void StartPhase()
+{
+	MINIBASE_BM->ResetStat();
+	MINIBASE_BM->GetMetrics(phaseMetrics);
+	phaseStart = std::chrono::steady_clock::now();
+}
+
+
+// Upper bound, in microseconds, of the pin hold bucket the given share
+// of the holds falls in.
+static long HoldPercentile(const BufMetrics& m, double share)
+{
+	long total = 0, seen = 0;
+
+	for (int b = 0; b < PIN_HOLD_BUCKETS; b++)
+		total += m.pinHolds[b];
+	for (int b = 0; b < PIN_HOLD_BUCKETS; b++)
+	{
+		seen += m.pinHolds[b];
+		if (seen > 0 && seen >= share * total)
+			return 1L << b;
+	}
+	return 0;
+}
+
+
+//-------------------------------------------------------------------
+// PrintMetrics
+//
+// Input   : m - the metrics of a phase.
+// Output  : None
+// Purpose : Print the misses and pins of each index by node type, the
+//           time spent reading and writing, the waits, and the pin
+//           hold times.
+//-------------------------------------------------------------------
+
+static void PrintMetrics(const BufMetrics& m)
+{
+	static const char *types[METRICS_MAX_TYPES] = { "index", "leaf", "", "other" };
+
+	if (m.TotalPins() > 0)
+	{
+		printf("%-16s misses/pins", "");
+		for (int f = 0; f < METRICS_MAX_FILES; f++)
+		{
+			for (int t = 0; t < METRICS_MAX_TYPES; t++)
+			{
+				if (m.pins[f][t] > 0)
+					printf(" %s%s%s %ld/%ld", f ? MINIBASE_BM->GetMetricsFileName(f) : "",
+						   f ? "." : "", types[t], m.misses[f][t], m.pins[f][t]);
+			}
+		}
+		printf("\n");
+	}
+
+	printf("%-16s read %ld in %.1f ms, wrote %ld in %.1f ms, %ld lock %ld latch waits",
+		   "", m.reads, m.readNanos / 1e6, m.pagesWritten, m.writeNanos / 1e6,
+		   m.lockWaits, m.latchWaits);
+	if (HoldPercentile(m, 1.0) > 0)
+		printf(", pin hold p50 < %ld us, p99 < %ld us", HoldPercentile(m, 0.5),
+			   HoldPercentile(m, 0.99));
+	printf("\n");
+}
+
+
+//-------------------------------------------------------------------
+// EndPhase
+//
+// Input   : name - name of the phase.
+//           ops - number of operations it did.
+// Output  : None
+// Purpose : Print the time, throughput and buffer pool statistics of
+//           the phase started by the last StartPhase, with the frames
+//           scans took and recycled through their BULK_READ rings,
+//           the pages written and the writes they took, the
+//           evictions of clean and of dirty pages, those of clean
+//           pages the background writer had written, and the pages
+//           prefetched, then its metrics.
+//-------------------------------------------------------------------
+
+static void EndPhase(const char *name, int ops)
+{
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - phaseStart;
+	long pins, misses, taken, recycled, writes, written, clean, dirty, ahead;
+
+	MINIBASE_BM->GetStat(pins, misses);
+	MINIBASE_BM->GetStrategyStat(BULK_READ, taken, recycled);
+	MINIBASE_BM->GetWriteStat(writes, written);
+	MINIBASE_BM->GetEvictionStat(clean, dirty, ahead);
+	printf("%-16s %8d ops %9.3f ms %11.0f ops/s %10ld pins %8ld misses (%.2f%% hit)",
+		   name, ops, elapsed.count() * 1000, ops / elapsed.count(), pins, misses,
+		   pins ? 100.0 * (pins - misses) / pins : 100.0);
+	if (taken + recycled > 0)
+		printf(", ring %ld taken %ld recycled", taken, recycled);
+	if (writes > 0)
+		printf(", %ld pages in %ld writes", written, writes);
+	if (dirty > 0)
+		printf(", %ld of %ld evictions dirty", dirty, clean + dirty);
+	if (ahead > 0)
+		printf(", %ld cleaned ahead", ahead);
+	if (MINIBASE_BM->GetPrefetchStat() > 0)
+		printf(", %ld prefetched", MINIBASE_BM->GetPrefetchStat());
+	printf("\n");
+
+	BufMetrics metrics;
+	MINIBASE_BM->GetMetrics(metrics);
+	metrics.Subtract(phaseMetrics);
+	PrintMetrics(metrics);
+}
+
+
+static void MakeKey(int n, char *key)
+{
+	sprintf(key, "%08d", n);
+}
+
+
+static RecordID MakeRid(int n)
+{
+	RecordID rid;
+	rid.pageNo = n / 100;
+	rid.slotNo = n % 100;
+	return rid;
+}
+
+
+//-------------------------------------------------------------------
+// RunInserts
+//
+// Input   : name - name of the index and the phase.
+//           keys - keys to insert, in order.
+// Output  : None
+// Purpose : Build an index by inserting keys one at a time, and print
+//           the tail of the insert latencies.
+// Return  : The index, NULL on an error.
+//-------------------------------------------------------------------
+
+static BTreeFile *RunInserts(const char *name, const std::vector<int>& keys)
+{
+	Status status;
+	KeyType key;
+	BTreeFile *btf = new BTreeFile(status, name);
+
+	if (status != OK)
+	{
+		fprintf(stderr, "Couldn't create index %s\n", name);
+		return NULL;
+	}
+
+	std::vector<double> latencies(keys.size());
+	StartPhase();
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		MakeKey(keys[i], key);
+		if (btf->Insert(key, MakeRid(keys[i])) != OK)
+		{
+			fprintf(stderr, "Insert of %s failed\n", key);
+			return NULL;
+		}
+		std::chrono::duration<double, std::micro> elapsed =
+			std::chrono::steady_clock::now() - start;
+		latencies[i] = elapsed.count();
+	}
+	EndPhase(name, (int)keys.size());
+
+	if (!latencies.empty())
+	{
+		std::sort(latencies.begin(), latencies.end());
+		printf("%-16s p99 %.1f us, p99.9 %.1f us, max %.1f us\n", "", latencies[latencies.size() * 99 / 100],
+			   latencies[latencies.size() * 999 / 1000], latencies.back());
+	}
+
+	return btf;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int numKeys = argc > 1 ? atoi(argv[1]) : 20000;
+	int bufPages = argc > 2 ? atoi(argv[2]) : 200;
+	int dbPages = argc > 3 ? atoi(argv[3]) : MINIBASE_DB_SIZE;
+	const char *policy = argc > 4 ? argv[4] : "Clock";
+	int cleanPercent = argc > 5 ? atoi(argv[5]) : 0;
+	Status status;
+	KeyType key, low, high;
+	RecordID rid;
+
+	minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL,
+									  dbPages, 500, bufPages, policy);
+	if (status != OK)
+	{
+		minibase_errors.show_errors();
+		return 1;
+	}
+
+	printf("%d keys, %d buffer pages, %d database pages, %s\n",
+		   numKeys, bufPages, dbPages, policy);
+	if (cleanPercent > 0 && MINIBASE_BM->StartBackgroundWriter(cleanPercent) != OK)
+		return 1;
+
+	std::vector<int> sequential(numKeys), shuffled(numKeys);
+	for (int i = 0; i < numKeys; i++)
+		sequential[i] = shuffled[i] = i;
+	std::mt19937 rng(42);
+	std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+	BTreeFile *seq = RunInserts("insert-seq", sequential);
+	if (seq == NULL)
+		return 1;
+
+	// A checkpoint after the bulk load.
+	StartPhase();
+	if (MINIBASE_BM->FlushAllPages() != OK)
+		fprintf(stderr, "Flush after insert-seq failed\n");
+	EndPhase("checkpoint", MINIBASE_BM->GetNumOfBuffers());
+	seq->DestroyFile();
+	delete seq;
+
+	BTreeFile *btf = RunInserts("insert-random", shuffled);
+	if (btf == NULL)
+		return 1;
+
+	StartPhase();
+	IndexFileScan *scan = btf->OpenScan(NULL, NULL);
+	int found = 0;
+	while (scan->GetNext(rid, key) == OK)
+		found++;
+	delete scan;
+	EndPhase("scan-full", found);
+	if (found != numKeys)
+		fprintf(stderr, "Full scan found %d keys, expected %d\n", found, numKeys);
+
+	StartPhase();
+	for (int i = 0; i < numKeys; i++)
+	{
+		MakeKey(shuffled[i], key);
+		scan = btf->OpenScan(key, key);
+		if (scan->GetNext(rid, low) != OK)
+			fprintf(stderr, "Lookup of %s failed\n", key);
+		delete scan;
+	}
+	EndPhase("lookup", numKeys);
+
+	// The same lookups down the swizzled links of the index nodes,
+	// which the first lookups through each node set.
+	btf->SetSwizzling(true);
+	StartPhase();
+	for (int i = 0; i < numKeys; i++)
+	{
+		MakeKey(shuffled[i], key);
+		scan = btf->OpenScan(key, key);
+		if (scan->GetNext(rid, low) != OK)
+			fprintf(stderr, "Lookup of %s failed\n", key);
+		delete scan;
+	}
+	EndPhase("lookup-swizzled", numKeys);
+	btf->SetSwizzling(false);
+
+	const int rangeLen = 100;
+	int numRanges = numKeys / rangeLen;
+	StartPhase();
+	for (int i = 0; i < numRanges; i++)
+	{
+		int start = shuffled[i] - shuffled[i] % rangeLen;
+		MakeKey(start, low);
+		MakeKey(start + rangeLen - 1, high);
+		scan = btf->OpenScan(low, high);
+		while (scan->GetNext(rid, key) == OK)
+			;
+		delete scan;
+	}
+	EndPhase("scan-range", numRanges);
+
+	StartPhase();
+	for (int i = 0; i < numKeys / 2; i++)
+	{
+		MakeKey(shuffled[i], key);
+		if (btf->Delete(key, MakeRid(shuffled[i])) != OK)
+			fprintf(stderr, "Delete of %s failed\n", key);
+	}
+	EndPhase("delete-random", numKeys / 2);
+
+	// Destroying the index walks it all, a node's children prefetched
+	// before the node's subtrees are freed.
+	StartPhase();
+	if (btf->DestroyFile() != OK)
+		fprintf(stderr, "DestroyFile failed\n");
+	EndPhase("destroy", 1);
+	delete btf;
+	delete minibase_globals;
+	remove(BENCH_DB_NAME);
+	remove(BENCH_DB_NAME "-hot");
+
+	return 0;
+}
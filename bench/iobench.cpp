@@ -0,0 +1,200 @@
+/*
+ * iobench.cpp - random page reads per second through the async I/O
+ *               backends at queue depths from 1 to AIO_QUEUE_DEPTH,
+ *               against pread one page at a time.
+ *
+ * The database file is written in full first, so on a file system the
+ * reads are served from the page cache unless the file is opened with
+ * O_DIRECT, which is what shows the device's own queue.
+ *
+ * Usage: iobench [pages [reads [direct]]]
+ *        direct: 1 to open the file with O_DIRECT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "aio.h"
+#include "db.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+#define BENCH_DB_NAME  "IOBENCH"
+
+// Buffers are aligned for O_DIRECT.
+#define IO_ALIGNMENT  4096
+
+
+//-------------------------------------------------------------------
+// SyncReads
+//
+// Input   : fd - the database file.
+//           pids - pages to read, in order.
+// Output  : None
+// Purpose : Read each page with pread, one at a time.
+// Return  : Reads per second, 0 on an error.
+//-------------------------------------------------------------------
+
+static double SyncReads(int fd, const std::vector<PageID>& pids)
+{
+	Page *page = (Page *)aligned_alloc(IO_ALIGNMENT, IO_ALIGNMENT);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < pids.size(); i++)
+	{
+		if (pread(fd, page, MINIBASE_PAGESIZE, (off_t)pids[i] * MINIBASE_PAGESIZE) !=
+			MINIBASE_PAGESIZE)
+		{
+			free(page);
+			return 0;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	free(page);
+	return pids.size() / elapsed.count();
+}
+
+
+//-------------------------------------------------------------------
+// AsyncReads
+//
+// Input   : aio - the backend.
+//           pids - pages to read, in order.
+//           depth - reads to keep in flight.
+// Output  : None
+// Purpose : Read each page, with depth requests in flight: wait for
+//           the oldest and submit the next read in its place.
+// Return  : Reads per second, 0 on an error.
+//-------------------------------------------------------------------
+
+static double AsyncReads(AsyncIO *aio, const std::vector<PageID>& pids, int depth)
+{
+	std::vector<IORequest> requests(depth);
+	char *buffers = (char *)aligned_alloc(IO_ALIGNMENT, (size_t)depth * IO_ALIGNMENT);
+	size_t next = 0, completed = 0;
+	bool failed = false;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < depth && next < pids.size(); i++, next++)
+	{
+		IORequest *request = &requests[i];
+		request->pid = pids[next];
+		request->page = (Page *)(buffers + (size_t)i * IO_ALIGNMENT);
+		if (aio->Submit(request) != OK)
+			failed = true;
+	}
+
+	for (int i = 0; completed < next; i = (i + 1) % depth)
+	{
+		IORequest *request = &requests[i];
+		aio->Wait(request);
+		if (request->status != OK)
+			failed = true;
+		completed++;
+
+		if (next < pids.size())
+		{
+			request->pid = pids[next++];
+			if (aio->Submit(request) != OK)
+				failed = true;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	free(buffers);
+	return failed ? 0 : pids.size() / elapsed.count();
+}
+
+
+int main(int argc, char *argv[])
+{
+	int numPages = argc > 1 ? atoi(argv[1]) : 16384;
+	int numReads = argc > 2 ? atoi(argv[2]) : 200000;
+	bool direct = argc > 3 && atoi(argv[3]) != 0;
+	static const int depths[] = { 1, 4, 16, AIO_QUEUE_DEPTH };
+	static const char *backends[] = { "uring", "threads" };
+	const int numBackends = sizeof(backends) / sizeof(backends[0]);
+	std::mt19937 rng(42);
+	Status status;
+
+	minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL, numPages, 500, 50, "Clock");
+	if (status != OK)
+	{
+		minibase_errors.show_errors();
+		return 1;
+	}
+
+	// Write every page, so none is a hole in the file.
+	std::vector<IORequest> writes(numPages);
+	std::vector<IORequest *> batch(numPages);
+	Page *zero = (Page *)calloc(1, MINIBASE_PAGESIZE);
+	for (int i = 0; i < numPages; i++)
+	{
+		writes[i].write = true;
+		writes[i].pid = i;
+		writes[i].page = zero;
+		batch[i] = &writes[i];
+	}
+	// Leave the directory and the space map as they are.
+	int first = 8;
+	MINIBASE_DB->SubmitIO(&batch[first], numPages - first);
+	for (int i = first; i < numPages; i++)
+	{
+		if (MINIBASE_DB->WaitIO(batch[i]) != OK)
+		{
+			minibase_errors.show_errors();
+			return 1;
+		}
+	}
+	free(zero);
+
+	int fd = open(BENCH_DB_NAME, O_RDONLY | (direct ? O_DIRECT : 0));
+	if (fd < 0)
+	{
+		perror(BENCH_DB_NAME);
+		return 1;
+	}
+
+	std::uniform_int_distribution<int> anyPage(0, numPages - 1);
+	std::vector<PageID> pids(numReads);
+	for (int i = 0; i < numReads; i++)
+		pids[i] = anyPage(rng);
+
+	printf("%d pages, %d reads%s, database on %s\n", numPages, numReads,
+		   direct ? ", O_DIRECT" : "", MINIBASE_DB->GetIOBackend());
+	printf("pread: %.0f reads/s\n", SyncReads(fd, pids));
+	printf("%6s", "depth");
+	for (int b = 0; b < numBackends; b++)
+		printf(" %16s", backends[b]);
+	printf("\n");
+
+	for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+	{
+		printf("%6d", depths[d]);
+		for (int b = 0; b < numBackends; b++)
+		{
+			AsyncIO *aio = AsyncIO::Create(fd, depths[d], backends[b]);
+			if (aio == NULL)
+			{
+				printf(" %16s", "n/a");
+				continue;
+			}
+			printf(" %8.0f reads/s", AsyncReads(aio, pids, depths[d]));
+			delete aio;
+		}
+		printf("\n");
+	}
+
+	close(fd);
+	delete minibase_globals;
+	remove(BENCH_DB_NAME);
+	remove(BENCH_DB_NAME "-hot");
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * pagebench.cpp - BTIndexPage::GetPageID on full index pages, which
+ *                 ranks the key's prefix among the page's packed
+ *                 prefixes, against a binary search that reads the key
+ *                 of every slot it probes, as the pages used to be
+ *                 searched.
+ *
+ * Lookups go to random pages of a set larger than the caches, so each
+ * probe of a record's key is likely to miss.  Keys are random strings,
+ * whose prefixes all differ, and numbered keys, which share their first
+ * four bytes and make every search fall back to key compares.
+ *
+ * Usage: pagebench [pages [lookups]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "btindex.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+
+// An index page filled with count keys in order, child i under key i.
+static int FillPage(BTIndexPage *page, PageID pid, const std::vector<std::string>& keys)
+{
+	RecordID rid;
+	int count = 0;
+
+	page->Init(pid);
+	page->SetType(INDEX_NODE);
+	page->SetLeftLink(INVALID_PAGE);
+	while (count < (int)keys.size() &&
+		   page->AvailableSpace() >= GetKeyDataLength(keys[count].c_str(), INDEX_NODE))
+	{
+		page->Insert(keys[count].c_str(), count, rid);
+		count++;
+	}
+	return count;
+}
+
+
+//-------------------------------------------------------------------
+// ProbeSearch
+//
+// Input   : page - an index page.
+//           key - the key to look for.
+// Output  : None
+// Purpose : GetPageID as it was: binary search the slots, comparing
+//           the prefix of each probed record's key before the key.
+// Return  : The child key belongs under.
+//-------------------------------------------------------------------
+
+static PageID ProbeSearch(BTIndexPage *page, const char *key)
+{
+	unsigned int prefix = KeyPrefix(key);
+	int low = 0, high = page->GetNumOfRecords();
+
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		const char *probe = page->GetEntryKey(mid);
+		unsigned int probePrefix = KeyPrefix(probe);
+		int c;
+
+		if (prefix != probePrefix)
+			c = prefix < probePrefix ? -1 : 1;
+		else if ((prefix & 0xFF) == 0)
+			c = 0;
+		else
+			c = KeyCmp(key, probe);
+
+		if (c >= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low == 0)
+		return page->GetLeftLink();
+
+	DataType data;
+	GetKeyData(NULL, &data, (KeyDataEntry *)page->GetEntryKey(low - 1), INDEX_NODE);
+	return data.pid;
+}
+
+
+//-------------------------------------------------------------------
+// RunKeys
+//
+// Input   : name - what the keys are, for the report.
+//           keys - keys in increasing order.
+//           numPages, numLookups - as for main.
+// Output  : None
+// Purpose : Fill numPages pages with keys, then time numLookups
+//           lookups of random keys in random pages both ways.
+// Return  : 0 if both ways agree, 1 otherwise.
+//-------------------------------------------------------------------
+
+static int RunKeys(const char *name, const std::vector<std::string>& keys,
+				   int numPages, int numLookups)
+{
+	std::vector<Page> pages(numPages);
+	std::mt19937 rng(7);
+	int perPage = 0;
+
+	for (int p = 0; p < numPages; p++)
+		perPage = FillPage((BTIndexPage *)&pages[p], p, keys);
+
+	std::uniform_int_distribution<int> anyPage(0, numPages - 1);
+	std::uniform_int_distribution<int> anyKey(0, perPage - 1);
+	std::vector<int> which(numLookups), what(numLookups);
+	for (int i = 0; i < numLookups; i++)
+	{
+		which[i] = anyPage(rng);
+		what[i] = anyKey(rng);
+	}
+
+	long sum = 0, probeSum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numLookups; i++)
+	{
+		PageID pid;
+		((BTIndexPage *)&pages[which[i]])->GetPageID(keys[what[i]].c_str(), pid);
+		sum += pid;
+	}
+	std::chrono::duration<double> prefixTime = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numLookups; i++)
+		probeSum += ProbeSearch((BTIndexPage *)&pages[which[i]], keys[what[i]].c_str());
+	std::chrono::duration<double> probeTime = std::chrono::steady_clock::now() - start;
+
+	printf("%-10s %8d %14.0f %14.0f %7.2fx\n", name, perPage,
+		   numLookups / prefixTime.count(), numLookups / probeTime.count(),
+		   probeTime.count() / prefixTime.count());
+
+	if (sum != probeSum)
+	{
+		fprintf(stderr, "%s: the searches disagree\n", name);
+		return 1;
+	}
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int numPages = argc > 1 ? atoi(argv[1]) : 16384;
+	int numLookups = argc > 2 ? atoi(argv[2]) : 4000000;
+	std::mt19937 rng(42);
+	std::vector<std::string> keys;
+	int rc = 0;
+
+	if (numPages < 1 || numLookups < 1)
+	{
+		fprintf(stderr, "Usage: pagebench [pages [lookups]]\n");
+		return 1;
+	}
+
+	printf("%-10s %8s %14s %14s %8s\n", "keys", "per page", "prefix ops/s",
+		   "probe ops/s", "speedup");
+
+	// Random lower-case strings of 6 to 12 letters.
+	std::uniform_int_distribution<int> letter('a', 'z'), length(6, 12);
+	for (int i = 0; i < MINIBASE_PAGESIZE; i++)
+	{
+		std::string key(length(rng), ' ');
+		for (size_t c = 0; c < key.size(); c++)
+			key[c] = (char)letter(rng);
+		keys.push_back(key);
+	}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	rc |= RunKeys("random", keys, numPages, numLookups);
+
+	keys.clear();
+	for (int i = 0; i < MINIBASE_PAGESIZE; i++)
+	{
+		char key[16];
+		sprintf(key, "key%08d", i);
+		keys.push_back(key);
+	}
+	rc |= RunKeys("numbered", keys, numPages, numLookups);
+
+	return rc;
+}
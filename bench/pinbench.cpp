@@ -0,0 +1,180 @@
+/*
+ * pinbench.cpp - PinPage/UnpinPage throughput of the buffer manager
+ *                at pool sizes from 50 frames up, with every page
+ *                resident and with half the working set out of the pool,
+ *                and with every page resident on several threads at
+ *                once, which latch the pages they pin.
+ *
+ * Usage: pinbench [maxFrames [opsPerSize [threads]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bufmgr.h"
+#include "db.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+#define BENCH_DB_NAME  "PINBENCH"
+
+// Pages below this are left to the database's own directory and map.
+#define FIRST_BENCH_PAGE  64
+
+
+//-------------------------------------------------------------------
+// PinUnpin
+//
+// Input   : pids - pages to pin, in order.
+// Output  : None
+// Purpose : Pin and unpin each page once.
+// Return  : Operations per second, 0 on an error.
+//-------------------------------------------------------------------
+
+static double PinUnpin(const std::vector<PageID>& pids)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Page *page;
+
+	for (size_t i = 0; i < pids.size(); i++)
+	{
+		if (MINIBASE_BM->PinPage(pids[i], page) != OK ||
+			MINIBASE_BM->UnpinPage(pids[i], false) != OK)
+		{
+			fprintf(stderr, "Pin/unpin of page %d failed\n", pids[i]);
+			return 0;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return pids.size() / elapsed.count();
+}
+
+
+//-------------------------------------------------------------------
+// PinLatchThreads
+//
+// Input   : frames - pages FIRST_BENCH_PAGE on are resident, this many.
+//           numOps - pins per thread.
+//           numThreads - threads to run.
+// Output  : None
+// Purpose : Pin random resident pages on numThreads threads at once,
+//           latching three in four shared and the rest exclusive and
+//           unpinning those dirty.
+// Return  : Operations per second over all threads, 0 on an error.
+//-------------------------------------------------------------------
+
+static double PinLatchThreads(int frames, int numOps, int numThreads)
+{
+	std::vector<std::thread> threads;
+	std::vector<bool> failed(numThreads, false);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads.push_back(std::thread([&, t]()
+		{
+			std::mt19937 rng(t);
+			std::uniform_int_distribution<int> resident(0, frames - 1);
+			Page *page;
+
+			for (int i = 0; i < numOps; i++)
+			{
+				PageID pid = FIRST_BENCH_PAGE + resident(rng);
+				LatchMode mode = i % 4 == 3 ? LATCH_EXCLUSIVE : LATCH_SHARED;
+				if (MINIBASE_BM->PinPage(pid, page, mode) != OK ||
+					MINIBASE_BM->UnpinPage(pid, mode == LATCH_EXCLUSIVE, mode) != OK)
+				{
+					failed[t] = true;
+					return;
+				}
+			}
+		}));
+	}
+
+	for (int t = 0; t < numThreads; t++)
+		threads[t].join();
+
+	for (int t = 0; t < numThreads; t++)
+	{
+		if (failed[t])
+		{
+			fprintf(stderr, "Latched pin/unpin failed on thread %d\n", t);
+			return 0;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return (double)numOps * numThreads / elapsed.count();
+}
+
+
+int main(int argc, char *argv[])
+{
+	int maxFrames = argc > 1 ? atoi(argv[1]) : 1000000;
+	int numOps = argc > 2 ? atoi(argv[2]) : 2000000;
+	int numThreads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	static const int sizes[] = { 50, 1000, 10000, 100000, 1000000 };
+	std::mt19937 rng(42);
+	Status status;
+
+	if (numThreads < 1)
+		numThreads = 1;
+
+	printf("%10s %14s %14s %8s %17s\n", "frames", "hit pins/s", "mixed pins/s", "hit%",
+		   "latched pins/s");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxFrames; s++)
+	{
+		int frames = sizes[s];
+		long pins, misses;
+
+		minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL,
+										  FIRST_BENCH_PAGE + 2 * frames, 500, frames, "Clock");
+		if (status != OK)
+		{
+			minibase_errors.show_errors();
+			return 1;
+		}
+
+		// Fill the pool, then pin only pages that are in it.
+		std::vector<PageID> pids(frames);
+		for (int i = 0; i < frames; i++)
+			pids[i] = FIRST_BENCH_PAGE + i;
+		PinUnpin(pids);
+
+		std::uniform_int_distribution<int> resident(0, frames - 1);
+		pids.resize(numOps);
+		for (int i = 0; i < numOps; i++)
+			pids[i] = FIRST_BENCH_PAGE + resident(rng);
+		double hitRate = PinUnpin(pids);
+
+		// Twice as many pages as frames: about half the pins miss.
+		std::uniform_int_distribution<int> working(0, 2 * frames - 1);
+		for (int i = 0; i < numOps; i++)
+			pids[i] = FIRST_BENCH_PAGE + working(rng);
+		MINIBASE_BM->ResetStat();
+		double mixedRate = PinUnpin(pids);
+		MINIBASE_BM->GetStat(pins, misses);
+
+		// Back to every page resident for the threads.
+		pids.resize(frames);
+		for (int i = 0; i < frames; i++)
+			pids[i] = FIRST_BENCH_PAGE + i;
+		PinUnpin(pids);
+		double latchedRate = PinLatchThreads(frames, numOps / numThreads, numThreads);
+
+		printf("%10d %14.0f %14.0f %7.2f%% %14.0f x%d\n", frames, hitRate, mixedRate,
+			   pins ? 100.0 * (pins - misses) / pins : 100.0, latchedRate, numThreads);
+
+		delete minibase_globals;
+		remove(BENCH_DB_NAME);
+		remove(BENCH_DB_NAME "-hot");
+	}
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * tracebench.cpp - hit ratios of the buffer replacement policies on a
+ *                  page reference trace.
+ *
+ * A trace is a text file of page ids, one per pin, as BufMgr writes it
+ * after SetTraceFile.  Without one, a trace is recorded from a B+ tree
+ * workload of skewed point lookups with a full scan every so often,
+ * the case where the inner index pages should stay in the pool.  Each
+ * policy then replays the trace in a fresh pool.
+ *
+ * Usage: tracebench [bufPages [traceFile]]
+ *        If traceFile exists it is replayed, otherwise the recorded
+ *        trace is saved there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include "bufmgr.h"
+#include "db.h"
+#include "btfile.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+#define BENCH_DB_NAME  "TRACEBENCH"
+
+static const int numKeys = 20000;
+static const int numLookups = 40000;
+static const int lookupsPerScan = 2000;
+
+
+static Status ReadTrace(const char *fileName, std::vector<PageID>& trace)
+{
+	FILE *file = fopen(fileName, "r");
+	PageID pid;
+
+	if (file == NULL)
+		return FAIL;
+	while (fscanf(file, "%d", &pid) == 1)
+		trace.push_back(pid);
+	fclose(file);
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// RecordTrace
+//
+// Input   : bufPages - size of the pool to record with.
+//           fileName - where to save the trace.
+// Output  : trace - the page ids pinned by the workload.
+// Purpose : Build an index and record the pins of the mixed workload
+//           on it.  90% of the lookups go to a tenth of the keys.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+static Status RecordTrace(int bufPages, const char *fileName, std::vector<PageID>& trace)
+{
+	Status status;
+	KeyType key;
+	RecordID rid;
+	std::mt19937 rng(42);
+
+	minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL,
+									  MINIBASE_DB_SIZE, 500, bufPages, "Clock");
+	if (status != OK)
+		return FAIL;
+
+	BTreeFile *btf = new BTreeFile(status, "tracebench");
+	if (status != OK)
+		return FAIL;
+
+	for (int i = 0; i < numKeys; i++)
+	{
+		int k = (int)(((long long)i * 7919) % numKeys);
+		sprintf(key, "%08d", k);
+		rid.pageNo = k / 100;
+		rid.slotNo = k % 100;
+		if (btf->Insert(key, rid) != OK)
+			return FAIL;
+	}
+
+	FILE *file = fopen(fileName, "w");
+	if (file == NULL)
+	{
+		perror(fileName);
+		return FAIL;
+	}
+	MINIBASE_BM->SetTraceFile(file);
+
+	std::uniform_int_distribution<int> all(0, numKeys - 1), hot(0, numKeys / 10 - 1);
+	std::uniform_real_distribution<double> coin(0, 1);
+	for (int i = 0; i < numLookups; i++)
+	{
+		int k = coin(rng) < 0.9 ? hot(rng) : all(rng);
+		sprintf(key, "%08d", k);
+		IndexFileScan *scan = btf->OpenScan(key, key);
+		scan->GetNext(rid, key);
+		delete scan;
+
+		if ((i + 1) % lookupsPerScan == 0)
+		{
+			scan = btf->OpenScan(NULL, NULL);
+			while (scan->GetNext(rid, key) == OK)
+				;
+			delete scan;
+		}
+	}
+
+	MINIBASE_BM->SetTraceFile(NULL);
+	fclose(file);
+
+	btf->DestroyFile();
+	delete btf;
+	delete minibase_globals;
+	remove(BENCH_DB_NAME);
+	remove(BENCH_DB_NAME "-hot");
+
+	return ReadTrace(fileName, trace);
+}
+
+
+//-------------------------------------------------------------------
+// Replay
+//
+// Input   : trace - page ids to pin, in order.
+//           bufPages - size of the pool.
+//           policy - name of the replacement policy.
+// Output  : None
+// Purpose : Pin and unpin every page of the trace in a new pool.
+// Return  : The hit ratio, in percent, -1 on an error.
+//-------------------------------------------------------------------
+
+static double Replay(const std::vector<PageID>& trace, int bufPages, const char *policy)
+{
+	Status status;
+	Page *page;
+	long pins, misses;
+	PageID maxPid = 0;
+
+	for (size_t i = 0; i < trace.size(); i++)
+		if (trace[i] > maxPid)
+			maxPid = trace[i];
+
+	minibase_globals = new SystemDefs(status, BENCH_DB_NAME, NULL,
+									  maxPid + 1, 500, bufPages, policy);
+	if (status != OK)
+		return -1;
+
+	for (size_t i = 0; i < trace.size(); i++)
+	{
+		if (MINIBASE_BM->PinPage(trace[i], page) != OK ||
+			MINIBASE_BM->UnpinPage(trace[i], false) != OK)
+			return -1;
+	}
+
+	MINIBASE_BM->GetStat(pins, misses);
+	delete minibase_globals;
+	remove(BENCH_DB_NAME);
+	remove(BENCH_DB_NAME "-hot");
+
+	return pins ? 100.0 * (pins - misses) / pins : 100.0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int bufPages = argc > 1 ? atoi(argv[1]) : 100;
+	const char *fileName = argc > 2 ? argv[2] : "tracebench.trace";
+	static const char *policies[] = { "Clock", "LRU2", "2Q", "ARC", "ClockPro" };
+	std::vector<PageID> trace;
+
+	if (argc <= 2 || ReadTrace(fileName, trace) != OK)
+	{
+		if (RecordTrace(bufPages, fileName, trace) != OK)
+		{
+			fprintf(stderr, "Couldn't record a trace\n");
+			minibase_errors.show_errors();
+			return 1;
+		}
+		if (argc <= 2)
+			remove(fileName);
+	}
+
+	printf("%zu references, %d buffer pages\n", trace.size(), bufPages);
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+	{
+		double hitRatio = Replay(trace, bufPages, policies[i]);
+		if (hitRatio < 0)
+		{
+			fprintf(stderr, "Replay with %s failed\n", policies[i]);
+			return 1;
+		}
+		printf("%-10s %6.2f%% hits\n", policies[i], hitRatio);
+	}
+
+	return 0;
+}
@@ -1,14 +1,47 @@
+#include <algorithm>
+#include <iterator>
+
 #include "minirel.h"
 #include "bufmgr.h"
+#include "pageguard.h"
 #include "db.h"
 #include "new_error.h"
 #include "btfile.h"
 #include "btfilescan.h"
 
+// NEWPAGE_GUARD, for a node from the file's extents (see NewNode).
+#define NEWNODE_GUARD(after, a, b)  if (NewNode(reserved, (after), (a), (b), PIN_SITE) != OK) {\
+						cerr << "Unable to allocate new page " << a << endl; return FAIL;}
+
+//-------------------------------------------------------------------
+// BTreePageType
+//
+// Input   : pid - a page of a B+ tree, pinned.
+//           page - its contents.
+// Output  : None
+// Purpose : Tell index and leaf nodes apart for the buffer pool's
+//           metrics.  A node records its own page id; the header and
+//           overflow pages do not, and count as other pages.
+// Return  : The NodeType, METRICS_OTHER_TYPE if the page is no node.
+//-------------------------------------------------------------------
+static int BTreePageType(PageID pid, Page *page)
+{
+	SortedPage *node = (SortedPage *)page;
+
+	if (node->PageNo() != pid)
+		return METRICS_OTHER_TYPE;
+	NodeType type = node->GetType();
+	return type == INDEX_NODE || type == LEAF_NODE ? type : METRICS_OTHER_TYPE;
+}
+
 //-------------------------------------------------------------------
 // BTreeFile::BTreeFile
 //
 // Input   : filename - filename of an index.
+//           ridEncoding - how the leaves of a new index store RecordIDs.
+//                         An existing index keeps its own.
+//           pinnedLevels - levels of index nodes, from the root down,
+//                          to keep pinned while the file is open.
 // Output  : returnStatus - status of execution of constructor.
 //           OK if successful, FAIL otherwise.
 // Purpose : Open the index file, if it exists.
@@ -21,50 +54,62 @@
 //           once you have read or created it. You will use the header
 //           page to find the root node.
 //-------------------------------------------------------------------
-BTreeFile::BTreeFile (Status& returnStatus, const char *filename) {
+BTreeFile::BTreeFile (Status& returnStatus, const char *filename,
+					  RidEncoding ridEncoding, int pinnedLevels) {
+	this->pinnedLevels = pinnedLevels;
+	pinnedStale = false;
+	swizzling = false;
+	reorgRunning = false;
+	reorgLast = INVALID_PAGE;
+	reorgEpoch = 0;
+	updateEpoch = 0;
+
 	// Save the name of the file so we delete appropriately
 	// when DestroyFile is called.
 	dbname = strcpy(new char[strlen(filename) + 1], filename);
+	metricsFile = MINIBASE_BM->RegisterMetricsFile(filename, BTreePageType);
+	MetricsScope scope(metricsFile);
 
 	Status stat = MINIBASE_DB->GetFileEntry(filename, headerID);
-	Page *_headerPage;
 	returnStatus = OK;
 
 	// File does not exist, so we should create a new index file.
 	if (stat == FAIL) {
 		//Allocate a new header page.
-		stat = MINIBASE_BM->NewPage(headerID, _headerPage, 1);
+		stat = MINIBASE_BM->NewPage(headerID, header, PIN_SITE);
 
 		if (stat != OK) {
 			std::cerr << "Error allocating header page." << std::endl;
 			headerID = INVALID_PAGE;
-			header = NULL;
 			returnStatus = FAIL;
 			return;
 		}
 
-		header = (BTreeHeaderPage *)(_headerPage);
 		header->Init(headerID);
+		header->SetRidEncoding(ridEncoding);
+		header.SetDirty();
 		stat = MINIBASE_DB->AddFileEntry(filename, headerID);
 
 		if (stat != OK) {
 			std::cerr << "Error creating file" << std::endl;
 			headerID = INVALID_PAGE;
-			header = NULL;
+			header.Free();
 			returnStatus = FAIL;
 			return;
 		}
 	} else {
-		stat = MINIBASE_BM->PinPage(headerID, _headerPage);
+		stat = MINIBASE_BM->PinPage(headerID, header, PIN_SITE);
 
 		if (stat != OK) {
 			std::cerr << "Error pinning existing header page" << std::endl;
 			headerID = INVALID_PAGE;
-			header = NULL;
 			returnStatus = FAIL;
+			return;
 		}
 
-		header = (BTreeHeaderPage *) _headerPage;
+		LoadReserved();
+		if (PinUpperLevels() != OK)
+			returnStatus = FAIL;
 	}
 }
 
@@ -81,11 +126,15 @@ BTreeFile::BTreeFile (Status& returnStatus, const char *filename) {
 //-------------------------------------------------------------------
 BTreeFile::~BTreeFile ()
 {
+	MetricsScope scope(metricsFile);
     delete [] dbname;
+	UnpinUpperLevels();
+	ReleaseReserved(reserved);
+	ReleaseReserved(reorgReserved);
 	
     if (headerID != INVALID_PAGE) 
 	{
-		Status st = MINIBASE_BM->UnpinPage (headerID, CLEAN);
+		Status st = header.Unpin();
 		if (st != OK)
 		{
 		cerr << "ERROR : Cannot unpin page " << headerID << " in BTreeFile::~BTreeFile" << endl;
@@ -110,7 +159,8 @@ Status BTreeFile::DestroyFile ()
 	//header page is a heap page, not a sorted page
 	//parent-> child: heapPage->SortedPage->(BTIndexPage and BTLeafPage)
 	//typedef enum {	INDEX_NODE,	LEAF_NODE	} NodeType;
-	Status s= OK; PageID rootPageID; SortedPage* rootPage; NodeType nType;
+	Status s= OK;
+	MetricsScope scope(metricsFile);
 
 //	DumpStatistics();
 //	_PrintTree(header->GetRootPageID());
@@ -126,81 +176,211 @@ Status BTreeFile::DestroyFile ()
 	//_PrintTree(112);
 	//cin.get();
 */
-	if (header == NULL || headerID == INVALID_PAGE) {
+	if (!header.IsPinned() || headerID == INVALID_PAGE) {
 		headerID = INVALID_PAGE;
-		header = NULL;
+		header.Unpin();
 		s = MINIBASE_DB->DeleteFileEntry(dbname);
 		return s;
 	}
 
+	UnpinUpperLevels();
+	ReleaseReserved(reserved);
+	ReleaseReserved(reorgReserved);
 	if ( header->GetRootPageID() != INVALID_PAGE){
-		//Get the root page (MINIBASE_BM->PinPage)
-		rootPageID= header->GetRootPageID();
-		PIN(rootPageID,(Page *&)rootPage);
-		//if root page is leaf page {
-		if( rootPage->GetType()==LEAF_NODE) {
-			//Free root page.
-			FREEPAGE(rootPageID); //also unpins page. if FAILED, will return FAIL for Status BTreeFile::DestroyFile ()
-		}
-		else {//Recursively free all other pages. //root page is an index page
-			s=DestroyNode(rootPageID);
-			MINIBASE_BM->FreePage(rootPageID); // not return any value for Status BTreeFile::DestroyFile ()
-		}
-		//UNPIN(rootPageID,CLEAN); //freePage unpins page in the fn
+		//Recursively free the root and all pages under it; each node
+		//frees itself.
+		s=DestroyNode(header->GetRootPageID());
 	}
 
-	FREEPAGE(headerID);
+	FREE_GUARD(header);
 	headerID = INVALID_PAGE;
-	header = NULL;
 	//Remove the file entry in the database
 	s = MINIBASE_DB->DeleteFileEntry(dbname);
 	return s;
 }
 
+//-------------------------------------------------------------------
+// BTreeFile::DestroyNode
+//
+// Input   : pageID - a node of the tree.
+// Output  : None
+// Return  : OK if successful, FAIL if a page could not be pinned or
+//           freed.
+// Purpose : Free the node and, for an index node, everything under it.
+//-------------------------------------------------------------------
 Status BTreeFile::DestroyNode(PageID pageID) {
-	SortedPage *page; NodeType type; 
-	RecordID rid; char* key; PageID keyPid; PageID keyPid2; PageID keyPid3; 
-	Status s= OK; Status stat= OK;
-	//Status PinPage( PageID pid, Page*& page, bool emptyPage=false );
-	PIN (pageID, page); //returns SortedPage *page
-	type = page->GetType();
+	PageGuard<SortedPage> page;
+	RecordID rid; KeyType key; PageID keyPid;
+	Status s= OK;
 
-	//base case: node is a leaf node
-	if (type==LEAF_NODE) {
-		FREEPAGE(pageID); //freePage unpins page in the fn
-		return OK;
-	}
+	PIN_GUARD(pageID, page);
 
-	//recursive case: //node is an index node
-	if (type==INDEX_NODE){
-	//	Status GetFirst (RecordID& rid, char *key, PageID & pageNo);
-	//Status GetNext (RecordID& rid, char *key, PageID & pageNo);
-			//Return  : OK if there is a next record, DONE if no more.
-		keyPid=((BTIndexPage*&)page)->GetLeftLink(); 
-		s=DestroyNode(keyPid);
-		FREEPAGE(keyPid); //freePage unpins page in the fn
-		key=new char[MAX_KEY_SIZE];
-		stat=((BTIndexPage*&)page)->GetFirst (rid, key, keyPid2); //returns rid, key, keypPid
+	//base case: node is a leaf node
+	if (page->GetType()==LEAF_NODE) {
+		((BTLeafPage *)page.Get())->FreeOverflow();
+	} else {
+		//recursive case: node is an index node
 		//<pid1, key1, pid2, key2, ..., keyk, pidk+1>
 		//leftlink or leftmost child page stores pid1 while (keyi, pidi+1) are stored as records of type IndexEntry in BTIndexPage
-		if (stat==OK) {
-			s=DestroyNode(keyPid2); //destroys GetFirst keyPid
-			FREEPAGE(keyPid2);
-			stat= ((BTIndexPage*&)page)->GetNext(rid, key, keyPid3); //input: rid; returns rid, key, keypPid
-			//OK if there's next record, DONE if no more. DONE returns last valid key value
-			while(stat!=DONE) {
-				s=DestroyNode(keyPid3); //destroys GetNext keyPid
-				FREEPAGE(keyPid3);
-				stat= ((BTIndexPage*&)page)->GetNext(rid, key, keyPid3);
-			}
+		BTIndexPage *index = (BTIndexPage *)page.Get();
+		PrefetchChildren(index);
+		if (DestroyNode(index->GetLeftLink()) != OK)
+			s = FAIL;
+		for (Status stat = index->GetFirst(rid, key, keyPid); stat == OK;
+			 stat = index->GetNext(rid, key, keyPid)) {
+			if (DestroyNode(keyPid) != OK)
+				s = FAIL;
 		}
-		UNPIN(pageID, CLEAN);
-		delete key;
-		return s;
 	}
+	page->ReleaseKeys();
+	FREE_GUARD(page);
 	return s;
 }
 
+//-------------------------------------------------------------------
+// BTreeFile::PrefetchChildren
+//
+// Input   : index - a pinned index page.
+// Output  : None
+// Purpose : Start reading all the children of the page, before a walk
+//           of the whole subtree pins them one by one.
+//-------------------------------------------------------------------
+void BTreeFile::PrefetchChildren(BTIndexPage *index)
+{
+	std::vector<PageID> children;
+
+	GetChildren(index, children);
+	MINIBASE_BM->Prefetch(&children[0], (int)children.size());
+}
+
+// Append the children of a pinned index page to children, left to right.
+void BTreeFile::GetChildren(BTIndexPage *index, std::vector<PageID>& children)
+{
+	RecordID rid;
+	KeyType key;
+	PageID child;
+
+	children.push_back(index->GetLeftLink());
+	for (Status s = index->GetFirst(rid, key, child); s == OK;
+		 s = index->GetNext(rid, key, child))
+		children.push_back(child);
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::SetPinnedLevels
+//
+// Input   : levels - levels of index nodes to keep pinned, 0 for none.
+// Output  : None
+// Return  : OK if successful, FAIL if the nodes could not be pinned,
+//           in which case none are.
+// Purpose : Keep the index nodes of the top levels of the tree pinned,
+//           so that they stay in the pool however cold the rest is,
+//           and descents find them here instead of in the pool.  They
+//           are pinned again after an insert or delete that adds or
+//           removes an index node there or changes the root.
+//-------------------------------------------------------------------
+Status BTreeFile::SetPinnedLevels(int levels)
+{
+	MetricsScope scope(metricsFile);
+
+	pinnedLevels = levels;
+	return PinUpperLevels();
+}
+
+// The pinned index node pid, NULL if it is not one.
+PageGuard<SortedPage> *BTreeFile::FindPinnedNode(PageID pid)
+{
+	if (pinnedNodes.empty())
+		return NULL;
+
+	std::vector< PageGuard<SortedPage> >::iterator it = std::lower_bound(
+		pinnedNodes.begin(), pinnedNodes.end(), pid,
+		[](const PageGuard<SortedPage>& node, PageID pid) { return node.GetPageID() < pid; });
+	return it != pinnedNodes.end() && it->GetPageID() == pid ? &*it : NULL;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::PinNode
+//
+// Input   : parent - the frame of the pinned parent of the node, NULL
+//                    for the root.
+//           pid - the node.
+//           site - the caller, PIN_SITE.
+// Output  : page - the node, pinned.
+// Return  : OK if successful, FAIL otherwise.
+// Purpose : Pin a node on the way down, through its parent's swizzled
+//           link to it when swizzling.
+//-------------------------------------------------------------------
+Status BTreeFile::PinNode(ClockFrame *parent, PageID pid, PageGuard<SortedPage>& page,
+						  const char *site)
+{
+	Status s = swizzling && parent != NULL ?
+		MINIBASE_BM->PinChild(parent, pid, page, site) :
+		MINIBASE_BM->PinPage(pid, page, site);
+
+	if (s != OK)
+		cerr << "Unable to pin page " << pid << endl;
+	return s;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::PinUpperLevels
+//
+// Input   : None
+// Output  : None
+// Return  : OK if successful, FAIL if a node could not be pinned.
+// Purpose : Unpin the nodes pinned before, then pin the index nodes
+//           of the top pinnedLevels levels, a level at a time, reading
+//           each level ahead with Prefetch.
+//-------------------------------------------------------------------
+Status BTreeFile::PinUpperLevels()
+{
+	std::vector<PageID> level, next;
+
+	UnpinUpperLevels();
+	pinnedStale = false;
+	if (!header.IsPinned() || header->GetRootPageID() == INVALID_PAGE)
+		return OK;
+
+	level.push_back(header->GetRootPageID());
+	for (int depth = 0; depth < pinnedLevels && !level.empty(); depth++) {
+		next.clear();
+		for (size_t i = 0; i < level.size(); i++) {
+			PageGuard<SortedPage> page;
+			if (MINIBASE_BM->PinPage(level[i], page, PIN_SITE) != OK) {
+				cerr << "Unable to pin page " << level[i] << endl;
+				UnpinUpperLevels();
+				return FAIL;
+			}
+
+			//	The leaves are all at one depth, so this is the bottom.
+			if (page->GetType() != INDEX_NODE)
+				continue;
+			if (depth + 1 < pinnedLevels)
+				GetChildren((BTIndexPage *)page.Get(), next);
+			pinnedNodes.push_back(std::move(page));
+		}
+		if (!next.empty())
+			MINIBASE_BM->Prefetch(&next[0], (int)next.size());
+		level.swap(next);
+	}
+
+	std::sort(pinnedNodes.begin(), pinnedNodes.end(),
+		[](const PageGuard<SortedPage>& a, const PageGuard<SortedPage>& b) {
+			return a.GetPageID() < b.GetPageID(); });
+	return OK;
+}
+
+void BTreeFile::UnpinUpperLevels()
+{
+	for (size_t i = 0; i < pinnedNodes.size(); i++) {
+		PageID pid = pinnedNodes[i].GetPageID();
+		if (pinnedNodes[i].Unpin() != OK)
+			cerr << "Unable to unpin page " << pid << endl;
+	}
+	pinnedNodes.clear();
+}
+
 //-------------------------------------------------------------------
 // BTreeFile::Insert
 //
@@ -212,83 +392,612 @@ Status BTreeFile::DestroyNode(PageID pageID) {
 // Note    : If the root didn't exist, create it.
 //-------------------------------------------------------------------
 Status BTreeFile::Insert (const char *key, const RecordID rid)
+{
+	KeyType storedKey;
+	Status res;
+	MetricsScope scope(metricsFile);
+
+	if (StoreKey(storedKey, key) != OK) return FAIL;
+	updateEpoch++;
+	res = _InsertKey(storedKey, rid);
+	KeyRelease(storedKey);
+	if (pinnedStale && PinUpperLevels() != OK)
+		res = FAIL;
+	return res;
+}
+
+// Insert with key already in its stored form (see StoreKey).
+Status BTreeFile::_InsertKey (const char *key, const RecordID rid)
 {
 	PageID rootPageID;
-	SortedPage* rootPage; 
+	PageGuard<SortedPage> rootPage;
 	BTLeafPage *leafPage; PageID leafPageID; RecordID leafRid; NodeType type;
 
 	Status res;
 	Status s;
 
-	if (header == NULL || headerID == INVALID_PAGE) return FAIL;
+	if (!header.IsPinned() || headerID == INVALID_PAGE) return FAIL;
 	rootPageID = header->GetRootPageID();
 
 	if (rootPageID==INVALID_PAGE) { //If the root didn't exist, create it.
 		//BTreeFile with only one BTLeafPage: the single leaf page is also the root.
 		//The leaf and index nodes are implemented by the classes BTLeafPage and BTIndexPage, respectively; both subclasses of SortedPage
-		//Status NewPage( PageID& pid, Page*& firstpage,int howmany=1 ); 
-		// NewPage(): Allocate howMany number of pages & pin firstpage into buffer. Returns firstpage, pointer to page pinned in buffer           
-		s = MINIBASE_BM->NewPage(rootPageID, (Page *&)rootPage, 1);
+		s = NewNode(reserved, 0, rootPageID, rootPage, PIN_SITE);
 		if (s != OK) {
 			std::cerr << "Error allocating root page." << std::endl;
 			return FAIL;
 		}
-		leafPage = (BTLeafPage* &)rootPage;
+		leafPage = (BTLeafPage *)rootPage.Get();
 		leafPageID = rootPageID;
-		leafPage->Init(leafPageID);
-		leafPage->SetType(LEAF_NODE);
+		InitLeafPage(leafPage, leafPageID);
 		header->SetRootPageID(rootPageID);
+		header.SetDirty();
 
 		leafPage->Insert(key, rid, leafRid); //return leafRid: record id of inserted pair (key, dataRid)
-		UNPIN(leafPageID, DIRTY);
+		rootPage.SetDirty();
 		return OK;
 	}
 
 	if (rootPageID!=INVALID_PAGE) {
-		PIN(rootPageID, (Page *&)rootPage); //returns page - a pointer to a page pinned in buffer pool.
+		PIN_GUARD(rootPageID, rootPage); //returns page - a pointer to a page pinned in buffer pool.
+		rootPage.SetDirty();
 
 		type= rootPage->GetType();
 
 		if(type==LEAF_NODE){
-			leafPage=(BTLeafPage* &)rootPage;
+			leafPage=(BTLeafPage *)rootPage.Get();
 			leafPageID= rootPageID;
-			if (leafPage->AvailableSpace() >= GetKeyDataLength(key, type)) {
-				res = leafPage->Insert(key, rid, leafRid);
-			} else {
+			// A key already on the page only needs room for one more
+			// RecordID, so let the leaf decide whether it fits.
+			res = leafPage->Insert(key, rid, leafRid);
+			if (res != OK) {
 				PageID newRootPageID;
 				res = Split1LeafNode(leafPageID,newRootPageID, key, rid);
 				if(res == OK) {
 					header->SetRootPageID(newRootPageID);
+					header.SetDirty();
+					pinnedStale = true;
 				}
 			}
 		} else {
 			char * newKey=new char[MAX_KEY_SIZE];
 			PageID newPid;
-			Status res = _Insert(rootPageID, key, rid, newPid, newKey);
+			res = _Insert(rootPageID, NULL, key, rid, newPid, newKey);
 			if (newPid != INVALID_PAGE) {
 				PageID newRootPageID;
-				BTIndexPage* newRootPage;
+				PageGuard<BTIndexPage> newRootPage;
 				RecordID newRid;
-				NEWPAGE(newRootPageID, (Page *&)newRootPage, 1);
+				NEWNODE_GUARD(INVALID_PAGE, newRootPageID, newRootPage);
+				newRootPage.SetDirty();
 				newRootPage->SetType(INDEX_NODE);
 				newRootPage->Init(newRootPageID);
 
 				newRootPage->SetLeftLink(rootPageID);
 				newRootPage->Insert(newKey, newPid, newRid); 
+				KeyRelease(newKey);
 				header->SetRootPageID(newRootPageID);
+				header.SetDirty();
+				pinnedStale = true;
 
 				//PrintTree(newRootPageID, SINGLE);
+			}
+			delete [] newKey;
+		}
+	}
+	return res;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::InitLeafPage
+//
+// Input   : page - a newly allocated page.
+//           pid - its page id.
+// Output  : None
+// Return  : OK always.
+// Purpose : Set up an empty leaf that stores RecordIDs the way this
+//           index does.
+//-------------------------------------------------------------------
+Status BTreeFile::InitLeafPage(BTLeafPage *page, PageID pid)
+{
+	page->Init(pid);
+	page->SetType(LEAF_NODE);
+	page->SetRidEncoding(header->GetRidEncoding());
+	return OK;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::NewNode
+//
+// Input   : pages - the pages reserved to take it from.
+//           after - the leaf the new node follows in the leaf chain, 0
+//                   for none, or INVALID_PAGE for an index node.
+//           site - the caller, PIN_SITE.
+// Output  : pid - the new page.
+//           page - pinned, its contents undefined.
+// Return  : OK if successful, FAIL otherwise.
+// Purpose : Allocate a page for a node from pages the file has
+//           reserved, reserving another extent when it needs one.  A
+//           leaf takes the first reserved page after the leaf before
+//           it, so leaves split off in turn lie in order on disk, and
+//           a scan of them reads forward.  Index nodes take the last,
+//           out of the leaves' way.
+//-------------------------------------------------------------------
+Status BTreeFile::NewNode(std::set<PageID>& pages, PageID after, PageID& pid,
+						  PinGuard& page, const char *site)
+{
+	std::set<PageID>::iterator it;
+
+	if (after == INVALID_PAGE) {
+		if (pages.empty())
+			ReserveExtent(pages);
+		it = pages.empty() ? pages.end() : std::prev(pages.end());
+	} else {
+		//	Sooner than go back, reserve more, while less than an
+		//	extent is left.
+		it = pages.upper_bound(after);
+		if (it == pages.end() && (int)pages.size() < BTREE_EXTENT_PAGES &&
+			ReserveExtent(pages) == OK)
+			it = pages.upper_bound(after);
+		if (it == pages.end())
+			it = pages.begin();
+	}
+
+	//	No extent to be had: a page from wherever there is one.
+	if (it == pages.end())
+		return MINIBASE_BM->NewPage(pid, page, site);
+
+	pid = *it;
+	pages.erase(it);
+	if (MINIBASE_BM->PinNewPage(pid, page, site) != OK) {
+		pages.insert(pid);
+		return FAIL;
+	}
+	SaveReserved();
+	return OK;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::ReserveExtent
+//
+// Input   : pages - the pages reserved, to add them to.
+// Output  : None
+// Return  : OK if successful, FAIL if the database has no free page.
+// Purpose : Reserve BTREE_EXTENT_PAGES consecutive pages, or as many
+//           as there are together if fewer, for new nodes.
+//-------------------------------------------------------------------
+Status BTreeFile::ReserveExtent(std::set<PageID>& pages)
+{
+	int freePages, numExtents, longest;
+	PageID start;
+
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+	int n = std::min(longest, BTREE_EXTENT_PAGES);
+	if (n == 0 || MINIBASE_DB->AllocatePage(start, n) != OK)
+		return FAIL;
+
+	for (int i = 0; i < n; i++)
+		pages.insert(start + i);
+	SaveReserved();
+	return OK;
+}
+
+// Give reserved pages back to the database, a run at a time.
+void BTreeFile::ReleaseReserved(std::set<PageID>& pages)
+{
+	bool any = !pages.empty();
+
+	while (!pages.empty()) {
+		std::set<PageID>::iterator it = pages.begin();
+		PageID start = *it;
+		int n = 0;
+
+		while (it != pages.end() && *it == start + n) {
+			it = pages.erase(it);
+			n++;
+		}
+		MINIBASE_DB->DeallocatePage(start, n);
+	}
+	if (any)
+		SaveReserved();
+}
+
+// A run of consecutive reserved pages, and the set it is in.
+struct PageRun {
+	PageID start;
+	int n;
+	std::set<PageID> *pages;
+};
+
+// Append the runs of consecutive pages in pages to runs.
+static void FindRuns(std::set<PageID>& pages, std::vector<PageRun>& runs)
+{
+	std::set<PageID>::iterator it = pages.begin();
+
+	while (it != pages.end()) {
+		PageRun run = { *it, 0, &pages };
+		for (; it != pages.end() && *it == run.start + run.n; ++it)
+			run.n++;
+		runs.push_back(run);
+	}
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::SaveReserved
+//
+// Input   : None
+// Output  : None
+// Return  : None
+// Purpose : Record the runs of reserved pages in the header page, the
+//           longest BTREE_MAX_RESERVED_RUNS of them; the rest are given
+//           back to the database, so that no page is reserved without
+//           the header knowing.
+//-------------------------------------------------------------------
+void BTreeFile::SaveReserved()
+{
+	std::vector<PageRun> runs;
+
+	if (!header.IsPinned())
+		return;
+
+	FindRuns(reserved, runs);
+	FindRuns(reorgReserved, runs);
+	if ((int)runs.size() > BTREE_MAX_RESERVED_RUNS) {
+		std::stable_sort(runs.begin(), runs.end(),
+			[](const PageRun& a, const PageRun& b) { return a.n > b.n; });
+		for (size_t r = BTREE_MAX_RESERVED_RUNS; r < runs.size(); r++) {
+			for (int i = 0; i < runs[r].n; i++)
+				runs[r].pages->erase(runs[r].start + i);
+			MINIBASE_DB->DeallocatePage(runs[r].start, runs[r].n);
+		}
+		runs.resize(BTREE_MAX_RESERVED_RUNS);
+	}
+
+	header->SetNumOfReservedRuns((int)runs.size());
+	for (size_t r = 0; r < runs.size(); r++) {
+		header->ReservedRun((int)r)[0] = runs[r].start;
+		header->ReservedRun((int)r)[1] = runs[r].n;
+	}
+	header.SetDirty();
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::LoadReserved
+//
+// Input   : None
+// Output  : None
+// Return  : None
+// Purpose : Take back the pages the header page says are reserved,
+//           which a file that was not closed never gave back.  A run
+//           that does not lie within the database is ignored.
+//-------------------------------------------------------------------
+void BTreeFile::LoadReserved()
+{
+	int numRuns = header->GetNumOfReservedRuns();
+
+	if (numRuns < 0 || numRuns > BTREE_MAX_RESERVED_RUNS)
+		numRuns = 0;
+	for (int r = 0; r < numRuns; r++) {
+		PageID start = header->ReservedRun(r)[0];
+		int n = header->ReservedRun(r)[1];
+		if (start < 0 || n < 1 || n > BTREE_EXTENT_PAGES ||
+			start + n > MINIBASE_DB->GetNumOfPages())
+			continue;
+		for (int i = 0; i < n; i++)
+			reserved.insert(start + i);
+	}
+	SaveReserved();
+}
 
-				UNPIN(newRootPageID, DIRTY);	
+//-------------------------------------------------------------------
+// BTreeFile::Reorganize
+//
+// Input   : targetFill - how full to make each leaf, as a fraction of
+//                        a page.
+//           batchLeaves - most leaves to rewrite in one step.
+// Output  : None
+// Return  : OK if successful, FAIL otherwise.
+// Purpose : Rewrite all the leaves, a ReorganizeStep at a time, from
+//           the first.
+//-------------------------------------------------------------------
+Status BTreeFile::Reorganize(float targetFill, int batchLeaves)
+{
+	Status s;
+
+	reorgRunning = false;
+	while ((s = ReorganizeStep(targetFill, batchLeaves)) == OK)
+		;
+	return s == DONE ? OK : FAIL;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::FillLeaves
+//
+// Input   : old - the leaves of a batch, pinned.
+//           budget - most bytes of entries to put in a new leaf.
+// Output  : fresh - new leaves, pinned, holding copies of old's
+//                   entries in order.
+// Return  : OK if successful, FAIL otherwise, with what fresh holds
+//           still to be discarded.
+// Purpose : Copy the entries of a batch into new leaves taken one
+//           after another from the step's extents.  An entry coded
+//           again relative to a new leaf's base may grow, so one that
+//           does not fit starts a leaf even within budget.  The old
+//           leaves are not changed.
+//-------------------------------------------------------------------
+Status BTreeFile::FillLeaves(std::vector< PageGuard<BTLeafPage> >& old, int budget,
+							 std::vector< PageGuard<BTLeafPage> >& fresh)
+{
+	PageID after = reorgLast;
+	int used = 0;
+
+	for (size_t j = 0; j < old.size(); j++) {
+		for (int i = 0; i < old[j]->GetNumOfRecords(); i++) {
+			int size = old[j]->GetEntrySpace(i);
+			bool copied = false;
+
+			if (!fresh.empty() && (used == 0 || used + size <= budget)) {
+				int before = fresh.back()->GetNumOfRecords();
+				copied = old[j]->CopyEntry(i, fresh.back().Get()) == OK;
+
+				//	In, but its key could not be retained.
+				if (!copied && fresh.back()->GetNumOfRecords() != before)
+					return FAIL;
+			}
+			if (!copied) {
+				PageID newPid;
+				fresh.push_back(PageGuard<BTLeafPage>());
+				if (NewNode(reorgReserved, after, newPid, fresh.back(), PIN_SITE) != OK) {
+					fresh.pop_back();
+					return FAIL;
+				}
+				InitLeafPage(fresh.back().Get(), newPid);
+				after = newPid;
+				used = 0;
+				if (old[j]->CopyEntry(i, fresh.back().Get()) != OK)
+					return FAIL;
 			}
+			used += size;
 		}
-		UNPIN(rootPageID, DIRTY);
 	}
+	return OK;
+}
+
+// Give the pages of new leaves a step will not use back to its
+// extents, dropping the references their entries hold on long keys.
+void BTreeFile::DiscardLeaves(std::vector< PageGuard<BTLeafPage> >& fresh)
+{
+	for (size_t m = 0; m < fresh.size(); m++) {
+		PageID pid = fresh[m].GetPageID();
+		fresh[m]->ReleaseKeys();
+		fresh[m].Unpin();
+		reorgReserved.insert(pid);
+	}
+	if (!fresh.empty())
+		SaveReserved();
+	fresh.clear();
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::ReorganizeStep
+//
+// Input   : targetFill, batchLeaves - as for Reorganize.
+// Output  : None
+// Return  : OK if there are leaves left to do, DONE once the last is
+//           done, FAIL otherwise.
+// Purpose : Rewrite the next batch of leaves, sibling leaves from the
+//           one the last step stopped at, or from the first if no pass
+//           is running.  Their entries move, in order, into new leaves
+//           taken one after another from the file's extents, filled to
+//           targetFill, or full if the parent has no room for that many
+//           leaves.  The parent and the leaves either side are pointed
+//           at the new leaves, and the old ones are freed.  A batch the
+//           parent has no room for even so is left as it is, as is one
+//           whose new leaves cannot all be had, their pages going back
+//           to the extents.
+//-------------------------------------------------------------------
+Status BTreeFile::ReorganizeStep(float targetFill, int batchLeaves)
+{
+	MetricsScope scope(metricsFile);
+	PageGuard<SortedPage> parent;
+	PageID leafPid;
+	ProbeKeyType key;
+	RecordID rid;
+	Status s;
+	bool resumed = reorgRunning;
+
+	if (!header.IsPinned() || targetFill <= 0 || batchLeaves < 1)
+		return FAIL;
+
+	//	A new pass starts in a new extent.
+	if (!reorgRunning) {
+		ReleaseReserved(reorgReserved);
+		reorgLast = 0;
+		s = FindLeafParent(NULL, parent, leafPid);
+	} else {
+		ProbeKey(key, reorgNext.c_str());
+		s = FindLeafParent(key, parent, leafPid);
+	}
+	if (s != OK)
+		return FAIL;
+
+	//	A tree of one leaf has nothing to put in order.
+	reorgRunning = false;
+	if (!parent.IsPinned())
+		return DONE;
+
+	//	The batch: the leaf to start with and the siblings after it.
+	BTIndexPage *index = (BTIndexPage *)parent.Get();
+	std::vector<PageID> children(1, index->GetLeftLink());
+	PageID childPid;
+	for (s = index->GetFirst(rid, key, childPid); s == OK; s = index->GetNext(rid, key, childPid))
+		children.push_back(childPid);
+
+	int first = std::find(children.begin(), children.end(), leafPid) - children.begin();
+	if (first == (int)children.size())
+		return FAIL;
+	int last = std::min((int)children.size(), first + batchLeaves);
+	std::vector< PageGuard<BTLeafPage> > old(last - first);
+	std::vector<int> sizes;
+	for (int c = first; c < last; c++) {
+		BTLeafPage *leaf;
+		PIN_GUARD(children[c], old[c - first]);
+		leaf = old[c - first].Get();
+		for (int i = 0; i < leaf->GetNumOfRecords(); i++)
+			sizes.push_back(leaf->GetEntrySpace(i));
+	}
+	PageID prevPid = old.front()->GetPrevPage();
+	PageID nextPid = old.back()->GetNextPage();
+
+	//	The new leaves are filled with copies of the entries before
+	//	anything shared changes, so a step that fails leaves the batch
+	//	as it was.  The first entry of each new leaf goes up to the
+	//	parent, for the old leaves' entries but the first's, which
+	//	still bounds the batch from below.
+	int capacity = BTLeafPage::EmptySpace();
+	int budget = targetFill >= 1 ? capacity : (int)(targetFill * capacity);
+	std::vector< PageGuard<BTLeafPage> > fresh;
+	bool fits = false;
+	for (int pass = 0; pass < 2 && !fits; pass++) {
+		if (FillLeaves(old, pass == 0 ? budget : capacity, fresh) != OK) {
+			DiscardLeaves(fresh);
+			return FAIL;
+		}
+
+		int room = index->GetFreeSpace();
+		for (int c = first + 1; c < last; c++)
+			room += index->GetEntrySpace(c - 1);
+		for (size_t m = 1; m < fresh.size(); m++)
+			room -= SortedPage::EntrySpace(GetKeyDataLength(fresh[m]->GetEntryKey(0), INDEX_NODE));
+		fits = room >= 0;
+		if (!fits)
+			DiscardLeaves(fresh);
+	}
+
+	PageGuard<BTLeafPage> prev, next;
+	if (fits && ((prevPid != INVALID_PAGE &&
+				  MINIBASE_BM->PinPage(prevPid, prev, PIN_SITE) != OK) ||
+				 (nextPid != INVALID_PAGE &&
+				  MINIBASE_BM->PinPage(nextPid, next, PIN_SITE) != OK))) {
+		DiscardLeaves(fresh);
+		return FAIL;
+	}
+
+	//	Nothing below needs room or a page it does not have.
+	Status end = OK;
+	if (fits) {
+		for (size_t m = 0; m < fresh.size(); m++) {
+			fresh[m]->SetPrevPage(m > 0 ? fresh[m - 1].GetPageID() : prevPid);
+			fresh[m]->SetNextPage(m + 1 < fresh.size() ? fresh[m + 1].GetPageID() : nextPid);
+			fresh[m].SetDirty();
+		}
+		if (prev.IsPinned()) {
+			prev->SetNextPage(fresh.front().GetPageID());
+			prev.SetDirty();
+		}
+		if (next.IsPinned()) {
+			next->SetPrevPage(fresh.back().GetPageID());
+			next.SetDirty();
+		}
+
+		//	The old leaves' entries in the parent are slots first to
+		//	last - 2, after the left link.
+		rid.pageNo = parent.GetPageID();
+		rid.slotNo = first;
+		for (int c = first + 1; c < last; c++) {
+			if (index->DeleteRecord(rid) != OK)
+				end = FAIL;
+		}
+		if (first == 0) {
+			index->SetLeftLink(fresh.front().GetPageID());
+		} else {
+			KeyCopy(key, index->GetEntryKey(first - 1));
+			KeyRetain(key);
+			rid.slotNo = first - 1;
+			if (index->DeleteRecord(rid) != OK ||
+				index->Insert(key, fresh.front().GetPageID(), rid) != OK)
+				end = FAIL;
+			KeyRelease(key);
+		}
+		for (size_t m = 1; m < fresh.size(); m++) {
+			if (index->Insert(fresh[m]->GetEntryKey(0), fresh[m].GetPageID(), rid) != OK)
+				end = FAIL;
+		}
+		parent.SetDirty();
+
+		//	The new leaves hold the overflow chains and key references
+		//	now; the old pages go without them.
+		for (size_t j = 0; j < old.size(); j++) {
+			if (old[j]->ReleaseKeys() != OK)
+				end = FAIL;
+			FREE_GUARD(old[j]);
+		}
+		reorgLast = fresh.back().GetPageID();
+		reorgEpoch++;
+		updateEpoch++;
+	}
+	prev.Unpin();
+	next.Unpin();
+	if (end != OK)
+		return FAIL;
+
+	//	Go on from the first key of the next leaf holding one.
+	while (nextPid != INVALID_PAGE) {
+		PIN_GUARD(nextPid, next);
+		if (next->GetNumOfRecords() > 0) {
+			const char *nextKey = next->GetEntryKey(0);
+			std::vector<char> fullKey(GetFullKeyLength(nextKey));
+			if (GetFullKey(fullKey.data(), nextKey) != OK)
+				return FAIL;
+
+			//	Keys out of order in the index would bring the pass back
+			//	to where it was, for ever.
+			if (resumed && reorgNext.compare(fullKey.data()) >= 0)
+				return FAIL;
+			reorgNext.assign(fullKey.data());
+			reorgRunning = true;
+			return OK;
+		}
+		nextPid = next->GetNextPage();
+	}
+	ReleaseReserved(reorgReserved);
+	return DONE;
+}
+
+//-------------------------------------------------------------------
+// BTreeFile::FindLeafParent
+//
+// Input   : key - a key as stored, or NULL for the first leaf.
+// Output  : parent - the index node over the leaf key belongs on,
+//                    pinned, or empty if the root is a leaf.
+//           leafPid - that leaf.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+Status BTreeFile::FindLeafParent(const char *key, PageGuard<SortedPage>& parent, PageID& leafPid)
+{
+	PageGuard<SortedPage> node;
+	bool leftMost;
+
+	parent.Unpin();
+	leafPid = header->GetRootPageID();
+	if (leafPid == INVALID_PAGE)
+		return OK;
+
+	PIN_GUARD(leafPid, node);
+	while (node->GetType() == INDEX_NODE) {
+		parent = std::move(node);
+		BTIndexPage *index = (BTIndexPage *)parent.Get();
+		if (key == NULL)
+			leafPid = index->GetLeftLink();
+		else
+			index->FindPage(key, leafPid, leftMost);
+		PIN_GUARD(leafPid, node);
+	}
+	return OK;
 }
 
 //splits leafPageID into 1 root page, 2 leaf pages; returns newRootPageID
 Status BTreeFile::Split1LeafNode(PageID leafPageID, PageID& newRootPageID, const char *newKey, const RecordID newRid) {
-	BTIndexPage* newRootPage; BTLeafPage *leafPage; BTLeafPage* newLeafPage;
+	PageGuard<BTIndexPage> newRootPage; PageGuard<BTLeafPage> leafPage; PageGuard<BTLeafPage> newLeafPage;
 	PageID newLeafPageID; //PageID newRootPageID;
 	 
 	int originalLeafAvailableSpace=0; int originalLeafUsedSpace=0;
@@ -296,16 +1005,16 @@ Status BTreeFile::Split1LeafNode(PageID leafPageID, PageID& newRootPageID, const
 	RecordID rid; char* key; RecordID keyRecordID; Status s=OK;
 	RecordID validrid; char* validkey; RecordID validkeyRecordID;
 
-	//Status NewPage( PageID& pid, Page*& firstpage,int howmany=1); //pin firstpage.Returns firstpage, pointer to page pinned in buffer
-	NEWPAGE(newRootPageID, (Page *&)newRootPage, 1);
+	NEWNODE_GUARD(INVALID_PAGE, newRootPageID, newRootPage);
+		newRootPage.SetDirty();
 		newRootPage->SetType(INDEX_NODE);
 		newRootPage->Init(newRootPageID);
-	NEWPAGE(newLeafPageID, (Page *&)newLeafPage, 1);
-		newLeafPage->SetType(LEAF_NODE);
-		newLeafPage->Init(newLeafPageID);
-	PIN(leafPageID, (Page *&)leafPage);
+	NEWNODE_GUARD(0, newLeafPageID, newLeafPage);
+		newLeafPage.SetDirty();
+		InitLeafPage(newLeafPage.Get(), newLeafPageID);
+	PIN_GUARD(leafPageID, leafPage);
+	leafPage.SetDirty();
 
-	newLeafPage->SetType(LEAF_NODE);	newLeafPage->Init(newLeafPageID);
 	newRootPage->SetType(INDEX_NODE);	newRootPage->Init(newRootPageID);
 	originalLeafAvailableSpace= leafPage->AvailableSpace();
 	originalLeafUsedSpace= HEAPPAGE_DATA_SIZE-originalLeafAvailableSpace;
@@ -315,20 +1024,12 @@ Status BTreeFile::Split1LeafNode(PageID leafPageID, PageID& newRootPageID, const
 	//get the first pair (key, dataRid) in the leaf page and its rid.
 	key=new char[MAX_KEY_SIZE];
 
-	leafPage->GetFirst(rid,key,keyRecordID); //return rid,key,keyRecordID
-	s= newLeafPage->Insert(key,keyRecordID,rid);//Output: rid - record id of the inserted pair (key, dataRid)
-	if(s!=OK) newLeafPage->Delete(key,keyRecordID);
-	if(s==OK) leafPage->Delete(key,keyRecordID);
-
-	s=leafPage->GetFirst(rid,key,keyRecordID); //OK if there's next record, DONE if no more. DONE returns last valid key value
+	//move whole entries, so that all RecordIDs of a key stay on one leaf
+	s= leafPage->MoveFirst(newLeafPage.Get());
 	while((newLeafAvailableSpace=newLeafPage->AvailableSpace())>(originalLeafAvailableSpace=leafPage->AvailableSpace())
-		&& s!=DONE){
-			s= newLeafPage->Insert(key,keyRecordID,rid);//Output: rid - record id of the inserted pair (key, dataRid)
-			validrid=rid; validkeyRecordID= keyRecordID; //validkey=key;
-			if(s!=OK) newLeafPage->Delete(key,keyRecordID);
-			if(s==OK) leafPage->Delete(key,keyRecordID);
-			s= leafPage->GetFirst(rid,key,keyRecordID); //OK if there's next record, DONE if no more. DONE returns last valid key value
-	} //last key inserted into new leaf is the key in middle of original leaf node
+		&& s==OK){
+			s= leafPage->MoveFirst(newLeafPage.Get());
+	} //last key moved into new leaf is the key in middle of original leaf node
 
 	s = leafPage->GetFirst(rid, key, keyRecordID);
 	if (KeyCmp(newKey, key) >= 0) {
@@ -346,51 +1047,44 @@ Status BTreeFile::Split1LeafNode(PageID leafPageID, PageID& newRootPageID, const
 	newLeafPage->SetNextPage(leafPageID);
 	leafPage->SetPrevPage(newLeafPageID);
 
-	UNPIN(leafPageID, DIRTY);
-	UNPIN(newRootPageID, DIRTY);
-	UNPIN(newLeafPageID, DIRTY);
-
-
 	return OK;
 }
 
-Status BTreeFile::_Insert(PageID nodePid, const char *targetKey, 
+Status BTreeFile::_Insert(PageID nodePid, ClockFrame *parent, const char *targetKey, 
 const RecordID targetId, PageID& newPid, char *newKey)
 {
 	RecordID tempRid;
 	Status res;
 	Status s;
 
-	SortedPage *nodePage;
-	PIN(nodePid, (Page *&)nodePage);
+	PageGuard<SortedPage> nodePage;
+	newPid = INVALID_PAGE;
+	if (PinNode(parent, nodePid, nodePage, PIN_SITE) != OK)
+		return FAIL;
+	nodePage.SetDirty();
 	NodeType nodeType = nodePage->GetType();
 
 	if (nodeType == LEAF_NODE) {
 		BTLeafPage *leafPage;
 		RecordID leafRid;
-		leafPage=(BTLeafPage* &)nodePage;
+		leafPage=(BTLeafPage *)nodePage.Get();
 
-		if (leafPage->AvailableSpace() >= GetKeyDataLength(targetKey, nodeType)) {
-			res = leafPage->Insert(targetKey, targetId, leafRid);
-			newPid = INVALID_PAGE;
-			UNPIN(nodePid, DIRTY);
-			return res;
+		if (leafPage->Insert(targetKey, targetId, leafRid) == OK) {
+			return OK;
 		} else {
-			BTLeafPage* newLeafPage;
+			PageGuard<BTLeafPage> newLeafPage;
 			PageID newLeafPid;
-			NEWPAGE(newLeafPid, (Page *&)newLeafPage, 1);
-			newLeafPage->SetType(LEAF_NODE);
-			newLeafPage->Init(newLeafPid);
+			NEWNODE_GUARD(nodePid, newLeafPid, newLeafPage);
+			newLeafPage.SetDirty();
+			InitLeafPage(newLeafPage.Get(), newLeafPid);
 
 			RecordID rid;
 			RecordID keyRecordID;
 			char *key=new char[MAX_KEY_SIZE];
 
-			s = leafPage->GetLast(rid,key,keyRecordID);
-			while(newLeafPage->AvailableSpace() > leafPage->AvailableSpace() && s != DONE){
-				s= newLeafPage->Insert(key, keyRecordID, rid);
-				leafPage->Delete(key,keyRecordID);
-				s = leafPage->GetLast(rid,key,keyRecordID);
+			s = OK;
+			while(newLeafPage->AvailableSpace() > leafPage->AvailableSpace() && s == OK){
+				s = leafPage->MoveLast(newLeafPage.Get());
 			}
 
 			s = newLeafPage->GetFirst(rid, key, keyRecordID);
@@ -401,27 +1095,27 @@ const RecordID targetId, PageID& newPid, char *newKey)
 				res = leafPage->Insert(targetKey, targetId, leafRid);
 			}
 			s = newLeafPage->GetFirst(rid, key, keyRecordID);
-			strcpy(newKey, key);
+			// newKey goes up to the parent with its own reference,
+			// which the caller drops once it is inserted there.
+			KeyCopy(newKey, key);
+			KeyRetain(newKey);
 			newPid = newLeafPid;
 
 			PageID nnPid = leafPage->GetNextPage();
 			if (nnPid != INVALID_PAGE) {
-				BTLeafPage *nnPage;
-				PIN(nnPid, (Page *&)nnPage);
+				PageGuard<BTLeafPage> nnPage;
+				PIN_GUARD(nnPid, nnPage);
 				nnPage->SetPrevPage(newLeafPid);
-				UNPIN(nnPid, DIRTY);
+				nnPage.SetDirty();
 			}
 			newLeafPage->SetNextPage(nnPid);
 			newLeafPage->SetPrevPage(nodePid);
 			leafPage->SetNextPage(newLeafPid);
-
-			UNPIN(nodePid, DIRTY);
-			UNPIN(newLeafPid, DIRTY);
 			return res;
 		}
 
 	} else {
-		BTIndexPage * indexPage = (BTIndexPage *) nodePage;
+		BTIndexPage * indexPage = (BTIndexPage *) nodePage.Get();
 
 		PageID targetPid;
 		bool leftMost;
@@ -429,27 +1123,26 @@ const RecordID targetId, PageID& newPid, char *newKey)
 
 		PageID tempNewPid;
 		char *tempNewKey = new char[MAX_KEY_SIZE];
-		res = _Insert(targetPid, targetKey, targetId, tempNewPid, tempNewKey);
+		res = _Insert(targetPid, nodePage.GetFrame(), targetKey, targetId, tempNewPid, tempNewKey);
 		
 		if (tempNewPid == INVALID_PAGE) {
-			newPid = INVALID_PAGE;
-			UNPIN(nodePid, DIRTY);
 			return res;
 		}
 
 		if (indexPage->AvailableSpace() >= GetKeyDataLength(tempNewKey, nodeType)) {
 			RecordID rid;
 			res = indexPage->Insert(tempNewKey, tempNewPid, rid);
-			newPid = INVALID_PAGE;
-			UNPIN(nodePid, DIRTY);
+			KeyRelease(tempNewKey);
 			return res;
 		} else {
 			PageID newIndexPid;
-			BTIndexPage* newIndexPage;
+			PageGuard<BTIndexPage> newIndexPage;
 			RecordID rid;
-			NEWPAGE(newIndexPid, (Page *&)newIndexPage, 1);
+			NEWNODE_GUARD(INVALID_PAGE, newIndexPid, newIndexPage);
+			newIndexPage.SetDirty();
 			newIndexPage->SetType(INDEX_NODE);
 			newIndexPage->Init(newIndexPid);
+			pinnedStale = true;
 
 			RecordID keyRecordID;
 			PageID cPid;
@@ -463,20 +1156,20 @@ const RecordID targetId, PageID& newPid, char *newKey)
 			}
 
 			s = newIndexPage->GetFirst(rid, cKey, cPid);
+			KeyRetain(cKey);
 			newIndexPage->Delete(cKey, rid);
 			newIndexPage->SetLeftLink(cPid);
 
-			strcpy(newKey, cKey);
+			KeyCopy(newKey, cKey);
 
 			if (KeyCmp(tempNewKey, newKey) >= 0) {
 				res = newIndexPage->Insert(tempNewKey, tempNewPid, rid);
 			} else {
 				res = indexPage->Insert(tempNewKey, tempNewPid, rid);
 			}
+			KeyRelease(tempNewKey);
 
 			newPid = newIndexPid;
-			UNPIN(nodePid, DIRTY);
-			UNPIN(newIndexPid, DIRTY);
 			return res;
 		}
 	}
@@ -496,7 +1189,22 @@ const RecordID targetId, PageID& newPid, char *newKey)
 
 Status BTreeFile::Delete (const char *key, const RecordID rid)
 {
-	SortedPage* rootPage; 
+	ProbeKeyType probeKey;
+	Status res;
+	MetricsScope scope(metricsFile);
+
+	ProbeKey(probeKey, key);
+	updateEpoch++;
+	res = _DeleteKey(probeKey, rid);
+	if (pinnedStale && PinUpperLevels() != OK)
+		res = FAIL;
+	return res;
+}
+
+// Delete with key already in the form ProbeKey makes, or stored.
+Status BTreeFile::_DeleteKey (const char *key, const RecordID rid)
+{
+	PageGuard<SortedPage> rootPage;
 	PageID rootPid;
 	Status s = OK;
 	Status res;
@@ -504,23 +1212,27 @@ Status BTreeFile::Delete (const char *key, const RecordID rid)
 	char *key2; RecordID rid2; RecordID keyRecordID;
 
 	rootPid = header->GetRootPageID();
-	PIN(rootPid, (Page *&)rootPage);
+	if (rootPid == INVALID_PAGE)
+		return FAIL;
+	PIN_GUARD(rootPid, rootPage);
+	rootPage.SetDirty();
 
  	type = rootPage->GetType();
 	if (type == LEAF_NODE) {
-		BTLeafPage *leafPage = (BTLeafPage *)rootPage;
+		BTLeafPage *leafPage = (BTLeafPage *)rootPage.Get();
 
 		res = leafPage->Delete(key, rid);
 
 		if (leafPage->GetNumOfRecords() == 0) {
 			header->SetRootPageID(INVALID_PAGE);
+			header.SetDirty();
+			FREE_GUARD(rootPage);
+			reorgEpoch++;
 		}
-
-		UNPIN(rootPid,DIRTY);
 		return res;
 	} else {
 		PageID childPid;
-		BTIndexPage *indexPage =(BTIndexPage *)rootPage;
+		BTIndexPage *indexPage =(BTIndexPage *)rootPage.Get();
 		
 		PageID oldPid;
 		bool rightSibling;
@@ -528,7 +1240,6 @@ Status BTreeFile::Delete (const char *key, const RecordID rid)
 		res = _Delete(rootPid, childPid, key, rid, oldPid, rightSibling);
 
 		if (res == FAIL) {
-			UNPIN(rootPid,DIRTY);
 			return FAIL;
 		}
 
@@ -537,13 +1248,18 @@ Status BTreeFile::Delete (const char *key, const RecordID rid)
 			PageID firstPid;
 			key2 = new char[MAX_KEY_SIZE];
 			s = indexPage->GetFirst(rid2, key2, firstPid);
+			delete [] key2;
 			if (s == DONE) {
 				firstPid = indexPage->GetLeftLink();
 				header->SetRootPageID(firstPid);
+				header.SetDirty();
+
+				//	The old root is pinned among the top levels too.
+				UnpinUpperLevels();
+				pinnedStale = true;
+				FREE_GUARD(rootPage);
 			}
-			delete key2;
 		}
-		UNPIN(rootPid,DIRTY);
 		return res;
 	}
 }
@@ -554,29 +1270,30 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 	Status res;
 	Status s;
 
-	BTIndexPage *parentPage;
-	PIN(parentPid, (Page *&)parentPage);
+	// Each page is unpinned on the way out, dirty if it was changed.
+	oldPid = INVALID_PAGE;
+	PageGuard<BTIndexPage> parentPage;
+	PIN_GUARD(parentPid, parentPage);
 	
-	SortedPage *nodePage;
-	PIN(nodePid, (Page *&)nodePage);
+	PageGuard<SortedPage> nodePage;
+	PIN_GUARD(nodePid, nodePage);
 	NodeType nodeType = nodePage->GetType();
 
 	if (nodeType == LEAF_NODE) {
-		BTLeafPage * nodePageL = (BTLeafPage *) nodePage;
+		BTLeafPage * nodePageL = (BTLeafPage *) nodePage.Get();
 		res = nodePageL->Delete(key, rid);
+		nodePage.SetDirty();
 
 		if (res == FAIL || nodePageL->AvailableSpace() <= HEAPPAGE_DATA_SIZE/2) {
-			oldPid = INVALID_PAGE;
-			UNPIN(parentPid, DIRTY);
-			UNPIN(nodePid, DIRTY);
 			return res;
 		}
 
 		PageID siblingPid;
 		parentPage->FindSiblingForChild(nodePid, siblingPid, rightSibling);
 
-		BTLeafPage *siblingPage;
-		PIN(siblingPid, (Page *&)siblingPage);
+		PageGuard<BTLeafPage> siblingPage;
+		PIN_GUARD(siblingPid, siblingPage);
+		siblingPage.SetDirty();
 
 		char* oldParentKey = new char[MAX_KEY_SIZE];
 		RecordID tempDrid;
@@ -591,16 +1308,11 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 		// redistribute
 		while(nodePageL->AvailableSpace() > HEAPPAGE_DATA_SIZE/2) {
 			if (rightSibling) {
-				s = siblingPage->GetFirst(tempRid, tempKey, tempDrid);
-				s = nodePageL->Insert(tempKey, tempDrid, tempRid);
-				if(s == OK) siblingPage->Delete(tempKey, tempDrid);
+				s = siblingPage->MoveFirst(nodePageL);
 			} else {
-				s = siblingPage->GetLast(tempRid,tempKey,tempDrid);
-				s= nodePageL->Insert(tempKey, tempDrid, tempRid);
-				if(s == OK) {
-					siblingPage->Delete(tempKey, tempDrid);
-				}
+				s = siblingPage->MoveLast(nodePageL);
 			}
+			if (s != OK) break;
 		}
 
 		// redistribution successful
@@ -611,58 +1323,62 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 				s = nodePageL->GetFirst(tempRid, tempKey, tempDrid);
 			}
 			parentPage->AdjustKey(tempKey, oldParentKey);
-			oldPid = INVALID_PAGE;
-			UNPIN(parentPid, DIRTY);
-			UNPIN(nodePid, DIRTY);
-			UNPIN(siblingPid, DIRTY);
+			parentPage.SetDirty();
 			return res;
 		} else {
+			// merge.  Entries coded again for this leaf's base may not
+			// all fit after all; those that do still move, from the
+			// end nearest this leaf, and the rest stay.
 			if (siblingPage->AvailableSpace() + nodePageL->AvailableSpace() >= HEAPPAGE_DATA_SIZE) {
-				// merge
-				while (true) {
-					s = siblingPage->GetFirst(tempRid, tempKey, tempDrid);
-					if(s == OK) {
-						s = nodePageL->Insert(tempKey, tempDrid, tempRid);
-						siblingPage->Delete(tempKey, tempDrid);
-					} else if (s == DONE) {
-						break;
-					};
+				if (rightSibling) {
+					while (siblingPage->MoveFirst(nodePageL) == OK)
+						;
+				} else {
+					while (siblingPage->MoveLast(nodePageL) == OK)
+						;
 				}
+			}
+			if (siblingPage->GetNumOfRecords() == 0) {
 				if (rightSibling) {
 					PageID nnPid = siblingPage->GetNextPage();
 					if (nnPid != INVALID_PAGE) {
-						BTLeafPage *nnPage;
-						PIN(nnPid, (Page *&)nnPage);
+						PageGuard<BTLeafPage> nnPage;
+						PIN_GUARD(nnPid, nnPage);
 						nnPage->SetPrevPage(nodePid);
-						UNPIN(nnPid, DIRTY);
+						nnPage.SetDirty();
 					}
 					nodePageL->SetNextPage(nnPid);
 				} else {
 					PageID ppPid = siblingPage->GetPrevPage();
 					if (ppPid != INVALID_PAGE) {
-						BTLeafPage *ppPage;
-						PIN(ppPid, (Page *&)ppPage);
+						PageGuard<BTLeafPage> ppPage;
+						PIN_GUARD(ppPid, ppPage);
 						ppPage->SetNextPage(nodePid);
-						UNPIN(ppPid, DIRTY);
+						ppPage.SetDirty();
 					}
 					nodePageL->SetPrevPage(ppPid);
 				}
 				oldPid = siblingPid;
-				UNPIN(parentPid, DIRTY);
-				UNPIN(nodePid, DIRTY);
-				UNPIN(siblingPid, DIRTY);
 
+				//	A scan on the sibling finds its place again.
+				FREE_GUARD(siblingPage);
+				reorgEpoch++;
 				return res;
 			} else {
-				oldPid = INVALID_PAGE;
-				UNPIN(parentPid, DIRTY);
-				UNPIN(nodePid, DIRTY);
-				UNPIN(siblingPid, DIRTY);
+				// Entries may have moved even though neither page ends up
+				// half full; the separator must follow them.
+				if (rightSibling) {
+					s = siblingPage->GetFirst(tempRid, tempKey, tempDrid);
+				} else {
+					s = nodePageL->GetFirst(tempRid, tempKey, tempDrid);
+				}
+				parentPage->AdjustKey(tempKey, oldParentKey);
+				parentPage.SetDirty();
 				return res;
 			}
 		}
 	} else {
-		BTIndexPage * nodePageI = (BTIndexPage *) nodePage;
+		BTIndexPage * nodePageI = (BTIndexPage *) nodePage.Get();
 
 		PageID targetPid;
 		bool leftMost;
@@ -674,27 +1390,23 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 		res = _Delete(nodePid, targetPid, key, rid, tempOldPid, tempRightSibling);
 
 		if (res == FAIL || tempOldPid == INVALID_PAGE) {
-			oldPid = INVALID_PAGE;
-			UNPIN(parentPid, CLEAN);
-			UNPIN(nodePid, CLEAN);
 			return res;
 		}
 
 		nodePageI->DeletePage(tempOldPid, tempRightSibling);
+		nodePage.SetDirty();
 
 		if (nodePageI->AvailableSpace() <= HEAPPAGE_DATA_SIZE/2) {
-			oldPid = INVALID_PAGE;
-			UNPIN(parentPid, CLEAN);
-			UNPIN(nodePid, DIRTY);
 			return res;
 		}
 
 		PageID siblingPid;
-		bool rightSibling;
 		parentPage->FindSiblingForChild(nodePid, siblingPid, rightSibling);
 
-		BTIndexPage *siblingPage;
-		PIN(siblingPid, (Page *&)siblingPage);
+		PageGuard<BTIndexPage> siblingPage;
+		PIN_GUARD(siblingPid, siblingPage);
+		siblingPage.SetDirty();
+		parentPage.SetDirty();
 
 		char *keyToAdjust = new char[MAX_KEY_SIZE];
 		if (rightSibling) {
@@ -710,14 +1422,14 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 				siblingPage->GetFirst(tempRid, tempKey, tempPid);
 				nodePageI->Insert(keyToAdjust, siblingPage->GetLeftLink(), tempRid);
 				parentPage->AdjustKey(tempKey, keyToAdjust);
-				keyToAdjust = tempKey;
+				KeyCopy(keyToAdjust, tempKey);
 				siblingPage->SetLeftLink(tempPid);
 				siblingPage->Delete(tempKey, tempRid);
 			} else {
 				s = siblingPage->GetLast(tempRid, tempKey, tempPid);
 				nodePageI->Insert(keyToAdjust, nodePageI->GetLeftLink(), tempRid);
 				parentPage->AdjustKey(tempKey, keyToAdjust);
-				keyToAdjust = tempKey;
+				KeyCopy(keyToAdjust, tempKey);
 				nodePageI->SetLeftLink(tempPid);
 				siblingPage->Delete(tempKey, tempRid);
 			}
@@ -725,13 +1437,12 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 
 		// redistribution successful
 		if (siblingPage->AvailableSpace() <= HEAPPAGE_DATA_SIZE/2) {
-			oldPid = INVALID_PAGE;
-			UNPIN(parentPid, DIRTY);
-			UNPIN(nodePid, DIRTY);
-			UNPIN(siblingPid, DIRTY);
 			return res;
 		} else {
-			if (siblingPage->AvailableSpace() + nodePageI->AvailableSpace() >= HEAPPAGE_DATA_SIZE) {
+			// The separator comes down into the merged page, and a long
+			// key's stub takes a good part of it.
+			int sepSpace = GetKeyDataLength(keyToAdjust, INDEX_NODE) + 2 * sizeof(short);
+			if (siblingPage->AvailableSpace() + nodePageI->AvailableSpace() >= HEAPPAGE_DATA_SIZE + sepSpace) {
 				// merge
 				while (true) {
 					if (rightSibling) {
@@ -741,7 +1452,7 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 							break;
 						}
 						parentPage->AdjustKey(tempKey, keyToAdjust);
-						keyToAdjust = tempKey;
+						KeyCopy(keyToAdjust, tempKey);
 						siblingPage->SetLeftLink(tempPid);
 						siblingPage->Delete(tempKey, tempRid);
 					} else {
@@ -753,7 +1464,7 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 							break;
 						} else {
 							parentPage->AdjustKey(tempKey, keyToAdjust);
-							keyToAdjust = tempKey;
+							KeyCopy(keyToAdjust, tempKey);
 							nodePageI->SetLeftLink(tempPid);
 							siblingPage->Delete(tempKey, tempRid);
 						}
@@ -763,28 +1474,30 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 				s = siblingPage->GetFirst(tempRid, tempKey, tempPid);
 				if (s == DONE) {
 					oldPid = siblingPid;
-					UNPIN(parentPid, DIRTY);
-					UNPIN(nodePid, DIRTY);
-					UNPIN(siblingPid, DIRTY);
-					return res;
-				} else {
-					oldPid = INVALID_PAGE;
-					UNPIN(parentPid, DIRTY);
-					UNPIN(nodePid, DIRTY);
-					UNPIN(siblingPid, DIRTY);
-					return res;
+
+					//	The sibling may be pinned among the top levels.
+					UnpinUpperLevels();
+					pinnedStale = true;
+					FREE_GUARD(siblingPage);
 				}
+				return res;
 			} else {
-				oldPid = INVALID_PAGE;
-				UNPIN(parentPid, DIRTY);
-				UNPIN(nodePid, DIRTY);
-				UNPIN(siblingPid, DIRTY);
 				return res;
 			}
 		}
 	}
 }
 
+// A key made by ProbeKey, followed by the copy of key it points into,
+// for deleting with delete [].
+static char *NewProbeKey(const char *key)
+{
+	char *probe = new char[PROBE_KEY_SIZE + strlen(key) + 1];
+	ProbeKey(probe, strcpy(probe + PROBE_KEY_SIZE, key));
+	return probe;
+}
+
+
 //-------------------------------------------------------------------
 // BTreeFile::OpenScan
 //
@@ -807,34 +1520,42 @@ Status BTreeFile::_Delete(PageID parentPid, PageID nodePid, const char *key, con
 
 IndexFileScan *BTreeFile::OpenScan (const char *lowKey, const char *highKey)
 {
-	RecordID rid; char* key; RecordID keyRecordID;
+	RecordID rid; RecordID keyRecordID;
 	RecordID validrid; char* validkey; RecordID validkeyRecordID;
 	Status s= OK;
 	PageID rootPageID;
-	PageID startPageID; BTLeafPage *startPage;
+	PageGuard<BTLeafPage> startPage;
 	BTreeFileScan* scan=new BTreeFileScan(); 
-
+	MetricsScope scope(metricsFile);
+
+	scan->metricsFile = metricsFile;
+	scan->file = this;
+	scan->reorgEpoch = reorgEpoch;
+	scan->updateEpoch = updateEpoch;
+	scan->cursor.leaf = INVALID_PAGE;
+	scan->started = false;
 	scan->setScanFirstTime(true);
+	scan->setScanPrefix(NULL);
+	scan->curKey[0] = '\0';
+	scan->strategy = NULL;
 
+	scan->setScanHighKey(NULL);
+	scan->setScanLowKey(NULL);
+	scan->setScanPid(INVALID_PAGE);
+
+	// The scan keeps both bounds in the form ProbeKey makes, each with
+	// a copy of the key it points into, and deletes them with itself.
 	if (highKey != NULL){
-		key = new char[MAX_KEY_SIZE];
-		key = strcpy(key, highKey);
-		scan->setScanHighKey(key);
-	} else {
-		scan->setScanHighKey(NULL);
+		scan->setScanHighKey(NewProbeKey(highKey));
 	}
 
 	if(lowKey!=NULL) {
-		key = new char[MAX_KEY_SIZE];
-		key = strcpy(key, lowKey);
-		scan->setScanLowKey(key);
-	} else {
-		scan->setScanLowKey(NULL);
+		lowKey = NewProbeKey(lowKey);
+		scan->setScanLowKey(lowKey);
 	}
 
-	if (header == NULL || headerID == INVALID_PAGE) {
-		headerID = INVALID_PAGE;
-		header = NULL;
+	if (!header.IsPinned() || headerID == INVALID_PAGE) {
+		return scan;
 	}
 
 	rootPageID= header->GetRootPageID();
@@ -853,27 +1574,38 @@ IndexFileScan *BTreeFile::OpenScan (const char *lowKey, const char *highKey)
 
 		scan->setScanPid(startPageID);
 
-		s = MINIBASE_BM->PinPage(startPageID, (Page *&)startPage);
-		if (startPage->GetNumOfRecords() <= 0) {
-			s=MINIBASE_BM->UnpinPage(rootPageID);
+		if (MINIBASE_BM->PinPage(startPageID, startPage, PIN_SITE) != OK ||
+			startPage->GetNumOfRecords() <= 0) {
 			return scan;
 		}
 
-		key=new char[MAX_KEY_SIZE];
-		s = startPage->GetFirst(rid, key, keyRecordID);
-		if (lowKey != NULL) {
-			while(strcmp(lowKey, key) != 0){ // TODO: probably > 0
-				s = startPage->GetNext(rid, key, keyRecordID);
-			}
-			scan->setScanLowKey(key);
-		}
+		// Start at the first entry not below lowKey.  If the whole leaf
+		// is below it, rid ends up past the last slot and GetNext moves
+		// on to the next leaf.
+		rid.pageNo = startPageID;
+		rid.slotNo = LEAF_CURSOR(lowKey ? startPage->LowerBound(lowKey) : 0, 0);
 		scan->setScanCrid(rid);
-
-		s=MINIBASE_BM->UnpinPage(startPageID, CLEAN);
 	}
 	return scan;
 }
 
+//-------------------------------------------------------------------
+// BTreeFile::OpenPrefixScan
+//
+// Input   : prefix - pointer to the prefix of the keys to scan.
+// Output  : None
+// Return  : A pointer to IndexFileScan class.
+// Purpose : Initialize a scan over every key that starts with prefix,
+//           e.g. a CompositeKey prefix on the leading columns.
+//-------------------------------------------------------------------
+
+IndexFileScan *BTreeFile::OpenPrefixScan (const char *prefix)
+{
+	BTreeFileScan *scan = (BTreeFileScan *)OpenScan(prefix, NULL);
+	scan->setScanPrefix(strcpy(new char[strlen(prefix) + 1], prefix));
+	return scan;
+}
+
 // Dump Following Statistics:
 // 1. Total # of leafnodes, and Indexnodes.
 // 2. Total # of dataEntries.
@@ -882,6 +1614,7 @@ IndexFileScan *BTreeFile::OpenScan (const char *lowKey, const char *highKey)
 Status BTreeFile::DumpStatistics() {	
 	ostream& os = std::cout;
 	float avgDataFillFactor, avgIndexFillFactor;
+	MetricsScope scope(metricsFile);
 
 // initialization 
 	hight = totalDataPages = totalIndexPages = totalNumIndex = totalNumData = 0;
@@ -920,7 +1653,7 @@ Status BTreeFile::DumpStatistics() {
 Status BTreeFile::_DumpStatistics(PageID pageID) { 
 	__DumpStatistics(pageID);
 
-	SortedPage *page;
+	PageGuard<SortedPage> page;
 	BTIndexPage *index;
 
 	Status s;
@@ -929,12 +1662,13 @@ Status BTreeFile::_DumpStatistics(PageID pageID) {
 	RecordID curRid;
 	KeyType key;
 
-	PIN (pageID, page);
+	PIN_GUARD (pageID, page);
 	NodeType type = page->GetType ();
 
 	switch (type) {
 	case INDEX_NODE:
-		index = (BTIndexPage *)page;
+		index = (BTIndexPage *)page.Get();
+		PrefetchChildren(index);
 		curPageID = index->GetLeftLink();
 		_DumpStatistics(curPageID);
 		s=index->GetFirst(curRid, key, curPageID);
@@ -946,11 +1680,9 @@ Status BTreeFile::_DumpStatistics(PageID pageID) {
 				s = index->GetNext(curRid, key, curPageID);
 			}
 		}
-		UNPIN(pageID, CLEAN);
 		break;
 
 	case LEAF_NODE:
-		UNPIN(pageID, CLEAN);
 		break;
 	default:		
 		assert (0);
@@ -960,7 +1692,7 @@ Status BTreeFile::_DumpStatistics(PageID pageID) {
 }
 
 Status BTreeFile::__DumpStatistics (PageID pageID) {
-	SortedPage *page;
+	PageGuard<SortedPage> page;
 	BTIndexPage *index;
 	BTLeafPage *leaf;
 	int i;
@@ -972,7 +1704,7 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 	KeyType  key;
 	RecordID dataRid;
 
-	PIN (pageID, page);
+	PIN_GUARD (pageID, page);
 	NodeType type = page->GetType ();
 	i = 0;
 	switch (type) {
@@ -981,7 +1713,7 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 		totalIndexPages++;
 		if ( hight <= 0) // still not reach the bottom
 			hight--;
-		index = (BTIndexPage *)page;
+		index = (BTIndexPage *)page.Get();
 		curPageID = index->GetLeftLink();
 		s=index->GetFirst (curRid , key, curPageID); 
 		if ( s == OK) {	
@@ -999,7 +1731,6 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 		if ( minIndexFillFactor > curFillFactor)
 			minIndexFillFactor = curFillFactor;
 		totalFillIndex += curFillFactor;
-		UNPIN(pageID, CLEAN);
 		break;
 
 	case LEAF_NODE:
@@ -1008,7 +1739,7 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 			hight = -hight;
 		totalDataPages++;
 
-		leaf = (BTLeafPage *)page;
+		leaf = (BTLeafPage *)page.Get();
 		s = leaf->GetFirst (curRid, key, dataRid);
 		if (s == OK) {	
 			s = leaf->GetNext(curRid, key, dataRid);
@@ -1025,7 +1756,6 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 		if ( minDataFillFactor > curFillFactor)
 			minDataFillFactor = curFillFactor;
 		totalFillData += curFillFactor;
-		UNPIN(pageID, CLEAN);
 		break;
 	default:		
 		assert (0);
@@ -1037,10 +1767,10 @@ Status BTreeFile::__DumpStatistics (PageID pageID) {
 // function  BTreeFile::_SearchIndex
 // PURPOSE	: given a IndexNode and key, find the PageID with the key in it
 // INPUT	: key, a pointer to key;
-//			: currIndexID, 
 //			: curIndex, pointer to current BTIndexPage
+//			: pin, its pin, empty if it is a pinned node, which stays pinned
 // OUTPUT	: found PageID
-Status BTreeFile::_SearchIndex (const char *key,  PageID currIndexID, BTIndexPage *currIndex, PageID& foundID)
+Status BTreeFile::_SearchIndex (const char *key,  BTIndexPage *currIndex, PinGuard& pin, PageID& foundID)
 {
 	PageID nextPageID;
 	
@@ -1048,9 +1778,10 @@ Status BTreeFile::_SearchIndex (const char *key,  PageID currIndexID, BTIndexPag
 	if (s != OK)
 		return FAIL;
 	
-	// Now unpin the page, recurse and then pin it again
+	// Now unpin the page and recurse
 	
-	UNPIN (currIndexID, CLEAN);
+	if (pin.Unpin() != OK)
+		return FAIL;
 	s = _Search (key, nextPageID, foundID);
 	if (s != OK)
 		return FAIL;
@@ -1064,10 +1795,18 @@ Status BTreeFile::_SearchIndex (const char *key,  PageID currIndexID, BTIndexPag
 Status BTreeFile::_Search( const char *key,  PageID currID, PageID& foundID)
 {
 	
-    SortedPage *page;
+	if (swizzling)
+		return _SearchSwizzled(key, currID, foundID);
+
+	PageGuard<SortedPage> *node = FindPinnedNode(currID);
+	PageGuard<SortedPage> pin;
+    SortedPage *page = node != NULL ? node->Get() : NULL;
 	Status s;
 	
-    PIN (currID, page);
+	if (node == NULL) {
+		PIN_GUARD (currID, pin);
+		page = pin.Get();
+	}
     NodeType type = page->GetType ();
 	
     // TWO CASES:
@@ -1079,12 +1818,11 @@ Status BTreeFile::_Search( const char *key,  PageID currID, PageID& foundID)
     switch (type) 
 	{
 	case INDEX_NODE:
-		s =	_SearchIndex(key,  currID, (BTIndexPage*)page, foundID);
+		s =	_SearchIndex(key,  (BTIndexPage*)page, pin, foundID);
 		break;
 		
 	case LEAF_NODE:
 		foundID =  page->PageNo();
-		UNPIN(currID,CLEAN);
 		break;
 	default:		
 		assert (0);
@@ -1094,6 +1832,48 @@ Status BTreeFile::_Search( const char *key,  PageID currID, PageID& foundID)
 	return OK;
 }
 
+// function  BTreeFile::_SearchSwizzled
+// PURPOSE	: _Search, following the swizzled links of the index nodes
+//			  down, each child pinned before its parent is unpinned
+// INPUT	: key, currID as _Search
+// OUTPUT	: found PageID
+Status BTreeFile::_SearchSwizzled( const char *key,  PageID currID, PageID& foundID)
+{
+	// The parent's pin, empty if it is a pinned node, and its frame.
+	PageGuard<SortedPage> parent;
+	ClockFrame *parentFrame = NULL;
+
+	while (true) {
+		PageGuard<SortedPage> *node = FindPinnedNode(currID);
+		PageGuard<SortedPage> pin;
+		SortedPage *page = NULL;
+		ClockFrame *frame = NULL;
+		Status s = OK;
+
+		if (node != NULL) {
+			page = node->Get();
+			frame = node->GetFrame();
+		} else {
+			s = PinNode(parentFrame, currID, pin, PIN_SITE);
+			page = pin.Get();
+			frame = pin.GetFrame();
+		}
+		parent.Unpin();
+		if (s != OK)
+			return FAIL;
+
+		if (page->GetType() == LEAF_NODE) {
+			foundID = currID;
+			return OK;
+		}
+
+		if (((BTIndexPage *)page)->GetPageID(key, currID) != OK)
+			return FAIL;
+		parent = std::move(pin);
+		parentFrame = frame;
+	}
+}
+
 // BTreeeFile:: Search
 // PURPOSE	: find the PageNo of a give key
 // INPUT	: key, pointer to a key
@@ -1101,6 +1881,8 @@ Status BTreeFile::_Search( const char *key,  PageID currID, PageID& foundID)
 
 Status BTreeFile::Search(const char *key,  PageID& foundPid)
 {
+	MetricsScope scope(metricsFile);
+
 	if (header->GetRootPageID() == INVALID_PAGE)
 	{
 		foundPid = INVALID_PAGE;
@@ -1109,8 +1891,10 @@ Status BTreeFile::Search(const char *key,  PageID& foundPid)
 	}
 
 	Status s;
-	
-	s = _Search(key,  header->GetRootPageID(), foundPid);
+	ProbeKeyType probeKey;
+
+	ProbeKey(probeKey, key);
+	s = _Search(probeKey,  header->GetRootPageID(), foundPid);
 	if (s != OK)
 	{
 		cerr << "Search FAIL in BTreeFile::Search\n";
@@ -1122,7 +1906,7 @@ Status BTreeFile::Search(const char *key,  PageID& foundPid)
 
 Status BTreeFile::_PrintTree ( PageID pageID)
 {
-	SortedPage *page;
+	PageGuard<SortedPage> page;
 	BTIndexPage *index;
 	BTLeafPage *leaf;
 	int i;
@@ -1136,13 +1920,13 @@ Status BTreeFile::_PrintTree ( PageID pageID)
 
 	ostream& os = cout;
 
-    PIN (pageID, page);
+    PIN_GUARD (pageID, page);
     NodeType type = page->GetType ();
 	i = 0;
       switch (type) 
 	{
 	case INDEX_NODE:
-			index = (BTIndexPage *)page;
+			index = (BTIndexPage *)page.Get();
 			curPageID = index->GetLeftLink();
 			os << "\n---------------- Content of Index_Node-----   " << pageID <<endl;
 			os << "\n Left most PageID:  "  << curPageID << endl;
@@ -1162,11 +1946,10 @@ Status BTreeFile::_PrintTree ( PageID pageID)
 				}
 			}
 			os << "\n This page contains  " << i <<"  Entries!" << endl;
-			UNPIN(pageID, CLEAN);
 			break;
 		
 	case LEAF_NODE:
-		leaf = (BTLeafPage *)page;
+		leaf = (BTLeafPage *)page.Get();
 		s = leaf->GetFirst (curRid, key, dataRid);
 			if ( s == OK)
 			{	os << "\n Content of Leaf_Node"  << pageID << endl;
@@ -1183,7 +1966,6 @@ Status BTreeFile::_PrintTree ( PageID pageID)
 				}
 			}
 			os << "\n This page contains  " << i <<"  entries!" << endl;
-			UNPIN(pageID, CLEAN);
 			break;
 	default:		
 		assert (0);
@@ -1195,10 +1977,11 @@ Status BTreeFile::_PrintTree ( PageID pageID)
 
 Status BTreeFile::PrintTree ( PageID pageID, PrintOption option)
 { 
+	MetricsScope scope(metricsFile);
 	_PrintTree(pageID);
 	if (option == SINGLE) return OK;
 
-	SortedPage *page;
+	PageGuard<SortedPage> page;
 	BTIndexPage *index;
 
 	Status s;
@@ -1207,12 +1990,13 @@ Status BTreeFile::PrintTree ( PageID pageID, PrintOption option)
 	RecordID curRid;
 	KeyType  key;
 
-    PIN (pageID, page);
+    PIN_GUARD (pageID, page);
     NodeType type = page->GetType ();
 	
 	switch (type) {
 	case INDEX_NODE:
-		index = (BTIndexPage *)page;
+		index = (BTIndexPage *)page.Get();
+		PrefetchChildren(index);
 		curPageID = index->GetLeftLink();
 		PrintTree(curPageID, RECURSIVE);
 		s=index->GetFirst (curRid , key, curPageID);
@@ -1226,11 +2010,9 @@ Status BTreeFile::PrintTree ( PageID pageID, PrintOption option)
 				s = index->GetNext(curRid, key, curPageID);
 			}
 		}
-		UNPIN(pageID, CLEAN);
 		break;
 
 	case LEAF_NODE:
-		UNPIN(pageID, CLEAN);
 		break;
 	default:		
 		assert (0);
@@ -1241,6 +2023,7 @@ Status BTreeFile::PrintTree ( PageID pageID, PrintOption option)
 
 Status BTreeFile::PrintWhole() {	
 	ostream& os = cout;
+	MetricsScope scope(metricsFile);
 
 	os << "\n\n------------------ Now Begin Printing a new whole B+ Tree -----------"<< endl;
 
@@ -1255,9 +2038,14 @@ PageID BTreeFile::GetLeftmostLeaf() {
 	PageID curPid = header->GetRootPageID();
 
 	while (curPid != INVALID_PAGE) {
-		SortedPage *curPage;
+		PageGuard<SortedPage> *node = FindPinnedNode(curPid);
+		PageGuard<SortedPage> curPage;
 
-		if (MINIBASE_BM->PinPage(curPid, (Page *&)curPage) == FAIL) {
+		if (node != NULL) {
+			curPid = (*node)->GetPrevPage();
+			continue;
+		}
+		if (MINIBASE_BM->PinPage(curPid, curPage, PIN_SITE) == FAIL) {
 			std::cerr << "Unable to pin page" << std::endl;
 			return INVALID_PAGE;
 		}
@@ -1267,24 +2055,9 @@ PageID BTreeFile::GetLeftmostLeaf() {
 		if (nodeType == LEAF_NODE) {
 			//	If we have reached a leaf page, then we are done.
 			break;
-		} else {
-			//	Traverse down to the leftmost branch
-			PageID tempPid = curPage->GetPrevPage();
-
-			if (MINIBASE_BM->UnpinPage(curPid, CLEAN) == FAIL) {
-				std::cerr << "Unable to unpin page" << std::endl;
-				return INVALID_PAGE;
-			}
-
-			curPid = tempPid;
-		}
-	}
-
-	if (curPid != INVALID_PAGE) {
-		if (MINIBASE_BM->UnpinPage(curPid, CLEAN) == FAIL) {
-			std::cerr << "Unable to unpin page" << std::endl;
-			return INVALID_PAGE;
 		}
+		//	Traverse down to the leftmost branch
+		curPid = curPage->GetPrevPage();
 	}
 	return curPid;
 }
\ No newline at end of file
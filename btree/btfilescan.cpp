@@ -1,5 +1,6 @@
 #include "minirel.h"
 #include "bufmgr.h"
+#include "pageguard.h"
 #include "db.h"
 #include "new_error.h"
 #include "btfile.h"
@@ -15,8 +16,11 @@
 
 BTreeFileScan::~BTreeFileScan ()
 {
-	if (lowKey) delete lowKey;
-	if (highKey) delete highKey;
+	if (lowKey) delete [] lowKey;
+	if (highKey) delete [] highKey;
+	if (prefix) delete [] prefix;
+	KeyRelease(curKey);
+	MINIBASE_BM->FreeAccessStrategy(strategy);
 }
 
 
@@ -26,53 +30,192 @@ BTreeFileScan::~BTreeFileScan ()
 // Input   : None
 // Output  : rid  - record id of the scanned record.
 //           keyPtr - and a pointer to it's key value.
-// Purpose : Return the next record from the B+-tree index.
+// Purpose : Return the next record from the B+-tree index.  Leaves
+//           after the first are read through a BULK_READ ring, so a
+//           long scan leaves the rest of the pool alone, and each is
+//           prefetched while the one before it is scanned.  The entry
+//           the scan is in stays decoded in cursor from one call to the
+//           next, until the file is changed through its handle.
 // Return  : OK if successful, DONE if no more records to read.
 //-------------------------------------------------------------------
 Status BTreeFileScan::GetNext (RecordID & rid, char* keyPtr)
 {
-	BTLeafPage *page;
+	PageGuard<BTLeafPage> page;
 	RecordID dataRid;
 	Status s= OK;
 	if (pid == INVALID_PAGE) {
 		return DONE;
 	}
 
-	char *key = new char[MAX_KEY_SIZE];
+	MetricsScope scope(metricsFile);
+	if (updateEpoch != file->updateEpoch) {
+		updateEpoch = file->updateEpoch;
+		cursor.leaf = INVALID_PAGE;
+	}
+	if (reorgEpoch != file->reorgEpoch) {
+		if (Reposition() != OK)
+			return FAIL;
+		if (pid == INVALID_PAGE)
+			return DONE;
+	}
 
-	s = MINIBASE_BM->PinPage(pid, (Page *&)page);
+	char *key = new char[MAX_KEY_SIZE];
+	if (MINIBASE_BM->PinPage(pid, page, PIN_SITE, strategy) != OK) {
+		delete [] key;
+		return FAIL;
+	}
 	if (firstTime) {
-		s = page->GetCurrent(crid, key, dataRid);
+		s = page->GetCurrent(crid, key, dataRid, &cursor);
 		firstTime = false;
 	} else {
-		s = page->GetNext(crid, key, dataRid);
+		s = page->GetNext(crid, key, dataRid, &cursor);
 	}
 
 	if (s == DONE) {
 		if (page->GetNextPage() == INVALID_PAGE) {
-			s = MINIBASE_BM->UnpinPage(pid, CLEAN);
-			delete key;
+			delete [] key;
 			return DONE;
 		} else {
-			PageID oldPid = pid;
 			pid = page->GetNextPage();
-			s = MINIBASE_BM->UnpinPage(oldPid, CLEAN);
-			s = MINIBASE_BM->PinPage(pid, (Page *&)page);
-			s = page->GetFirst(crid, key, dataRid);
+			if (strategy == NULL)
+				strategy = MINIBASE_BM->GetAccessStrategy(BULK_READ);
+			// Drops the pin of the leaf before.
+			if (MINIBASE_BM->PinPage(pid, page, PIN_SITE, strategy) != OK) {
+				delete [] key;
+				return FAIL;
+			}
+			PageID nextPid = page->GetNextPage();
+			if (nextPid != INVALID_PAGE)
+				MINIBASE_BM->Prefetch(&nextPid, 1, strategy);
+			s = page->GetFirst(crid, key, dataRid, &cursor);
 		}
 	}
 
-	if (highKey == NULL || strcmp(key, highKey) <= 0) {
+	if ((highKey == NULL || KeyCmp(key, highKey) <= 0) && MatchesPrefix(key)) {
 		rid = dataRid;
-		strcpy(keyPtr, key);
-		s = MINIBASE_BM->UnpinPage(pid, CLEAN);
-		delete key;
+		// Hold on to the chain of a long key so GetFullKey still works
+		// if the entry is deleted before the next call.
+		KeyRelease(curKey);
+		KeyCopy(curKey, key);
+		KeyRetain(curKey);
+		started = true;
+		KeyCopy(keyPtr, key);
+		delete [] key;
 		return OK;
 	} else {
-		s = MINIBASE_BM->UnpinPage(pid, CLEAN);
-		delete key;
+		delete [] key;
 		return DONE;
 	}
 
 	return OK;
 }
+
+
+//-------------------------------------------------------------------
+// BTreeFileScan::Reposition
+//
+// Input   : None
+// Output  : None
+// Purpose : Find the scan's place again after a reorganize step or a
+//           delete, which may have freed the leaf it was on: in the
+//           entry of curKey, at the RecordID it last returned, or at
+//           the first key not below lowKey if it has returned none.
+//           Should curKey have been deleted since, the scan goes on
+//           from the key after.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BTreeFileScan::Reposition ()
+{
+	PageGuard<BTLeafPage> page;
+	PageID rootPid = file->header->GetRootPageID();
+	const char *key = started ? curKey : lowKey;
+	int slot = 0;
+
+	reorgEpoch = file->reorgEpoch;
+	pid = INVALID_PAGE;
+	if (rootPid == INVALID_PAGE)
+		return OK;
+
+	if (key == NULL)
+		pid = file->GetLeftmostLeaf();
+	else if (file->_Search(key, rootPid, pid) != OK)
+		return FAIL;
+	if (pid == INVALID_PAGE ||
+		MINIBASE_BM->PinPage(pid, page, PIN_SITE, strategy) != OK)
+		return FAIL;
+
+	if (started)
+		slot = page->UpperBound(key);
+	else if (key != NULL)
+		slot = page->LowerBound(key);
+
+	crid.pageNo = pid;
+	if (started && slot > 0 && KeyCmp(page->GetEntryKey(slot - 1), curKey) == 0) {
+		crid.slotNo = LEAF_CURSOR(slot - 1, LEAF_CURSOR_POS(crid.slotNo));
+		firstTime = false;
+	} else {
+		crid.slotNo = LEAF_CURSOR(slot, 0);
+		firstTime = true;
+	}
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BTreeFileScan::MatchesPrefix
+//
+// Input   : key - a stored key.
+// Output  : None
+// Purpose : Check key against the prefix of a prefix scan.  A prefix
+//           longer than the inline part of a long key is checked
+//           against the key read back from its overflow chain.
+// Return  : true if there is no prefix or key starts with it.
+//-------------------------------------------------------------------
+
+bool BTreeFileScan::MatchesPrefix (const char *key)
+{
+	if (prefix == NULL)
+		return true;
+	if (prefixLen <= LONG_KEY_PREFIX || !IsLongKey(key))
+		return strncmp(key, prefix, prefixLen) == 0;
+
+	char *fullKey = new char[::GetFullKeyLength(key) + 1];
+	bool match = ::GetFullKey(fullKey, key) == OK &&
+		strncmp(fullKey, prefix, prefixLen) == 0;
+	delete [] fullKey;
+	return match;
+}
+
+
+//-------------------------------------------------------------------
+// BTreeFileScan::GetFullKeyLength
+//
+// Input   : None
+// Output  : None
+// Purpose : Length of the key last returned by GetNext, which may be
+//           longer than the stored form GetNext copies out.
+// Return  : The length, not counting the terminating '\0'.
+//-------------------------------------------------------------------
+
+int BTreeFileScan::GetFullKeyLength ()
+{
+	return ::GetFullKeyLength(curKey) - 1;
+}
+
+
+//-------------------------------------------------------------------
+// BTreeFileScan::GetFullKey
+//
+// Input   : None
+// Output  : key - the whole key last returned by GetNext.  Must hold
+//                 GetFullKeyLength() + 1 bytes.
+// Purpose : Read back a key that was stored with an overflow chain.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BTreeFileScan::GetFullKey (char *key)
+{
+	MetricsScope scope(metricsFile);
+	return ::GetFullKey(key, curKey);
+}
@@ -79,13 +79,13 @@ Status BTIndexPage::DeletePage (PageID pid, bool rightSibling)
 		s = GetFirst (rid, currKey, pageNo);
 		Delete(currKey, rid);
 		SetLeftLink(pageNo);
-		delete currKey;
+		delete [] currKey;
 		return OK;
 	} else {
 		s = GetFirst (rid, currKey, pageNo);
 		if (pageNo == pid && rightSibling) {
 			Delete(currKey, rid);
-			delete currKey;
+			delete [] currKey;
 			return OK;
 		}
 
@@ -99,21 +99,25 @@ Status BTIndexPage::DeletePage (PageID pid, bool rightSibling)
 		}
 
 		if (pid == INVALID_PAGE) {
-			delete currKey;
+			delete [] currKey;
 			return FAIL;
 		} else {
 			PageID targetPid = pageNo;
 			char * targetKey = new char[MAX_KEY_SIZE];
-			strcpy(targetKey, currKey);
+			KeyCopy(targetKey, currKey);
 
 			s = GetNext(rid, currKey, pageNo);
 			char * oldKey = new char[MAX_KEY_SIZE];
-			strcpy(oldKey, currKey);
+			KeyCopy(oldKey, currKey);
 
+			// targetKey goes back in by AdjustKey, so keep its overflow
+			// chain alive across the Delete.
+			KeyRetain(targetKey);
 			s = Delete(targetKey, rid);
 
 			AdjustKey(targetKey, oldKey);
-			delete currKey;
+			KeyRelease(targetKey);
+			delete [] currKey;
 			return OK;
 		}
 
@@ -134,22 +138,16 @@ Status BTIndexPage::DeletePage (PageID pid, bool rightSibling)
 
 Status BTIndexPage::GetPageID (const char *key, PageID& pid)
 {
-	KeyDataEntry *currKey;
-	int len;
-	
-	// A sequential search is implemented here.  You can modify it
-	// to a binary search if you like.
+	// Binary search for the last entry whose key is <= key.
 	
-	for (int i = numOfSlots - 1; i >= 0; i--)
+	int i = UpperBound(key) - 1;
+
+	if (i >= 0)
 	{
-		currKey = (KeyDataEntry *)(data + slots[i].offset);
-		
-		if (KeyCmp(key, currKey->key) >= 0)
-		{
-			len = slots[i].length;
-			GetKeyData(NULL, (DataType *)&pid, currKey, len, INDEX_NODE);
-			return OK;
-		}
+		GetKeyData(NULL, (DataType *)&pid, 
+			(KeyDataEntry *)(data + slots[i].offset),
+			INDEX_NODE);
+		return OK;
 	}
 	
 	// If we reach this point, then the page we should follow in our 
@@ -181,35 +179,24 @@ Status BTIndexPage::GetPageID (const char *key, PageID& pid)
 Status BTIndexPage::GetSibling (const char *key,
 								PageID &pageNo, int &left)
 {
-	int i;
+	int i = UpperBound(key) - 1;
 	
-	for (i = numOfSlots - 1; i >= 0; i--)
+	if (i >= 0)
 	{
-		GetKeyData(
-			NULL, 
-			(DataType *)&pageNo,
-			(KeyDataEntry *)(data + slots[i].offset),
-			slots[i].length,
-			(NodeType)type);
-		
-		if (KeyCmp(key, (char *)(data+slots[i].offset)) >= 0)
+		left = 1;
+		if (i != 0)
 		{
-			left = 1;
-			if (i != 0)
-			{
-				GetKeyData(
-					NULL, 
-					(DataType *)&pageNo,
-					(KeyDataEntry *)(data + slots[i-1].offset),
-					slots[i-1].length,
-					(NodeType)type);
-				return OK;
-			}
-			else
-			{
-				pageNo = GetLeftLink();
-				return OK;
-			}
+			GetKeyData(
+				NULL, 
+				(DataType *)&pageNo,
+				(KeyDataEntry *)(data + slots[i-1].offset),
+				(NodeType)type);
+			return OK;
+		}
+		else
+		{
+			pageNo = GetLeftLink();
+			return OK;
 		}
 	}
 	
@@ -218,7 +205,6 @@ Status BTIndexPage::GetSibling (const char *key,
 		NULL, 
 		(DataType *)&pageNo,
 		(KeyDataEntry *)(data + slots[0].offset),
-		slots[0].length,
 		(NodeType)type);
 	return OK;
 }
@@ -250,7 +236,7 @@ Status BTIndexPage::GetFirst (RecordID& rid, char *key, PageID& pageNo)
 	GetKeyData(key, 
 		(DataType *)&pageNo, 
 		(KeyDataEntry *)(data+slots[0].offset),
-		slots[0].length, (NodeType)type);
+		(NodeType)type);
 	
 	return OK;
 }
@@ -269,7 +255,7 @@ Status BTIndexPage::GetLast (RecordID& rid, char* key, PageID & pageNo)
 	GetKeyData(key, 
 		(DataType *)&pageNo,
 		(KeyDataEntry *)(data+slots[numOfSlots - 1].offset),
-		slots[numOfSlots - 1].length, (NodeType)type);
+		(NodeType)type);
 	
 	return OK;
 }
@@ -299,7 +285,6 @@ Status BTIndexPage::GetNext (RecordID& rid, char *key, PageID & pageNo)
 	GetKeyData(key,
 		(DataType *)&pageNo,
 		(KeyDataEntry *)(data+slots[rid.slotNo].offset),
-		slots[rid.slotNo].length,
 		(NodeType)type);
 	
 	return OK;
@@ -321,31 +306,28 @@ Status BTIndexPage::GetNext (RecordID& rid, char *key, PageID & pageNo)
 
 Status BTIndexPage::FindKey(char *key, char *entry)
 {
-	for (int i = numOfSlots - 1; i >= 0; i--)
+	int i = UpperBound(key) - 1;
+
+	if (i >= 0)
 	{
-		if (KeyCmp(key, (char *)(data+slots[i].offset)) >= 0)
-		{
-			memcpy(entry, data+slots[i].offset, GetKeyLength(key));
-			return OK;
-		}
+		KeyCopy(entry, data+slots[i].offset);
+		return OK;
 	}
 	return FAIL;
 }
 
 Status BTIndexPage::FindPage(const char *key, PageID& pageNo, bool& leftMost)
 {
-	for (int i = numOfSlots - 1; i >= 0; i--)
+	int i = UpperBound(key) - 1;
+
+	if (i >= 0)
 	{
-		if (KeyCmp(key, (char *)(data+slots[i].offset)) >= 0)
-		{
-			GetKeyData(NULL,
-				(DataType *)&pageNo,
-				(KeyDataEntry *)(data+slots[i].offset),
-				slots[i].length,
-				(NodeType)type);
-			leftMost = false;
-			return OK;
-		}
+		GetKeyData(NULL,
+			(DataType *)&pageNo,
+			(KeyDataEntry *)(data+slots[i].offset),
+			(NodeType)type);
+		leftMost = false;
+		return OK;
 	}
 
 	leftMost = true;
@@ -365,7 +347,6 @@ Status BTIndexPage::FindKeyWithPage(PageID targetPid, char *key, bool& leftMost)
 		GetKeyData(key,
 			(DataType *)&pageNo,
 			(KeyDataEntry *)(data+slots[i].offset),
-			slots[i].length,
 			(NodeType)type);
 		if (targetPid == pageNo) {
 			leftMost = false;
@@ -384,7 +365,6 @@ Status BTIndexPage::FindSiblingForChild(PageID targetPid, PageID& siblingPid, bo
 		GetKeyData(NULL,
 			(DataType *)&siblingPid,
 			(KeyDataEntry *)(data+slots[0].offset),
-			slots[0].length,
 			(NodeType)type);
 	}
 
@@ -394,7 +374,6 @@ Status BTIndexPage::FindSiblingForChild(PageID targetPid, PageID& siblingPid, bo
 		GetKeyData(NULL,
 			(DataType *)&pageNo,
 			(KeyDataEntry *)(data+slots[i].offset),
-			slots[i].length,
 			(NodeType)type);
 		if (targetPid == pageNo) {
 			rightSibling = false;
@@ -404,7 +383,6 @@ Status BTIndexPage::FindSiblingForChild(PageID targetPid, PageID& siblingPid, bo
 				GetKeyData(NULL,
 					(DataType *)&siblingPid,
 					(KeyDataEntry *)(data+slots[i-1].offset),
-					slots[i-1].length,
 					(NodeType)type);
 			}
 			return OK;
@@ -444,13 +422,49 @@ void BTIndexPage::SetLeftLink (PageID pid)
 }
 
 
+//-------------------------------------------------------------------
+// BTIndexPage::AdjustKey
+//
+// Input   : newKey - the key to put in.
+//           oldKey - a key routed by the entry to change.
+// Output  : None
+// Purpose : Replace the key of the entry oldKey is routed by with
+//           newKey, keeping its page id.  The entry is reinserted as
+//           the two keys need not have the same length.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
 Status BTIndexPage::AdjustKey (const char *newKey, const char *oldKey)
 {
-    for (int i = numOfSlots -1; i >= 0; i--) {
-        if (KeyCmp(oldKey, (char*)(data+slots[i].offset)) >= 0) {
-			memcpy(data+slots[i].offset, newKey, GetKeyLength(newKey)); 
-			return OK;
-        }
-    }
-    return FAIL;
+	int i = UpperBound(oldKey) - 1;
+	KeyDataEntry oldEntry;
+	int oldLen;
+	RecordID rid;
+	PageID pageNo;
+	Status s;
+
+	if (i < 0)
+		return FAIL;
+
+	oldLen = slots[i].length;
+	memcpy(&oldEntry, data+slots[i].offset, oldLen);
+	GetKeyData(NULL, (DataType *)&pageNo, &oldEntry, INDEX_NODE);
+
+	// Either key may only be referenced by the entry being replaced.
+	if (KeyRetain(newKey) != OK || KeyRetain((char *)&oldEntry) != OK)
+		return FAIL;
+
+	rid.pageNo = pid;
+	rid.slotNo = i;
+	s = SortedPage::DeleteRecord(rid);
+	if (s == OK && Insert(newKey, pageNo, rid) != OK)
+	{
+		// No room for a longer key: put the old entry back.
+		SortedPage::InsertRecord((char *)&oldEntry, oldLen, rid);
+		s = FAIL;
+	}
+
+	KeyRelease((char *)&oldEntry);
+	KeyRelease(newKey);
+	return s;
 }
@@ -1,69 +1,389 @@
+#include <string.h>
+#include "bufmgr.h"
+#include "pageguard.h"
 #include "btleaf.h"
 
 
+//-------------------------------------------------------------------
+// BTLeafPage::Init
+//
+// Input   : pageNo - page id of this page.
+// Output  : None
+// Purpose : Make this an empty leaf, with room for its RID base at the
+//           end of the data area and a base of 0.
+//-------------------------------------------------------------------
+
+void BTLeafPage::Init(PageID pageNo)
+{
+	HeapPage::Init(pageNo);
+	fillPtr -= sizeof(PageID);
+	freeSpace -= sizeof(PageID);
+	SetRidBase(0);
+}
+
+
 //-------------------------------------------------------------------
 // BTLeafPage::InsertRecord
 //
 // Input   : key  - pointer to the key value to be inserted.
 //           dataRid - record id to be associated with key
 // Output  : rid - record id of the inserted pair (key, dataRid)
-// Purpose : Insert the pair (key, dataRid) into this leaf node.
+// Purpose : Insert the pair (key, dataRid) into this leaf node.  If
+//           key is already on the page, dataRid is added to its entry,
+//           spilling to the overflow chain once the entry is full.
+// Return  : OK if successful, FAIL if the page has no room.
 //-------------------------------------------------------------------
 
-Status BTLeafPage::Insert(const char *key, 
+Status BTLeafPage::Insert(const char *key,
 						  RecordID dataRid, RecordID& rid)
 {
-	KeyDataEntry entry;
+	char entry[MAX_SPACE];
+	RecordID rids[MAX_RIDS_PER_ENTRY];
+	PageID overflowPid;
 	int entryLen;
-	
+	int numRids;
+	int i, pos;
+
+	rid.pageNo = pid;
+
+	i = UpperBound(key) - 1;
+	if (i >= 0 && KeyCmp(key, data + slots[i].offset) == 0)
+	{
+		// Keep the key the entry already has; a long key passed in may
+		// point to a different, equal, overflow chain.
+		KeyType entryKey;
+		KeyCopy(entryKey, data + slots[i].offset);
+		key = entryKey;
+
+		numRids = GetRidList(rids, overflowPid,
+			data + slots[i].offset, slots[i].length, GetRidEncoding(), GetRidBase());
+
+		if (overflowPid == INVALID_PAGE)
+		{
+			// Keep the list sorted so the deltas stay small.
+			for (pos = numRids; pos > 0 && dataRid < rids[pos - 1]; pos--)
+				rids[pos] = rids[pos - 1];
+			rids[pos] = dataRid;
+
+			entryLen = MakeRidListEntry(entry, key, rids, numRids + 1,
+				INVALID_PAGE, GetRidEncoding(), GetRidBase());
+			if (entryLen <= MAX_POSTING_SIZE)
+			{
+				if (entryLen - slots[i].length > AvailableSpace() ||
+					ReplaceEntry(i, entry, entryLen) != OK)
+					return FAIL;
+				rid.slotNo = LEAF_CURSOR(i, pos);
+				return OK;
+			}
+
+			memmove(&rids[pos], &rids[pos + 1],
+				(numRids - pos) * sizeof(RecordID));
+		}
+
+		if (AddOverflow(i, key, rids, numRids, overflowPid, dataRid, pos) != OK)
+			return FAIL;
+		rid.slotNo = LEAF_CURSOR(i, pos);
+		return OK;
+	}
+
+	// An empty leaf codes its RecordIDs relative to the first one.
+	if (numOfSlots == 0)
+		SetRidBase(dataRid.pageNo);
+
 	DataType d;
-	
 	d.rid = dataRid;
-	MakeEntry(&entry, key, (NodeType)type, d, &entryLen);
+	MakeEntry((KeyDataEntry *)entry, key, LEAF_NODE, d, &entryLen,
+		GetRidEncoding(), GetRidBase());
 	//the data is packed into entry so that it can be inserted using SortedPage
 	//MakeEntry is defined in key.cpp
 
-	if (SortedPage::InsertRecord ((char *)&entry, entryLen, rid) != OK)
+	if (SortedPage::InsertRecord (entry, entryLen, rid) != OK)
+	{
+		return FAIL;
+	}
+	rid.slotNo = LEAF_CURSOR(rid.slotNo, 0);
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::ReplaceEntry
+//
+// Input   : slot - slot of the entry to replace.
+//           entry - the new entry, with the same key.
+//           entryLen - length of the new entry.
+// Output  : None
+// Purpose : Replace the entry in slot.  The page is left unchanged if
+//           the new entry does not fit.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::ReplaceEntry(int slot, char *entry, int entryLen)
+{
+	char oldEntry[MAX_SPACE];
+	int oldLen = slots[slot].length;
+	RecordID rid;
+
+	memcpy(oldEntry, data + slots[slot].offset, oldLen);
+
+	// Hold on to a long key while the entry is out of the page.
+	if (KeyRetain(oldEntry) != OK)
+		return FAIL;
+
+	rid.pageNo = pid;
+	rid.slotNo = slot;
+	if (SortedPage::DeleteRecord(rid) != OK)
+	{
+		KeyRelease(oldEntry);
+		return FAIL;
+	}
+
+	if (SortedPage::InsertRecord(entry, entryLen, rid) == OK)
+		return KeyRelease(oldEntry);
+
+	SortedPage::InsertRecord(oldEntry, oldLen, rid);
+	KeyRelease(oldEntry);
+	return FAIL;
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::AddOverflow
+//
+// Input   : slot - slot of the entry of key.
+//           key - the key of the entry.
+//           rids, numRids - the record ids kept in the entry itself.
+//           overflowPid - head of the overflow chain, or INVALID_PAGE.
+//           dataRid - record id to add.
+// Output  : pos - position of dataRid within the entry.
+// Purpose : Add dataRid to the overflow chain of the entry.  New
+//           record ids go to the head page; a new head page is
+//           started when it is full.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::AddOverflow(int slot, const char *key, RecordID *rids,
+	int numRids, PageID overflowPid, RecordID dataRid, int& pos)
+{
+	PageGuard<RidOverflowPage> overflow;
+	char entry[MAX_SPACE];
+	int entryLen;
+	PageID headPid;
+
+	if (overflowPid != INVALID_PAGE)
 	{
+		PIN_GUARD(overflowPid, overflow);
+		if (overflow->numOfRids < (int)RIDS_PER_OVERFLOW_PAGE)
+		{
+			pos = numRids + overflow->numOfRids;
+			overflow->rids[overflow->numOfRids++] = dataRid;
+			overflow.SetDirty();
+			return OK;
+		}
+		overflow.Unpin();
+	}
+
+	// The entry grows by the overflow PageID if it had none yet.
+	entryLen = MakeRidListEntry(entry, key, rids, numRids, 0,
+		GetRidEncoding(), GetRidBase());
+	if (entryLen - slots[slot].length > AvailableSpace())
+		return FAIL;
+
+	NEWPAGE_GUARD(headPid, overflow);
+	overflow->nextPage = overflowPid;
+	overflow->numOfRids = 1;
+	overflow->rids[0] = dataRid;
+	overflow.SetDirty();
+
+	MakeRidListEntry(entry, key, rids, numRids, headPid,
+		GetRidEncoding(), GetRidBase());
+	if (ReplaceEntry(slot, entry, entryLen) != OK)
+	{
+		FREE_GUARD(overflow);
 		return FAIL;
 	}
-	
+
+	pos = numRids;
 	return OK;
 }
 
 
+//-------------------------------------------------------------------
+// BTLeafPage::DeleteOverflow
+//
+// Input   : slot - slot of the entry of key.
+//           key - the key of the entry.
+//           rids, numRids - the record ids kept in the entry itself.
+//           overflowPid - head of the overflow chain.
+//           dataRid - record id to delete.
+// Output  : None
+// Purpose : Remove dataRid from the overflow chain of the entry,
+//           freeing the page that held it if it becomes empty.
+// Return  : OK if successful, FAIL if dataRid is not in the chain.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::DeleteOverflow(int slot, const char *key, RecordID *rids,
+	int numRids, PageID overflowPid, const RecordID& dataRid)
+{
+	PageID prevPid = INVALID_PAGE;
+	PageID curPid = overflowPid;
+	PageGuard<RidOverflowPage> cur;
+
+	while (curPid != INVALID_PAGE)
+	{
+		PIN_GUARD(curPid, cur);
+		for (int k = 0; k < cur->numOfRids; k++)
+		{
+			if (cur->rids[k] != dataRid)
+				continue;
+
+			cur->rids[k] = cur->rids[--cur->numOfRids];
+			cur.SetDirty();
+			if (cur->numOfRids > 0)
+				return OK;
+
+			PageID nextPid = cur->nextPage;
+			FREE_GUARD(cur);
+
+			if (prevPid != INVALID_PAGE)
+			{
+				PageGuard<RidOverflowPage> prev;
+				PIN_GUARD(prevPid, prev);
+				prev->nextPage = nextPid;
+				prev.SetDirty();
+				return OK;
+			}
+
+			// The head page went away; point the entry past it.
+			char entry[MAX_SPACE];
+			int entryLen = MakeRidListEntry(entry, key, rids, numRids,
+				nextPid, GetRidEncoding(), GetRidBase());
+			return ReplaceEntry(slot, entry, entryLen);
+		}
+
+		prevPid = curPid;
+		curPid = cur->nextPage;
+	}
+
+	return FAIL;
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::GetEntry
+//
+// Input   : slot - slot of the entry.
+//           pos - position of the record id within the entry.
+//           cursor - what was kept of the entry by the call before,
+//                    NULL if nothing is kept.
+// Output  : key - pointer to the key value (NULL if not needed)
+//           dataRid - the record id
+//           cursor - updated for the entry and pos.
+// Purpose : Get the pair (key, dataRid) at the given slot and position.
+//           With a cursor already on the entry, the entry is not
+//           decoded again, and the overflow chain is read on from the
+//           page it holds if pos is not before it.
+// Return  : OK if there is such a pair, DONE if slot or pos is past
+//           the end.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::GetEntry(int slot, int pos, char* key, RecordID & dataRid,
+							LeafEntryCursor *cursor)
+{
+	LeafEntryCursor local;
+	PageGuard<RidOverflowPage> overflow;
+	PageID nextPid;
+	int first;
+
+	dataRid.pageNo = INVALID_PAGE;
+	dataRid.slotNo = INVALID_SLOT;
+
+	if (slot >= numOfSlots)
+		return DONE;
+
+	if (cursor == NULL)
+	{
+		cursor = &local;
+		cursor->leaf = INVALID_PAGE;
+	}
+	if (cursor->leaf != pid || cursor->slot != slot)
+	{
+		cursor->numRids = GetRidList(cursor->rids, cursor->overflowHead,
+			data + slots[slot].offset, slots[slot].length, GetRidEncoding(), GetRidBase());
+		cursor->leaf = pid;
+		cursor->slot = slot;
+		cursor->overflowPid = INVALID_PAGE;
+	}
+	if (key)
+		GetKeyData(key, NULL, (KeyDataEntry *)(data + slots[slot].offset), LEAF_NODE);
+
+	if (pos < cursor->numRids)
+	{
+		dataRid = cursor->rids[pos];
+		return OK;
+	}
+
+	if (cursor->overflowPid != INVALID_PAGE && pos >= cursor->overflowPos)
+	{
+		first = cursor->overflowPos;
+		if (pos < first + cursor->numOverflowRids)
+		{
+			dataRid = cursor->overflowRids[pos - first];
+			return OK;
+		}
+		first += cursor->numOverflowRids;
+		nextPid = cursor->overflowNext;
+	}
+	else
+	{
+		first = cursor->numRids;
+		nextPid = cursor->overflowHead;
+	}
+
+	while (nextPid != INVALID_PAGE)
+	{
+		PIN_GUARD(nextPid, overflow);
+		cursor->overflowPid = nextPid;
+		cursor->overflowNext = overflow->nextPage;
+		cursor->overflowPos = first;
+		cursor->numOverflowRids = overflow->numOfRids;
+		memcpy(cursor->overflowRids, overflow->rids,
+			overflow->numOfRids * sizeof(RecordID));
+
+		if (pos < first + cursor->numOverflowRids)
+		{
+			dataRid = cursor->overflowRids[pos - first];
+			return OK;
+		}
+		first += cursor->numOverflowRids;
+		nextPid = cursor->overflowNext;
+	}
+
+	return DONE;
+}
+
+
 //-------------------------------------------------------------------
 // BTLeafPage::GetFirst
 //
-// Input   : None
+// Input   : cursor - see LeafEntryCursor, NULL if none.
 // Output  : rid - record id of the first entry
 //           key - pointer to the key value
 //           dataRid - pointer to the record id
-// Purpose : get the first pair (key, dataRid) in the leaf page and 
+// Purpose : get the first pair (key, dataRid) in the leaf page and
 //           it's rid.
-// Return  : OK always.
+// Return  : OK if there is one, DONE if the page is empty.
 //-------------------------------------------------------------------
 
 
-Status BTLeafPage::GetFirst (RecordID& rid, char* key, RecordID & dataRid)
+Status BTLeafPage::GetFirst (RecordID& rid, char* key, RecordID & dataRid,
+							 LeafEntryCursor *cursor)
 {
 	rid.pageNo = pid;
-	rid.slotNo = 0;
-	
-	if (numOfSlots == 0)
-	{
-		dataRid.pageNo = INVALID_PAGE;
-		dataRid.slotNo = INVALID_SLOT;
-		return DONE;
-	}
-	
-	GetKeyData(key, 
-		(DataType *)&dataRid, 
-		(KeyDataEntry *)(data + slots[0].offset),
-		slots[0].length,
-		(NodeType)type);
-	
-	return OK;
+	rid.slotNo = LEAF_CURSOR(0, 0);
+
+	return GetEntry(0, 0, key, dataRid, cursor);
 }
 
 
@@ -71,6 +391,7 @@ Status BTLeafPage::GetFirst (RecordID& rid, char* key, RecordID & dataRid)
 // BTLeafPage::GetNext
 //
 // Input   : rid - record id of the current entry
+//           cursor - see LeafEntryCursor, NULL if none.
 // Output  : rid - record id of the next entry
 //           key - pointer to the key value
 //           dataRid - the record id
@@ -80,24 +401,23 @@ Status BTLeafPage::GetFirst (RecordID& rid, char* key, RecordID & dataRid)
 //-------------------------------------------------------------------
 
 
-Status BTLeafPage::GetNext (RecordID& rid, char* key, RecordID & dataRid)
+Status BTLeafPage::GetNext (RecordID& rid, char* key, RecordID & dataRid,
+							LeafEntryCursor *cursor)
 {
-	rid.slotNo ++;
-	
-	if (rid.slotNo == numOfSlots)
+	int slot = LEAF_CURSOR_SLOT(rid.slotNo);
+	int pos = LEAF_CURSOR_POS(rid.slotNo) + 1;
+	Status s;
+
+	s = GetEntry(slot, pos, key, dataRid, cursor);
+	if (s == DONE && slot < numOfSlots)
 	{
-		dataRid.pageNo = INVALID_PAGE;
-		dataRid.slotNo = INVALID_SLOT;
-		return DONE;
+		slot++;
+		pos = 0;
+		s = GetEntry(slot, pos, key, dataRid, cursor);
 	}
-	
-	GetKeyData(key, 
-		(DataType *)&dataRid, 
-		(KeyDataEntry *)(data + slots[rid.slotNo].offset),
-		slots[rid.slotNo].length,
-		(NodeType)type);
-	
-	return OK;
+
+	rid.slotNo = LEAF_CURSOR(slot, pos);
+	return s;
 }
 
 
@@ -105,29 +425,19 @@ Status BTLeafPage::GetNext (RecordID& rid, char* key, RecordID & dataRid)
 // BTLeafPage::GetCurrent
 //
 // Input   : rid - record id of the current entry
+//           cursor - see LeafEntryCursor, NULL if none.
 // Output  : key - pointer to the key value
 //           dataRid - the record id
 // Purpose : get the current pair (key, dataRid) in the leaf page and its
 //           rid.
-// Return  : OK always.
+// Return  : OK if there is one, DONE if rid is past the last entry.
 //-------------------------------------------------------------------
 
-Status BTLeafPage::GetCurrent (RecordID rid, char* key, RecordID & dataRid)
+Status BTLeafPage::GetCurrent (RecordID rid, char* key, RecordID & dataRid,
+							   LeafEntryCursor *cursor)
 {
-	if (rid.slotNo == numOfSlots)
-	{
-		dataRid.pageNo = INVALID_PAGE;
-		dataRid.slotNo = INVALID_SLOT;
-		return DONE;
-	}
-	
-	GetKeyData(key, 
-		(DataType *)&dataRid, 
-		(KeyDataEntry *)(data + slots[rid.slotNo].offset),
-		slots[rid.slotNo].length,
-		(NodeType)type);
-	
-	return OK;
+	return GetEntry(LEAF_CURSOR_SLOT(rid.slotNo), LEAF_CURSOR_POS(rid.slotNo),
+		key, dataRid, cursor);
 }
 
 
@@ -137,57 +447,240 @@ Status BTLeafPage::GetCurrent (RecordID rid, char* key, RecordID & dataRid)
 // Input   : key - pointer to the key
 //           dataRid - record id
 // Output  : None
-// Purpose : Find the pair (key, dataRid) and delete it.
+// Purpose : Find the pair (key, dataRid) and delete it.  The entry of
+//           key is removed with its last record id.
 // Return  : OK if successful, FAIL otherwise.
 //-------------------------------------------------------------------
 
 Status BTLeafPage::Delete (const char* key, const RecordID& dataRid)
 {
-	int i;
-	
-	for (i = numOfSlots - 1; i >= 0; i--)
-	{
-		KeyType tmpKey;
-		RecordID tmpRid;
-		GetKeyData(
-			tmpKey,
-			(DataType *)&tmpRid,
-			(KeyDataEntry *)(data + slots[i].offset),
-			slots[i].length,
-			(NodeType)type);
-		if (tmpRid == dataRid && KeyCmp(key, tmpKey) == 0)
+	RecordID rids[MAX_RIDS_PER_ENTRY];
+	PageID overflowPid;
+	int numRids;
+	int i, j;
+
+	// Only the run of entries equal to key needs to be checked.
+	for (i = LowerBound(key);
+		 i < numOfSlots && KeyCmp(key, data + slots[i].offset) == 0; i++)
+	{
+		KeyType entryKey;
+		KeyCopy(entryKey, data + slots[i].offset);
+
+		numRids = GetRidList(rids, overflowPid,
+			data + slots[i].offset, slots[i].length, GetRidEncoding(), GetRidBase());
+
+		for (j = 0; j < numRids && rids[j] != dataRid; j++)
+			;
+
+		if (j == numRids)
+		{
+			if (overflowPid != INVALID_PAGE &&
+				DeleteOverflow(i, entryKey, rids, numRids, overflowPid, dataRid) == OK)
+				return OK;
+			continue;
+		}
+
+		memmove(&rids[j], &rids[j + 1], (numRids - j - 1) * sizeof(RecordID));
+		numRids--;
+
+		// The entry keeps at least one record id of its own, so refill
+		// it from the overflow chain.
+		if (numRids == 0 && overflowPid != INVALID_PAGE)
+		{
+			PageGuard<RidOverflowPage> head;
+			PIN_GUARD(overflowPid, head);
+			rids[numRids++] = head->rids[--head->numOfRids];
+			head.SetDirty();
+			if (head->numOfRids == 0)
+			{
+				PageID nextPid = head->nextPage;
+				FREE_GUARD(head);
+				overflowPid = nextPid;
+			}
+		}
+
+		if (numRids == 0)
 		{
 			RecordID delRid;
 			Status s;
-			
+
 			delRid.pageNo = PageNo();
 			delRid.slotNo = i;
 			s = SortedPage::DeleteRecord(delRid);
 			assert(s == OK);
 			return OK;
 		}
+
+		char entry[MAX_SPACE];
+		int entryLen = MakeRidListEntry(entry, entryKey, rids, numRids,
+			overflowPid, GetRidEncoding(), GetRidBase());
+		return ReplaceEntry(i, entry, entryLen);
 	}
-	
+
 	return FAIL;
 }
 
 Status BTLeafPage::GetLast (RecordID& rid, char* key, RecordID & dataRid)
 {
+	RecordID rids[MAX_RIDS_PER_ENTRY];
+	PageID overflowPid;
+	PageGuard<RidOverflowPage> overflow;
+	int slot = numOfSlots - 1;
+	int pos;
+
 	rid.pageNo = pid;
-	rid.slotNo = numOfSlots - 1;
-	
+	rid.slotNo = LEAF_CURSOR(numOfSlots, 0);
+
 	if (numOfSlots == 0)
 	{
 		dataRid.pageNo = INVALID_PAGE;
 		dataRid.slotNo = INVALID_SLOT;
 		return DONE;
 	}
-	
-	GetKeyData(key, 
-		(DataType *)&dataRid, 
-		(KeyDataEntry *)(data + slots[numOfSlots - 1].offset),
-		slots[numOfSlots - 1].length,
-		(NodeType)type);
-	
+
+	pos = GetRidList(rids, overflowPid,
+		data + slots[slot].offset, slots[slot].length, GetRidEncoding(), GetRidBase());
+	while (overflowPid != INVALID_PAGE)
+	{
+		PIN_GUARD(overflowPid, overflow);
+		pos += overflow->numOfRids;
+		overflowPid = overflow->nextPage;
+	}
+
+	rid.slotNo = LEAF_CURSOR(slot, pos - 1);
+	return GetEntry(slot, pos - 1, key, dataRid, NULL);
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::CopyEntry
+//
+// Input   : slot - slot of the entry to copy.
+//           dest - leaf page to copy it to.
+// Output  : None
+// Purpose : Copy a whole entry to dest, which shares its overflow
+//           chain with this page until one of the two is dropped.  An
+//           empty dest takes this page's base; otherwise the entry is
+//           coded again relative to dest's, if that differs.
+// Return  : OK if successful, FAIL if dest has no room for it.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::CopyEntry (int slot, BTLeafPage *dest)
+{
+	char *entry = data + slots[slot].offset;
+	int entryLen = slots[slot].length;
+	char recoded[MAX_SPACE];
+	RecordID rid;
+
+	if (dest->numOfSlots == 0)
+		dest->SetRidBase(GetRidBase());
+
+	if (GetRidEncoding() == RID_VARINT && dest->GetRidBase() != GetRidBase())
+	{
+		RecordID rids[MAX_RIDS_PER_ENTRY];
+		PageID overflowPid;
+		int numRids = GetRidList(rids, overflowPid, entry, entryLen,
+			RID_VARINT, GetRidBase());
+		entryLen = MakeRidListEntry(recoded, entry, rids, numRids,
+			overflowPid, RID_VARINT, dest->GetRidBase());
+		entry = recoded;
+	}
+
+	return dest->SortedPage::InsertRecord(entry, entryLen, rid);
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::MoveEntry
+//
+// Input   : slot - slot of the entry to move.
+//           dest - leaf page to move it to.
+// Output  : None
+// Purpose : Move a whole entry, with its overflow chain, to dest.
+// Return  : OK if successful, FAIL if dest has no room for it.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::MoveEntry (int slot, BTLeafPage *dest)
+{
+	RecordID rid;
+
+	if (CopyEntry(slot, dest) != OK)
+		return FAIL;
+
+	rid.pageNo = pid;
+	rid.slotNo = slot;
+	return SortedPage::DeleteRecord(rid);
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::MoveFirst
+//
+// Input   : dest - leaf page to move the entry to.
+// Output  : None
+// Purpose : Move the entry with the smallest key to dest.  Splits and
+//           merges move whole entries so that a key never spans two
+//           leaves.
+// Return  : OK if successful, DONE if this page is empty, FAIL if
+//           dest has no room.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::MoveFirst (BTLeafPage *dest)
+{
+	if (numOfSlots == 0)
+		return DONE;
+
+	return MoveEntry(0, dest);
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::MoveLast
+//
+// Input   : dest - leaf page to move the entry to.
+// Output  : None
+// Purpose : Move the entry with the largest key to dest.
+// Return  : OK if successful, DONE if this page is empty, FAIL if
+//           dest has no room.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::MoveLast (BTLeafPage *dest)
+{
+	if (numOfSlots == 0)
+		return DONE;
+
+	return MoveEntry(numOfSlots - 1, dest);
+}
+
+
+//-------------------------------------------------------------------
+// BTLeafPage::FreeOverflow
+//
+// Input   : None
+// Output  : None
+// Purpose : Free the overflow chains of all entries on this page.
+//           Used when the index is destroyed.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BTLeafPage::FreeOverflow ()
+{
+	RecordID rids[MAX_RIDS_PER_ENTRY];
+	PageID overflowPid;
+	PageGuard<RidOverflowPage> overflow;
+
+	for (int i = 0; i < numOfSlots; i++)
+	{
+		GetRidList(rids, overflowPid,
+			data + slots[i].offset, slots[i].length, GetRidEncoding(), GetRidBase());
+		while (overflowPid != INVALID_PAGE)
+		{
+			PIN_GUARD(overflowPid, overflow);
+			PageID nextPid = overflow->nextPage;
+			FREE_GUARD(overflow);
+			overflowPid = nextPid;
+		}
+	}
+
 	return OK;
-}
\ No newline at end of file
+}
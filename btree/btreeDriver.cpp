@@ -6,14 +6,21 @@
 #include <ctime>
 #include <vector>
 #include <algorithm>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+#include <random>
 
 using namespace std;
 
 #include "heapfile.h"
+#include "scan.h"
 #include "bufmgr.h"
 #include "db.h"
 #include "btfile.h"
 #include "btreeDriver.h"
+#include "compositekey.h"
 
 
 void TestScanCount(int actualCount, int expectedCount) {
@@ -31,14 +38,14 @@ Status BTreeDriver::runTests() {
 	char *inputTxt = new char[inTxtLen];
 
 	cout << "Input a space separated test sequence (ie. a list of numbers " << endl <<
-		" in the range 0-7: 0 3 2 1) or hit ENTER to run all tests: ";
+		" in the range 0-9, a to p: 0 3 2 1) or hit ENTER to run all tests: ";
 
 	cin.getline (inputTxt, inTxtLen);
 	if (strlen(inputTxt) == 0) {
-		inputTxt = "01234567";
+		strcpy(inputTxt, "0123456789abcdefghijklmnop");
 	}
 	
-	minibase_globals = new SystemDefs(status, "BTREEDRIVER", "btlog", 1000, 500, 200, "Clock");
+	minibase_globals = new SystemDefs(status, "BTREEDRIVER", "btlog", 2000, 500, 200, "Clock");
 	if (status != OK) {
 		cerr << "ERROR: Couldn'initialize the Minibase globals" << std::endl;
 		minibase_errors.show_errors();
@@ -75,6 +82,60 @@ Status BTreeDriver::runTests() {
 		case '7':
 			result = Test7();
 			break;
+		case '8':
+			result = Test8();
+			break;
+		case '9':
+			result = Test9();
+			break;
+		case 'a':
+			result = Test10();
+			break;
+		case 'b':
+			result = Test11();
+			break;
+		case 'c':
+			result = Test12();
+			break;
+		case 'd':
+			result = Test13();
+			break;
+		case 'e':
+			result = Test14();
+			break;
+		case 'f':
+			result = Test15();
+			break;
+		case 'g':
+			result = Test16();
+			break;
+		case 'h':
+			result = Test17();
+			break;
+		case 'i':
+			result = Test18();
+			break;
+		case 'j':
+			result = Test19();
+			break;
+		case 'k':
+			result = Test20();
+			break;
+		case 'l':
+			result = Test21();
+			break;
+		case 'm':
+			result = Test22();
+			break;
+		case 'n':
+			result = Test23();
+			break;
+		case 'o':
+			result = Test24();
+			break;
+		case 'p':
+			result = Test25();
+			break;
 		}
 
 		if (!result || minibase_errors.error()) {
@@ -148,8 +209,9 @@ bool BTreeDriver::Test1() {
 		exit(1);
 	}
 
-	if (!InsertRange(btf, 1, 50)) {
-		std::cerr << "InsertRange(1, 50) failed" << std::endl;
+	//	40 entries and their slots and prefixes fill most of a page.
+	if (!InsertRange(btf, 1, 40)) {
+		std::cerr << "InsertRange(1, 40) failed" << std::endl;
 		res = false;
 	}
 
@@ -158,13 +220,13 @@ bool BTreeDriver::Test1() {
 		res = false;
 	}
 
-	if (!TestNumEntries(btf, 50)) {
-		std::cerr << "TestNumEntries(50) failed" << std::endl;
+	if (!TestNumEntries(btf, 40)) {
+		std::cerr << "TestNumEntries(40) failed" << std::endl;
 		res = false;
 	}
 	
 	std::vector<int> expectedKeys;
-	for (int i = 1; i <= 50; i++) {
+	for (int i = 1; i <= 40; i++) {
 		expectedKeys.push_back(i);
 	}
 	
@@ -712,156 +774,2095 @@ bool BTreeDriver::Test7() {
 	return res;
 }
 
-//	Test Helper functions
+//	Test composite keys and prefix scans
+bool BTreeDriver::Test8() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
 
-//-------------------------------------------------------------------
-// BTreeDriver::InsertRange
-//
-// Input   : btf,  The BTree to insert into.
-//           low,  The beginning of the range (inclusive).
-//           high, The end of the range (inclusive).
-//           ridOffset, The offset used to compute the rid.
-//           pad,  The amount of padding to use for the keys.
-//           reverse, Whether to insert in reverse order.
-// Output  : None
-// Return  : True if this operation completed succesfully.
-// Purpose : Inserts a range of keys into the B-Tree.
-//-------------------------------------------------------------------
-bool BTreeDriver::InsertRange(BTreeFile *btf, int low, int high,
-							  int ridOffset, int pad, bool reverse) {
-	int numKeys = high - low + 1;
-	int keyNum;
+	btf = new BTreeFile(status, "TestCompositeKeys");
 
-	char skey[MAX_KEY_SIZE];
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
 
-	int i;
-	if (reverse) {
-		i = numKeys - 1;
-	} else {
-		i = 0;
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
 	}
 
-	while (reverse && i >= 0 || !reverse && i < numKeys) {
-		RecordID rid;
-		keyNum = i+low;
-		rid.pageNo=keyNum + ridOffset;
-		rid.slotNo=keyNum + ridOffset + 1;
-		BTreeDriver::toString(keyNum, skey, pad);
+	//	Key on (dept integer, name string)
+	AttrType types[] = { attrInteger, attrString };
+	short strSizes[] = { 10 };
+	CompositeKey ckey(status, 2, types, strSizes);
 
-		if (btf->Insert(skey, rid) != OK) {
-			std::cerr << "Insertion of range failed at key=" << skey
-					  << " rid=" << rid << std::endl;
-			minibase_errors.show_errors();
-			return false;
-		}
+	Tuple *tuple = (Tuple *) new char[Tuple::max_size];
+	if (status != OK || tuple->setHdr(2, types, strSizes) != OK) {
+		std::cerr << "Error setting up composite key schema" << std::endl;
+		delete [] (char *)tuple;
+		delete btf;
+		return false;
+	}
 
-		if (reverse) {
-			i--;
-		} else {
-			i++;
+	//	Insert names in reverse so that key order differs from insert order.
+	const int numDepts = 7, numNames = 40;
+	char key[MAX_KEY_SIZE];
+	char name[20];
+	for (int n = numNames - 1; n >= 0 && res; n--) {
+		for (int d = 0; d < numDepts; d++) {
+			RecordID rid;
+			rid.pageNo = d;
+			rid.slotNo = n;
+
+			sprintf(name, "emp%03d", n);
+			tuple->setFld(1, d - numDepts / 2);
+			tuple->setFld(2, name);
+
+			if (ckey.MakeKey(tuple, key) != OK || btf->Insert(key, rid) != OK) {
+				std::cerr << "Inserting composite key (" << d - numDepts / 2
+						  << ", " << name << ") failed" << std::endl;
+				res = false;
+				break;
+			}
 		}
 	}
 
-	return true;
-}
-
-//	Delete from BTree with a certain stride
-bool BTreeDriver::DeleteStride(BTreeFile *btf, int low, int high,
-							  int stride, int pad) {
-	char lowKey[MAX_KEY_SIZE];
-	char highKey[MAX_KEY_SIZE];
-    BTreeDriver::toString(low, lowKey, pad);
-    BTreeDriver::toString(high, highKey, pad);
+	if (!TestNumEntries(btf, numDepts * numNames)) {
+		std::cerr << "TestNumEntries(" << numDepts * numNames << ") failed" << std::endl;
+		res = false;
+	}
 
-	IndexFileScan* scan = btf->OpenScan(lowKey, highKey);
-	RecordID rid;
-	char curKey[MAX_KEY_SIZE];
+	//	Negative departments must sort before positive ones.
+	IndexFileScan *scan = btf->OpenScan(NULL, NULL);
+	RecordID rid, prevRid;
 	int count = 0;
+	while (res && scan->GetNext(rid, key) == OK) {
+		if (count > 0 && (rid.pageNo < prevRid.pageNo ||
+			(rid.pageNo == prevRid.pageNo && rid.slotNo <= prevRid.slotNo))) {
+			std::cerr << "Composite keys out of order at " << rid << std::endl;
+			res = false;
+		}
+		prevRid = rid;
+		count++;
+	}
+	delete scan;
 
-	std::vector<std::pair<char*, RecordID>*> deleteVec;
+	//	Every prefix scan on dept returns exactly that department, by name.
+	for (int d = 0; d < numDepts && res; d++) {
+		tuple->setFld(1, d - numDepts / 2);
+		scan = ckey.OpenPrefixScan(btf, tuple, 1);
+		if (scan == NULL) {
+			std::cerr << "Error opening prefix scan" << std::endl;
+			res = false;
+			break;
+		}
 
-	while(scan->GetNext(rid, curKey) != DONE) {
-		char* tempKey = new char[MAX_KEY_SIZE];
-		memcpy(tempKey, curKey, strlen(curKey) + 1);
+		count = 0;
+		while (scan->GetNext(rid, key) == OK) {
+			if (rid.pageNo != d || rid.slotNo != count) {
+				std::cerr << "Prefix scan on dept " << d - numDepts / 2
+						  << " returned " << rid << std::endl;
+				res = false;
+				break;
+			}
+			count++;
+		}
+		delete scan;
 
-		if(count == 0) {
-			deleteVec.push_back(new std::pair<char*, RecordID>(tempKey, rid));
+		if (res && count != numNames) {
+			std::cerr << "Prefix scan on dept " << d - numDepts / 2 << " found "
+					  << count << " entries, expected " << numNames << std::endl;
+			res = false;
 		}
-		count = (count + 1)	% stride;
 	}
 
+	//	A prefix on both columns is an exact match.
+	tuple->setFld(1, 1);
+	strcpy(name, "emp007");
+	tuple->setFld(2, name);
+	scan = ckey.OpenPrefixScan(btf, tuple, 2);
+	if (scan == NULL || !TestScanCount(scan, 1)) {
+		std::cerr << "Exact prefix scan failed" << std::endl;
+		res = false;
+	}
 	delete scan;
 
-	int numToDelete = deleteVec.size();
-	int numDeleted = 0;
+	delete [] (char *)tuple;
 
-	std::vector<std::pair<char*, RecordID>*>::iterator it;
-	for(it = deleteVec.begin(); it != deleteVec.end(); it++) {
-		std::pair<char*, RecordID>* pair = *it;
-		if(btf->Delete(pair->first, pair->second) == OK) {
-			numDeleted++;
-		}
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
 	}
 
-	for(it = deleteVec.begin(); it != deleteVec.end(); it++) {
-		delete [] (*it)->first;
-		delete *it;
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 8 Passed!" << std::endl;
 	}
+	return res;
+}
 
-	if(numDeleted != numToDelete) {
-		std::cerr << "Error: Attempted to delete " << numToDelete
-         	      << "pairs. Only able to delete " << numDeleted << std::endl;
-		return false;
+//	Test duplicate keys, stored with both RecordID encodings
+bool BTreeDriver::Test9() {
+	bool res = true;
+
+	if (!TestDuplicates(RID_RAW)) {
+		std::cerr << "TestDuplicates(RID_RAW) failed" << std::endl;
+		res = false;
 	}
 
-	return true;
+	if (!TestDuplicates(RID_VARINT)) {
+		std::cerr << "TestDuplicates(RID_VARINT) failed" << std::endl;
+		res = false;
+	}
 
+	if (!TestClusteredRids()) {
+		std::cerr << "TestClusteredRids failed" << std::endl;
+		res = false;
+	}
+
+	if (res) {
+		std::cout << "Test 9 Passed!" << std::endl;
+	}
+	return res;
 }
 
-//-------------------------------------------------------------------
-// BTreeDriver::TestNumLeafPages
-//
-// Input   : btf,  The BTree to test
-//           expected,  The number of leaf pages you expect.
-// Output  : None
-// Return  : True if the number of leaf pages == expected.
-// Purpose : Tests the number of leaf pages in the tree.
-//-------------------------------------------------------------------
-bool BTreeDriver::TestNumLeafPages(BTreeFile *btf, int expected)
-{
-	PageID pid = GetLeftmostLeaf(btf);
+//	Test keys longer than MAX_KEY_SIZE
+bool BTreeDriver::Test10() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
 
-	if (pid == INVALID_PAGE) {
-		std::cerr << "Unable to access left leaf" << std::endl;
-		return false;
+	btf = new BTreeFile(status, "TestLongKeys");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
 	}
 
-	int numPages = 0;
+	//	All keys share a prefix longer than what fits inline, so only
+	//	their overflow chains tell them apart.
+	const int numKeys = 60, prefixLen = 250;
+	char *keys[numKeys];
+	RecordID rid;
 
-	while (pid != INVALID_PAGE) {
-		numPages++;
+	for (int k = 0; k < numKeys; k++) {
+		int len = 300 + (k * 53) % 301;
+		keys[k] = new char[len + 1];
+		memset(keys[k], 'x', len);
+		keys[k][len] = '\0';
+		BTreeDriver::toString(k, keys[k] + prefixLen, 4);
+		keys[k][prefixLen + 4] = 'y';
+	}
+
+	for (int k = 0; k < numKeys && res; k++) {
+		rid.pageNo = k;
+		rid.slotNo = k + 1;
+		if (btf->Insert(keys[(k * 7) % numKeys], rid) != OK) {
+			std::cerr << "Inserting long key " << (k * 7) % numKeys
+					  << " failed" << std::endl;
+			res = false;
+		}
+	}
 
-		SortedPage *page;
-		if (MINIBASE_BM->PinPage(pid, (Page *&)page) == FAIL) {
-			std::cerr << "Unable to pin page" << std::endl;
-			return false;
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	//	An exact match finds one key and gives back all of it.
+	BTreeFileScan *scan = (BTreeFileScan *)btf->OpenScan(keys[17], keys[17]);
+	KeyType skey;
+	if (scan->GetNext(rid, skey) != OK) {
+		std::cerr << "Scan of a long key found nothing" << std::endl;
+		res = false;
+	} else {
+		int len = scan->GetFullKeyLength();
+		char *fullKey = new char[len + 1];
+		if (len != (int)strlen(keys[17]) || scan->GetFullKey(fullKey) != OK ||
+			strcmp(fullKey, keys[17]) != 0) {
+			std::cerr << "Long key did not read back intact" << std::endl;
+			res = false;
+		}
+		delete [] fullKey;
+		if (scan->GetNext(rid, skey) != DONE) {
+			std::cerr << "Scan of a long key found too much" << std::endl;
+			res = false;
 		}
+	}
+	delete scan;
 
-		pid = page->GetNextPage();
+	//	A prefix reaching past the inline part: keys 10 to 19.
+	char *prefix = new char[prefixLen + 4];
+	strncpy(prefix, keys[10], prefixLen + 3);
+	prefix[prefixLen + 3] = '\0';
+	IndexFileScan *pscan = btf->OpenPrefixScan(prefix);
+	if (!TestScanCount(pscan, 10)) {
+		std::cerr << "Prefix scan of long keys failed" << std::endl;
+		res = false;
+	}
+	delete pscan;
+	delete [] prefix;
+
+	//	Looking long keys up writes nothing, so searches, scans and
+	//	deletes still work with every page of the database taken.
+	int freePages, numExtents, longest;
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+	std::vector<PageID> taken(freePages);
+	for (int i = 0; i < freePages && res; i++) {
+		if (MINIBASE_DB->AllocatePage(taken[i]) != OK) {
+			std::cerr << "Couldn't take free page " << i << std::endl;
+			res = false;
+		}
+	}
+	PageID leaf;
+	if (res && (btf->Search(keys[23], leaf) != OK || leaf == INVALID_PAGE)) {
+		std::cerr << "Search of a long key in a full database failed" << std::endl;
+		res = false;
+	}
+	scan = (BTreeFileScan *)btf->OpenScan(keys[23], keys[23]);
+	if (res && !TestScanCount(scan, 1)) {
+		std::cerr << "Scan of a long key in a full database failed" << std::endl;
+		res = false;
+	}
+	delete scan;
+	rid.pageNo = 43;
+	rid.slotNo = 44;
+	if (res && btf->Delete(keys[1], rid) != OK) {
+		std::cerr << "Deleting a long key in a full database failed" << std::endl;
+		res = false;
+	}
+	for (int i = 0; i < freePages; i++)
+		MINIBASE_DB->DeallocatePage(taken[i]);
 
-		if (MINIBASE_BM->UnpinPage(page->PageNo(), CLEAN) == FAIL) {
-			std::cerr << "Unable to unpin page" << std::endl;
-			return false;
+	for (int k = 0; k < numKeys && res; k += 2) {
+		rid.pageNo = (k * 43) % numKeys;
+		rid.slotNo = rid.pageNo + 1;
+		if (btf->Delete(keys[k], rid) != OK) {
+			std::cerr << "Deleting long key " << k << " failed" << std::endl;
+			res = false;
 		}
 	}
 
-	if (numPages != expected) {
-		std::cerr << "Unexpected number of leaf pages. Expected " << expected
-				  << ", but got " << numPages << std::endl;
-		return false;
+	if (res && !TestNumEntries(btf, numKeys / 2 - 1)) {
+		std::cerr << "TestNumEntries(" << numKeys / 2 - 1 << ") failed" << std::endl;
+		res = false;
 	}
 
-	return true;
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+	for (int k = 0; k < numKeys; k++)
+		delete [] keys[k];
+
+	if (res) {
+		std::cout << "Test 10 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that a long scan reads through a small ring of frames
+bool BTreeDriver::Test11() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestScanRing");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Many more leaves than frames, so the scan has to read most of
+	//	them back in.
+	const int numKeys = 12000;
+	if (!InsertRange(btf, 1, numKeys, 1, 5)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	MINIBASE_BM->ResetStat();
+	IndexFileScan *scan = btf->OpenScan(NULL, NULL);
+	if (res && !TestScanCount(scan, numKeys)) {
+		std::cerr << "Full scan failed" << std::endl;
+		res = false;
+	}
+	delete scan;
+
+	long taken, recycled;
+	MINIBASE_BM->GetStrategyStat(BULK_READ, taken, recycled);
+	int ringSize = MINIBASE_BM->GetNumOfBuffers() / 8;
+	if (ringSize > BULK_READ_RING_SIZE)
+		ringSize = BULK_READ_RING_SIZE;
+	if (res && (taken > ringSize || recycled == 0)) {
+		std::cerr << "Scan took " << taken << " frames from the pool and recycled "
+				  << recycled << ", expected at most " << ringSize
+				  << " and some" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	//	And so does a scan of a heap file of more pages than frames.
+	HeapFile *hf = new HeapFile("TestScanRingHeap", status);
+	const int numRecs = 2800, recLen = 240;
+	char rec[recLen];
+	RecordID rid;
+	memset(rec, 0, recLen);
+	for (int i = 0; i < numRecs && res && status == OK; i++) {
+		*(int *)rec = i;
+		if (hf->InsertRecord(rec, recLen, rid) != OK) {
+			std::cerr << "Couldn't insert record " << i << std::endl;
+			res = false;
+		}
+	}
+
+	MINIBASE_BM->ResetStat();
+	Scan *hscan = hf->OpenScan(status);
+	int len, count = 0;
+	while (res && hscan->GetNext(rid, rec, len) == OK) {
+		if (len != recLen || *(int *)rec != count) {
+			std::cerr << "Record " << count << " read back as " << *(int *)rec << std::endl;
+			res = false;
+		}
+		count++;
+	}
+	delete hscan;
+
+	MINIBASE_BM->GetStrategyStat(BULK_READ, taken, recycled);
+	if (res && (count != numRecs || taken > ringSize || recycled == 0)) {
+		std::cerr << "Heap scan read " << count << " records, took " << taken
+				  << " frames from the pool and recycled " << recycled << std::endl;
+		res = false;
+	}
+
+	if (hf->DeleteFile() != OK) {
+		std::cerr << "Error deleting HeapFile" << std::endl;
+		res = false;
+	}
+	delete hf;
+
+	if (res) {
+		std::cout << "Test 11 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that flushing writes runs of adjacent dirty pages together
+bool BTreeDriver::Test12() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestFlushRuns");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	A sequential load allocates its leaves one after another, so
+	//	the dirty pages of the pool sit next to each other on disk.
+	const int numKeys = 3000;
+	if (!InsertRange(btf, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	long writes, pages;
+	MINIBASE_BM->ResetStat();
+	if (MINIBASE_BM->FlushAllPages() != OK) {
+		std::cerr << "FlushAllPages failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->GetWriteStat(writes, pages);
+	if (res && (pages < 2 || writes * 2 > pages)) {
+		std::cerr << "Flush wrote " << pages << " pages in " << writes
+				  << " writes, expected at least two pages a write" << std::endl;
+		res = false;
+	}
+
+	//	Everything is clean now.
+	MINIBASE_BM->ResetStat();
+	MINIBASE_BM->FlushAllPages();
+	MINIBASE_BM->GetWriteStat(writes, pages);
+	if (res && pages != 0) {
+		std::cerr << "Second flush wrote " << pages << " pages" << std::endl;
+		res = false;
+	}
+
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 12 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test the background writer alongside inserts and deletes
+bool BTreeDriver::Test13() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestBackgroundWriter");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	More pages than frames, so the pool is full of dirty pages.
+	const int numKeys = 4000;
+	if (!InsertRange(btf, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	long writes, pages, clean, dirty, ahead;
+	MINIBASE_BM->ResetStat();
+	if (MINIBASE_BM->CleanAhead() != OK) {
+		std::cerr << "CleanAhead failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->GetWriteStat(writes, pages);
+	if (res && pages == 0) {
+		std::cerr << "CleanAhead wrote no pages" << std::endl;
+		res = false;
+	}
+
+	//	Deleting frees pages the writer may be writing.
+	if (MINIBASE_BM->StartBackgroundWriter(25, 1) != OK) {
+		std::cerr << "StartBackgroundWriter failed" << std::endl;
+		res = false;
+	}
+	if (res && !InsertRange(btf, numKeys + 1, 2 * numKeys)) {
+		std::cerr << "InsertRange(" << numKeys + 1 << ", " << 2 * numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && !DeleteStride(btf, 1, 2 * numKeys, 2)) {
+		std::cerr << "DeleteStride(1, " << 2 * numKeys << ", 2) failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->StopBackgroundWriter();
+
+	//	The writer cleaned victims ahead of the misses that took them.
+	MINIBASE_BM->GetEvictionStat(clean, dirty, ahead);
+	if (res && (ahead == 0 || ahead > clean)) {
+		std::cerr << ahead << " of " << clean << " clean evictions cleaned ahead" << std::endl;
+		res = false;
+	}
+
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 13 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test prefetching pages, directly and from scans and tree walks
+bool BTreeDriver::Test14() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestPrefetch");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	More leaves than frames, all of them clean.
+	const int numKeys = 12000;
+	if (!InsertRange(btf, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->FlushAllPages();
+
+	//	Pages out of the database are skipped, and a page prefetched
+	//	twice is read once.
+	PageID pids[] = { GetLeftmostLeaf(btf), INVALID_PAGE, MINIBASE_DB->GetNumOfPages() };
+	PageID leaf = pids[0];
+	MINIBASE_BM->Prefetch(pids, 3);
+	MINIBASE_BM->Prefetch(pids, 1);
+	Page *page;
+	if (res && (MINIBASE_BM->PinPage(leaf, page) != OK ||
+				MINIBASE_BM->UnpinPage(leaf, CLEAN) != OK)) {
+		std::cerr << "Couldn't pin prefetched page " << leaf << std::endl;
+		res = false;
+	}
+
+	//	A scan prefetches each leaf while it reads the one before.
+	MINIBASE_BM->ResetStat();
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && MINIBASE_BM->GetPrefetchStat() == 0) {
+		std::cerr << "The scan prefetched no pages" << std::endl;
+		res = false;
+	}
+
+	//	And so does destroying the tree, a level at a time.
+	MINIBASE_BM->ResetStat();
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+	if (res && MINIBASE_BM->GetPrefetchStat() == 0) {
+		std::cerr << "DestroyFile prefetched no pages" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 14 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that the buffer pool metrics count pins by index and node type
+bool BTreeDriver::Test15() {
+	Status status;
+	BTreeFile *btfA, *btfB;
+	bool res = true;
+
+	btfA = new BTreeFile(status, "TestMetricsA");
+	if (status == OK)
+		btfB = new BTreeFile(status, "TestMetricsB");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	const int numKeys = 2000;
+	if (!InsertRange(btfA, 1, numKeys) || !InsertRange(btfB, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	int a = btfA->metricsFile, b = btfB->metricsFile;
+	if (a == 0 || a == b || strcmp(MINIBASE_BM->GetMetricsFileName(a), "TestMetricsA") != 0 ||
+		MINIBASE_BM->RegisterMetricsFile("TestMetricsA", NULL) != a) {
+		std::cerr << "Indexes registered as " << a << " and " << b << std::endl;
+		res = false;
+	}
+
+	//	A scan of A descends through its index nodes to its leaves, and
+	//	does not touch B.
+	BufMetrics before, delta;
+	MINIBASE_BM->GetMetrics(before);
+	if (res && !TestNumEntries(btfA, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->GetMetrics(delta);
+	delta.Subtract(before);
+
+	long holds = 0;
+	for (int i = 0; i < PIN_HOLD_BUCKETS; i++)
+		holds += delta.pinHolds[i];
+	long pinsOfB = 0;
+	for (int t = 0; t < METRICS_MAX_TYPES; t++)
+		pinsOfB += delta.pins[b][t];
+
+	if (res && (delta.pins[a][INDEX_NODE] == 0 || delta.pins[a][LEAF_NODE] == 0 || pinsOfB != 0)) {
+		std::cerr << "Scan of A counted " << delta.pins[a][INDEX_NODE] << " index and "
+				  << delta.pins[a][LEAF_NODE] << " leaf pins, and " << pinsOfB
+				  << " pins of B" << std::endl;
+		res = false;
+	}
+	if (res && (delta.TotalPins() < delta.pins[a][INDEX_NODE] + delta.pins[a][LEAF_NODE] ||
+				holds == 0 || holds > delta.TotalPins() || delta.TotalMisses() < 0)) {
+		std::cerr << "Scan of A counted " << delta.TotalPins() << " pins, "
+				  << delta.TotalMisses() << " misses and " << holds << " pin holds" << std::endl;
+		res = false;
+	}
+
+	if (btfA->DestroyFile() != OK || btfB->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btfA;
+	delete btfB;
+
+	if (res) {
+		std::cout << "Test 15 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that the buffer pool grows and shrinks under an open scan
+bool BTreeDriver::Test16() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestResize");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	const int numKeys = 6000;
+	if (!InsertRange(btf, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	unsigned int numOfBuf = MINIBASE_BM->GetNumOfBuffers();
+	unsigned int unpinned = MINIBASE_BM->GetNumOfUnpinnedBuffers();
+
+	//	Grow the pool half way through a scan, which goes on with the
+	//	leaf it has pinned and the frame numbers of its rings gone stale.
+	IndexFileScan *scan = btf->OpenScan(NULL, NULL);
+	RecordID rid;
+	char key[MAX_KEY_SIZE];
+	int seen = 0;
+	while (seen < numKeys / 2 && scan->GetNext(rid, key) != DONE)
+		seen++;
+	if (MINIBASE_BM->Resize(3 * numOfBuf) != OK ||
+		MINIBASE_BM->GetNumOfBuffers() != 3 * numOfBuf) {
+		std::cerr << "Couldn't grow the pool to " << 3 * numOfBuf << " frames" << std::endl;
+		res = false;
+	}
+	while (scan->GetNext(rid, key) != DONE)
+		seen++;
+	delete scan;
+	if (seen != numKeys) {
+		std::cerr << "Scan across the resize saw " << seen << " keys" << std::endl;
+		res = false;
+	}
+
+	//	Shrink it below the pages just dirtied, which are written as
+	//	their frames are given up.
+	if (res && !InsertRange(btf, numKeys + 1, 2 * numKeys)) {
+		std::cerr << "InsertRange(" << numKeys + 1 << ", " << 2 * numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && MINIBASE_BM->Resize(numOfBuf / 2) != OK) {
+		std::cerr << "Couldn't shrink the pool to " << numOfBuf / 2 << " frames" << std::endl;
+		res = false;
+	}
+	if (res && !TestNumEntries(btf, 2 * numKeys)) {
+		std::cerr << "TestNumEntries(" << 2 * numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	//	Pages pinned in more frames than would be left, or fewer frames
+	//	than shards: the pool stays as it is.
+	std::vector<PageID> pinned;
+	Page *page;
+	for (PageID pid = 0; res && pid < (PageID)numOfBuf * 3 / 10; pid++) {
+		if (MINIBASE_BM->PinPage(pid, page) != OK) {
+			std::cerr << "Couldn't pin page " << pid << std::endl;
+			res = false;
+		}
+		else
+			pinned.push_back(pid);
+	}
+	if (res && (MINIBASE_BM->Resize(numOfBuf / 5) == OK ||
+				MINIBASE_BM->Resize(MINIBASE_BM->GetNumOfShards() - 1) == OK ||
+				MINIBASE_BM->GetNumOfBuffers() != numOfBuf / 2)) {
+		std::cerr << "Shrank the pool to " << MINIBASE_BM->GetNumOfBuffers()
+				  << " frames with " << pinned.size() << " pages pinned" << std::endl;
+		res = false;
+	}
+	for (size_t i = 0; i < pinned.size(); i++)
+		MINIBASE_BM->UnpinPage(pinned[i], CLEAN);
+
+	if (MINIBASE_BM->Resize(numOfBuf) != OK ||
+		MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned) {
+		std::cerr << "Couldn't resize the pool back to " << numOfBuf << " frames" << std::endl;
+		res = false;
+	}
+	if (res && !TestNumEntries(btf, 2 * numKeys)) {
+		std::cerr << "TestNumEntries(" << 2 * numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 16 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test saving the buffer pool's hot set and warming the pool from it
+bool BTreeDriver::Test17() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestHotSet");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	const int numKeys = 2000;
+	const char *hotSetName = "TestHotSet-hot";
+	if (!InsertRange(btf, 1, numKeys)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	unsigned int numOfBuf = MINIBASE_BM->GetNumOfBuffers();
+
+	//	Save the hot set, then cool the pool by shrinking it and growing
+	//	it back, as a restart would leave it.
+	if (res && (MINIBASE_BM->FlushAllPages() != OK ||
+				MINIBASE_BM->SaveHotSet(hotSetName) != OK)) {
+		std::cerr << "Couldn't save the hot set" << std::endl;
+		res = false;
+	}
+	if (res && (MINIBASE_BM->Resize(numOfBuf / 10) != OK ||
+				MINIBASE_BM->Resize(numOfBuf) != OK)) {
+		std::cerr << "Couldn't cool the pool" << std::endl;
+		res = false;
+	}
+
+	//	Warm it from the hot set: the tree is back in the pool, and
+	//	counting its entries reads nothing.
+	long warmedBefore = MINIBASE_BM->GetWarmStat();
+	if (res && MINIBASE_BM->LoadHotSet(hotSetName) != OK) {
+		std::cerr << "Couldn't load the hot set" << std::endl;
+		res = false;
+	}
+	long pinsBefore, missesBefore, pins, misses;
+	MINIBASE_BM->GetStat(pinsBefore, missesBefore);
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->GetStat(pins, misses);
+	if (res && (MINIBASE_BM->GetWarmStat() == warmedBefore || misses != missesBefore)) {
+		std::cerr << "Warmed " << MINIBASE_BM->GetWarmStat() - warmedBefore << " pages, then "
+				  << misses - missesBefore << " misses in " << pins - pinsBefore
+				  << " pins" << std::endl;
+		res = false;
+	}
+
+	//	A hot set that cannot take the place of fileName, a directory,
+	//	fails and leaves no temporary file behind.
+	const char *hotSetDir = "TestHotSet-dir";
+	std::string hotSetTemp = std::string(hotSetDir) + ".new";
+	mkdir(hotSetDir, 0755);
+	if (res && MINIBASE_BM->SaveHotSet(hotSetDir) == OK) {
+		std::cerr << "Saved a hot set over a directory" << std::endl;
+		res = false;
+	}
+	if (res && remove(hotSetTemp.c_str()) == 0) {
+		std::cerr << "SaveHotSet left " << hotSetTemp << " behind" << std::endl;
+		res = false;
+	}
+	rmdir(hotSetDir);
+
+	//	The keeper saves the hot set when it stops.  The pool's own keeper
+	//	is stopped meanwhile and started again after.
+	MINIBASE_BM->StopHotSetKeeper();
+	remove(hotSetName);
+	if (MINIBASE_BM->StartHotSetKeeper(hotSetName, false, 10) != OK) {
+		std::cerr << "Couldn't start the hot set keeper" << std::endl;
+		res = false;
+	}
+	MINIBASE_BM->StopHotSetKeeper();
+	if (res && MINIBASE_BM->LoadHotSet(hotSetName) != OK) {
+		std::cerr << "The hot set keeper left no hot set" << std::endl;
+		res = false;
+	}
+	std::string poolHotSetName = std::string(MINIBASE_DBNAME) + "-hot";
+	MINIBASE_BM->StartHotSetKeeper(poolHotSetName.c_str(), false);
+	remove(hotSetName);
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 17 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that the top levels of an index stay pinned
+bool BTreeDriver::Test18() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+	unsigned int unpinned = MINIBASE_BM->GetNumOfUnpinnedBuffers();
+
+	btf = new BTreeFile(status, "TestPinnedLevels", RID_RAW, 2);
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Long keys make a tree of three levels; the top two stay pinned
+	//	through the root splits and index splits on the way.
+	const int numKeys = 2000, pad = 40;
+	if (!InsertRange(btf, 1, numKeys, 0, pad)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	int numPinned = btf->GetNumOfPinnedNodes();
+	if (res && (numPinned < 2 ||
+				MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned - 1 - numPinned)) {
+		std::cerr << numPinned << " nodes pinned, "
+				  << MINIBASE_BM->GetNumOfUnpinnedBuffers() << " frames unpinned" << std::endl;
+		res = false;
+	}
+
+	//	A search pins two pages fewer than through a handle pinning none.
+	BTreeFile *plain = new BTreeFile(status, "TestPinnedLevels");
+	char skey[MAX_KEY_SIZE];
+	PageID pinnedLeaf, plainLeaf;
+	long pins, misses, pinsPinned, pinsPlain;
+	BTreeDriver::toString(numKeys / 3, skey, pad);
+	MINIBASE_BM->GetStat(pins, misses);
+	btf->Search(skey, pinnedLeaf);
+	MINIBASE_BM->GetStat(pinsPinned, misses);
+	plain->Search(skey, plainLeaf);
+	MINIBASE_BM->GetStat(pinsPlain, misses);
+	delete plain;
+	if (res && (pinnedLeaf != plainLeaf || (pinsPlain - pinsPinned) - (pinsPinned - pins) != 2)) {
+		std::cerr << "Search pinned " << pinsPinned - pins << " pages, and "
+				  << pinsPlain - pinsPinned << " with no nodes pinned" << std::endl;
+		res = false;
+	}
+
+	//	Deleting every key merges the pinned levels away.
+	if (res && !DeleteStride(btf, 1, numKeys, 1, pad)) {
+		std::cerr << "DeleteStride(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && (!TestNumEntries(btf, 0) ||
+				MINIBASE_BM->GetNumOfUnpinnedBuffers() !=
+				unpinned - 1 - btf->GetNumOfPinnedNodes())) {
+		std::cerr << "After deleting, " << btf->GetNumOfPinnedNodes() << " nodes pinned, "
+				  << MINIBASE_BM->GetNumOfUnpinnedBuffers() << " frames unpinned" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res && MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned) {
+		std::cerr << "Pages left pinned" << std::endl;
+		res = false;
+	}
+	if (res) {
+		std::cout << "Test 18 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test following swizzled child links from resident index pages
+bool BTreeDriver::Test19() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestSwizzling");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Inserts pin their way down through the links too.
+	const int numKeys = 1000, pad = 40, stride = 7;
+	btf->SetSwizzling(true);
+	if (!InsertRange(btf, 1, numKeys, 0, pad)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	//	Searches through the links find the leaves a handle that does not
+	//	follow them finds: the first time round, then through the links
+	//	set the first time, then after the pool is cooled, when the
+	//	links point at frames that hold other pages or none.
+	BTreeFile *plain = new BTreeFile(status, "TestSwizzling");
+	unsigned int numOfBuf = MINIBASE_BM->GetNumOfBuffers();
+	long followed[4], missed[4];
+	char skey[MAX_KEY_SIZE];
+	PageID leaf, plainLeaf;
+
+	for (int round = 0; round < 3 && res; round++) {
+		MINIBASE_BM->GetSwizzleStat(followed[round], missed[round]);
+		if (round == 2 && (MINIBASE_BM->Resize(numOfBuf / 10) != OK ||
+						   MINIBASE_BM->Resize(numOfBuf) != OK)) {
+			std::cerr << "Couldn't cool the pool" << std::endl;
+			res = false;
+		}
+		for (int key = 1; key <= numKeys && res; key += stride) {
+			BTreeDriver::toString(key, skey, pad);
+			if (btf->Search(skey, leaf) != OK || plain->Search(skey, plainLeaf) != OK ||
+				leaf != plainLeaf) {
+				std::cerr << "Search of " << key << " found leaf " << leaf
+						  << ", not " << plainLeaf << std::endl;
+				res = false;
+			}
+		}
+	}
+	MINIBASE_BM->GetSwizzleStat(followed[3], missed[3]);
+	delete plain;
+
+	//	Two hops a search; the second round misses only where two children
+	//	share a slot, the third where the pool was cooled.
+	long hops = 2 * ((numKeys + stride - 1) / stride);
+	if (res && (followed[2] - followed[1] < hops / 2 ||
+				missed[2] - missed[1] + followed[2] - followed[1] != hops ||
+				missed[3] - missed[2] <= missed[2] - missed[1])) {
+		std::cerr << "Links followed/missed: " << followed[2] - followed[1] << "/"
+				  << missed[2] - missed[1] << " warm, " << followed[3] - followed[2]
+				  << "/" << missed[3] - missed[2] << " cooled" << std::endl;
+		res = false;
+	}
+
+	if (res && !TestNumEntries(btf, numKeys)) {
+		std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	if (res) {
+		std::cout << "Test 19 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that page guards leave no pins behind
+bool BTreeDriver::Test20() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+	unsigned int unpinned = MINIBASE_BM->GetNumOfUnpinnedBuffers();
+
+	MINIBASE_BM->SetPinTracking(true);
+	btf = new BTreeFile(status, "TestPageGuards");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Splits, merges and scans leave only the header pinned.
+	const int numKeys = 1000, pad = 40;
+	if (!InsertRange(btf, 1, numKeys, 0, pad)) {
+		std::cerr << "InsertRange(1, " << numKeys << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && !DeleteStride(btf, 1, numKeys, 2, pad)) {
+		std::cerr << "DeleteStride(1, " << numKeys << ", 2) failed" << std::endl;
+		res = false;
+	}
+	if (res && !TestNumEntries(btf, numKeys / 2)) {
+		std::cerr << "TestNumEntries(" << numKeys / 2 << ") failed" << std::endl;
+		res = false;
+	}
+	if (res && (MINIBASE_BM->GetNumOfTrackedPins() != 1 ||
+				MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned - 1)) {
+		std::cerr << "Pins held after the updates:" << std::endl;
+		MINIBASE_BM->ReportPins(std::cerr);
+		res = false;
+	}
+
+	//	A pin held here is reported against this file, moves with its
+	//	guard, and is dropped when the guard goes.
+	{
+		PageGuard<SortedPage> held;
+		if (MINIBASE_BM->PinPage(btf->header->GetRootPageID(), held, PIN_SITE) != OK) {
+			res = false;
+		}
+		PageGuard<SortedPage> moved(std::move(held));
+		std::ostringstream report;
+		MINIBASE_BM->ReportPins(report);
+		if (res && (held.IsPinned() || !moved.IsPinned() ||
+					MINIBASE_BM->GetNumOfTrackedPins() != 2 ||
+					report.str().find("btreeDriver.cpp") == std::string::npos)) {
+			std::cerr << "Pins held with a guard here:" << std::endl << report.str();
+			res = false;
+		}
+	}
+	if (res && MINIBASE_BM->GetNumOfTrackedPins() != 1) {
+		std::cerr << "Guard left its page pinned" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+	MINIBASE_BM->SetPinTracking(false);
+
+	if (res && (MINIBASE_BM->GetNumOfTrackedPins() != 0 ||
+				MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned)) {
+		std::cerr << "Pages left pinned" << std::endl;
+		res = false;
+	}
+	if (res) {
+		std::cout << "Test 20 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test allocating and freeing runs of pages from the free extents
+bool BTreeDriver::Test21() {
+	bool res = true;
+	Status status;
+	int freePages, numExtents, longest;
+	int freeNow, extentsNow, longestNow;
+
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+
+	//	Runs come out of the free extents, and a page freed alone between
+	//	used pages is the extent a one page run takes.
+	PageID a, b, c, d;
+	if (MINIBASE_DB->AllocatePage(a, 32) != OK || MINIBASE_DB->AllocatePage(b) != OK ||
+		MINIBASE_DB->AllocatePage(c, 8) != OK) {
+		std::cerr << "Couldn't allocate the runs" << std::endl;
+		return false;
+	}
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (freeNow != freePages - 41) {
+		std::cerr << freeNow << " pages free after allocating 41 of "
+				  << freePages << std::endl;
+		res = false;
+	}
+
+	MINIBASE_DB->DeallocatePage(c + 3);
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	int holes = extentsNow;
+	if (MINIBASE_DB->AllocatePage(d) != OK) {
+		res = false;
+	}
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (res && extentsNow != holes - 1) {
+		std::cerr << "Page " << d << " was not taken from a one page extent" << std::endl;
+		res = false;
+	}
+
+	//	Freed in pieces, and some twice, the runs join up into the
+	//	extents there were before.
+	MINIBASE_DB->DeallocatePage(d);
+	MINIBASE_DB->DeallocatePage(c, 8);
+	MINIBASE_DB->DeallocatePage(c + 3);
+	MINIBASE_DB->DeallocatePage(b);
+	MINIBASE_DB->DeallocatePage(a + 16, 16);
+	MINIBASE_DB->DeallocatePage(a, 16);
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (freeNow != freePages || extentsNow != numExtents || longestNow != longest) {
+		std::cerr << "Free pages/extents/longest " << freeNow << "/" << extentsNow
+				  << "/" << longestNow << ", not " << freePages << "/" << numExtents
+				  << "/" << longest << std::endl;
+		res = false;
+	}
+
+	//	The extents agree with the space map on disk, as read afresh.
+	DB reopened(MINIBASE_DB->GetName(), 0, status);
+	if (status != OK) {
+		std::cerr << "Couldn't reopen the database" << std::endl;
+		return false;
+	}
+	reopened.GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (freeNow != freePages || extentsNow != numExtents || longestNow != longest) {
+		std::cerr << "Space map has free pages/extents/longest " << freeNow << "/"
+				  << extentsNow << "/" << longestNow << std::endl;
+		res = false;
+	}
+
+	if (res) {
+		std::cout << "Test 21 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test that the leaves of each tree are allocated from its own extents
+bool BTreeDriver::Test22() {
+	Status status;
+	BTreeFile *btf[2];
+	bool res = true;
+	int freePages, numExtents, longest;
+	int freeNow, extentsNow, longestNow;
+
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+	btf[0] = new BTreeFile(status, "TestLeafExtents0");
+	if (status == OK)
+		btf[1] = new BTreeFile(status, "TestLeafExtents1");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Two trees grown together each take their own extents, so the
+	//	leaves of each follow one another on disk.
+	const int numKeys = 1000, pad = 40;
+	for (int key = 1; key <= numKeys && res; key++) {
+		for (int t = 0; t < 2 && res; t++) {
+			if (!InsertKey(btf[t], key, pad)) {
+				res = false;
+			}
+		}
+	}
+	for (int t = 0; t < 2 && res; t++) {
+		int numLeaves;
+		int sequential = CountSequentialLeaves(btf[t], numLeaves);
+		if (numLeaves < 50 || sequential < (numLeaves - 1) * 9 / 10) {
+			std::cerr << "Tree " << t << ": " << sequential << " of " << numLeaves
+					  << " leaves are followed by the next page" << std::endl;
+			res = false;
+		}
+		if (res && !TestNumEntries(btf[t], numKeys)) {
+			std::cerr << "TestNumEntries(" << numKeys << ") failed" << std::endl;
+			res = false;
+		}
+	}
+
+	//	A tree that is never closed leaves the pages it reserved listed
+	//	in its header page, and takes them back when opened again.
+	btf[0]->reserved.clear();
+	btf[0]->reorgReserved.clear();
+	btf[0]->header.Unpin();
+	btf[0]->headerID = INVALID_PAGE;
+	delete btf[0];
+	btf[0] = new BTreeFile(status, "TestLeafExtents0");
+	if (status != OK || (res && !TestNumEntries(btf[0], numKeys))) {
+		std::cerr << "Couldn't reopen a tree that was not closed" << std::endl;
+		res = false;
+	}
+
+	//	The pages reserved and not used go back with the trees.
+	for (int t = 0; t < 2; t++) {
+		if (btf[t]->DestroyFile() != OK) {
+			std::cerr << "Error destroying BTreeFile" << std::endl;
+			res = false;
+		}
+		delete btf[t];
+	}
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (res && freeNow != freePages) {
+		std::cerr << freeNow << " pages free after the trees went, not "
+				  << freePages << std::endl;
+		res = false;
+	}
+
+	if (res) {
+		std::cout << "Test 22 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test reorganizing the leaves of a tree into contiguous extents
+bool BTreeDriver::Test23() {
+	Status status;
+	BTreeFile *btf, *other;
+	bool res = true;
+	int freePages, numExtents, longest;
+	int freeNow, extentsNow, longestNow;
+	unsigned int unpinned = MINIBASE_BM->GetNumOfUnpinnedBuffers();
+
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+	btf = new BTreeFile(status, "TestReorganize");
+	if (status == OK)
+		other = new BTreeFile(status, "TestReorganizeOther");
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Keys out of order, into two trees at once, then half of them
+	//	deleted: leaves part full, and out of order on disk.
+	const int numKeys = 1200, pad = 40, stride = 2;
+	for (int i = 0; i < numKeys && res; i++) {
+		int key = i * 7919 % numKeys + 1;
+		if (!InsertKey(btf, key, pad) || !InsertKey(other, key, pad)) {
+			res = false;
+		}
+	}
+	std::vector<int> keys;
+	for (int key = 1; key <= numKeys && res; key++) {
+		if (key % stride == 0) {
+			res = DeleteKey(btf, key, pad, false);
+		} else {
+			keys.push_back(key);
+		}
+	}
+	int leavesBefore, leavesAfter;
+	int sequentialBefore = CountSequentialLeaves(btf, leavesBefore);
+
+	//	Whether the database has a run of free pages to hold the new
+	//	leaves together; earlier tests may have left it in pieces.
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	bool roomy = longestNow >= leavesBefore + BTREE_EXTENT_PAGES;
+
+	//	A step at a time, with keys added at the end and some taken out
+	//	again in between.
+	int steps = 0, added = numKeys;
+	while (res) {
+		status = btf->ReorganizeStep(0.9f, 8);
+		if (status == DONE)
+			break;
+		if (status != OK) {
+			std::cerr << "ReorganizeStep failed" << std::endl;
+			res = false;
+			break;
+		}
+		steps++;
+		res = InsertKey(btf, ++added, pad) && InsertKey(btf, ++added, pad) &&
+			DeleteKey(btf, added, pad, false);
+		keys.push_back(added - 1);
+	}
+
+	//	Fuller, in order on disk, one after another if there was room,
+	//	and still the same tree.
+	int forwardAfter;
+	int sequentialAfter = CountSequentialLeaves(btf, leavesAfter, &forwardAfter);
+	if (res && (steps < 2 || leavesAfter >= leavesBefore ||
+				forwardAfter < (leavesAfter - 1) * 8 / 10 ||
+				(roomy && sequentialAfter < (leavesAfter - 1) * 9 / 10))) {
+		std::cerr << steps << " steps; " << sequentialBefore << " of " << leavesBefore
+				  << " leaves followed by the next page before, " << sequentialAfter
+				  << " of " << leavesAfter << " after, " << forwardAfter
+				  << " by a later one" << std::endl;
+		res = false;
+	}
+	if (res && !TestScanKeys(btf, NULL, NULL, keys, pad)) {
+		std::cerr << "Scan after reorganizing failed" << std::endl;
+		res = false;
+	}
+	for (size_t i = 0; i < keys.size() && res; i += 5) {
+		res = DeleteKey(btf, keys[i], pad, false) && InsertKey(btf, keys[i], pad);
+	}
+	if (res && (!TestNumEntries(btf, keys.size()) || !TestNumEntries(other, numKeys))) {
+		std::cerr << "TestNumEntries failed after reorganizing" << std::endl;
+		res = false;
+	}
+
+	//	A step that cannot have pages for all of its new leaves fails,
+	//	and leaves the batch as it was, the pages it took reserved.
+	std::vector< std::pair<PageID, int> > held;
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	while (res && freeNow > 3) {
+		PageID start;
+		int n = std::min(longestNow, freeNow - 3);
+		if (MINIBASE_DB->AllocatePage(start, n) != OK) {
+			std::cerr << "Couldn't fill the database" << std::endl;
+			res = false;
+		}
+		held.push_back(std::make_pair(start, n));
+		MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	}
+	if (res && btf->ReorganizeStep(0.4f, 8) != FAIL) {
+		std::cerr << "ReorganizeStep with no pages to be had did not fail" << std::endl;
+		res = false;
+	}
+	if (res && (int)btf->reorgReserved.size() != freeNow) {
+		std::cerr << btf->reorgReserved.size() << " pages reserved after the step failed, not "
+				  << freeNow << std::endl;
+		res = false;
+	}
+	for (size_t i = 0; i < held.size(); i++) {
+		MINIBASE_DB->DeallocatePage(held[i].first, held[i].second);
+	}
+	minibase_errors.clear_errors();
+	if (res && (!TestScanKeys(btf, NULL, NULL, keys, pad) || !TestNumEntries(btf, keys.size()) ||
+				btf->ReorganizeStep(0.4f, 8) != OK)) {
+		std::cerr << "The tree changed in a step that failed" << std::endl;
+		res = false;
+	}
+
+	//	A scan open across steps, some taken with the key it returned
+	//	last deleted, still returns every key once, in order.
+	IndexFileScan *scan = btf->OpenScan(NULL, NULL);
+	char scanKey[MAX_KEY_SIZE], expectedKey[MAX_KEY_SIZE];
+	RecordID scanRid;
+	std::vector<int> gone;
+	size_t seen = 0;
+	if (res && btf->ReorganizeStep(0.6f, 4) == FAIL) {
+		res = false;
+	}
+	while (res && scan->GetNext(scanRid, scanKey) == OK) {
+		if (seen < keys.size())
+			toString(keys[seen], expectedKey, pad);
+		if (seen >= keys.size() || strcmp(scanKey, expectedKey) != 0) {
+			std::cerr << "Scan across steps returned " << scanKey << " for key "
+					  << seen << std::endl;
+			res = false;
+			break;
+		}
+		if (seen % 3 == 0) {
+			res = DeleteKey(btf, keys[seen], pad, false);
+			gone.push_back(keys[seen]);
+		}
+		if (res && seen % 3 != 2 && btf->ReorganizeStep(0.6f, 4) == FAIL) {
+			std::cerr << "ReorganizeStep failed under a scan" << std::endl;
+			res = false;
+		}
+		seen++;
+	}
+	delete scan;
+	if (res && seen != keys.size()) {
+		std::cerr << "Scan across steps returned " << seen << " keys, not "
+				  << keys.size() << std::endl;
+		res = false;
+	}
+	for (size_t i = 0; i < gone.size() && res; i++) {
+		res = InsertKey(btf, gone[i], pad);
+	}
+
+	//	All at once, full, in a tree opened afresh: the old leaves are
+	//	freed, and the pages reserved and not used go back on closing.
+	delete other;
+	other = new BTreeFile(status, "TestReorganizeOther");
+	MINIBASE_DB->GetFreeExtentStat(freePages, numExtents, longest);
+	CountSequentialLeaves(other, leavesBefore);
+	if (res && (status != OK || other->Reorganize(1.0f) != OK ||
+				!TestNumEntries(other, numKeys))) {
+		std::cerr << "Reorganize failed" << std::endl;
+		res = false;
+	}
+	CountSequentialLeaves(other, leavesAfter);
+	delete other;
+	MINIBASE_DB->GetFreeExtentStat(freeNow, extentsNow, longestNow);
+	if (res && freeNow != freePages + leavesBefore - leavesAfter) {
+		std::cerr << freeNow << " pages free after going from " << leavesBefore
+				  << " leaves to " << leavesAfter << ", not " << freePages
+				  << std::endl;
+		res = false;
+	}
+	other = new BTreeFile(status, "TestReorganizeOther");
+
+	if (btf->DestroyFile() != OK || other->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+	delete btf;
+	delete other;
+
+	if (res && MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned) {
+		std::cerr << "Pages left pinned" << std::endl;
+		res = false;
+	}
+
+	if (res) {
+		std::cout << "Test 23 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test pins from several threads at once, with more pages than frames
+bool BTreeDriver::Test24() {
+	bool res = true;
+	unsigned int unpinned = MINIBASE_BM->GetNumOfUnpinnedBuffers();
+
+	//	Each page holds its own id and the number of times it was
+	//	written.
+	const int numPages = MINIBASE_BM->GetNumOfBuffers() * 3 / 2;
+	const int numThreads = 4, numOps = 20000;
+	std::vector<PageID> pids(numPages);
+	Page *page;
+	for (int i = 0; i < numPages && res; i++) {
+		if (MINIBASE_DB->AllocatePage(pids[i]) != OK ||
+			MINIBASE_BM->PinPage(pids[i], page, true) != OK) {
+			std::cerr << "Couldn't allocate page " << i << std::endl;
+			return false;
+		}
+		((int *)page)[0] = pids[i];
+		((int *)page)[1] = 0;
+		MINIBASE_BM->UnpinPage(pids[i], DIRTY);
+	}
+
+	//	Each thread pins pages of its own half of the file, which
+	//	overlaps those of the others, reading most and writing one in
+	//	four.  Pins miss and evict all the while.
+	std::vector<std::thread> threads;
+	std::vector<long> writes(numThreads, 0);
+	std::vector<bool> failed(numThreads, false);
+	for (int t = 0; t < numThreads; t++) {
+		threads.push_back(std::thread([&, t]() {
+			std::mt19937 rng(t);
+			std::uniform_int_distribution<int> half(0, numPages / 2 - 1);
+			Page *page;
+
+			for (int i = 0; i < numOps && !failed[t]; i++) {
+				PageID pid = pids[(t * numPages / (2 * numThreads) + half(rng)) % numPages];
+				LatchMode mode = i % 4 == 3 ? LATCH_EXCLUSIVE : LATCH_SHARED;
+				if (MINIBASE_BM->PinPage(pid, page, mode) != OK) {
+					failed[t] = true;
+					break;
+				}
+				if (((int *)page)[0] != pid) {
+					failed[t] = true;
+				} else if (mode == LATCH_EXCLUSIVE) {
+					((int *)page)[1]++;
+					writes[t]++;
+				}
+				if (MINIBASE_BM->UnpinPage(pid, mode == LATCH_EXCLUSIVE, mode) != OK) {
+					failed[t] = true;
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < numThreads; t++) {
+		threads[t].join();
+		if (failed[t]) {
+			std::cerr << "Thread " << t << " pinned a page with the wrong contents, "
+					  << "or failed to pin or unpin one" << std::endl;
+			res = false;
+		}
+	}
+
+	//	No write was lost, and no pin was left behind.
+	long written = 0, counted = 0;
+	for (int t = 0; t < numThreads; t++)
+		written += writes[t];
+	for (int i = 0; i < numPages && res; i++) {
+		if (MINIBASE_BM->PinPage(pids[i], page) != OK) {
+			res = false;
+			break;
+		}
+		if (((int *)page)[0] != pids[i]) {
+			std::cerr << "Page " << pids[i] << " holds " << ((int *)page)[0] << std::endl;
+			res = false;
+		}
+		counted += ((int *)page)[1];
+		MINIBASE_BM->UnpinPage(pids[i], CLEAN);
+	}
+	if (res && counted != written) {
+		std::cerr << "Pages count " << counted << " writes of " << written << std::endl;
+		res = false;
+	}
+	if (res && MINIBASE_BM->GetNumOfUnpinnedBuffers() != unpinned) {
+		std::cerr << MINIBASE_BM->GetNumOfUnpinnedBuffers() << " frames unpinned, "
+				  << unpinned << " before" << std::endl;
+		res = false;
+	}
+
+	for (int i = 0; i < numPages; i++) {
+		if (MINIBASE_BM->FreePage(pids[i]) != OK) {
+			res = false;
+		}
+	}
+
+	if (res) {
+		std::cout << "Test 24 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test each replacement policy under a tree larger than the pool
+bool BTreeDriver::Test25() {
+	Status status;
+	bool res = true;
+	const char *policies[] = { "Clock", "LRU2", "2Q", "ARC", "ClockPro" };
+	const int numPolicies = sizeof(policies) / sizeof(policies[0]);
+	const int numFrames = 24, numKeys = 3000, pad = 40;
+
+	//	Every third key is deleted; the rest stay.
+	std::vector<int> keys;
+	for (int i = 1; i <= numKeys; i++) {
+		if ((i - 1) % 3 != 0)
+			keys.push_back(i);
+	}
+	char lowKey[MAX_KEY_SIZE], highKey[MAX_KEY_SIZE];
+	BTreeDriver::toString(numKeys / 4, lowKey, pad);
+	BTreeDriver::toString(numKeys / 2, highKey, pad);
+
+	//	Each policy gets a pool of its own in place of the driver's,
+	//	which is written out first, as the database is read and
+	//	written past it meanwhile.
+	BufMgr *pool = MINIBASE_BM;
+	if (pool->FlushAllPages() != OK) {
+		std::cerr << "Couldn't flush the pool" << std::endl;
+		return false;
+	}
+
+	for (int p = 0; p < numPolicies && res; p++) {
+		MINIBASE_BM = new BufMgr(numFrames, policies[p]);
+
+		//	Twice, so the second tree is built in a pool whose policy
+		//	has seen the first one's pages freed.
+		for (int round = 0; round < 2 && res; round++) {
+			int freePages, extents, longest, freeNow;
+			MINIBASE_DB->GetFreeExtentStat(freePages, extents, longest);
+
+			BTreeFile *btf = new BTreeFile(status, "TestPolicies");
+			if (status != OK) {
+				std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+				res = false;
+				delete btf;
+				break;
+			}
+
+			long pins, misses;
+			MINIBASE_BM->ResetStat();
+			if (!InsertRange(btf, 1, numKeys, 1, pad, round == 1) ||
+				!DeleteStride(btf, 1, numKeys, 3, pad)) {
+				res = false;
+			}
+			if (res && (!TestScanKeys(btf, NULL, NULL, keys, pad) ||
+						!TestScanKeys(btf, lowKey, highKey, keys, pad))) {
+				res = false;
+			}
+			MINIBASE_BM->GetStat(pins, misses);
+			if (res && misses == 0) {
+				std::cerr << "The tree fit in the pool" << std::endl;
+				res = false;
+			}
+
+			if (btf->DestroyFile() != OK) {
+				std::cerr << "Error destroying BTreeFile" << std::endl;
+				res = false;
+			}
+			delete btf;
+
+			//	No pin was left behind, and every page was freed.
+			if (res && MINIBASE_BM->GetNumOfUnpinnedBuffers() != MINIBASE_BM->GetNumOfBuffers()) {
+				std::cerr << MINIBASE_BM->GetNumOfBuffers() - MINIBASE_BM->GetNumOfUnpinnedBuffers()
+						  << " frames left pinned" << std::endl;
+				res = false;
+			}
+			MINIBASE_DB->GetFreeExtentStat(freeNow, extents, longest);
+			if (res && freeNow != freePages) {
+				std::cerr << freeNow << " pages free after the tree went, not "
+						  << freePages << std::endl;
+				res = false;
+			}
+		}
+		if (!res) {
+			std::cerr << "Failed with the " << policies[p] << " policy" << std::endl;
+		}
+
+		delete MINIBASE_BM;
+		MINIBASE_BM = pool;
+	}
+
+	if (res) {
+		std::cout << "Test 25 Passed!" << std::endl;
+	}
+	return res;
+}
+
+//	Test Helper functions
+
+//-------------------------------------------------------------------
+// BTreeDriver::TestDuplicates
+//
+// Input   : ridEncoding, The leaf RecordID encoding of the tree.
+// Output  : None
+// Return  : True if the test completed succesfully.
+// Purpose : Inserts and deletes many RecordIDs per key, including one
+//           key that needs overflow pages, and checks that a scan of
+//           that key pins each of its overflow pages about once.
+//-------------------------------------------------------------------
+bool BTreeDriver::TestDuplicates(RidEncoding ridEncoding) {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+
+	btf = new BTreeFile(status, "TestDuplicateKeys", ridEncoding);
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	Key 20 is hot enough to need overflow pages; the others are not.
+	const int numKeys = 40, numRids = 25, hotKey = 20, numHotRids = 1500;
+	char skey[MAX_KEY_SIZE];
+	RecordID rid;
+
+	for (int i = 0; i < numHotRids && res; i++) {
+		for (int k = 0; k < numKeys; k++) {
+			if (i >= (k == hotKey ? numHotRids : numRids))
+				continue;
+
+			//	Spread the rids over pages, out of order.
+			rid.pageNo = (i * 37) % 101 + 1;
+			rid.slotNo = i;
+			BTreeDriver::toString(k, skey);
+			if (btf->Insert(skey, rid) != OK) {
+				std::cerr << "Inserting duplicate " << skey << " " << rid
+						  << " failed" << std::endl;
+				res = false;
+				break;
+			}
+		}
+	}
+
+	int total = (numKeys - 1) * numRids + numHotRids;
+	if (!TestNumEntries(btf, total)) {
+		std::cerr << "TestNumEntries(" << total << ") failed" << std::endl;
+		res = false;
+	}
+
+	//	Stepping through the hot key reads each of its overflow pages
+	//	once, rather than its chain from the head for every RecordID.
+	BTreeDriver::toString(hotKey, skey);
+	int file = MINIBASE_BM->RegisterMetricsFile("TestDuplicateKeys", NULL);
+	BufMetrics before, delta;
+	MINIBASE_BM->GetMetrics(before);
+	IndexFileScan *scan = btf->OpenScan(skey, skey);
+	if (!TestScanCount(scan, numHotRids)) {
+		std::cerr << "Scan of hot key found the wrong number of entries" << std::endl;
+		res = false;
+	}
+	delete scan;
+	MINIBASE_BM->GetMetrics(delta);
+	delta.Subtract(before);
+	long overflowPins = delta.pins[file][METRICS_OTHER_TYPE];
+	if (res && overflowPins > 2 * (numHotRids / (int)RIDS_PER_OVERFLOW_PAGE + 1)) {
+		std::cerr << "Scan of hot key pinned overflow pages " << overflowPins
+				  << " times" << std::endl;
+		res = false;
+	}
+
+	//	Delete two thirds of the hot key and every other rid of the rest.
+	int remaining = 0;
+	for (int k = 0; k < numKeys && res; k++) {
+		int n = (k == hotKey ? numHotRids : numRids);
+		BTreeDriver::toString(k, skey);
+		for (int i = 0; i < n; i++) {
+			rid.pageNo = (i * 37) % 101 + 1;
+			rid.slotNo = i;
+			if (k == hotKey ? i % 3 == 0 : i % 2 == 1) {
+				remaining++;
+				continue;
+			}
+			if (btf->Delete(skey, rid) != OK) {
+				std::cerr << "Deleting duplicate " << skey << " " << rid
+						  << " failed" << std::endl;
+				res = false;
+				break;
+			}
+		}
+	}
+
+	if (res && !TestNumEntries(btf, remaining)) {
+		std::cerr << "TestNumEntries(" << remaining << ") failed" << std::endl;
+		res = false;
+	}
+
+	//	A deleted (key, rid) pair is gone for good.
+	BTreeDriver::toString(hotKey, skey);
+	rid.pageNo = 1 * 37 % 101 + 1;
+	rid.slotNo = 1;
+	if (btf->Delete(skey, rid) == OK) {
+		std::cerr << "Deleting a deleted duplicate succeeded" << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	return res;
+}
+
+//	The RecordID of key in TestClusteredRids: a few slots each on runs of
+//	pages far into the database, a different run every hundred keys.
+static RecordID ClusteredRid(int key)
+{
+	RecordID rid;
+	rid.pageNo = 300000000 + (key / 100) * 50000000 + key / 8;
+	rid.slotNo = key % 8;
+	return rid;
+}
+
+//-------------------------------------------------------------------
+// BTreeDriver::TestClusteredRids
+//
+// Input   : None
+// Output  : None
+// Return  : True if the test completed succesfully.
+// Purpose : Checks that RID_VARINT leaves code page numbers relative to
+//           their base, so RecordIDs on high but nearby pages take few
+//           bytes, and that they decode right after splits and merges
+//           have moved entries between leaves of different bases.
+//-------------------------------------------------------------------
+bool BTreeDriver::TestClusteredRids() {
+	Status status;
+	BTreeFile *btf;
+	bool res = true;
+	char skey[MAX_KEY_SIZE];
+
+	btf = new BTreeFile(status, "TestClusteredRids", RID_VARINT);
+
+	if (status != OK) {
+		std::cerr << "ERROR: Couldn't create a BTreeFile" << std::endl;
+		minibase_errors.show_errors();
+
+		std::cerr << "Hit [enter] to continue..." << std::endl;
+		std::cin.get();
+		exit(1);
+	}
+
+	//	60 entries of 7 bytes and their slots and prefixes fit one leaf;
+	//	with page numbers of 5 bytes they would take two.
+	const int onePage = 60, numKeys = 600;
+	for (int key = 0; key < numKeys && res; key++) {
+		BTreeDriver::toString(key, skey);
+		if (btf->Insert(skey, ClusteredRid(key)) != OK) {
+			std::cerr << "Inserting key " << skey << " failed" << std::endl;
+			res = false;
+		}
+		if (res && key == onePage - 1 && !TestNumLeafPages(btf, 1)) {
+			std::cerr << "TestNumLeafPages(1) failed" << std::endl;
+			res = false;
+		}
+	}
+
+	//	Deleting every other key merges leaves of different bases.
+	int remaining = 0;
+	for (int key = 0; key < numKeys && res; key++) {
+		if (key % 2 == 0) {
+			remaining++;
+			continue;
+		}
+		BTreeDriver::toString(key, skey);
+		if (btf->Delete(skey, ClusteredRid(key)) != OK) {
+			std::cerr << "Deleting key " << skey << " failed" << std::endl;
+			res = false;
+		}
+	}
+
+	IndexFileScan *scan = btf->OpenScan();
+	RecordID rid;
+	char key[MAX_KEY_SIZE];
+	int found = 0;
+	while (res && scan->GetNext(rid, key) == OK) {
+		if (rid != ClusteredRid(atoi(key))) {
+			std::cerr << "Key " << key << " has " << rid << ", not "
+					  << ClusteredRid(atoi(key)) << std::endl;
+			res = false;
+		}
+		found++;
+	}
+	delete scan;
+	if (res && found != remaining) {
+		std::cerr << "Scan found " << found << " entries, not " << remaining << std::endl;
+		res = false;
+	}
+
+	if (btf->DestroyFile() != OK) {
+		std::cerr << "Error destroying BTreeFile" << std::endl;
+		res = false;
+	}
+
+	delete btf;
+
+	return res;
+}
+
+//-------------------------------------------------------------------
+// BTreeDriver::InsertRange
+//
+// Input   : btf,  The BTree to insert into.
+//           low,  The beginning of the range (inclusive).
+//           high, The end of the range (inclusive).
+//           ridOffset, The offset used to compute the rid.
+//           pad,  The amount of padding to use for the keys.
+//           reverse, Whether to insert in reverse order.
+// Output  : None
+// Return  : True if this operation completed succesfully.
+// Purpose : Inserts a range of keys into the B-Tree.
+//-------------------------------------------------------------------
+bool BTreeDriver::InsertRange(BTreeFile *btf, int low, int high,
+							  int ridOffset, int pad, bool reverse) {
+	int numKeys = high - low + 1;
+	int keyNum;
+
+	char skey[MAX_KEY_SIZE];
+
+	int i;
+	if (reverse) {
+		i = numKeys - 1;
+	} else {
+		i = 0;
+	}
+
+	while (reverse && i >= 0 || !reverse && i < numKeys) {
+		RecordID rid;
+		keyNum = i+low;
+		rid.pageNo=keyNum + ridOffset;
+		rid.slotNo=keyNum + ridOffset + 1;
+		BTreeDriver::toString(keyNum, skey, pad);
+
+		if (btf->Insert(skey, rid) != OK) {
+			std::cerr << "Insertion of range failed at key=" << skey
+					  << " rid=" << rid << std::endl;
+			minibase_errors.show_errors();
+			return false;
+		}
+
+		if (reverse) {
+			i--;
+		} else {
+			i++;
+		}
+	}
+
+	return true;
+}
+
+//	Delete from BTree with a certain stride
+bool BTreeDriver::DeleteStride(BTreeFile *btf, int low, int high,
+							  int stride, int pad) {
+	char lowKey[MAX_KEY_SIZE];
+	char highKey[MAX_KEY_SIZE];
+    BTreeDriver::toString(low, lowKey, pad);
+    BTreeDriver::toString(high, highKey, pad);
+
+	IndexFileScan* scan = btf->OpenScan(lowKey, highKey);
+	RecordID rid;
+	char curKey[MAX_KEY_SIZE];
+	int count = 0;
+
+	std::vector<std::pair<char*, RecordID>*> deleteVec;
+
+	while(scan->GetNext(rid, curKey) != DONE) {
+		char* tempKey = new char[MAX_KEY_SIZE];
+		memcpy(tempKey, curKey, strlen(curKey) + 1);
+
+		if(count == 0) {
+			deleteVec.push_back(new std::pair<char*, RecordID>(tempKey, rid));
+		}
+		count = (count + 1)	% stride;
+	}
+
+	delete scan;
+
+	int numToDelete = deleteVec.size();
+	int numDeleted = 0;
+
+	std::vector<std::pair<char*, RecordID>*>::iterator it;
+	for(it = deleteVec.begin(); it != deleteVec.end(); it++) {
+		std::pair<char*, RecordID>* pair = *it;
+		if(btf->Delete(pair->first, pair->second) == OK) {
+			numDeleted++;
+		}
+	}
+
+	for(it = deleteVec.begin(); it != deleteVec.end(); it++) {
+		delete [] (*it)->first;
+		delete *it;
+	}
+
+	if(numDeleted != numToDelete) {
+		std::cerr << "Error: Attempted to delete " << numToDelete
+         	      << "pairs. Only able to delete " << numDeleted << std::endl;
+		return false;
+	}
+
+	return true;
+
+}
+
+//-------------------------------------------------------------------
+// BTreeDriver::TestNumLeafPages
+//
+// Input   : btf,  The BTree to test
+//           expected,  The number of leaf pages you expect.
+// Output  : None
+// Return  : True if the number of leaf pages == expected.
+// Purpose : Tests the number of leaf pages in the tree.
+//-------------------------------------------------------------------
+bool BTreeDriver::TestNumLeafPages(BTreeFile *btf, int expected)
+{
+	PageID pid = GetLeftmostLeaf(btf);
+
+	if (pid == INVALID_PAGE) {
+		std::cerr << "Unable to access left leaf" << std::endl;
+		return false;
+	}
+
+	int numPages = 0;
+
+	while (pid != INVALID_PAGE) {
+		numPages++;
+
+		SortedPage *page;
+		if (MINIBASE_BM->PinPage(pid, (Page *&)page) == FAIL) {
+			std::cerr << "Unable to pin page" << std::endl;
+			return false;
+		}
+
+		pid = page->GetNextPage();
+
+		if (MINIBASE_BM->UnpinPage(page->PageNo(), CLEAN) == FAIL) {
+			std::cerr << "Unable to unpin page" << std::endl;
+			return false;
+		}
+	}
+
+	if (numPages != expected) {
+		std::cerr << "Unexpected number of leaf pages. Expected " << expected
+				  << ", but got " << numPages << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//-------------------------------------------------------------------
+// BTreeDriver::CountSequentialLeaves
+//
+// Input   : btf,  The BTree to walk.
+// Output  : numLeaves,  The number of leaf pages.
+//           forward,  If not NULL, the number of leaves whose next
+//                     leaf is on a later page.
+// Return  : The number of leaves whose next leaf is the next page of
+//           the database, -1 if a page could not be pinned.
+// Purpose : Tells how much of a scan of the leaves reads forward.
+//-------------------------------------------------------------------
+int BTreeDriver::CountSequentialLeaves(BTreeFile *btf, int& numLeaves, int *forward)
+{
+	PageID pid = GetLeftmostLeaf(btf);
+	int sequential = 0;
+
+	numLeaves = 0;
+	if (forward != NULL)
+		*forward = 0;
+	while (pid != INVALID_PAGE) {
+		SortedPage *page;
+		if (MINIBASE_BM->PinPage(pid, (Page *&)page) == FAIL) {
+			std::cerr << "Unable to pin page" << std::endl;
+			return -1;
+		}
+
+		PageID next = page->GetNextPage();
+		if (MINIBASE_BM->UnpinPage(pid, CLEAN) == FAIL) {
+			std::cerr << "Unable to unpin page" << std::endl;
+			return -1;
+		}
+
+		numLeaves++;
+		if (next == pid + 1)
+			sequential++;
+		if (forward != NULL && next != INVALID_PAGE && next > pid)
+			(*forward)++;
+		pid = next;
+	}
+	return sequential;
 }
 
 //	Get the leftmost leaf page in this index.
@@ -1086,8 +3087,8 @@ bool BTreeDriver::DeleteKey(BTreeFile *btf, int key, int pad, bool expectedFail)
 void BTreeDriver::toString(const int n, char *str, int pad)
 {
 	char format[200];
-	sprintf_s(format, 200, "%%0%dd", pad);
-	sprintf_s(str, MAX_KEY_SIZE, format, n);
+	snprintf(format, 200, "%%0%dd", pad);
+	snprintf(str, MAX_KEY_SIZE, format, n);
 }
 
 
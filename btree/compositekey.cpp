@@ -0,0 +1,221 @@
+/*
+ * compositekey.cpp - order preserving multi-column keys built from
+ *                    Tuple fields.  See compositekey.h for the format.
+ */
+
+#include <string.h>
+#include "compositekey.h"
+
+
+#define KEY_FIELD_END   0x01   // terminates a string field
+#define KEY_ESCAPE      0x02   // escapes 0x01 and 0x02 inside a string
+#define INT_KEY_LENGTH  5      // bytes used by an integer or real field
+
+
+//-------------------------------------------------------------------
+// CompositeKey::CompositeKey
+//
+// Input   : numFlds - number of fields in the key schema.
+//           types - types of the fields.
+//           strSizes - maximum length of each string field, indexed
+//                      by string field as in Tuple::setHdr.
+// Output  : status - OK if the schema is usable, FAIL otherwise.
+// Purpose : Remember the schema used to encode keys.
+//-------------------------------------------------------------------
+
+CompositeKey::CompositeKey(Status& status, short numFlds,
+						   AttrType types[], short strSizes[])
+{
+	int strCount = 0;
+
+	this->numFlds = numFlds;
+	this->types = new AttrType[numFlds];
+	this->strSizes = new short[numFlds];
+	status = OK;
+
+	for (int i = 0; i < numFlds; i++)
+	{
+		this->types[i] = types[i];
+		this->strSizes[i] = 0;
+
+		if (types[i] == attrString)
+		{
+			if (strSizes == NULL)
+			{
+				cerr << "CompositeKey: no size given for string field "
+					<< i + 1 << endl;
+				status = FAIL;
+				return;
+			}
+			this->strSizes[i] = strSizes[strCount++];
+		}
+	}
+}
+
+
+CompositeKey::~CompositeKey()
+{
+	delete [] types;
+	delete [] strSizes;
+}
+
+
+//-------------------------------------------------------------------
+// CompositeKey::EncodeUnsigned
+//
+// Input   : value - value to write.
+// Output  : p - advanced past the written bytes.
+// Purpose : Write value as INT_KEY_LENGTH bytes of seven bits each,
+//           most significant first, with the high bit of every byte
+//           set so that no byte is '\0'.
+//-------------------------------------------------------------------
+
+void CompositeKey::EncodeUnsigned(unsigned int value, char *&p)
+{
+	for (int shift = 7 * (INT_KEY_LENGTH - 1); shift >= 0; shift -= 7)
+		*p++ = (char)(0x80 | ((value >> shift) & 0x7F));
+}
+
+
+//-------------------------------------------------------------------
+// CompositeKey::MakePrefix
+//
+// Input   : tuple - tuple holding the field values.
+//           numPrefixFlds - number of leading fields to encode.
+// Output  : key - the encoded key.  Must hold MAX_KEY_SIZE bytes.
+// Purpose : Encode the first numPrefixFlds fields of tuple.
+// Return  : OK if successful, FAIL if a field is too long or the
+//           encoded key does not fit in a B+-tree key.
+//-------------------------------------------------------------------
+
+Status CompositeKey::MakePrefix(Tuple *tuple, short numPrefixFlds, char *key)
+{
+	char *p = key;
+	char *end = key + MAX_KEY_SIZE - 2;
+
+	if (numPrefixFlds < 0 || numPrefixFlds > numFlds ||
+		numPrefixFlds > tuple->noOfFlds())
+	{
+		cerr << "CompositeKey: bad number of fields " << numPrefixFlds << endl;
+		return FAIL;
+	}
+
+	for (int i = 0; i < numPrefixFlds; i++)
+	{
+		switch (types[i])
+		{
+		case attrInteger:
+			{
+				int ival;
+				tuple->getFld(i + 1, ival);
+				if (p + INT_KEY_LENGTH > end)
+					goto tooLong;
+				// Flipping the sign bit maps signed order to unsigned order.
+				EncodeUnsigned((unsigned int)ival ^ 0x80000000u, p);
+				break;
+			}
+
+		case attrReal:
+			{
+				float fval;
+				unsigned int bits;
+				tuple->getFld(i + 1, fval);
+				if (fval == 0.0f)
+					fval = 0.0f;    // -0.0 and 0.0 compare equal
+				memcpy(&bits, &fval, sizeof(bits));
+				// IEEE 754: negatives sort in reverse, so invert them all;
+				// positives only need the sign bit set.
+				bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+				if (p + INT_KEY_LENGTH > end)
+					goto tooLong;
+				EncodeUnsigned(bits, p);
+				break;
+			}
+
+		case attrString:
+			{
+				char *sval;
+				tuple->getFld(i + 1, sval);
+				if ((int)strlen(sval) > strSizes[i])
+				{
+					cerr << "CompositeKey: field " << i + 1
+						<< " is longer than " << strSizes[i] << endl;
+					return FAIL;
+				}
+				for (unsigned char *s = (unsigned char *)sval; *s; s++)
+				{
+					if (*s == KEY_FIELD_END || *s == KEY_ESCAPE)
+					{
+						if (p + 2 > end)
+							goto tooLong;
+						*p++ = KEY_ESCAPE;
+						*p++ = (char)(*s + 1);
+					}
+					else
+					{
+						if (p + 1 > end)
+							goto tooLong;
+						*p++ = (char)*s;
+					}
+				}
+				if (p + 1 > end)
+					goto tooLong;
+				*p++ = KEY_FIELD_END;
+				break;
+			}
+
+		case attrNull:
+			break;
+
+		default:
+			cerr << "CompositeKey: unknown type for field " << i + 1 << endl;
+			return FAIL;
+		}
+	}
+
+	*p = '\0';
+	return OK;
+
+tooLong:
+	cerr << "CompositeKey: encoded key exceeds maximum key size" << endl;
+	return FAIL;
+}
+
+
+//-------------------------------------------------------------------
+// CompositeKey::MakeKey
+//
+// Input   : tuple - tuple holding the field values.
+// Output  : key - the encoded key.  Must hold MAX_KEY_SIZE bytes.
+// Purpose : Encode all the key fields of tuple.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status CompositeKey::MakeKey(Tuple *tuple, char *key)
+{
+	return MakePrefix(tuple, numFlds, key);
+}
+
+
+//-------------------------------------------------------------------
+// CompositeKey::OpenPrefixScan
+//
+// Input   : btf - index built on keys made by this CompositeKey.
+//           tuple - tuple holding the values of the leading fields.
+//           numPrefixFlds - number of leading fields to match.
+// Output  : None
+// Purpose : Open a scan over all entries whose first numPrefixFlds
+//           fields equal those of tuple, in key order.
+// Return  : The scan, or NULL if the prefix cannot be encoded.
+//-------------------------------------------------------------------
+
+IndexFileScan *CompositeKey::OpenPrefixScan(BTreeFile *btf, Tuple *tuple,
+											short numPrefixFlds)
+{
+	KeyType prefix;
+
+	if (MakePrefix(tuple, numPrefixFlds, prefix) != OK)
+		return NULL;
+
+	return btf->OpenPrefixScan(prefix);
+}
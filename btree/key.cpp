@@ -9,9 +9,175 @@
 #include <string.h>
 #include <assert.h>
 
+#include "page.h"
+#include "heappage.h"
+#include "bufmgr.h"
+#include "pageguard.h"
 #include "bt.h"
 
 
+/*
+ * The part of a long key past LONG_KEY_PREFIX, '\0' included, lives in
+ * a chain of these pages.  The first page counts the entries and other
+ * holders that refer to the chain; it is freed when that drops to 0.
+ */
+
+struct KeyOverflowPage {
+	PageID nextPage;
+	int    refCount;
+	int    length;     // bytes of the key on this page
+	char   data[MAX_SPACE - sizeof(PageID) - 2 * sizeof(int)];
+};
+
+#define KEY_OVERFLOW_SPACE  ((int)sizeof(((KeyOverflowPage *)0)->data))
+
+
+//-------------------------------------------------------------------
+// IsLongKey
+//
+// Input   : key - a key as stored in the tree.
+// Output  : None
+// Purpose : Tell whether key is an inline prefix with an overflow
+//           chain.
+// Return  : Non-zero if it is.
+//-------------------------------------------------------------------
+
+int IsLongKey(const char *key)
+{
+	return strlen(key) == LONG_KEY_PREFIX;
+}
+
+
+static PageID GetOverflowPid(const char *key)
+{
+	PageID pid;
+	memcpy(&pid, key + LONG_KEY_PREFIX + 1, sizeof(PageID));
+	return pid;
+}
+
+
+//-------------------------------------------------------------------
+// FreeKeyChain
+//
+// Input   : pid - first page of an overflow chain.
+// Output  : None
+// Purpose : Free every page of the chain.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+static Status FreeKeyChain(PageID pid)
+{
+	PageGuard<KeyOverflowPage> page;
+
+	while (pid != INVALID_PAGE)
+	{
+		PIN_GUARD(pid, page);
+		PageID nextPid = page->nextPage;
+		FREE_GUARD(page);
+		pid = nextPid;
+	}
+
+	return OK;
+}
+
+
+// The rest of a probe key, past its inline prefix: see ProbeKey.
+static const char *GetProbeRest(const char *key)
+{
+	const char *rest;
+	memcpy(&rest, key + MAX_KEY_SIZE, sizeof(rest));
+	return rest;
+}
+
+
+//-------------------------------------------------------------------
+// KeyRest
+//
+// Reads the rest of a long key, past its inline prefix, a byte at a
+// time: from memory for a key made by ProbeKey, from its overflow
+// chain for a stored one.  The rest ends with '\0'.
+//-------------------------------------------------------------------
+
+class KeyRest
+{
+	private:
+
+		const char *mem;     // the rest of a probe key, NULL if chained
+		PageID pid;          // page of the chain read next, or pinned
+		PageGuard<KeyOverflowPage> page;
+		int i;               // next byte of page
+
+	public:
+
+		KeyRest(const char *key)
+		{
+			pid = GetOverflowPid(key);
+			mem = pid == PROBE_KEY_PID ? GetProbeRest(key) : NULL;
+			i = 0;
+		}
+
+		// FAIL if a page of the chain cannot be pinned.
+		Status Next(unsigned char& c)
+		{
+			if (mem != NULL)
+			{
+				c = (unsigned char)*mem++;
+				return OK;
+			}
+			if (!page.IsPinned() || i == page->length)
+			{
+				if (page.IsPinned())
+					pid = page->nextPage;
+				if (MINIBASE_BM->PinPage(pid, page, PIN_SITE) != OK)
+				{
+					cerr << "Unable to pin key overflow page " << pid << endl;
+					return FAIL;
+				}
+				i = 0;
+			}
+			c = (unsigned char)page->data[i++];
+			return OK;
+		}
+};
+
+
+//-------------------------------------------------------------------
+// KeyCmpOverflow
+//
+// Input   : key1, key2 - two long keys whose inline prefixes are
+//                        equal, stored or made by ProbeKey.
+// Output  : None
+// Purpose : Compare the rest of the two keys.  If a page of either
+//           chain cannot be pinned, the keys are ordered by the first
+//           pages of their chains: that does not say which key is the
+//           smaller, but two keys that may differ are never taken for
+//           one, and the same two keys always compare the same way.
+// Return  : Same as KeyCmp.
+//-------------------------------------------------------------------
+
+static int KeyCmpOverflow(const char *key1, const char *key2)
+{
+	PageID pid1 = GetOverflowPid(key1);
+	PageID pid2 = GetOverflowPid(key2);
+	int unreadable = pid1 < pid2 ? -1 : 1;
+	unsigned char c1, c2;
+
+	if (pid1 == pid2 && pid1 != PROBE_KEY_PID)
+		return 0;
+
+	KeyRest rest1(key1), rest2(key2);
+	do
+	{
+		if (rest1.Next(c1) != OK || rest2.Next(c2) != OK)
+			return unreadable;
+		if (c1 != c2)
+			return c1 < c2 ? -1 : 1;
+	} while (c1 != '\0');
+
+	return 0;
+}
+
+
 
 //-------------------------------------------------------------------
 // KeyCmp
@@ -29,15 +195,43 @@
 
 int KeyCmp(const char *key1, const char *key2)
 {
-	return strncmp(key1, key2, MAX_KEY_SIZE);
+	int c = strncmp(key1, key2, MAX_KEY_SIZE);
+
+	// Equal inline parts of two long keys: the overflow decides.
+	if (c != 0 || !IsLongKey(key1))
+		return c;
+
+	return KeyCmpOverflow(key1, key2);
+}
+
+//-------------------------------------------------------------------
+// KeyPrefix
+//
+// Input   : key - pointer to the key.
+// Output  : None
+// Purpose : Pack the first four bytes of key, most significant first.
+//           Bytes past the end of the key are zero.
+// Return  : The packed prefix.
+//-------------------------------------------------------------------
+
+unsigned int KeyPrefix(const char *key)
+{
+	const unsigned char *k = (const unsigned char *)key;
+	unsigned int prefix = 0;
+
+	for (int i = 0; i < 4 && k[i] != '\0'; i++)
+		prefix |= (unsigned int)k[i] << (24 - 8 * i);
+
+	return prefix;
 }
 
+
 //-------------------------------------------------------------------
 // GetKeyLength
 //
 // Input   : key - key we are interested in.
 // Output  : None
-// Purpose : Return the size of key
+// Purpose : Return the size of key, as stored in the tree.
 // Return  : The size of the key.
 //-------------------------------------------------------------------
 
@@ -46,10 +240,248 @@ int GetKeyLength(const char *key)
 	int len;
 	
 	len = strlen((char *) key); 
+	if (len == LONG_KEY_PREFIX)
+		return len + 1 + sizeof(PageID);
 	return len+1;
 }
 
 
+//-------------------------------------------------------------------
+// KeyCopy
+//
+// Input   : src - a key as stored in the tree.
+// Output  : dst - a copy of it.  Must hold MAX_KEY_SIZE bytes.
+// Purpose : Copy a key, including the overflow PageID of a long key.
+//-------------------------------------------------------------------
+
+void KeyCopy(char *dst, const char *src)
+{
+	memcpy(dst, src, GetKeyLength(src));
+}
+
+
+//-------------------------------------------------------------------
+// StoreKey
+//
+// Input   : key - a '\0' terminated key of any length.
+// Output  : target - the key as it is stored in the tree.  Must hold
+//                    MAX_KEY_SIZE bytes.
+// Purpose : Keys shorter than LONG_KEY_PREFIX are copied.  Longer ones
+//           keep LONG_KEY_PREFIX bytes inline, then '\0' and the
+//           PageID of a new overflow chain holding the rest.  The chain
+//           starts with one reference, owned by the caller, which must
+//           KeyRelease(target) when done with it.
+// Return  : OK if successful, FAIL if the chain cannot be allocated.
+//-------------------------------------------------------------------
+
+Status StoreKey(char *target, const char *key)
+{
+	int len = strlen(key);
+
+	if (len < LONG_KEY_PREFIX)
+	{
+		memcpy(target, key, len + 1);
+		return OK;
+	}
+
+	const char *rest = key + LONG_KEY_PREFIX;
+	int restLen = len - LONG_KEY_PREFIX + 1;
+	int numPages = (restLen + KEY_OVERFLOW_SPACE - 1) / KEY_OVERFLOW_SPACE;
+	PageID nextPid = INVALID_PAGE;
+
+	// Fill the chain back to front so each page can link to the next.
+	for (int i = numPages - 1; i >= 0; i--)
+	{
+		PageGuard<KeyOverflowPage> page;
+		PageID pid;
+
+		if (MINIBASE_BM->NewPage(pid, page, PIN_SITE) != OK)
+		{
+			cerr << "Unable to allocate key overflow page" << endl;
+			FreeKeyChain(nextPid);
+			return FAIL;
+		}
+
+		page->nextPage = nextPid;
+		page->refCount = 1;
+		page->length = restLen - i * KEY_OVERFLOW_SPACE;
+		if (page->length > KEY_OVERFLOW_SPACE)
+			page->length = KEY_OVERFLOW_SPACE;
+		memcpy(page->data, rest + i * KEY_OVERFLOW_SPACE, page->length);
+		page.SetDirty();
+		nextPid = pid;
+	}
+
+	memcpy(target, key, LONG_KEY_PREFIX);
+	target[LONG_KEY_PREFIX] = '\0';
+	memcpy(target + LONG_KEY_PREFIX + 1, &nextPid, sizeof(PageID));
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// ProbeKey
+//
+// Input   : key - a '\0' terminated key of any length, which must
+//                 outlive target.
+// Output  : target - the key to look key up by.  Must hold
+//                    PROBE_KEY_SIZE bytes.
+// Purpose : As StoreKey, but a long key gets no overflow chain:
+//           PROBE_KEY_PID stands in for its PageID, and a pointer to
+//           the rest of key follows, which KeyCmp reads instead of a
+//           chain.  Nothing is written to the database, so searches,
+//           scans and deletes cannot fail for want of a free page.
+//           target must never be put on a page, or retained.
+//-------------------------------------------------------------------
+
+void ProbeKey(char *target, const char *key)
+{
+	int len = strlen(key);
+
+	if (len < LONG_KEY_PREFIX)
+	{
+		memcpy(target, key, len + 1);
+		return;
+	}
+
+	PageID pid = PROBE_KEY_PID;
+	const char *rest = key + LONG_KEY_PREFIX;
+
+	memcpy(target, key, LONG_KEY_PREFIX);
+	target[LONG_KEY_PREFIX] = '\0';
+	memcpy(target + LONG_KEY_PREFIX + 1, &pid, sizeof(PageID));
+	memcpy(target + MAX_KEY_SIZE, &rest, sizeof(rest));
+}
+
+
+//-------------------------------------------------------------------
+// KeyRetain
+//
+// Input   : key - a key as stored in the tree.
+// Output  : None
+// Purpose : Add a reference to the overflow chain of a long key.  Does
+//           nothing for short keys and those made by ProbeKey.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status KeyRetain(const char *key)
+{
+	PageGuard<KeyOverflowPage> page;
+	PageID pid;
+
+	if (!IsLongKey(key) || (pid = GetOverflowPid(key)) == PROBE_KEY_PID)
+		return OK;
+
+	PIN_GUARD(pid, page);
+	page->refCount++;
+	page.SetDirty();
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// KeyRelease
+//
+// Input   : key - a key as stored in the tree.
+// Output  : None
+// Purpose : Drop a reference to the overflow chain of a long key, and
+//           free the chain with the last one.  Does nothing for short
+//           keys and those made by ProbeKey.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status KeyRelease(const char *key)
+{
+	PageGuard<KeyOverflowPage> page;
+	PageID pid;
+
+	if (!IsLongKey(key) || (pid = GetOverflowPid(key)) == PROBE_KEY_PID)
+		return OK;
+
+	PIN_GUARD(pid, page);
+	page.SetDirty();
+	if (--page->refCount > 0)
+		return OK;
+
+	PageID nextPid = page->nextPage;
+	FREE_GUARD(page);
+	return FreeKeyChain(nextPid);
+}
+
+
+//-------------------------------------------------------------------
+// GetFullKeyLength
+//
+// Input   : key - a key as stored in the tree, or made by ProbeKey.
+// Output  : None
+// Purpose : Return the size of the key as the user gave it.
+// Return  : The size of the key, '\0' included.
+//-------------------------------------------------------------------
+
+int GetFullKeyLength(const char *key)
+{
+	PageGuard<KeyOverflowPage> page;
+	PageID pid;
+	int len = strlen(key) + 1;
+
+	if (len - 1 != LONG_KEY_PREFIX)
+		return len;
+
+	len = LONG_KEY_PREFIX;
+	if (GetOverflowPid(key) == PROBE_KEY_PID)
+		return len + strlen(GetProbeRest(key)) + 1;
+	for (pid = GetOverflowPid(key); pid != INVALID_PAGE; )
+	{
+		if (MINIBASE_BM->PinPage(pid, page, PIN_SITE) != OK)
+			break;
+		len += page->length;
+		pid = page->nextPage;
+	}
+
+	return len;
+}
+
+
+//-------------------------------------------------------------------
+// GetFullKey
+//
+// Input   : key - a key as stored in the tree, or made by ProbeKey.
+// Output  : target - the key as the user gave it.  Must hold
+//                    GetFullKeyLength(key) bytes.
+// Purpose : Undo StoreKey or ProbeKey.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status GetFullKey(char *target, const char *key)
+{
+	PageGuard<KeyOverflowPage> page;
+	PageID pid;
+
+	if (!IsLongKey(key))
+	{
+		strcpy(target, key);
+		return OK;
+	}
+
+	memcpy(target, key, LONG_KEY_PREFIX);
+	target += LONG_KEY_PREFIX;
+	if (GetOverflowPid(key) == PROBE_KEY_PID)
+	{
+		strcpy(target, GetProbeRest(key));
+		return OK;
+	}
+	for (pid = GetOverflowPid(key); pid != INVALID_PAGE; )
+	{
+		PIN_GUARD(pid, page);
+		memcpy(target, page->data, page->length);
+		target += page->length;
+		pid = page->nextPage;
+	}
+
+	return OK;
+}
+
+
 //-------------------------------------------------------------------
 // GetKeyDataLength
 //
@@ -82,25 +514,80 @@ int GetKeyDataLength(const char *key, const NodeType nodeType)
 }
 
 
+//-------------------------------------------------------------------
+// PutVarint / GetVarint
+//
+// Write or read an unsigned int seven bits per byte, least significant
+// first, with the high bit set on every byte but the last.
+//-------------------------------------------------------------------
+
+static void PutVarint(char *&p, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		*p++ = (char)(0x80 | (value & 0x7F));
+		value >>= 7;
+	}
+	*p++ = (char)value;
+}
+
+static unsigned int GetVarint(const char *&p)
+{
+	unsigned int value = 0;
+	int shift = 0;
+	unsigned char c;
+
+	do {
+		c = (unsigned char)*p++;
+		value |= (unsigned int)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return value;
+}
+
+
+//-------------------------------------------------------------------
+// PutRid / GetRid
+//
+// Write or read a RecordID as RID_VARINT stores it: the zigzag varint
+// of pageNo - base, so pages either side of base take few bytes, then
+// slotNo as a varint.
+//-------------------------------------------------------------------
+
+static void PutRid(char *&p, const RecordID& rid, PageID base)
+{
+	unsigned int delta = (unsigned int)rid.pageNo - (unsigned int)base;
+
+	PutVarint(p, (delta << 1) ^ (0 - (delta >> 31)));
+	PutVarint(p, rid.slotNo);
+}
+
+static void GetRid(const char *&p, RecordID& rid, PageID base)
+{
+	unsigned int zigzag = GetVarint(p);
+
+	rid.pageNo = (PageID)((unsigned int)base + ((zigzag >> 1) ^ (0 - (zigzag & 1))));
+	rid.slotNo = GetVarint(p);
+}
+
+
 //-------------------------------------------------------------------
 // FillEntryKey
 //
 // Write the key part of a (key, data) pair.  Set keyLen to the length
 // of the key.
 //
-// Assume for key of type string, there is enough space.
+// key is in its stored form (see StoreKey), so it always fits.
 //-------------------------------------------------------------------
 
 static void FillEntryKey(KeyType *target, const char *key, 
                          int *keyLen)
 {
 	char *p = (char *) target;
-	int len = strlen((char *)key)+1;
-	if (len >= MAX_KEY_SIZE) {
-		cerr<<"error: string key length exceeds maximum"<<endl;
-		exit(1);
-	}
-	strcpy(p, (char *) key);
+	int len = GetKeyLength(key);
+	assert(len <= MAX_KEY_SIZE);
+	memcpy(p, key, len);
 	*keyLen = len;
 	return;
 }
@@ -117,7 +604,7 @@ static void FillEntryKey(KeyType *target, const char *key,
 //-------------------------------------------------------------------
 
 static void FillEntryData(char *target, DataType source, NodeType nodeType,
-                          int *dataLen)
+                          RidEncoding ridEncoding, PageID ridBase, int *dataLen)
 {
 	switch(nodeType) {
 
@@ -131,6 +618,13 @@ static void FillEntryData(char *target, DataType source, NodeType nodeType,
 	case LEAF_NODE:
 		{
 			DataType src = source;
+			if (ridEncoding == RID_VARINT)
+			{
+				char *p = target;
+				PutRid(p, src.rid, ridBase);
+				*dataLen = (int)(p - target);
+				return;
+			}
 			memcpy((char*)target, (char*)(&source), sizeof(RecordID));      
 			*dataLen = sizeof(RecordID);
 			return;
@@ -149,6 +643,8 @@ static void FillEntryData(char *target, DataType source, NodeType nodeType,
 //           nodeType - type of the B+-tree node where the entry is to
 //                      be created.
 //           data     - data to be inserted into the entry.
+//           ridEncoding, ridBase - how a leaf entry stores its
+//                                  RecordID, and relative to what.
 // Output  : len      - length of the entry created.
 // Purpose : Create an entry (key, data) in location target.
 // Precond : target is big enough to hold the created entry.
@@ -158,7 +654,7 @@ static void FillEntryData(char *target, DataType source, NodeType nodeType,
 void MakeEntry (KeyDataEntry *target,
                 const char *key,
                 NodeType nodeType, DataType data,
-                int *len)
+                int *len, RidEncoding ridEncoding, PageID ridBase)
 {
 	int keyLen, dataLen;
 	char *c;
@@ -170,7 +666,7 @@ void MakeEntry (KeyDataEntry *target,
 	// a chunk of memory big enough to hold any legal <key,data> pair).
 	c = (char *)target+keyLen;
 	FillEntryData ((char *) (((char *)target) + keyLen),
-		data, nodeType, &dataLen);         
+		data, nodeType, ridEncoding, ridBase, &dataLen);         
 	*len = keyLen + dataLen;
 }
 
@@ -184,13 +680,16 @@ void MakeEntry (KeyDataEntry *target,
 //           data     - pointer to mem area where data is to be copied
 //                      (NULL if we are not interested in data)
 //           pair     - pointer to a (key, data) pair.
-//           len      - length (num of bytes) of the (key, data) pair.
 //           nodeType - type of the B+-tree node where the entry is in.
+//           ridEncoding, ridBase - how a leaf entry stores its
+//                                  RecordID, and relative to what.
 // Output  : None
-// Purpose : Extract the key and data from an (key, data) pair.
+// Purpose : Extract the key and data from an (key, data) pair.  For a
+//           leaf entry the data is its first RecordID, decoded.
 //-------------------------------------------------------------------
 
-void GetKeyData (char *key, DataType *data, KeyDataEntry *pair, int len, NodeType nodeType)
+void GetKeyData (char *key, DataType *data, KeyDataEntry *pair,
+                 NodeType nodeType, RidEncoding ridEncoding, PageID ridBase)
 {
 	int dataLen;
 	int keyLen;
@@ -210,11 +709,133 @@ void GetKeyData (char *key, DataType *data, KeyDataEntry *pair, int len, NodeTyp
 		assert(0);
 	}
 	
-	keyLen = len - dataLen;
+	// Leaf entries may carry more than one RecordID after the key, so
+	// the key is measured rather than taken as what precedes the data.
+	keyLen = GetKeyLength((char *)pair);
 
 	if (key)
 		memcpy(key, pair, keyLen);
 
-	if (data)
+	if (data && nodeType == LEAF_NODE && ridEncoding == RID_VARINT)
+	{
+		const char *p = ((char*)pair) + keyLen;
+		GetRid(p, data->rid, ridBase);
+	}
+	else if (data)
 		memcpy(data, ((char*)pair) + keyLen, dataLen);
 }
+
+
+//-------------------------------------------------------------------
+// MakeRidListEntry
+//
+// Input   : target - pointer to a location in mem where the entry is
+//                    to be created.
+//           key - pointer to the key.
+//           rids - the record ids, sorted.
+//           numRids - number of record ids, at least one.
+//           overflowPid - first page of the overflow chain of this
+//                         entry, INVALID_PAGE if it has none.
+//           ridEncoding, ridBase - how the first record id is stored,
+//                                  and relative to what.
+// Output  : None
+// Purpose : Create a leaf entry (key, rids) in location target.  Each
+//           record id after the first is written as varint(page delta
+//           + 1) followed by the slot delta if the page is the same, or
+//           by the slot number otherwise.  A 0 in place of a page delta
+//           marks the overflow PageID, which ends the entry.
+// Return  : The length of the entry created.
+// Precond : target is big enough to hold the created entry.
+//-------------------------------------------------------------------
+
+int MakeRidListEntry(char *target, const char *key, const RecordID *rids,
+					 int numRids, PageID overflowPid, RidEncoding ridEncoding,
+					 PageID ridBase)
+{
+	int keyLen;
+	char *p;
+
+	FillEntryKey((KeyType *)target, key, &keyLen);
+	p = target + keyLen;
+
+	if (ridEncoding == RID_VARINT)
+		PutRid(p, rids[0], ridBase);
+	else
+	{
+		memcpy(p, &rids[0], sizeof(RecordID));
+		p += sizeof(RecordID);
+	}
+
+	for (int i = 1; i < numRids; i++)
+	{
+		unsigned int pageDelta = rids[i].pageNo - rids[i - 1].pageNo;
+		PutVarint(p, pageDelta + 1);
+		if (pageDelta == 0)
+			PutVarint(p, rids[i].slotNo - rids[i - 1].slotNo);
+		else
+			PutVarint(p, rids[i].slotNo);
+	}
+
+	if (overflowPid != INVALID_PAGE)
+	{
+		*p++ = 0;
+		memcpy(p, &overflowPid, sizeof(PageID));
+		p += sizeof(PageID);
+	}
+
+	return (int)(p - target);
+}
+
+
+//-------------------------------------------------------------------
+// GetRidList
+//
+// Input   : entry - pointer to a leaf entry made by MakeEntry or
+//                   MakeRidListEntry with the same ridEncoding.
+//           len - length of the entry.
+//           ridEncoding, ridBase - how the first record id is stored,
+//                                  and relative to what.
+// Output  : rids - the record ids kept in the entry itself.  Must hold
+//                  MAX_RIDS_PER_ENTRY record ids.
+//           overflowPid - first page of the overflow chain, or
+//                         INVALID_PAGE.
+// Purpose : Decode the record id list of a leaf entry.
+// Return  : The number of record ids written to rids.
+//-------------------------------------------------------------------
+
+int GetRidList(RecordID *rids, PageID& overflowPid, const char *entry, int len,
+			   RidEncoding ridEncoding, PageID ridBase)
+{
+	const char *p = entry + GetKeyLength(entry);
+	const char *end = entry + len;
+	int n = 1;
+
+	if (ridEncoding == RID_VARINT)
+		GetRid(p, rids[0], ridBase);
+	else
+	{
+		memcpy(&rids[0], p, sizeof(RecordID));
+		p += sizeof(RecordID);
+	}
+	overflowPid = INVALID_PAGE;
+
+	while (p < end)
+	{
+		unsigned int pageDelta = GetVarint(p);
+		if (pageDelta == 0)
+		{
+			memcpy(&overflowPid, p, sizeof(PageID));
+			break;
+		}
+		pageDelta--;
+
+		rids[n].pageNo = rids[n - 1].pageNo + pageDelta;
+		if (pageDelta == 0)
+			rids[n].slotNo = rids[n - 1].slotNo + GetVarint(p);
+		else
+			rids[n].slotNo = GetVarint(p);
+		n++;
+	}
+
+	return n;
+}
@@ -4,6 +4,10 @@
 * Johannes Gehrke & Gideon Glass  951016  CS564  UW-Madison
 */
 
+#include <string.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "sortedpage.h"
 #include "btindex.h"
 #include "btleaf.h"
@@ -19,13 +23,15 @@
 //           slots directory is compact.
 // Postcond: The records on this page is still sorted and the
 //           slots directory is compact.
-// Purpose : Insert the record into this page.
+// Purpose : Insert the record into this page.  A long key gains a
+//           reference from the new record.
 //-------------------------------------------------------------------
 
 Status SortedPage::InsertRecord (char * recPtr,
                                  int recLen, RecordID& rid)
 {
 	Status status;
+	int n = numOfSlots;
 	int i;
 	
 	// ASSERTIONS:
@@ -33,48 +39,192 @@ Status SortedPage::InsertRecord (char * recPtr,
 	// - slotCnt gives the number of slots used
 	
 	// general plan:
-	//    1. Insert the record into the page,
-	//       which is then not necessarily any more sorted
-	//    2. Sort the page by rearranging the slots (insertion sort)
-	
+	//    1. Find the record's place among the sorted slots
+	//    2. Move the prefixes up over the slot the record will get,
+	//       and insert the record into the page
+	//    3. Shift the slots and prefixes after its place up by one
+
+	if (recLen > AvailableSpace())
+		return FAIL;
+
+	// Equal keys go after the existing ones, as the insertion sort
+	// used to do.
+	i = UpperBound(recPtr);
+
+	memmove(&slots[n + 1], &slots[n], n * PREFIX_SIZE);
 	status = HeapPage::InsertRecord (recPtr, recLen, rid);
 	if (status != OK)
+	{
+		memmove(&slots[n], &slots[n + 1], n * PREFIX_SIZE);
 		return FAIL;
+	}
 	
-	// performs a simple insertion sort
+	Slot newSlot = slots[n];
+	memmove(&slots[i + 1], &slots[i], (n - i) * sizeof(Slot));
+	slots[i] = newSlot;
 
-	for (i = numOfSlots - 1; i > 0; i--) 
-	{
-		char *x = data + slots[i].offset;
-		char *y = data + slots[i-1].offset;
-		
-		if (KeyCmp((char*)x, (char*)y) < 0)
-		{
-			// switch slots
-
-			Slot tmpSlot;
-			tmpSlot   = slots[i];
-			slots[i]   = slots[i-1];
-			slots[i-1] = tmpSlot;
-			
-		} else {
-			
-			// end insertion sort
-
-			break;
-		}
-	}
+	unsigned int *prefixes = Prefixes();
+	memmove(&prefixes[i + 1], &prefixes[i], (n - i) * PREFIX_SIZE);
+	prefixes[i] = KeyPrefix(recPtr);
+	freeSpace -= PREFIX_SIZE;
 	
 	// ASSERTIONS:
 	// - record keys increase with increasing slot number (starting at slot 0)
 	// - slot directory compacted
 	
 	rid.slotNo = i;
+
+	if (KeyRetain(recPtr) != OK)
+		return FAIL;
 		
 	return OK;
 }
 
 
+//-------------------------------------------------------------------
+// PrefixRank
+//
+// Input   : prefixes, n - prefixes in increasing order.
+//           prefix - the prefix to rank.
+//           upper - count the prefixes equal to prefix as well.
+// Output  : None
+// Purpose : Count the prefixes below prefix, or not above it if upper.
+//           A binary search narrows them to PREFIX_RUN, which are then
+//           compared with it all at once.
+// Return  : The count.
+//-------------------------------------------------------------------
+
+#define PREFIX_RUN  32
+
+static int PrefixRank(const unsigned int *prefixes, int n, unsigned int prefix, bool upper)
+{
+	int low = 0, high = n;
+
+	while (high - low > PREFIX_RUN)
+	{
+		int mid = (low + high) / 2;
+		if (prefixes[mid] < prefix || (upper && prefixes[mid] == prefix))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	// The prefixes from low on are below prefix up to the first that is
+	// not, so counting those below gives its place.  The comparisons
+	// are signed, so both sides have their top bit flipped.
+	const unsigned int *p = prefixes + low;
+	int count = high - low;
+	int rank = low;
+	int i = 0;
+
+#if defined(__AVX2__)
+	__m256i bias8 = _mm256_set1_epi32((int)0x80000000);
+	__m256i key8 = _mm256_xor_si256(_mm256_set1_epi32((int)prefix), bias8);
+	__m256i hits8 = _mm256_setzero_si256();
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(p + i)), bias8);
+		hits8 = _mm256_sub_epi32(hits8, upper ? _mm256_cmpgt_epi32(v, key8) :
+												_mm256_cmpgt_epi32(key8, v));
+	}
+	__m128i hits4 = _mm_add_epi32(_mm256_castsi256_si128(hits8),
+								  _mm256_extracti128_si256(hits8, 1));
+#elif defined(__SSE2__)
+	__m128i hits4 = _mm_setzero_si128();
+#endif
+#if defined(__SSE2__)
+	// Each lane counts the prefixes it found past key, or below it.
+	__m128i bias4 = _mm_set1_epi32((int)0x80000000);
+	__m128i key4 = _mm_xor_si128(_mm_set1_epi32((int)prefix), bias4);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + i)), bias4);
+		hits4 = _mm_sub_epi32(hits4, upper ? _mm_cmpgt_epi32(v, key4) :
+											 _mm_cmplt_epi32(v, key4));
+	}
+	hits4 = _mm_add_epi32(hits4, _mm_shuffle_epi32(hits4, _MM_SHUFFLE(1, 0, 3, 2)));
+	hits4 = _mm_add_epi32(hits4, _mm_shuffle_epi32(hits4, _MM_SHUFFLE(2, 3, 0, 1)));
+	int hits = _mm_cvtsi128_si32(hits4);
+	rank += upper ? i - hits : hits;
+#endif
+	for (; i < count; i++)
+		rank += upper ? p[i] <= prefix : p[i] < prefix;
+
+	return rank;
+}
+
+
+//-------------------------------------------------------------------
+// SortedPage::KeyBound
+//
+// Input   : key - pointer to the key to look for.
+//           upper - look past the keys equal to key.
+// Output  : None
+// Purpose : Rank key's prefix among the page's, then binary search
+//           the records whose prefixes tie with it, if they can differ
+//           from key.
+// Return  : The first slot whose key is >= key, > key if upper.
+//-------------------------------------------------------------------
+
+int SortedPage::KeyBound (const char *key, bool upper)
+{
+	unsigned int prefix = KeyPrefix(key);
+	unsigned int *prefixes = Prefixes();
+	int low = PrefixRank(prefixes, numOfSlots, prefix, false);
+	int high = low;
+
+	if (low < numOfSlots && prefixes[low] == prefix)
+		high += PrefixRank(prefixes + low, numOfSlots - low, prefix, true);
+
+	// A zero low byte means the tied keys all end within the prefix, so
+	// they equal key.
+	if (low == high || (prefix & 0xFF) == 0)
+		return upper ? high : low;
+
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		int c = KeyCmp(key, data + slots[mid].offset);
+		if (c > 0 || (upper && c == 0))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+
+//-------------------------------------------------------------------
+// SortedPage::LowerBound
+//
+// Input   : key - pointer to the key to look for.
+// Output  : None
+// Purpose : Search for the first slot whose key is >= key.
+// Return  : The slot number, numOfSlots if every key is < key.
+//-------------------------------------------------------------------
+
+int SortedPage::LowerBound (const char *key)
+{
+	return KeyBound(key, false);
+}
+
+
+//-------------------------------------------------------------------
+// SortedPage::UpperBound
+//
+// Input   : key - pointer to the key to look for.
+// Output  : None
+// Purpose : Search for the first slot whose key is > key.
+// Return  : The slot number, numOfSlots if every key is <= key.
+//-------------------------------------------------------------------
+
+int SortedPage::UpperBound (const char *key)
+{
+	return KeyBound(key, true);
+}
+
+
 //-------------------------------------------------------------------
 // SortedPage::DeleteRecord
 //
@@ -82,23 +232,60 @@ Status SortedPage::InsertRecord (char * recPtr,
 // Output  : None
 // Postcond: The slots directory is compact.
 // Purpose : Delete a record from this page, and compact the slot
-//           directory.
+//           directory and the prefixes after it.  A long key loses
+//           the record's reference.
 //-------------------------------------------------------------------
 
 Status SortedPage::DeleteRecord (const RecordID& rid)
 {
 	Status status;
+	KeyType key;
+	int n = numOfSlots;
+	int i = rid.slotNo;
+
+	if (i < 0 || i >= n)
+		return FAIL;
 	
+	KeyCopy(key, data + slots[i].offset);
+
+	unsigned int *prefixes = Prefixes();
+	memmove(&prefixes[i], &prefixes[i + 1], (n - 1 - i) * PREFIX_SIZE);
 	status = HeapPage::DeleteRecord (rid);
 	
 	if (status == OK)
 		HeapPage::CompactSlotDir();
 	else
 		return FAIL;
+
+	// The prefixes follow the slot directory down.
+	memmove(&slots[n - 1], &slots[n], (n - 1) * PREFIX_SIZE);
+	freeSpace += PREFIX_SIZE;
 	
 	// ASSERTIONS:
 	// - slot directory is compacted
 	
-	return OK;
+	return KeyRelease(key);
 }
 
+
+
+//-------------------------------------------------------------------
+// SortedPage::ReleaseKeys
+//
+// Input   : None
+// Output  : None
+// Purpose : Drop the references the records of this page hold on long
+//           keys, before the page is freed without deleting them.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status SortedPage::ReleaseKeys ()
+{
+	for (int i = 0; i < numOfSlots; i++)
+	{
+		if (KeyRelease(data + slots[i].offset) != OK)
+			return FAIL;
+	}
+
+	return OK;
+}
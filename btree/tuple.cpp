@@ -0,0 +1,148 @@
+/*
+ * tuple.cpp - implementation of the Tuple header routines.
+ *
+ * The field accessors are inline in tuple.h; this file only lays out
+ * the header (field count and offsets) and prints a tuple.
+ */
+
+#include "tuple.h"
+
+
+static const char *tupleErrMsgs[] = {
+	"tuple is too big",
+	"unknown attribute type"
+};
+
+static error_string_table tupleTable(TUPLE, tupleErrMsgs);
+
+
+int Tuple::max_size = MINIBASE_PAGESIZE;
+
+
+//-------------------------------------------------------------------
+// Tuple::pad
+//
+// Input   : offset - offset of the field to be placed.
+//           type - type of the field.
+// Output  : None
+// Purpose : Align integer and real fields on a 4 byte boundary.
+// Return  : The (possibly padded) offset of the field.
+//-------------------------------------------------------------------
+
+short Tuple::pad(short offset, AttrType type)
+{
+	switch (type)
+	{
+	case attrInteger:
+	case attrReal:
+		return (short)((offset + 3) & ~3);
+
+	default:
+		return offset;
+	}
+}
+
+
+//-------------------------------------------------------------------
+// Tuple::setHdr
+//
+// Input   : numFlds - number of fields in this tuple.
+//           types - types of the fields.
+//           strSizes - maximum length of each string field, excluding
+//                      the trailing '\0'.  Indexed by string field, i.e.
+//                      strSizes[k] is the size of the k-th string.
+// Output  : None
+// Purpose : Set up the header of this tuple: the field count followed
+//           by the offset of every field and the end of the tuple.
+// Return  : OK if the tuple fits in max_size, TUPLE otherwise.
+//-------------------------------------------------------------------
+
+Status Tuple::setHdr(short numFlds, AttrType types[], short strSizes[])
+{
+	int offset = (numFlds + 2) * sizeof(short);
+	int strCount = 0;
+
+	if (offset > max_size)
+		return MINIBASE_FIRST_ERROR(TUPLE, TUPLE_TOOBIG_ERR);
+
+	fldCnt = numFlds;
+
+	for (int i = 0; i < numFlds; i++)
+	{
+		offset = pad((short)offset, types[i]);
+		fldOffset[i] = (short)offset;
+
+		switch (types[i])
+		{
+		case attrInteger:
+			offset += sizeof(int);
+			break;
+
+		case attrReal:
+			offset += sizeof(float);
+			break;
+
+		case attrString:
+			if (strSizes == NULL)
+				return MINIBASE_FIRST_ERROR(TUPLE, TUPLE_TYPE_ERR);
+			offset += strSizes[strCount++] + 1;
+			break;
+
+		case attrNull:
+			break;
+
+		default:
+			return MINIBASE_FIRST_ERROR(TUPLE, TUPLE_TYPE_ERR);
+		}
+
+		if (offset > max_size)
+			return MINIBASE_FIRST_ERROR(TUPLE, TUPLE_TOOBIG_ERR);
+	}
+
+	fldOffset[numFlds] = (short)offset;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// Tuple::print
+//
+// Input   : type - types of the fields of this tuple.
+//           out - stream to print to.
+// Output  : None
+// Purpose : Print the fields of this tuple as [f1, f2, ...].
+//-------------------------------------------------------------------
+
+void Tuple::print(AttrType type[], ostream& out)
+{
+	int ival;
+	float fval;
+	char *sval;
+
+	out << "[";
+	for (int i = 1; i <= fldCnt; i++)
+	{
+		switch (type[i - 1])
+		{
+		case attrInteger:
+			out << getFld(i, ival);
+			break;
+
+		case attrReal:
+			out << getFld(i, fval);
+			break;
+
+		case attrString:
+			out << getFld(i, sval);
+			break;
+
+		default:
+			out << "NULL";
+			break;
+		}
+
+		if (i != fldCnt)
+			out << ", ";
+	}
+	out << "]" << endl;
+}
@@ -0,0 +1,180 @@
+/*
+ * arc.cpp - the ARC replacement policy (Megiddo and Modha).
+ *
+ * REPLACE in the paper also looks at whether the page being read is in
+ * B2 to break a tie at |T1| == p.  PickVictim is not told which page is
+ * coming, so a tie evicts from T2.
+ */
+
+#include "replacer.h"
+
+
+ARC::ARC(int bufSize, ClockFrame **frames)
+	: freeFrames(bufSize), where(bufSize, NOWHERE), position(bufSize)
+{
+	numOfBuf = bufSize;
+	this->frames = frames;
+	target = 0;
+}
+
+
+//-------------------------------------------------------------------
+// ARC::PickVictim
+//
+// Input   : None
+// Output  : None
+// Purpose : Take a free frame, or else the least recently used
+//           unpinned page of T1 if T1 is over its target size, of T2
+//           otherwise.  The page is remembered in B1 or B2.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int ARC::PickVictim()
+{
+	int frameNo = freeFrames.Take();
+	if (frameNo != INVALID_FRAME)
+		return frameNo;
+
+	if (!t1.empty() && ((int)t1.size() > target || t2.empty()))
+	{
+		frameNo = EvictFrom(t1, b1);
+		if (frameNo == INVALID_FRAME)
+			frameNo = EvictFrom(t2, b2);
+	}
+	else
+	{
+		frameNo = EvictFrom(t2, b2);
+		if (frameNo == INVALID_FRAME)
+			frameNo = EvictFrom(t1, b1);
+	}
+
+	return frameNo;
+}
+
+
+// The tail of T1, then of T2, or the other way round, as PickVictim
+// would take from them.
+void ARC::NextVictims(int n, std::vector<int>& frameNos)
+{
+	bool fromT1 = !t1.empty() && ((int)t1.size() > target || t2.empty());
+	std::list<int> *lists[2] = { fromT1 ? &t1 : &t2, fromT1 ? &t2 : &t1 };
+
+	for (int l = 0; l < 2; l++)
+	{
+		for (std::list<int>::reverse_iterator it = lists[l]->rbegin();
+			 it != lists[l]->rend() && n > 0; ++it)
+		{
+			if (frames[*it]->NotPinned())
+			{
+				frameNos.push_back(*it);
+				n--;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------
+// ARC::EvictFrom
+//
+// Input   : list - t1 or t2.
+//           ghostList - b1 or b2, to remember the page in.
+// Output  : None
+// Purpose : Take the unpinned frame nearest the tail of list.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int ARC::EvictFrom(std::list<int>& list, Ghosts& ghostList)
+{
+	for (std::list<int>::reverse_iterator it = list.rbegin(); it != list.rend(); ++it)
+	{
+		int frameNo = *it;
+		if (!frames[frameNo]->NotPinned())
+			continue;
+
+		list.erase(position[frameNo]);
+		where[frameNo] = NOWHERE;
+		ghostList.push_front(frames[frameNo]->GetPageID());
+		ghosts[ghostList.front()] = std::make_pair(&ghostList, ghostList.begin());
+		return frameNo;
+	}
+
+	return INVALID_FRAME;
+}
+
+
+void ARC::DropGhost(Ghosts& ghostList)
+{
+	ghosts.erase(ghostList.back());
+	ghostList.pop_back();
+}
+
+
+//-------------------------------------------------------------------
+// ARC::PageAccessed
+//
+// Input   : frameNo - frame of the page.
+//           pid - the page.
+// Output  : None
+// Purpose : A hit moves the page to the head of T2.  A page read in
+//           goes to T2 if B1 or B2 remembers it, after moving the
+//           target size of T1 towards that list, and to T1 otherwise.
+//           B1 and B2 are then trimmed to c and 2c pages with T1 and
+//           all four lists, c being the number of frames.
+//-------------------------------------------------------------------
+
+void ARC::PageAccessed(int frameNo, PageID pid)
+{
+	if (where[frameNo] == T1 || where[frameNo] == T2)
+	{
+		t2.splice(t2.begin(), where[frameNo] == T1 ? t1 : t2, position[frameNo]);
+		where[frameNo] = T2;
+		return;
+	}
+
+	freeFrames.Remove(frameNo);
+	std::unordered_map<PageID, std::pair<Ghosts *, Ghosts::iterator> >::iterator g =
+		ghosts.find(pid);
+	if (g != ghosts.end())
+	{
+		int b1Size = (int)b1.size(), b2Size = (int)b2.size();
+		if (g->second.first == &b1)
+		{
+			int delta = b2Size > b1Size ? b2Size / b1Size : 1;
+			target = target + delta < numOfBuf ? target + delta : numOfBuf;
+		}
+		else
+		{
+			int delta = b1Size > b2Size ? b1Size / b2Size : 1;
+			target = target - delta > 0 ? target - delta : 0;
+		}
+		g->second.first->erase(g->second.second);
+		ghosts.erase(g);
+
+		t2.push_front(frameNo);
+		position[frameNo] = t2.begin();
+		where[frameNo] = T2;
+	}
+	else
+	{
+		t1.push_front(frameNo);
+		position[frameNo] = t1.begin();
+		where[frameNo] = T1;
+	}
+
+	while ((int)(t1.size() + b1.size()) > numOfBuf && !b1.empty())
+		DropGhost(b1);
+	while ((int)(t1.size() + t2.size() + b1.size() + b2.size()) > 2 * numOfBuf)
+		DropGhost(b2.empty() ? b1 : b2);
+}
+
+
+void ARC::PageFreed(int frameNo)
+{
+	if (where[frameNo] == T1)
+		t1.erase(position[frameNo]);
+	else if (where[frameNo] == T2)
+		t2.erase(position[frameNo]);
+	where[frameNo] = NOWHERE;
+	freeFrames.Add(frameNo);
+}
@@ -0,0 +1,189 @@
+/*
+ * arena.cpp - the frames of the buffer pool and the memory of their
+ *             pages, in blocks of one mapping each.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+
+FrameArena::FrameArena(HugePages hugePages)
+{
+	this->hugePages = hugePages;
+	systemPageSize = sysconf(_SC_PAGESIZE);
+}
+
+
+FrameArena::~FrameArena()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		Unmap(blocks[i]);
+		delete [] blocks[i]->frames;
+		delete blocks[i];
+	}
+}
+
+
+//-------------------------------------------------------------------
+// FrameArena::Map
+//
+// Input   : block - a block whose size is set.
+// Output  : None
+// Purpose : Get the memory of the block's pages: reserved huge pages
+//           if asked for and there are enough, else a mapping trimmed
+//           to start on a huge page boundary, advised to be put on
+//           transparent huge pages unless HUGE_PAGES_OFF, else the
+//           heap.
+//-------------------------------------------------------------------
+
+void FrameArena::Map(Block *block)
+{
+	block->reserved = block->mapped = false;
+
+#ifdef MAP_HUGETLB
+	if (hugePages == HUGE_PAGES_RESERVED)
+	{
+		size_t size = (block->size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			block->memory = (char *)memory;
+			block->size = size;
+			block->reserved = block->mapped = true;
+			return;
+		}
+	}
+#endif
+
+	size_t size = (block->size + systemPageSize - 1) / systemPageSize * systemPageSize;
+	size_t over = size + HUGE_PAGE_SIZE;
+	void *memory = mmap(NULL, over, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+	{
+		block->memory = (char *)aligned_alloc(systemPageSize, size);
+		block->size = size;
+		return;
+	}
+
+	char *start = (char *)(((uintptr_t)memory + HUGE_PAGE_SIZE - 1) &
+						   ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+	if (start > (char *)memory)
+		munmap(memory, start - (char *)memory);
+	if ((char *)memory + over > start + size)
+		munmap(start + size, (char *)memory + over - (start + size));
+
+#ifdef MADV_HUGEPAGE
+	if (hugePages != HUGE_PAGES_OFF)
+		madvise(start, size, MADV_HUGEPAGE);
+#endif
+	block->memory = start;
+	block->size = size;
+	block->mapped = true;
+}
+
+
+void FrameArena::Unmap(Block *block)
+{
+	if (block->size == 0)
+		return;
+	if (block->mapped)
+		munmap(block->memory, block->size);
+	else
+		free(block->memory);
+	block->size = 0;
+}
+
+
+//-------------------------------------------------------------------
+// FrameArena::Allocate
+//
+// Input   : n - number of frames.
+// Output  : frames - gets the frames.
+// Purpose : Make a block of n empty frames and their pages.
+//-------------------------------------------------------------------
+
+void FrameArena::Allocate(int n, ClockFrame **frames)
+{
+	Block *block = new Block;
+
+	block->frames = new ClockFrame[n];
+	block->numOfFrames = n;
+	block->size = (size_t)n * MINIBASE_PAGESIZE;
+	block->given.assign(n, false);
+	block->numGiven = 0;
+	Map(block);
+
+	for (int i = 0; i < n; i++)
+	{
+		block->frames[i].SetPage((Page *)(block->memory + (size_t)i * MINIBASE_PAGESIZE));
+		frames[i] = &block->frames[i];
+	}
+	blocks.push_back(block);
+}
+
+
+//-------------------------------------------------------------------
+// FrameArena::GiveBack
+//
+// Input   : frame - a frame of the arena the pool no longer uses.
+// Output  : None
+// Purpose : Forget the frame's page, and return to the system the
+//           memory of the pages around it that are all given back:
+//           the operating system pages they cover, or the whole block
+//           if it is on reserved huge pages, which cannot be split.
+//-------------------------------------------------------------------
+
+void FrameArena::GiveBack(ClockFrame *frame)
+{
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		Block *block = blocks[b];
+		if (frame < block->frames || frame >= block->frames + block->numOfFrames)
+			continue;
+
+		int i = frame - block->frames;
+		frame->SetPage(NULL);
+		if (block->given[i])
+			return;
+		block->given[i] = true;
+		if (++block->numGiven == block->numOfFrames)
+		{
+			Unmap(block);
+			return;
+		}
+		if (!block->mapped || block->reserved)
+			return;
+
+		// The system pages the frame's page is on, and the frames on them.
+		size_t first = (size_t)i * MINIBASE_PAGESIZE / systemPageSize * systemPageSize;
+		size_t end = ((size_t)(i + 1) * MINIBASE_PAGESIZE + systemPageSize - 1) /
+			systemPageSize * systemPageSize;
+		for (size_t k = first / MINIBASE_PAGESIZE;
+			 k < (size_t)block->numOfFrames && k * MINIBASE_PAGESIZE < end; k++)
+			if (!block->given[k])
+				return;
+		madvise(block->memory + first, end - first, MADV_DONTNEED);
+		return;
+	}
+}
+
+
+void FrameArena::GetStat(long& bytes, long& reservedBytes)
+{
+	bytes = reservedBytes = 0;
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		long inUse = blocks[b]->size == 0 ? 0 :
+			(long)(blocks[b]->numOfFrames - blocks[b]->numGiven) * MINIBASE_PAGESIZE;
+		bytes += inUse;
+		if (blocks[b]->reserved)
+			reservedBytes += inUse;
+	}
+}
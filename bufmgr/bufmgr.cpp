@@ -0,0 +1,2295 @@
+/*
+ * bufmgr.cpp - the buffer manager.
+ *
+ * A pool of numOfBuf ClockFrames, made by a FrameArena, split into
+ * shards by page id.  Each shard has a HashTable from page id to frame,
+ * a replacement policy, Clock unless another is asked for, and a mutex
+ * held for the whole of every call on it, I/O included.  Misuse
+ * (unpinning a page that is not pinned, running out of frames, ...) is
+ * reported on cerr and returns FAIL.
+ *
+ * Under Clock, which needs no word of hits, a pin of a page already in
+ * the pool and its unpin skip the mutex: a LookUp of the page table,
+ * Frame::TryPin and an atomic count of the hit.  The pin itself is what
+ * keeps the frame from being refilled, as a frame must be claimed,
+ * unpinned, before the page in it changes (see frame.h).  Anything that
+ * does not work out that way, a page the LookUp misses or a frame that
+ * is claimed, takes the locked path.
+ *
+ * A miss with an AccessStrategy first tries the oldest frame of the
+ * strategy's ring for the shard, and only goes to the replacement
+ * policy if that one is pinned or no longer holds the ring's page.
+ *
+ * Dirty pages are written in runs of consecutive page ids, one pwritev
+ * each: FlushAllPages sorts the whole pool's dirty pages, and a dirty
+ * victim takes along the dirty pages next to it that no one has latched
+ * exclusive.
+ *
+ * The background writer, if started, writes the dirty pages the policy
+ * is about to evict before a miss has to.  It claims them, only those
+ * no one has pinned, under the lock of their shard and writes them
+ * without it, never waiting for a shard lock.  A claimed page cannot be
+ * pinned, and so changed, while it is being written: a lock-free pin
+ * passes it by, and FindFrame waits for the writer with the lock held.
+ *
+ * Prefetch reads pages into clean victims asynchronously.  A frame
+ * being read into is claimed, so lock-free pins pass it by, and its
+ * page is in the page table, so FindFrame sees it and waits for the
+ * read: whoever looks a page up under the lock gets it complete.
+ *
+ * GetMetrics adds up counters kept per shard, which are atomic and only
+ * go up, so it takes no lock and can be polled while the pool is busy.
+ * A pin is put on the account of its thread's MetricsScope, and of the
+ * page type the scope's file reads off the page once it is pinned.
+ *
+ * The hot set keeper saves the ids of the pages in the pool, hottest
+ * first, now and then, and LoadHotSet reads them back after a restart
+ * in sorted runs, without a lock, and puts each page in a free frame
+ * under the lock of its shard.  A page read that way may be stale if
+ * it was written meanwhile, so if any page was, it is dropped instead.
+ *
+ * Resize locks every shard and renumbers the frames, so the lock-free
+ * paths take the frames and page tables from the View current when
+ * they start, and a thread still on an old View finds pages only in
+ * frames that hold them or that are claimed: TryPin sorts it out.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "bufmgr.h"
+
+
+// File number whose account the pins of this thread go to.
+static thread_local int currentMetricsFile = 0;
+
+
+MetricsScope::MetricsScope(int fileNo)
+{
+	saved = currentMetricsFile;
+	currentMetricsFile = fileNo;
+}
+
+
+MetricsScope::~MetricsScope()
+{
+	currentMetricsFile = saved;
+}
+
+
+long BufMetrics::TotalPins() const
+{
+	long total = 0;
+	for (int f = 0; f < METRICS_MAX_FILES; f++)
+		for (int t = 0; t < METRICS_MAX_TYPES; t++)
+			total += pins[f][t];
+	return total;
+}
+
+
+long BufMetrics::TotalMisses() const
+{
+	long total = 0;
+	for (int f = 0; f < METRICS_MAX_FILES; f++)
+		for (int t = 0; t < METRICS_MAX_TYPES; t++)
+			total += misses[f][t];
+	return total;
+}
+
+
+void BufMetrics::Subtract(const BufMetrics& earlier)
+{
+	for (int f = 0; f < METRICS_MAX_FILES; f++)
+	{
+		for (int t = 0; t < METRICS_MAX_TYPES; t++)
+		{
+			pins[f][t] -= earlier.pins[f][t];
+			misses[f][t] -= earlier.misses[f][t];
+		}
+	}
+	cleanEvictions -= earlier.cleanEvictions;
+	dirtyEvictions -= earlier.dirtyEvictions;
+	aheadEvictions -= earlier.aheadEvictions;
+	lockWaits -= earlier.lockWaits;
+	latchWaits -= earlier.latchWaits;
+	readWaits -= earlier.readWaits;
+	reads -= earlier.reads;
+	readNanos -= earlier.readNanos;
+	writes -= earlier.writes;
+	pagesWritten -= earlier.pagesWritten;
+	writeNanos -= earlier.writeNanos;
+	prefetches -= earlier.prefetches;
+	for (int b = 0; b < PIN_HOLD_BUCKETS; b++)
+		pinHolds[b] -= earlier.pinHolds[b];
+}
+
+
+static long NanosSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::BufMgr
+//
+// Input   : bufsize - number of frames.
+//           replacementPolicy - name of the policy, see
+//                               Replacer::Create.
+//           numOfShards - number of shards, 0 for one per
+//                         MIN_SHARD_FRAMES frames up to MAX_BUF_SHARDS.
+//           hugePages - whether to put the pages on huge pages.
+// Output  : None
+// Purpose : Allocate the pool, all frames empty, and deal the frames
+//           out to the shards as evenly as possible.
+//-------------------------------------------------------------------
+
+BufMgr::BufMgr(int bufsize, const char *replacementPolicy, int numOfShards,
+			   HugePages hugePages)
+{
+	numOfBuf = bufsize;
+	arena = new FrameArena(hugePages);
+	frames = new ClockFrame*[numOfBuf];
+	arena->Allocate(numOfBuf, frames);
+
+	ringOf = new std::atomic<AccessStrategy *>[numOfBuf]();
+	reads = new IORequest[numOfBuf];
+	readPending = new bool[numOfBuf]();
+
+	if (numOfShards <= 0)
+	{
+		numOfShards = numOfBuf / MIN_SHARD_FRAMES;
+		if (numOfShards > MAX_BUF_SHARDS)
+			numOfShards = MAX_BUF_SHARDS;
+	}
+	if (numOfShards > numOfBuf)
+		numOfShards = numOfBuf;
+	if (numOfShards < 1)
+		numOfShards = 1;
+	this->numOfShards = numOfShards;
+	shards = new Shard[numOfShards];
+	policyName = replacementPolicy;
+
+	for (int i = 0, firstFrame = 0; i < numOfShards; i++)
+	{
+		Shard& shard = shards[i];
+		shard.firstFrame = firstFrame;
+		shard.numOfFrames = numOfBuf / numOfShards + (i < numOfBuf % numOfShards);
+		shard.writerCursor = 0;
+		firstFrame += shard.numOfFrames;
+
+		shard.hashTable = new HashTable(shard.numOfFrames);
+		shard.replacer = Replacer::Create(replacementPolicy, shard.numOfFrames,
+										  frames + shard.firstFrame, shard.hashTable);
+		if (shard.replacer == NULL)
+		{
+			if (i == 0)
+				cerr << "Replacement policy " << replacementPolicy
+					 << " is not available, using Clock" << endl;
+			shard.replacer = new Clock(shard.numOfFrames, frames + shard.firstFrame,
+									   shard.hashTable);
+			policyName = "Clock";
+		}
+	}
+
+	View *v = new View;
+	v->frames = frames;
+	v->ringOf = ringOf;
+	for (int i = 0; i < numOfShards; i++)
+		v->hashTables.push_back(shards[i].hashTable);
+	view = v;
+
+	lockFreeHits = !shards[0].replacer->WantsHits();
+	writerRunning = writerStop = writerKicked = false;
+	cleaning = 0;
+	resizing = false;
+	keeperRunning = keeperStop = false;
+	hotSetInterval = HOT_SET_INTERVAL;
+	hotSetDB = NULL;
+	warmed = 0;
+	cleaned = 0;
+	cleanPercent = 10;
+	writerInterval = 10;
+	traceFile = NULL;
+	pinTracking = false;
+	totalWrites = totalPagesWritten = writeNanos = 0;
+	numOfMetricsFiles = 1;
+	pageTypers[0] = NULL;
+	ResetStat();
+}
+
+
+BufMgr::~BufMgr()
+{
+	StopHotSetKeeper();
+	StopBackgroundWriter();
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		CompleteReads(shards[i], true);
+	}
+	FlushAllPages();
+
+	oldViews.push_back(view);
+	for (size_t i = 0; i < oldViews.size(); i++)
+	{
+		delete [] oldViews[i]->frames;
+		delete [] oldViews[i]->ringOf;
+		for (size_t j = 0; j < oldViews[i]->hashTables.size(); j++)
+			delete oldViews[i]->hashTables[j];
+		delete oldViews[i];
+	}
+	for (int i = 0; i < numOfShards; i++)
+		delete shards[i].replacer;
+	delete [] shards;
+	delete [] reads;
+	delete [] readPending;
+	delete arena;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FindFrame
+//
+// Input   : shard - the shard of pid, locked.
+//           pid - a page id.
+// Output  : None
+// Purpose : Look the page up, completing its read if Prefetch started
+//           one, or waiting for the background writer if it is writing
+//           the page.  The page tables hold pool-wide frame numbers;
+//           the replacers of the shards number their frames from 0.
+// Return  : The frame holding pid, INVALID_FRAME if none does or its
+//           read failed.
+//-------------------------------------------------------------------
+
+int BufMgr::FindFrame(Shard& shard, PageID pid)
+{
+	int frameNo = shard.hashTable->LookUp(pid);
+
+	if (frameNo == INVALID_FRAME)
+		return frameNo;
+	if (!readPending[frameNo])
+	{
+		// Under the lock, only the writer leaves a frame in the page
+		// table claimed.
+		if (frames[frameNo]->IsClaimed())
+			WaitForWriter(frameNo);
+		return frameNo;
+	}
+	if (!MINIBASE_DB->IsIODone(&reads[frameNo]))
+		shard.readWaits.Add();
+	return CompleteRead(shard, frameNo) == OK ? frameNo : INVALID_FRAME;
+}
+
+
+// Pins and misses are those of the metrics since ResetStat.
+Status BufMgr::GetStat(long& pinNo, long& missNo)
+{
+	SumPins(pinNo, missNo);
+	pinNo -= statPins;
+	missNo -= statMisses;
+	return OK;
+}
+
+
+void BufMgr::ResetStat()
+{
+	SumPins(statPins, statMisses);
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		for (int t = 0; t < NUM_ACCESS_TYPES; t++)
+			shards[i].framesTaken[t] = shards[i].framesRecycled[t] = 0;
+		shards[i].cleanEvictions = shards[i].dirtyEvictions = 0;
+		shards[i].aheadEvictions = 0;
+	}
+	writeCalls = 0;
+	pagesWritten = 0;
+	prefetched = 0;
+}
+
+
+void BufMgr::GetWriteStat(long& writes, long& pages)
+{
+	writes = writeCalls;
+	pages = pagesWritten;
+}
+
+
+void BufMgr::GetEvictionStat(long& clean, long& dirty, long& cleanedAhead)
+{
+	clean = dirty = cleanedAhead = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		clean += shards[i].cleanEvictions;
+		dirty += shards[i].dirtyEvictions;
+		cleanedAhead += shards[i].aheadEvictions;
+	}
+}
+
+
+// Count the eviction of the page in frame, dirty if it had to be
+// written first; before the frame is emptied.
+void BufMgr::CountEviction(Shard& shard, ClockFrame *frame, bool dirty)
+{
+	if (dirty)
+	{
+		shard.dirtyEvictions++;
+		shard.dirtyEvicted.Add();
+		return;
+	}
+
+	shard.cleanEvictions++;
+	shard.cleanEvicted.Add();
+	if (frame->WasCleanedAhead())
+	{
+		shard.aheadEvictions++;
+		shard.aheadEvicted.Add();
+	}
+}
+
+
+// PinChild calls that went through a link, and those that did not.
+void BufMgr::GetSwizzleStat(long& followed, long& missed)
+{
+	followed = missed = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		followed += shards[i].linksFollowed;
+		missed += shards[i].linksMissed;
+	}
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::GetMetrics
+//
+// Input   : None
+// Output  : metrics - the counters of the pool since it was made.
+// Purpose : Take a snapshot of the metrics.  The counters are read one
+//           by one, without a lock, so a snapshot taken while other
+//           threads pin pages is only consistent to within the pins
+//           under way.
+//-------------------------------------------------------------------
+
+void BufMgr::GetMetrics(BufMetrics& metrics)
+{
+	memset(&metrics, 0, sizeof(metrics));
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		Shard& shard = shards[i];
+		for (int f = 0; f < METRICS_MAX_FILES; f++)
+		{
+			for (int t = 0; t < METRICS_MAX_TYPES; t++)
+			{
+				metrics.pins[f][t] += shard.pins[f][t];
+				metrics.misses[f][t] += shard.misses[f][t];
+			}
+		}
+		metrics.cleanEvictions += shard.cleanEvicted;
+		metrics.dirtyEvictions += shard.dirtyEvicted;
+		metrics.aheadEvictions += shard.aheadEvicted;
+		metrics.lockWaits += shard.lockWaits;
+		metrics.latchWaits += shard.latchWaits;
+		metrics.readWaits += shard.readWaits;
+		metrics.reads += shard.reads;
+		metrics.readNanos += shard.readNanos;
+		metrics.prefetches += shard.prefetches;
+		for (int b = 0; b < PIN_HOLD_BUCKETS; b++)
+			metrics.pinHolds[b] += shard.pinHolds[b];
+	}
+	metrics.writes = totalWrites;
+	metrics.pagesWritten = totalPagesWritten;
+	metrics.writeNanos = writeNanos;
+}
+
+
+int BufMgr::RegisterMetricsFile(const char *name, PageTyper typer)
+{
+	std::lock_guard<std::mutex> guard(metricsMutex);
+	int n = numOfMetricsFiles;
+
+	for (int f = 1; f < n; f++)
+		if (metricsFileNames[f] == name)
+			return f;
+	if (n == METRICS_MAX_FILES)
+		return 0;
+
+	metricsFileNames[n] = name;
+	pageTypers[n] = typer;
+	numOfMetricsFiles = n + 1;
+	return n;
+}
+
+
+const char *BufMgr::GetMetricsFileName(int fileNo)
+{
+	if (fileNo <= 0 || fileNo >= numOfMetricsFiles)
+		return "";
+	return metricsFileNames[fileNo].c_str();
+}
+
+
+void BufMgr::SumPins(long& pins, long& misses)
+{
+	pins = misses = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		for (int f = 0; f < METRICS_MAX_FILES; f++)
+		{
+			for (int t = 0; t < METRICS_MAX_TYPES; t++)
+			{
+				pins += shards[i].pins[f][t];
+				misses += shards[i].misses[f][t];
+			}
+		}
+	}
+}
+
+
+// Count a pin of pid, which is in page unless the pin is of an empty
+// page, against the thread's file and the type of the page.
+void BufMgr::CountPin(Shard& shard, PageID pid, Page *page, bool miss)
+{
+	int fileNo = currentMetricsFile;
+	int type = METRICS_OTHER_TYPE;
+
+	if (fileNo != 0 && page != NULL && pageTypers[fileNo] != NULL)
+	{
+		type = pageTypers[fileNo](pid, page);
+		if (type < 0 || type > METRICS_OTHER_TYPE)
+			type = METRICS_OTHER_TYPE;
+	}
+	shard.pins[fileNo][type].Add();
+	if (miss)
+		shard.misses[fileNo][type].Add();
+}
+
+
+// The last pin of frame was dropped: count how long it was held, if
+// it was timed.
+void BufMgr::CountUnpin(Shard& shard, ClockFrame *frame)
+{
+	long held = frame->HeldFor();
+	if (held < 0)
+		return;
+
+	long us = held / 1000;
+	int bucket = 0;
+
+	while (us > 0 && bucket < PIN_HOLD_BUCKETS - 1)
+	{
+		us >>= 1;
+		bucket++;
+	}
+	shard.pinHolds[bucket].Add();
+}
+
+
+void BufMgr::GetStrategyStat(AccessType type, long& taken, long& recycled)
+{
+	taken = recycled = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		taken += shards[i].framesTaken[type];
+		recycled += shards[i].framesRecycled[type];
+	}
+}
+
+
+AccessStrategy::AccessStrategy(AccessType type, int numOfShards, int ringSize)
+	: rings(numOfShards, std::vector<int>(ringSize, INVALID_FRAME)),
+	  current(numOfShards, 0)
+{
+	this->type = type;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::GetAccessStrategy
+//
+// Input   : type - how the caller will use the pages it pins.
+// Output  : None
+// Purpose : Make a strategy to pass to PinPage, with empty rings.  The
+//           frames of a ring are shared out among the shards.  Free it
+//           with FreeAccessStrategy.
+// Return  : The strategy, NULL for NORMAL_ACCESS.
+//-------------------------------------------------------------------
+
+AccessStrategy *BufMgr::GetAccessStrategy(AccessType type)
+{
+	if (type != BULK_READ)
+		return NULL;
+
+	int ringSize = numOfBuf / 8;
+	if (ringSize > BULK_READ_RING_SIZE)
+		ringSize = BULK_READ_RING_SIZE;
+	ringSize /= numOfShards;
+	if (ringSize < 1)
+		ringSize = 1;
+	return new AccessStrategy(type, numOfShards, ringSize);
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FreeAccessStrategy
+//
+// Input   : strategy - a strategy from GetAccessStrategy, or NULL.
+// Output  : None
+// Purpose : Delete the strategy.  The pages of its rings stay in the
+//           pool as ordinary pages.
+//-------------------------------------------------------------------
+
+void BufMgr::FreeAccessStrategy(AccessStrategy *strategy)
+{
+	if (strategy == NULL)
+		return;
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		std::vector<int>& ring = strategy->rings[i];
+		for (size_t j = 0; j < ring.size(); j++)
+		{
+			if (InRing(shards[i], strategy, ring[j]))
+				ringOf[ring[j]] = NULL;
+		}
+	}
+	delete strategy;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::GetVictim
+//
+// Input   : shard - the shard to find a frame in, locked.
+//           strategy - strategy of the pin, NULL if none.
+// Output  : recycled - true if the frame comes from the ring, which
+//                      the replacement policy has not given up.
+// Purpose : Find a frame to read a page into.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int BufMgr::GetVictim(Shard& shard, AccessStrategy *strategy, bool& recycled)
+{
+	int frameNo;
+
+	recycled = false;
+	if (strategy != NULL)
+	{
+		int shardNo = &shard - shards;
+		frameNo = strategy->rings[shardNo][strategy->current[shardNo]];
+		if (InRing(shard, strategy, frameNo) && frames[frameNo]->NotPinned())
+		{
+			recycled = true;
+			return frameNo;
+		}
+	}
+
+	frameNo = shard.replacer->PickVictim();
+	return frameNo == INVALID_FRAME ? INVALID_FRAME : shard.firstFrame + frameNo;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::ClaimVictim
+//
+// Input   : As GetVictim.
+// Output  : recycled - as GetVictim.
+// Purpose : Find a frame to read a page into and claim it.  A victim
+//           may have been pinned without the lock since the policy
+//           picked it; the claim fails then and the policy picks again.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int BufMgr::ClaimVictim(Shard& shard, AccessStrategy *strategy, bool& recycled)
+{
+	for (int tries = 0; tries < shard.numOfFrames; tries++)
+	{
+		int frameNo = GetVictim(shard, strategy, recycled);
+		if (frameNo == INVALID_FRAME)
+			return INVALID_FRAME;
+		if (frames[frameNo]->Claim(0))
+			return frameNo;
+		if (!recycled)
+			shard.replacer->PageAccessed(frameNo - shard.firstFrame,
+										 frames[frameNo]->GetPageID());
+	}
+	return INVALID_FRAME;
+}
+
+
+// Make frameNo, just filled, the newest frame of the strategy's ring
+// for the shard.
+void BufMgr::AddToRing(Shard& shard, AccessStrategy *strategy, int frameNo)
+{
+	int shardNo = &shard - shards;
+	int& slot = strategy->rings[shardNo][strategy->current[shardNo]];
+
+	if (InRing(shard, strategy, slot))
+		ringOf[slot] = NULL;
+	slot = frameNo;
+	ringOf[frameNo] = strategy;
+	strategy->current[shardNo] = (strategy->current[shardNo] + 1) %
+		strategy->rings[shardNo].size();
+}
+
+
+// True if frameNo, from one of the strategy's rings for the shard, is
+// still in the ring.  Resize leaves the rings with the frame numbers of
+// before, which may now be another shard's, or past the end of the pool.
+bool BufMgr::InRing(Shard& shard, AccessStrategy *strategy, int frameNo)
+{
+	return frameNo >= shard.firstFrame && frameNo < shard.firstFrame + shard.numOfFrames &&
+		ringOf[frameNo] == strategy;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::PinPage
+//
+// Input   : pid - page to pin.
+//           emptyPage - true if the caller will overwrite the whole
+//                       page, so it need not be read.
+//           strategy - from GetAccessStrategy, NULL for normal access.
+// Output  : page - the page, in the pool.
+// Purpose : Pin a page, reading it into a free or victim frame if it
+//           is not in the pool.  A dirty victim is written first.  A
+//           pin without a strategy takes the page out of any ring, as
+//           it is no longer used by a scan alone.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::PinPage(PageID pid, Page*& page, bool emptyPage,
+					   AccessStrategy *strategy)
+{
+	ClockFrame *frame;
+
+	return Pin(pid, page, emptyPage, strategy, frame);
+}
+
+
+Status BufMgr::PinPage(PageID pid, Page*& page, LatchMode mode)
+{
+	ClockFrame *frame;
+
+	if (Pin(pid, page, false, NULL, frame) != OK)
+		return FAIL;
+	if (!frame->TryLatch(mode))
+	{
+		ShardOf(pid).latchWaits.Add();
+		frame->Latch(mode);
+	}
+	return OK;
+}
+
+
+Status BufMgr::PinPage(PageID pid, Page*& page, ClockFrame*& frame)
+{
+	return Pin(pid, page, false, NULL, frame);
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::PinChild
+//
+// Input   : parent - the frame of a page the caller has pinned.
+//           pid - a page that page links to.
+// Output  : page - the page, in the pool.
+//           frame - the frame holding it.
+// Purpose : Pin pid through parent's swizzled link to it: a pin of the
+//           frame the link points to, which holds if pid is still in
+//           it.  If not, or there is no link, or pins must go through
+//           the shard's lock, pin it as PinPage and link parent to it.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::PinChild(ClockFrame *parent, PageID pid, Page*& page, ClockFrame*& frame)
+{
+	Shard& shard = ShardOf(pid);
+
+	if (lockFreeHits && traceFile == NULL)
+	{
+		ClockFrame *linked = (ClockFrame *)parent->GetLink(pid);
+		if (linked != NULL && linked->TryPin(pid))
+		{
+			frame = linked;
+			page = frame->GetPage();
+			CountPin(shard, pid, page, false);
+			shard.linksFollowed.Add();
+			return OK;
+		}
+	}
+
+	shard.linksMissed.Add();
+	if (Pin(pid, page, false, NULL, frame) != OK)
+		return FAIL;
+	parent->SetLink(pid, frame);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::Pin
+//
+// Input   : As PinPage.
+// Output  : page - the page, in the pool.
+//           frame - the frame holding it, which the pin keeps there
+//                   though Resize may renumber it.
+// Purpose : PinPage, without the lock of the page's shard if the page
+//           is in the pool and the policy allows, under it otherwise.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::Pin(PageID pid, Page*& page, bool emptyPage,
+				   AccessStrategy *strategy, ClockFrame*& frame)
+{
+	Shard& shard = ShardOf(pid);
+	int frameNo;
+
+	if (lockFreeHits && strategy == NULL && traceFile == NULL)
+	{
+		View *v = view.load(std::memory_order_acquire);
+		frameNo = v->hashTables[&shard - shards]->LookUp(pid);
+		if (frameNo != INVALID_FRAME && v->frames[frameNo]->TryPin(pid))
+		{
+			frame = v->frames[frameNo];
+			if (v->ringOf[frameNo].load(std::memory_order_relaxed) != NULL)
+				v->ringOf[frameNo] = NULL;
+			page = frame->GetPage();
+			CountPin(shard, pid, page, false);
+			return OK;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		shard.lockWaits.Add();
+		lock.lock();
+	}
+	bool recycled;
+	AccessType type = strategy != NULL ? strategy->type : NORMAL_ACCESS;
+
+	if (traceFile != NULL)
+		fprintf(traceFile, "%d\n", pid);
+
+	frameNo = FindFrame(shard, pid);
+	if (frameNo != INVALID_FRAME)
+	{
+		frame = frames[frameNo];
+		frame->Pin();
+		shard.replacer->PageAccessed(frameNo - shard.firstFrame, pid);
+		if (strategy == NULL)
+			ringOf[frameNo] = NULL;
+		page = frame->GetPage();
+		CountPin(shard, pid, page, false);
+		return OK;
+	}
+
+	// Frames whose prefetch is done can be taken again; if those still
+	// being read are all there is, wait for them.
+	CompleteReads(shard, false);
+	frameNo = ClaimVictim(shard, strategy, recycled);
+	if (frameNo == INVALID_FRAME && !shard.pendingReads.empty())
+	{
+		CompleteReads(shard, true);
+		frameNo = ClaimVictim(shard, strategy, recycled);
+	}
+	if (frameNo == INVALID_FRAME)
+	{
+		cerr << "   Buffer is full." << endl;
+		return FAIL;
+	}
+	frame = frames[frameNo];
+
+	if (frame->IsValid())
+	{
+		bool dirty = frame->IsDirty();
+		if (dirty)
+			KickBackgroundWriter();
+		if (dirty && WriteVictim(frameNo) != OK)
+		{
+			// The victim stays: give it back to the policy.
+			frame->Release(0);
+			if (!recycled)
+				shard.replacer->PageAccessed(frameNo - shard.firstFrame,
+											 frame->GetPageID());
+			return FAIL;
+		}
+		CountEviction(shard, frame, dirty);
+		shard.hashTable->Delete(frame->GetPageID());
+		frame->EmptyIt();
+		if (recycled)
+			shard.replacer->PageFreed(frameNo - shard.firstFrame);
+	}
+	ringOf[frameNo] = NULL;
+
+	if (emptyPage)
+	{
+		frame->SetPageID(pid);
+	}
+	else
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Status s = frame->Read(pid);
+		shard.readNanos.Add(NanosSince(start));
+		shard.reads.Add();
+		if (s != OK)
+		{
+			frame->EmptyIt();
+			frame->Release(0);
+			shard.replacer->PageFreed(frameNo - shard.firstFrame);
+			return FAIL;
+		}
+	}
+
+	shard.hashTable->Insert(pid, frameNo);
+	frame->Release(1);
+	shard.replacer->PageAccessed(frameNo - shard.firstFrame, pid);
+	page = frame->GetPage();
+	CountPin(shard, pid, emptyPage ? NULL : page, true);
+
+	if (strategy != NULL)
+		AddToRing(shard, strategy, frameNo);
+	if (recycled)
+		shard.framesRecycled[type]++;
+	else
+		shard.framesTaken[type]++;
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::Prefetch
+//
+// Input   : pids - pages that will be pinned soon.
+//           n - how many.
+//           strategy - strategy of the pins to come, NULL if none.
+// Output  : None
+// Purpose : Start reading the pages that are not in the pool, each
+//           into a frame the replacement policy gives up.  A dirty
+//           victim is given back, and the background writer told,
+//           rather than written here.  At most a quarter of a shard's
+//           frames are being read into at once, so pins that miss
+//           still find victims.
+// Return  : OK; the pages skipped are simply read when pinned.
+//-------------------------------------------------------------------
+
+Status BufMgr::Prefetch(const PageID *pids, int n, AccessStrategy *strategy)
+{
+	std::vector< std::vector<PageID> > byShard(numOfShards);
+	int numOfPages = MINIBASE_DB->GetNumOfPages();
+
+	for (int i = 0; i < n; i++)
+		if (pids[i] >= 0 && pids[i] < numOfPages)
+			byShard[(unsigned int)pids[i] % numOfShards].push_back(pids[i]);
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		if (byShard[i].empty())
+			continue;
+
+		Shard& shard = shards[i];
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		std::vector<IORequest *> batch;
+		size_t limit = shard.numOfFrames / 4 > 1 ? shard.numOfFrames / 4 : 1;
+		AccessType type = strategy != NULL ? strategy->type : NORMAL_ACCESS;
+
+		for (size_t j = 0; j < byShard[i].size() && shard.pendingReads.size() < limit; j++)
+		{
+			PageID pid = byShard[i][j];
+			bool recycled;
+
+			if (shard.hashTable->LookUp(pid) != INVALID_FRAME)
+				continue;
+			int frameNo = ClaimVictim(shard, strategy, recycled);
+			if (frameNo == INVALID_FRAME)
+				break;
+
+			ClockFrame *frame = frames[frameNo];
+			if (frame->IsValid())
+			{
+				if (frame->IsDirty())
+				{
+					frame->Release(0);
+					if (!recycled)
+						shard.replacer->PageAccessed(frameNo - shard.firstFrame,
+													 frame->GetPageID());
+					KickBackgroundWriter();
+					continue;
+				}
+				CountEviction(shard, frame, false);
+				shard.hashTable->Delete(frame->GetPageID());
+				frame->EmptyIt();
+				if (recycled)
+					shard.replacer->PageFreed(frameNo - shard.firstFrame);
+			}
+			ringOf[frameNo] = NULL;
+
+			frame->SetPageID(pid);
+			shard.hashTable->Insert(pid, frameNo);
+			shard.replacer->PageAccessed(frameNo - shard.firstFrame, pid);
+			if (strategy != NULL)
+				AddToRing(shard, strategy, frameNo);
+			if (recycled)
+				shard.framesRecycled[type]++;
+			else
+				shard.framesTaken[type]++;
+
+			IORequest *read = &reads[frameNo];
+			read->write = false;
+			read->pid = pid;
+			read->page = frame->GetPage();
+			read->numPages = 1;
+			readPending[frameNo] = true;
+			shard.pendingReads.push_back(frameNo);
+			batch.push_back(read);
+		}
+
+		// Submitted under the lock, so no one waits for a read that has
+		// not started.
+		if (!batch.empty())
+		{
+			MINIBASE_DB->SubmitIO(&batch[0], (int)batch.size());
+			prefetched += batch.size();
+			shard.prefetches.Add(batch.size());
+		}
+	}
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::CompleteRead
+//
+// Input   : shard - the shard of the frame, locked.
+//           frameNo - a frame Prefetch is reading into.
+// Output  : None
+// Purpose : Wait for the read and give the frame up, unpinned.  If the
+//           read failed the page is dropped from the pool.
+// Return  : OK if successful, FAIL if the read failed.
+//-------------------------------------------------------------------
+
+Status BufMgr::CompleteRead(Shard& shard, int frameNo)
+{
+	ClockFrame *frame = frames[frameNo];
+	Status s = MINIBASE_DB->WaitIO(&reads[frameNo]);
+
+	readPending[frameNo] = false;
+	shard.pendingReads.erase(std::find(shard.pendingReads.begin(),
+									   shard.pendingReads.end(), frameNo));
+	if (s == OK)
+	{
+		frame->Release(0);
+		return OK;
+	}
+
+	shard.hashTable->Delete(frame->GetPageID());
+	frame->EmptyIt();
+	frame->Release(0);
+	shard.replacer->PageFreed(frameNo - shard.firstFrame);
+	ringOf[frameNo] = NULL;
+	return FAIL;
+}
+
+
+// Complete the shard's prefetch reads that are done, or all of them if
+// wait.
+void BufMgr::CompleteReads(Shard& shard, bool wait)
+{
+	for (size_t i = 0; i < shard.pendingReads.size(); )
+	{
+		int frameNo = shard.pendingReads[i];
+		if (wait || MINIBASE_DB->IsIODone(&reads[frameNo]))
+			CompleteRead(shard, frameNo);
+		else
+			i++;
+	}
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::UnpinPage
+//
+// Input   : pid - page to unpin.
+//           dirty - true if the caller modified the page.
+//           mode - the latch the caller holds on it, if any.
+// Output  : None
+// Return  : OK if successful, FAIL if the page is not pinned.
+//-------------------------------------------------------------------
+
+Status BufMgr::UnpinPage(PageID pid, bool dirty)
+{
+	return UnpinPage(pid, dirty, LATCH_NONE);
+}
+
+
+Status BufMgr::UnpinPage(PageID pid, bool dirty, LatchMode mode)
+{
+	Shard& shard = ShardOf(pid);
+	int frameNo;
+
+	// The caller's pin keeps the page where the LookUp finds it.
+	if (lockFreeHits)
+	{
+		View *v = view.load(std::memory_order_acquire);
+		frameNo = v->hashTables[&shard - shards]->LookUp(pid);
+		ClockFrame *frame = frameNo != INVALID_FRAME ? v->frames[frameNo] : NULL;
+		if (frame != NULL && frame->HasPageID(pid) && !frame->NotPinned())
+		{
+			frame->Unlatch(mode);
+			if (dirty)
+				frame->DirtyIt();
+			int left = frame->Unpin();
+			if (left == 0)
+				CountUnpin(shard, frame);
+			if (left >= 0)
+				return OK;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	frameNo = FindFrame(shard, pid);
+
+	if (frameNo == INVALID_FRAME)
+	{
+		cerr << "   Page " << pid << " is not in the buffer" << endl;
+		return FAIL;
+	}
+
+	if (frames[frameNo]->NotPinned())
+	{
+		cerr << "   Trying to unpin page " << pid
+			 << ", which is not pinned." << endl;
+		return FAIL;
+	}
+
+	frames[frameNo]->Unlatch(mode);
+	if (dirty)
+		frames[frameNo]->DirtyIt();
+	int left = frames[frameNo]->Unpin();
+	if (left == 0)
+		CountUnpin(shard, frames[frameNo]);
+	if (left < 0)
+	{
+		cerr << "   Trying to unpin page " << pid
+			 << ", which is not pinned." << endl;
+		return FAIL;
+	}
+	return OK;
+}
+
+
+// UnpinPage, for a page pinned in frame.
+Status BufMgr::UnpinFrame(ClockFrame *frame, bool dirty)
+{
+	PageID pid = frame->GetPageID();
+
+	if (!lockFreeHits)
+		return UnpinPage(pid, dirty);
+
+	int left = -1;
+	if (!frame->NotPinned())
+	{
+		if (dirty)
+			frame->DirtyIt();
+		left = frame->Unpin();
+	}
+	if (left < 0)
+	{
+		cerr << "   Trying to unpin page " << pid
+			 << ", which is not pinned." << endl;
+		return FAIL;
+	}
+	if (left == 0)
+		CountUnpin(ShardOf(pid), frame);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::PinPage, PinChild, NewPage, PinNewPage (into a guard)
+//
+// Input   : As the others, and site - the caller, or NULL.
+// Output  : guard - holds the pin, empty on failure.  A pin it held
+//                   before is dropped first.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::PinPage(PageID pid, PinGuard& guard, const char *site,
+					   AccessStrategy *strategy)
+{
+	ClockFrame *frame;
+	Page *page;
+
+	if (guard.Unpin() != OK || Pin(pid, page, false, strategy, frame) != OK)
+		return FAIL;
+	TrackPin(guard, pid, page, frame, site);
+	return OK;
+}
+
+
+Status BufMgr::PinChild(ClockFrame *parent, PageID pid, PinGuard& guard,
+						const char *site)
+{
+	ClockFrame *frame;
+	Page *page;
+
+	if (guard.Unpin() != OK || PinChild(parent, pid, page, frame) != OK)
+		return FAIL;
+	TrackPin(guard, pid, page, frame, site);
+	return OK;
+}
+
+
+Status BufMgr::NewPage(PageID& pid, PinGuard& guard, const char *site)
+{
+	if (guard.Unpin() != OK)
+		return FAIL;
+	if (MINIBASE_DB->AllocatePage(pid) != OK)
+	{
+		cerr << "  BufMgr :: Unable to allocate a page" << endl;
+		return FAIL;
+	}
+	if (PinNewPage(pid, guard, site) != OK)
+	{
+		MINIBASE_DB->DeallocatePage(pid);
+		return FAIL;
+	}
+	return OK;
+}
+
+
+Status BufMgr::PinNewPage(PageID pid, PinGuard& guard, const char *site)
+{
+	ClockFrame *frame;
+	Page *page;
+
+	if (guard.Unpin() != OK || Pin(pid, page, true, NULL, frame) != OK)
+		return FAIL;
+	TrackPin(guard, pid, page, frame, site);
+	return OK;
+}
+
+
+// Fill guard with a pin just made, and count it by site.
+void BufMgr::TrackPin(PinGuard& guard, PageID pid, Page *page, ClockFrame *frame,
+					  const char *site)
+{
+	guard.pool = this;
+	guard.pid = pid;
+	guard.page = page;
+	guard.frame = frame;
+	guard.dirty = false;
+	guard.site = NULL;
+
+	if (site != NULL && pinTracking.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> lock(pinSitesMutex);
+		pinSites[site]++;
+		guard.site = site;
+	}
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::ReleaseGuard
+//
+// Input   : guard - holding a pin.
+//           free - true to free the page instead of unpinning it.
+// Output  : None
+// Purpose : Drop the guard's pin, as UnpinFrame or FreePage, and empty
+//           the guard.  It is emptied even if that fails, so the pin
+//           is not dropped twice.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::ReleaseGuard(PinGuard& guard, bool free)
+{
+	Status s = free ? FreePage(guard.pid) : UnpinFrame(guard.frame, guard.dirty);
+
+	if (guard.site != NULL)
+	{
+		std::lock_guard<std::mutex> lock(pinSitesMutex);
+		std::map<std::string, int>::iterator it = pinSites.find(guard.site);
+		if (it != pinSites.end() && --it->second == 0)
+			pinSites.erase(it);
+	}
+	guard.pool = NULL;
+	guard.pid = INVALID_PAGE;
+	guard.page = NULL;
+	guard.frame = NULL;
+	guard.dirty = false;
+	guard.site = NULL;
+	return s;
+}
+
+
+// The sites holding tracked pins, without their directories.
+void BufMgr::ReportPins(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(pinSitesMutex);
+
+	for (std::map<std::string, int>::iterator it = pinSites.begin();
+		 it != pinSites.end(); ++it)
+	{
+		size_t slash = it->first.find_last_of("/\\");
+		out << "   " << (slash == std::string::npos ? it->first : it->first.substr(slash + 1))
+			<< ": " << it->second << " pinned" << endl;
+	}
+}
+
+
+int BufMgr::GetNumOfTrackedPins()
+{
+	std::lock_guard<std::mutex> lock(pinSitesMutex);
+	int n = 0;
+
+	for (std::map<std::string, int>::iterator it = pinSites.begin();
+		 it != pinSites.end(); ++it)
+		n += it->second;
+	return n;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::NewPage
+//
+// Input   : howmany - number of consecutive pages to allocate.
+// Output  : pid - the first page.
+//           firstpage - the first page, pinned in the pool.
+// Purpose : Allocate a run of pages and pin the first.  Its contents
+//           are undefined.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::NewPage(PageID& pid, Page*& firstpage, int howmany)
+{
+	if (MINIBASE_DB->AllocatePage(pid, howmany) != OK)
+	{
+		cerr << "  BufMgr :: Unable to allocate " << howmany << " pages" << endl;
+		return FAIL;
+	}
+
+	if (PinPage(pid, firstpage, true) != OK)
+	{
+		MINIBASE_DB->DeallocatePage(pid, howmany);
+		return FAIL;
+	}
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FreePage
+//
+// Input   : pid - page to free.
+// Output  : None
+// Purpose : Give a page back to the database, dropping it from the
+//           pool.  The caller may hold one pin on it.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::FreePage(PageID pid)
+{
+	Shard& shard = ShardOf(pid);
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	int frameNo = FindFrame(shard, pid);
+
+	if (frameNo == INVALID_FRAME)
+		return MINIBASE_DB->DeallocatePage(pid) == OK ? OK : FAIL;
+
+	Status s = frames[frameNo]->Free();
+	if (s == FAIL)
+	{
+		cerr << "   Free a page that is pinned more than once." << endl;
+		return FAIL;
+	}
+
+	shard.hashTable->Delete(pid);
+	frames[frameNo]->Release(0);
+	shard.replacer->PageFreed(frameNo - shard.firstFrame);
+	ringOf[frameNo] = NULL;
+	return s == OK ? OK : FAIL;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FlushFrame
+//
+// Input   : frameNo - a frame, its shard locked.
+// Output  : None
+// Purpose : Write the page in the frame if it is dirty.  A page latched
+//           exclusive is in the middle of a change and is left alone;
+//           it will be unpinned dirty and written later.
+// Return  : OK if successful, FAIL if the page could not be written.
+//-------------------------------------------------------------------
+
+Status BufMgr::FlushFrame(int frameNo)
+{
+	ClockFrame *frame = frames[frameNo];
+
+	if (!frame->IsValid() || !frame->IsDirty())
+		return OK;
+	if (!frame->TryLatchShared())
+		return FAIL;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Status s = frame->Write();
+	writeNanos += NanosSince(start);
+	frame->Unlatch(LATCH_SHARED);
+	writeCalls++;
+	pagesWritten++;
+	totalWrites++;
+	totalPagesWritten++;
+	return s == OK ? OK : FAIL;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FlushPage
+//
+// Input   : pid - a page in the pool.
+// Output  : None
+// Purpose : Write the page to the database if it is dirty.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status BufMgr::FlushPage(PageID pid)
+{
+	Shard& shard = ShardOf(pid);
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	int frameNo = FindFrame(shard, pid);
+
+	if (frameNo == INVALID_FRAME)
+	{
+		cerr << "Error : Unable to find the page " << pid
+			 << " in the buffer pool" << endl;
+		return FAIL;
+	}
+
+	return FlushFrame(frameNo);
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::WriteFrames
+//
+// Input   : frameNos - frames of dirty pages, in page id order, each
+//                      latched or claimed by the caller.
+// Output  : None
+// Purpose : Write the pages, a run of consecutive page ids as one
+//           request and all the runs in flight at once, and mark them
+//           clean.
+// Return  : OK if successful, FAIL if any write failed.
+//-------------------------------------------------------------------
+
+Status BufMgr::WriteFrames(const std::vector<int>& frameNos)
+{
+	std::vector<Page *> pages(frameNos.size());
+	std::vector<IORequest> runs(frameNos.size());
+	std::vector<IORequest *> batch;
+	std::vector<size_t> firstOf;     // index in frameNos of each run
+	Status s = OK;
+
+	for (size_t i = 0; i < frameNos.size(); i++)
+	{
+		ClockFrame *frame = frames[frameNos[i]];
+		PageID pid = frame->GetPageID();
+		pages[i] = frame->GetPage();
+
+		IORequest *run = batch.empty() ? NULL : batch.back();
+		if (run != NULL && run->pid + run->numPages == pid && run->numPages < AIO_MAX_RUN)
+		{
+			run->numPages++;
+			continue;
+		}
+		run = &runs[batch.size()];
+		run->write = true;
+		run->pid = pid;
+		run->page = pages[i];
+		run->pages = &pages[i];
+		batch.push_back(run);
+		firstOf.push_back(i);
+	}
+	if (batch.empty())
+		return OK;
+
+	// Clean before the write: a page changed by someone who pinned it
+	// meanwhile, latch or no latch, is dirtied again and not lost.
+	for (size_t i = 0; i < frameNos.size(); i++)
+		frames[frameNos[i]]->CleanIt();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (MINIBASE_DB->SubmitIO(&batch[0], (int)batch.size()) != OK)
+		s = FAIL;
+	for (size_t j = 0; j < batch.size(); j++)
+	{
+		if (MINIBASE_DB->WaitIO(batch[j]) == OK)
+			continue;
+		s = FAIL;
+		for (int k = 0; k < batch[j]->numPages; k++)
+			frames[frameNos[firstOf[j] + k]]->DirtyIt();
+	}
+
+	writeNanos += NanosSince(start);
+	writeCalls += batch.size();
+	pagesWritten += frameNos.size();
+	totalWrites += batch.size();
+	totalPagesWritten += frameNos.size();
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::PinDirtyNeighbour
+//
+// Input   : pid - a page next to a dirty victim.
+// Output  : None
+// Purpose : Pin and latch shared the page if it is in the pool and
+//           dirty, without the lock of its shard, which the caller may
+//           not take.  Undo with Unlatch and Frame::Unpin, which leaves
+//           the reference bit alone.
+// Return  : The frame of the page, INVALID_FRAME if it is not there,
+//           clean, claimed or latched exclusive.
+//-------------------------------------------------------------------
+
+int BufMgr::PinDirtyNeighbour(PageID pid)
+{
+	if (pid < 0)
+		return INVALID_FRAME;
+
+	int frameNo = ShardOf(pid).hashTable->LookUp(pid);
+	if (frameNo == INVALID_FRAME || !frames[frameNo]->IsDirty() ||
+		!frames[frameNo]->TryPin(pid))
+		return INVALID_FRAME;
+
+	if (!frames[frameNo]->IsDirty() || !frames[frameNo]->TryLatchShared())
+	{
+		frames[frameNo]->Frame::Unpin();
+		return INVALID_FRAME;
+	}
+	return frameNo;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::WriteVictim
+//
+// Input   : frameNo - a dirty frame the caller has claimed.
+// Output  : None
+// Purpose : Write the page in the frame, together with the dirty pages
+//           on either side of it up to a run of AIO_MAX_RUN, or of
+//           WRITE_MAX_LATCHES if less.
+// Return  : OK if successful, FAIL if any write failed.
+//-------------------------------------------------------------------
+
+Status BufMgr::WriteVictim(int frameNo)
+{
+	PageID pid = frames[frameNo]->GetPageID();
+	int maxRun = std::min(AIO_MAX_RUN, WRITE_MAX_LATCHES);
+	std::vector<int> run;
+	int neighbour;
+
+	for (PageID p = pid - 1; (int)run.size() < maxRun / 2 &&
+			 (neighbour = PinDirtyNeighbour(p)) != INVALID_FRAME; p--)
+		run.push_back(neighbour);
+	std::reverse(run.begin(), run.end());
+	run.push_back(frameNo);
+	for (PageID p = pid + 1; (int)run.size() < maxRun &&
+			 (neighbour = PinDirtyNeighbour(p)) != INVALID_FRAME; p++)
+		run.push_back(neighbour);
+
+	Status s = WriteFrames(run);
+
+	for (size_t i = 0; i < run.size(); i++)
+	{
+		if (run[i] == frameNo)
+			continue;
+		frames[run[i]]->Unlatch(LATCH_SHARED);
+		frames[run[i]]->Frame::Unpin();
+	}
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::FlushAllPages
+//
+// Input   : None
+// Output  : None
+// Purpose : Write every dirty page in the pool to the database, in
+//           page id order, with runs of adjacent pages written as one,
+//           WRITE_MAX_LATCHES pages latched at a time.  The shards are
+//           locked in order for the duration.
+// Return  : OK if successful, FAIL if any write failed or a page was
+//           latched exclusive.
+//-------------------------------------------------------------------
+
+Status BufMgr::FlushAllPages()
+{
+	std::vector< std::unique_lock<std::mutex> > locks;
+	std::vector< std::pair<PageID, int> > dirty;
+	Status s = OK;
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		locks.push_back(std::unique_lock<std::mutex>(shards[i].mutex));
+		int end = shards[i].firstFrame + shards[i].numOfFrames;
+		for (int frameNo = shards[i].firstFrame; frameNo < end; frameNo++)
+		{
+			ClockFrame *frame = frames[frameNo];
+			if (frame->IsValid() && frame->IsDirty())
+				dirty.push_back(std::make_pair(frame->GetPageID(), frameNo));
+		}
+	}
+
+	std::sort(dirty.begin(), dirty.end());
+	std::vector<int> frameNos;
+	for (size_t first = 0; first < dirty.size(); first += WRITE_MAX_LATCHES)
+	{
+		size_t end = std::min(dirty.size(), first + WRITE_MAX_LATCHES);
+		frameNos.clear();
+		for (size_t i = first; i < end; i++)
+		{
+			if (frames[dirty[i].second]->TryLatchShared())
+				frameNos.push_back(dirty[i].second);
+			else
+				s = FAIL;
+		}
+
+		if (WriteFrames(frameNos) != OK)
+			s = FAIL;
+		for (size_t i = 0; i < frameNos.size(); i++)
+			frames[frameNos[i]]->Unlatch(LATCH_SHARED);
+	}
+
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::CleanAhead
+//
+// Input   : None
+// Output  : None
+// Purpose : Write the dirty pages among the next cleanPercent percent
+//           of each shard's victims, as the policy names them, or of
+//           the frames from where the last round left off if it cannot.
+//           Only pages no one has pinned are taken, and they are
+//           claimed until written, so none changes under the write.
+//           A shard whose lock is taken is skipped this round, and
+//           the round is skipped while Resize renumbers the frames.
+// Return  : OK if successful, FAIL if any write failed.
+//-------------------------------------------------------------------
+
+Status BufMgr::CleanAhead()
+{
+	std::vector< std::pair<PageID, int> > dirty;
+	std::vector<int> candidates;
+	int percent;
+
+	{
+		std::lock_guard<std::mutex> guard(writerMutex);
+		if (resizing)
+			return OK;
+		cleaning++;
+		percent = cleanPercent;
+	}
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		Shard& shard = shards[i];
+		std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+		if (!lock.owns_lock())
+			continue;
+
+		int target = shard.numOfFrames * percent / 100;
+		if (target < 1)
+			target = 1;
+		candidates.clear();
+		shard.replacer->NextVictims(target, candidates);
+		if (candidates.empty())
+		{
+			for (int k = 0; k < target; k++)
+				candidates.push_back((shard.writerCursor + k) % shard.numOfFrames);
+			shard.writerCursor = (shard.writerCursor + target) % shard.numOfFrames;
+		}
+
+		for (size_t j = 0; j < candidates.size(); j++)
+		{
+			int frameNo = shard.firstFrame + candidates[j];
+			ClockFrame *frame = frames[frameNo];
+			if (!frame->IsValid() || !frame->IsDirty() || !frame->Claim(0))
+				continue;
+			dirty.push_back(std::make_pair(frame->GetPageID(), frameNo));
+		}
+	}
+
+	std::sort(dirty.begin(), dirty.end());
+	std::vector<int> frameNos(dirty.size());
+	for (size_t i = 0; i < dirty.size(); i++)
+		frameNos[i] = dirty[i].second;
+
+	Status s = WriteFrames(frameNos);
+	for (size_t i = 0; i < frameNos.size(); i++)
+	{
+		if (!frames[frameNos[i]]->IsDirty())
+			frames[frameNos[i]]->MarkCleanedAhead();
+		frames[frameNos[i]]->Release(0);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(writerMutex);
+		cleaning--;
+		cleaned++;
+	}
+	writerIdle.notify_all();
+	return s;
+}
+
+
+// Wait for the background writer to give up its claim on frameNo.
+void BufMgr::WaitForWriter(int frameNo)
+{
+	std::unique_lock<std::mutex> lock(writerMutex);
+
+	writerIdle.wait(lock, [this, frameNo]() { return !frames[frameNo]->IsClaimed(); });
+}
+
+
+void BufMgr::RunBackgroundWriter()
+{
+	std::unique_lock<std::mutex> lock(writerMutex);
+
+	while (!writerStop)
+	{
+		writerKicked = false;
+		lock.unlock();
+		CleanAhead();
+		lock.lock();
+		writerWake.wait_for(lock, std::chrono::milliseconds(writerInterval),
+							[this]() { return writerStop || writerKicked; });
+	}
+}
+
+
+// A miss had to write its victim: the writer is falling behind.
+void BufMgr::KickBackgroundWriter()
+{
+	std::lock_guard<std::mutex> guard(writerMutex);
+
+	if (writerRunning && !writerKicked)
+	{
+		writerKicked = true;
+		writerWake.notify_one();
+	}
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::StartBackgroundWriter
+//
+// Input   : cleanPercent - share of each shard's frames, from its
+//                          next victim on, to keep clean.
+//           intervalMs - time between rounds.
+// Output  : None
+// Purpose : Start the background writer thread.  It runs until
+//           StopBackgroundWriter or the BufMgr is deleted.
+// Return  : OK if successful, FAIL if it is already running or the
+//           arguments are out of range.
+//-------------------------------------------------------------------
+
+Status BufMgr::StartBackgroundWriter(int cleanPercent, int intervalMs)
+{
+	std::lock_guard<std::mutex> guard(writerMutex);
+
+	if (writerRunning)
+	{
+		cerr << "   The background writer is already running." << endl;
+		return FAIL;
+	}
+	if (cleanPercent < 1 || cleanPercent > 100 || intervalMs < 1)
+	{
+		cerr << "   Bad background writer settings " << cleanPercent << "%, "
+			 << intervalMs << " ms" << endl;
+		return FAIL;
+	}
+
+	this->cleanPercent = cleanPercent;
+	writerInterval = intervalMs;
+	writerStop = writerKicked = false;
+	writerRunning = true;
+	writer = std::thread(&BufMgr::RunBackgroundWriter, this);
+	return OK;
+}
+
+
+void BufMgr::StopBackgroundWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(writerMutex);
+		if (!writerRunning)
+			return;
+		writerStop = true;
+	}
+
+	writerWake.notify_one();
+	writer.join();
+
+	std::lock_guard<std::mutex> guard(writerMutex);
+	writerRunning = false;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::SaveHotSet
+//
+// Input   : fileName - file to write.
+// Output  : None
+// Purpose : Write the hot set: each shard's pages that are not among
+//           its policy's next victims, then the victims, last victim
+//           first, the shards taking turns.  The file is written under
+//           another name and renamed, so a crash leaves the old one.
+// Return  : OK if successful, FAIL if the file could not be written.
+//-------------------------------------------------------------------
+
+Status BufMgr::SaveHotSet(const char *fileName)
+{
+	std::vector< std::vector<PageID> > byShard(numOfShards);
+	std::vector<PageID> pids;
+	std::vector<int> victims;
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		Shard& shard = shards[i];
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		std::vector<bool> isVictim(shard.numOfFrames, false);
+
+		victims.clear();
+		shard.replacer->NextVictims(shard.numOfFrames, victims);
+		for (size_t j = 0; j < victims.size(); j++)
+			isVictim[victims[j]] = true;
+		for (int k = 0; k < shard.numOfFrames; k++)
+		{
+			ClockFrame *frame = frames[shard.firstFrame + k];
+			if (frame->IsValid() && !isVictim[k])
+				byShard[i].push_back(frame->GetPageID());
+		}
+		for (size_t j = victims.size(); j-- > 0; )
+			byShard[i].push_back(frames[shard.firstFrame + victims[j]]->GetPageID());
+	}
+
+	for (size_t rank = 0; ; rank++)
+	{
+		size_t before = pids.size();
+		for (int i = 0; i < numOfShards; i++)
+			if (rank < byShard[i].size())
+				pids.push_back(byShard[i][rank]);
+		if (pids.size() == before)
+			break;
+	}
+
+	std::string tempName = std::string(fileName) + ".new";
+	FILE *file = fopen(tempName.c_str(), "wb");
+	int header[2] = { HOT_SET_MAGIC, (int)pids.size() };
+	bool written = file != NULL &&
+		fwrite(header, sizeof(int), 2, file) == 2 &&
+		(pids.empty() ||
+		 fwrite(pids.data(), sizeof(PageID), pids.size(), file) == pids.size());
+
+	// Closed whatever happened, and the temporary file gone unless it
+	// made it to fileName.
+	if (file != NULL && fclose(file) != 0)
+		written = false;
+	if (written && rename(tempName.c_str(), fileName) != 0)
+		written = false;
+	if (!written)
+	{
+		if (file != NULL)
+			remove(tempName.c_str());
+		cerr << "   Cannot write the hot set to " << fileName << endl;
+		return FAIL;
+	}
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::ReadHotSet
+//
+// Input   : fileName - a file SaveHotSet wrote.
+//           db - the database of the pages.
+// Output  : None
+// Purpose : Read the hottest pages listed, as many as there are
+//           frames, sorted, a run of consecutive pages as one request
+//           and HOT_SET_BATCH runs at a time, into a buffer of its own,
+//           and put them in the pool with WarmPage.  Stops early if the
+//           hot set keeper is stopped or every shard is full.
+// Return  : OK if successful, FAIL if there is no hot set in the file.
+//-------------------------------------------------------------------
+
+Status BufMgr::ReadHotSet(const char *fileName, DB *db)
+{
+	FILE *file = fopen(fileName, "rb");
+	int header[2];
+
+	if (file == NULL)
+		return FAIL;
+	if (fread(header, sizeof(int), 2, file) != 2 || header[0] != HOT_SET_MAGIC ||
+		header[1] < 0)
+	{
+		fclose(file);
+		cerr << "   " << fileName << " holds no hot set." << endl;
+		return FAIL;
+	}
+
+	std::vector<PageID> pids(std::min(header[1], (int)numOfBuf));
+	size_t numRead = fread(pids.data(), sizeof(PageID), pids.size(), file);
+	fclose(file);
+	pids.resize(numRead);
+
+	int numOfPages = db->GetNumOfPages();
+	pids.erase(std::remove_if(pids.begin(), pids.end(), [numOfPages](PageID pid)
+		{ return pid < 0 || pid >= numOfPages; }), pids.end());
+	std::sort(pids.begin(), pids.end());
+	pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+
+	std::vector<char> buffer((size_t)HOT_SET_BATCH * AIO_MAX_RUN * MINIBASE_PAGESIZE);
+	std::vector<Page *> pages(HOT_SET_BATCH * AIO_MAX_RUN);
+	std::vector<bool> full(numOfShards, false);
+	int numFull = 0;
+
+	for (size_t i = 0; i < pids.size() && numFull < numOfShards && !KeeperStopping(); )
+	{
+		std::vector<IORequest> runs(HOT_SET_BATCH);
+		std::vector<IORequest *> batch;
+		size_t k = 0;
+
+		while (i < pids.size() && batch.size() < HOT_SET_BATCH)
+		{
+			IORequest *run = &runs[batch.size()];
+			run->pid = pids[i];
+			run->pages = &pages[k];
+			run->numPages = 0;
+			while (i < pids.size() && run->numPages < AIO_MAX_RUN &&
+				   pids[i] == run->pid + run->numPages)
+			{
+				pages[k] = (Page *)&buffer[k * MINIBASE_PAGESIZE];
+				k++;
+				run->numPages++;
+				i++;
+			}
+			run->page = run->pages[0];
+			batch.push_back(run);
+		}
+
+		long written = totalPagesWritten;
+		db->SubmitIO(&batch[0], (int)batch.size());
+		for (size_t j = 0; j < batch.size(); j++)
+		{
+			if (db->WaitIO(batch[j]) != OK)
+				continue;
+			for (int p = 0; p < batch[j]->numPages; p++)
+			{
+				PageID pid = batch[j]->pid + p;
+				int shardNo = (unsigned int)pid % numOfShards;
+				if (!full[shardNo] && !WarmPage(pid, batch[j]->PageAt(p), written))
+				{
+					full[shardNo] = true;
+					numFull++;
+				}
+			}
+		}
+	}
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::WarmPage
+//
+// Input   : pid - a page of the hot set.
+//           data - the page, read when totalPagesWritten was written.
+// Output  : None
+// Purpose : Put the page in a free frame of its shard, unless it is in
+//           the pool already or a page has been written since it was
+//           read, which may have been this one.
+// Return  : False if the shard has no free frame left, true otherwise.
+//-------------------------------------------------------------------
+
+bool BufMgr::WarmPage(PageID pid, Page *data, long written)
+{
+	Shard& shard = ShardOf(pid);
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	bool recycled;
+
+	if (shard.hashTable->LookUp(pid) != INVALID_FRAME || totalPagesWritten != written)
+		return true;
+
+	CompleteReads(shard, false);
+	int frameNo = ClaimVictim(shard, NULL, recycled);
+	if (frameNo == INVALID_FRAME)
+		return false;
+
+	ClockFrame *frame = frames[frameNo];
+	if (frame->IsValid())
+	{
+		frame->Release(0);
+		shard.replacer->PageAccessed(frameNo - shard.firstFrame, frame->GetPageID());
+		return false;
+	}
+
+	memcpy((char *)frame->GetPage(), data, MINIBASE_PAGESIZE);
+	frame->SetPageID(pid);
+	ringOf[frameNo] = NULL;
+	shard.hashTable->Insert(pid, frameNo);
+	frame->Release(0);
+	shard.replacer->PageAccessed(frameNo - shard.firstFrame, pid);
+	shard.framesTaken[NORMAL_ACCESS]++;
+	warmed++;
+	return true;
+}
+
+
+bool BufMgr::KeeperStopping()
+{
+	std::lock_guard<std::mutex> guard(keeperMutex);
+	return keeperStop;
+}
+
+
+void BufMgr::RunHotSetKeeper(bool reload)
+{
+	if (reload)
+		ReadHotSet(hotSetFile.c_str(), hotSetDB);
+
+	std::unique_lock<std::mutex> lock(keeperMutex);
+	bool stop = false;
+
+	while (!stop)
+	{
+		stop = keeperWake.wait_for(lock, std::chrono::milliseconds(hotSetInterval),
+								   [this]() { return keeperStop; });
+		lock.unlock();
+		SaveHotSet(hotSetFile.c_str());
+		lock.lock();
+	}
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::StartHotSetKeeper
+//
+// Input   : fileName - the hot set file, next to the database.
+//           reload - true to load the hot set first.
+//           intervalMs - time between saves.
+// Output  : None
+// Purpose : Start the hot set keeper thread.
+// Return  : OK if successful, FAIL if it is already running or the
+//           interval is out of range.
+//-------------------------------------------------------------------
+
+Status BufMgr::StartHotSetKeeper(const char *fileName, bool reload, int intervalMs)
+{
+	std::lock_guard<std::mutex> guard(keeperMutex);
+
+	if (keeperRunning)
+	{
+		cerr << "   The hot set keeper is already running." << endl;
+		return FAIL;
+	}
+	if (intervalMs < 1)
+	{
+		cerr << "   Bad hot set interval " << intervalMs << " ms" << endl;
+		return FAIL;
+	}
+
+	hotSetFile = fileName;
+	hotSetDB = MINIBASE_DB;
+	hotSetInterval = intervalMs;
+	keeperStop = false;
+	keeperRunning = true;
+	keeper = std::thread(&BufMgr::RunHotSetKeeper, this, reload);
+	return OK;
+}
+
+
+void BufMgr::StopHotSetKeeper()
+{
+	{
+		std::lock_guard<std::mutex> guard(keeperMutex);
+		if (!keeperRunning)
+			return;
+		keeperStop = true;
+	}
+
+	keeperWake.notify_one();
+	keeper.join();
+
+	std::lock_guard<std::mutex> guard(keeperMutex);
+	keeperRunning = false;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::Resize
+//
+// Input   : newNumOfBuf - number of frames to have.
+// Output  : None
+// Purpose : Deal newNumOfBuf frames out to the shards, with all of
+//           them locked, once the prefetch reads and background writer
+//           rounds under way are done.  A shard that shrinks gives up
+//           its empty frames, then the pages the policy would evict
+//           first, the dirty ones written in one go.  Nothing changes
+//           until every shard has claimed the frames it gives up.
+// Return  : OK if successful, FAIL if too many pages are pinned, a
+//           write failed or there would be fewer frames than shards.
+//-------------------------------------------------------------------
+
+Status BufMgr::Resize(int newNumOfBuf)
+{
+	if (newNumOfBuf < numOfShards)
+	{
+		cerr << "   Cannot make a pool of " << newNumOfBuf << " frames for "
+			 << numOfShards << " shards." << endl;
+		return FAIL;
+	}
+
+	std::lock_guard<std::mutex> resizeGuard(resizeMutex);
+	{
+		std::unique_lock<std::mutex> lock(writerMutex);
+		resizing = true;
+		writerIdle.wait(lock, [this]() { return cleaning == 0; });
+	}
+
+	std::vector< std::unique_lock<std::mutex> > locks;
+	std::vector< std::vector<int> > victims(numOfShards);
+	std::vector<int> claimed;
+	Status s = OK;
+
+	for (int i = 0; i < numOfShards && s == OK; i++)
+	{
+		Shard& shard = shards[i];
+		int numOfFrames = newNumOfBuf / numOfShards + (i < newNumOfBuf % numOfShards);
+
+		locks.push_back(std::unique_lock<std::mutex>(shard.mutex));
+		CompleteReads(shard, true);
+		shard.replacer->NextVictims(shard.numOfFrames, victims[i]);
+		if (numOfFrames < shard.numOfFrames &&
+			!ClaimToDrop(shard, shard.numOfFrames - numOfFrames, victims[i], claimed))
+		{
+			cerr << "   Too many pages are pinned to shrink the pool to "
+				 << newNumOfBuf << " frames." << endl;
+			s = FAIL;
+		}
+	}
+
+	std::vector< std::pair<PageID, int> > dirty;
+	for (size_t j = 0; j < claimed.size(); j++)
+		if (frames[claimed[j]]->IsValid() && frames[claimed[j]]->IsDirty())
+			dirty.push_back(std::make_pair(frames[claimed[j]]->GetPageID(), claimed[j]));
+	std::sort(dirty.begin(), dirty.end());
+	std::vector<int> frameNos(dirty.size());
+	for (size_t j = 0; j < dirty.size(); j++)
+		frameNos[j] = dirty[j].second;
+
+	if (s == OK && WriteFrames(frameNos) != OK)
+		s = FAIL;
+
+	if (s == OK)
+	{
+		for (size_t j = 0; j < claimed.size(); j++)
+		{
+			ClockFrame *frame = frames[claimed[j]];
+			if (!frame->IsValid())
+				continue;
+			Shard& shard = ShardOf(frame->GetPageID());
+			shard.hashTable->Delete(frame->GetPageID());
+			CountEviction(shard, frame, std::find(frameNos.begin(), frameNos.end(),
+												  claimed[j]) != frameNos.end());
+			frame->EmptyIt();
+		}
+		Renumber(newNumOfBuf, claimed, victims);
+	}
+	else
+	{
+		for (size_t j = 0; j < claimed.size(); j++)
+			frames[claimed[j]]->Release(0);
+	}
+
+	locks.clear();
+	std::lock_guard<std::mutex> guard(writerMutex);
+	resizing = false;
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::ClaimToDrop
+//
+// Input   : shard - a shard, locked.
+//           n - number of its frames to give up.
+//           victims - its policy's next victims, numbered in the shard.
+// Output  : claimed - gets the frames claimed.
+// Purpose : Claim n unpinned frames of the shard: the empty ones, then
+//           the victims, then any others, in order.
+// Return  : True if successful, false, with none of the shard's frames
+//           claimed, if fewer than n are unpinned.
+//-------------------------------------------------------------------
+
+bool BufMgr::ClaimToDrop(Shard& shard, int n, const std::vector<int>& victims,
+						 std::vector<int>& claimed)
+{
+	std::vector<int> order;
+	size_t start = claimed.size();
+
+	for (int k = 0; k < shard.numOfFrames; k++)
+		if (!frames[shard.firstFrame + k]->IsValid())
+			order.push_back(k);
+	order.insert(order.end(), victims.begin(), victims.end());
+	for (int k = 0; k < shard.numOfFrames; k++)
+		order.push_back(k);
+
+	// A frame claimed already is not claimed again.
+	for (size_t j = 0; j < order.size() && claimed.size() - start < (size_t)n; j++)
+		if (frames[shard.firstFrame + order[j]]->Claim(0))
+			claimed.push_back(shard.firstFrame + order[j]);
+
+	if (claimed.size() - start == (size_t)n)
+		return true;
+	for (size_t j = start; j < claimed.size(); j++)
+		frames[claimed[j]]->Release(0);
+	claimed.resize(start);
+	return false;
+}
+
+
+//-------------------------------------------------------------------
+// BufMgr::Renumber
+//
+// Input   : newNumOfBuf - number of frames to have.
+//           dropped - frames to give up, claimed and emptied.
+//           victims - the next victims of each shard's policy, from
+//                     before the frames were dropped.
+// Output  : None
+// Purpose : With every shard locked, lay the frames out anew: each
+//           shard keeps the frames it does not drop, in order, and new
+//           ones go at its end.  Each shard gets a new page table and
+//           policy, which hears of the shard's pages, the next victims
+//           first, so that they go first still.  The new View is put in
+//           place last.  The frames added are one block of the arena.
+//-------------------------------------------------------------------
+
+void BufMgr::Renumber(int newNumOfBuf, const std::vector<int>& dropped,
+					  const std::vector< std::vector<int> >& victims)
+{
+	std::vector<bool> isDropped(numOfBuf, false);
+	std::vector<ClockFrame *> added;
+	size_t nextAdded = 0;
+	View *v = new View;
+
+	for (size_t j = 0; j < dropped.size(); j++)
+		isDropped[dropped[j]] = true;
+	v->frames = new ClockFrame*[newNumOfBuf];
+	v->ringOf = new std::atomic<AccessStrategy *>[newNumOfBuf]();
+	if (newNumOfBuf > numOfBuf - (int)dropped.size())
+	{
+		added.resize(newNumOfBuf - (numOfBuf - dropped.size()));
+		arena->Allocate(added.size(), &added[0]);
+	}
+
+	for (int i = 0, next = 0; i < numOfShards; i++)
+	{
+		Shard& shard = shards[i];
+		int first = next;
+		int numOfFrames = newNumOfBuf / numOfShards + (i < newNumOfBuf % numOfShards);
+		std::vector<int> newNo(shard.numOfFrames, INVALID_FRAME);
+
+		for (int k = 0; k < shard.numOfFrames; k++)
+		{
+			ClockFrame *frame = frames[shard.firstFrame + k];
+			if (isDropped[shard.firstFrame + k])
+			{
+				arena->GiveBack(frame);
+				continue;
+			}
+			newNo[k] = next - first;
+			v->frames[next++] = frame;
+		}
+		while (next < first + numOfFrames)
+			v->frames[next++] = added[nextAdded++];
+
+		HashTable *hashTable = new HashTable(numOfFrames);
+		Replacer *replacer = Replacer::Create(policyName.c_str(), numOfFrames,
+											  v->frames + first, hashTable);
+		std::vector<int> order(victims[i]);
+		std::vector<bool> told(numOfFrames, false);
+
+		for (int k = 0; k < shard.numOfFrames; k++)
+			order.push_back(k);
+		for (size_t j = 0; j < order.size(); j++)
+		{
+			int frameNo = newNo[order[j]];
+			if (frameNo == INVALID_FRAME || told[frameNo] ||
+				!v->frames[first + frameNo]->IsValid())
+				continue;
+			told[frameNo] = true;
+			PageID pid = v->frames[first + frameNo]->GetPageID();
+			hashTable->Insert(pid, first + frameNo);
+			replacer->PageAccessed(frameNo, pid);
+		}
+
+		delete shard.replacer;
+		shard.replacer = replacer;
+		shard.hashTable = hashTable;
+		shard.firstFrame = first;
+		shard.numOfFrames = numOfFrames;
+		shard.writerCursor = 0;
+		v->hashTables.push_back(hashTable);
+	}
+
+	// No read is pending, and the rings are empty.
+	delete [] reads;
+	delete [] readPending;
+	reads = new IORequest[newNumOfBuf];
+	readPending = new bool[newNumOfBuf]();
+	frames = v->frames;
+	ringOf = v->ringOf;
+	numOfBuf = newNumOfBuf;
+
+	oldViews.push_back(view);
+	view.store(v, std::memory_order_release);
+}
+
+
+unsigned int BufMgr::GetNumOfBuffers()
+{
+	return numOfBuf;
+}
+
+
+unsigned int BufMgr::GetNumOfUnpinnedBuffers()
+{
+	unsigned int count = 0;
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].mutex);
+		int end = shards[i].firstFrame + shards[i].numOfFrames;
+		for (int frameNo = shards[i].firstFrame; frameNo < end; frameNo++)
+			if (frames[frameNo]->NotPinned())
+				count++;
+	}
+
+	return count;
+}
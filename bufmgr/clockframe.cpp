@@ -0,0 +1,71 @@
+/*
+ * clockframe.cpp - a frame with the reference bit used by Clock.
+ */
+
+#include "clockframe.h"
+
+
+ClockFrame::ClockFrame()
+	: referenced(false)
+{
+}
+
+
+ClockFrame::~ClockFrame()
+{
+}
+
+
+//-------------------------------------------------------------------
+// ClockFrame::Unpin
+//
+// Input   : None
+// Output  : None
+// Purpose : Unpin the frame.  The last unpin marks it referenced, so
+//           the clock hand passes over it once before evicting it.
+// Return  : The pins left.
+//-------------------------------------------------------------------
+
+int ClockFrame::Unpin()
+{
+	int count = Frame::Unpin();
+	if (count == 0)
+		referenced.store(true, std::memory_order_relaxed);
+	return count;
+}
+
+
+Status ClockFrame::Free()
+{
+	Status s = Frame::Free();
+	if (s == OK)
+		referenced = false;
+	return s;
+}
+
+
+void ClockFrame::UnsetReferenced()
+{
+	referenced = false;
+}
+
+
+bool ClockFrame::IsReferenced()
+{
+	return referenced;
+}
+
+
+//-------------------------------------------------------------------
+// ClockFrame::IsVictim
+//
+// Input   : None
+// Output  : None
+// Return  : True if the frame can be taken right away: it is empty,
+//           or unpinned and not recently referenced.
+//-------------------------------------------------------------------
+
+bool ClockFrame::IsVictim()
+{
+	return !IsValid() || (NotPinned() && !referenced);
+}
@@ -0,0 +1,307 @@
+/*
+ * clockpro.cpp - the CLOCK-Pro replacement policy (Jiang, Chen and
+ *                Zhang), in the simplified form of the authors'
+ *                reference simulator: every resident cold page is in
+ *                its test period.
+ *
+ * New pages go in just behind the hot hand.  Evicting a cold page
+ * leaves its entry in the ring as a non-resident test page and puts its
+ * frame on the free list, so PickVictim runs the cold hand until a
+ * frame turns up there.  The cold target starts at the whole pool.
+ */
+
+#include "replacer.h"
+
+
+ClockPro::ClockPro(int bufSize, ClockFrame **frames)
+	: freeFrames(bufSize), inRing(bufSize, false), entryOf(bufSize)
+{
+	numOfBuf = bufSize;
+	this->frames = frames;
+	coldTarget = bufSize;
+	numHot = numCold = numTest = 0;
+	handCold = handHot = handTest = ring.end();
+}
+
+
+ClockPro::Ring::iterator ClockPro::Next(Ring::iterator it)
+{
+	return ++it == ring.end() ? ring.begin() : it;
+}
+
+
+ClockPro::Ring::iterator ClockPro::Prev(Ring::iterator it)
+{
+	return it == ring.begin() ? --ring.end() : --it;
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::Remove
+//
+// Input   : it - an entry of the ring.
+// Output  : None
+// Purpose : Take the entry out of the ring and of the counts.  A hand
+//           on it moves back one entry, so it next looks at the entry
+//           that followed it.
+//-------------------------------------------------------------------
+
+void ClockPro::Remove(Ring::iterator it)
+{
+	if (it->frameNo == INVALID_FRAME)
+	{
+		nonResident.erase(it->pid);
+		numTest--;
+	}
+	else
+	{
+		inRing[it->frameNo] = false;
+		if (it->hot)
+			numHot--;
+		else
+			numCold--;
+	}
+
+	if (ring.size() == 1)
+	{
+		ring.clear();
+		handCold = handHot = handTest = ring.end();
+		return;
+	}
+
+	if (handCold == it)
+		handCold = Prev(it);
+	if (handHot == it)
+		handHot = Prev(it);
+	if (handTest == it)
+		handTest = Prev(it);
+	ring.erase(it);
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::RunHandCold
+//
+// Input   : None
+// Output  : None
+// Purpose : Move the cold hand one entry.  A referenced cold page
+//           turns hot; an unreferenced unpinned one is evicted and
+//           stays as a test page.  Test pages over the pool size and
+//           hot pages over their share are then let go.
+//-------------------------------------------------------------------
+
+void ClockPro::RunHandCold()
+{
+	if (ring.empty())
+		return;
+
+	Ring::iterator it = handCold;
+	if (!it->hot && it->frameNo != INVALID_FRAME)
+	{
+		if (it->referenced)
+		{
+			it->hot = true;
+			it->referenced = false;
+			numCold--;
+			numHot++;
+		}
+		else if (frames[it->frameNo]->NotPinned())
+		{
+			inRing[it->frameNo] = false;
+			freeFrames.Add(it->frameNo);
+			it->frameNo = INVALID_FRAME;
+			nonResident[it->pid] = it;
+			numCold--;
+			numTest++;
+			while (numTest > numOfBuf)
+				RunHandTest();
+		}
+	}
+
+	if (!ring.empty())
+		handCold = Next(handCold);
+	while (numHot > numOfBuf - coldTarget)
+		RunHandHot();
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::RunHandHot
+//
+// Input   : None
+// Output  : None
+// Purpose : Move the hot hand one entry, turning an unreferenced hot
+//           page cold and clearing the reference bit of a referenced
+//           one.  The test hand is pushed on ahead of it.
+//-------------------------------------------------------------------
+
+void ClockPro::RunHandHot()
+{
+	if (handHot == handTest)
+		RunHandTest();
+	if (ring.empty())
+		return;
+
+	Ring::iterator it = handHot;
+	if (it->hot)
+	{
+		if (it->referenced)
+		{
+			it->referenced = false;
+		}
+		else
+		{
+			it->hot = false;
+			numHot--;
+			numCold++;
+		}
+	}
+
+	handHot = Next(handHot);
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::RunHandTest
+//
+// Input   : None
+// Output  : None
+// Purpose : Move the test hand one entry, ending the test period of a
+//           non-resident page.  It did not come back in time, so cold
+//           pages get one frame less.
+//-------------------------------------------------------------------
+
+void ClockPro::RunHandTest()
+{
+	if (handTest == handCold)
+		RunHandCold();
+	if (ring.empty())
+		return;
+
+	if (handTest->frameNo == INVALID_FRAME)
+	{
+		Remove(handTest);
+		if (coldTarget > 1)
+			coldTarget--;
+		if (ring.empty())
+			return;
+	}
+
+	handTest = Next(handTest);
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::PickVictim
+//
+// Input   : None
+// Output  : None
+// Purpose : Take a free frame, running the cold hand until there is
+//           one.  If the cold pages are all pinned the hot hand runs
+//           too, to turn more pages cold.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int ClockPro::PickVictim()
+{
+	int frameNo;
+
+	for (int steps = 0; (frameNo = freeFrames.Take()) == INVALID_FRAME; steps++)
+	{
+		int size = (int)ring.size();
+		if (size == 0 || steps > 8 * size)
+			return INVALID_FRAME;
+
+		RunHandCold();
+		if (steps > 2 * size)
+			RunHandHot();
+	}
+
+	return frameNo;
+}
+
+
+// Unreferenced resident cold pages from the cold hand on.
+void ClockPro::NextVictims(int n, std::vector<int>& frameNos)
+{
+	Ring::iterator it = handCold;
+
+	for (size_t i = 0; i < ring.size() && n > 0; i++, it = Next(it))
+	{
+		if (!it->hot && !it->referenced && it->frameNo != INVALID_FRAME &&
+			frames[it->frameNo]->NotPinned())
+		{
+			frameNos.push_back(it->frameNo);
+			n--;
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------
+// ClockPro::PageAccessed
+//
+// Input   : frameNo - frame of the page.
+//           pid - the page.
+// Output  : None
+// Purpose : A hit sets the reference bit.  A page read in goes behind
+//           the hot hand: hot if it is a test page coming back, when
+//           cold pages also get one frame more, cold otherwise.
+//-------------------------------------------------------------------
+
+void ClockPro::PageAccessed(int frameNo, PageID pid)
+{
+	if (inRing[frameNo])
+	{
+		entryOf[frameNo]->referenced = true;
+		return;
+	}
+
+	// The page may have been evicted onto the free list and pinned
+	// again before the frame was reused.
+	freeFrames.Remove(frameNo);
+
+	Entry e;
+	e.pid = pid;
+	e.frameNo = frameNo;
+	e.hot = false;
+	e.referenced = false;
+
+	std::unordered_map<PageID, Ring::iterator>::iterator g = nonResident.find(pid);
+	if (g != nonResident.end())
+	{
+		if (coldTarget < numOfBuf)
+			coldTarget++;
+		Remove(g->second);
+		e.hot = true;
+		numHot++;
+	}
+	else
+	{
+		numCold++;
+	}
+
+	Ring::iterator it;
+	if (ring.empty())
+	{
+		it = ring.insert(ring.end(), e);
+		handCold = handHot = handTest = it;
+	}
+	else
+	{
+		it = ring.insert(handHot, e);
+		if (handCold == handHot)
+			handCold = it;
+	}
+
+	inRing[frameNo] = true;
+	entryOf[frameNo] = it;
+}
+
+
+void ClockPro::PageFreed(int frameNo)
+{
+	if (inRing[frameNo])
+		Remove(entryOf[frameNo]);
+	freeFrames.Add(frameNo);
+}
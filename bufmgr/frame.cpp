@@ -0,0 +1,387 @@
+/*
+ * frame.cpp - one frame of the buffer pool.
+ */
+
+#include <chrono>
+
+#include "frame.h"
+#include "db.h"
+
+
+// The page's memory is set by the FrameArena, which owns it.
+Frame::Frame()
+	: pid(INVALID_PAGE), pinCount(0), dirty(false), cleanedAhead(false), pinnedAt(0),
+	  links(NULL)
+{
+	data = NULL;
+}
+
+
+Frame::~Frame()
+{
+	delete [] links.load();
+}
+
+
+// Only with the lock of the shard, which keeps claims out.
+void Frame::Pin()
+{
+	if (pinCount.fetch_add(1, std::memory_order_acquire) == 0)
+		StampPin();
+}
+
+
+static long Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void Frame::StampPin()
+{
+	static thread_local unsigned int pins = 0;
+
+	pinnedAt.store(++pins % PIN_HOLD_SAMPLE == 0 ? Now() : 0, std::memory_order_relaxed);
+}
+
+
+long Frame::HeldFor()
+{
+	long at = pinnedAt.load(std::memory_order_relaxed);
+
+	return at == 0 ? -1 : Now() - at;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::TryPin
+//
+// Input   : pid - the page the caller expects in this frame.
+// Output  : None
+// Purpose : Pin the frame without the lock of its shard.
+// Return  : True if pinned and the frame holds pid, false, and not
+//           pinned, if it is claimed or holds another page.
+//-------------------------------------------------------------------
+
+bool Frame::TryPin(PageID pid)
+{
+	int count = pinCount.load(std::memory_order_relaxed);
+
+	do
+	{
+		if (count == CLAIMED)
+			return false;
+	}
+	while (!pinCount.compare_exchange_weak(count, count + 1,
+										   std::memory_order_acquire));
+
+	if (this->pid.load(std::memory_order_relaxed) == pid)
+	{
+		if (count == 0)
+			StampPin();
+		return true;
+	}
+
+	Frame::Unpin();
+	return false;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::Unpin
+//
+// Input   : None
+// Output  : None
+// Purpose : Drop one pin, if there is one.
+// Return  : The pins left, -1 if there was none to drop.
+//-------------------------------------------------------------------
+
+int Frame::Unpin()
+{
+	int count = pinCount.load(std::memory_order_relaxed);
+
+	do
+	{
+		if (count <= 0)
+			return -1;
+	}
+	while (!pinCount.compare_exchange_weak(count, count - 1,
+										   std::memory_order_release));
+
+	return count - 1;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::Claim
+//
+// Input   : pins - the pins the caller expects the frame to have.
+// Output  : None
+// Purpose : Take the frame to change the page in it.  Only with the
+//           lock of the shard.
+// Return  : True if the frame had exactly pins pins and is now
+//           claimed, false if someone pinned or unpinned it meanwhile.
+//-------------------------------------------------------------------
+
+bool Frame::Claim(int pins)
+{
+	return pinCount.compare_exchange_strong(pins, CLAIMED, std::memory_order_acquire);
+}
+
+
+// End a claim, leaving the frame with pins pins.
+void Frame::Release(int pins)
+{
+	if (pins > 0)
+		StampPin();
+	pinCount.store(pins, std::memory_order_release);
+}
+
+
+//-------------------------------------------------------------------
+// Frame::EmptyIt
+//
+// Input   : None
+// Output  : None
+// Purpose : Forget the page held in this frame, without writing it.
+//           The pin count is left to Release.
+//-------------------------------------------------------------------
+
+void Frame::EmptyIt()
+{
+	pid.store(INVALID_PAGE, std::memory_order_relaxed);
+	dirty.store(false, std::memory_order_relaxed);
+	cleanedAhead.store(false, std::memory_order_relaxed);
+
+	std::atomic<Frame *> *table = links.load(std::memory_order_relaxed);
+	if (table != NULL)
+	{
+		for (int i = 0; i < SWIZZLE_SLOTS; i++)
+			table[i].store(NULL, std::memory_order_relaxed);
+	}
+}
+
+
+Frame *Frame::GetLink(PageID pid)
+{
+	std::atomic<Frame *> *table = links.load(std::memory_order_acquire);
+
+	if (table == NULL)
+		return NULL;
+	// Acquire, to see the frame as made if Resize has just made it.
+	return table[(unsigned int)pid % SWIZZLE_SLOTS].load(std::memory_order_acquire);
+}
+
+
+//-------------------------------------------------------------------
+// Frame::SetLink
+//
+// Input   : pid - a page the page in this frame links to.
+//           frame - the frame holding pid.
+// Output  : None
+// Purpose : Swizzle the link to pid.  The table of links is made by
+//           the first link set, by whichever thread gets there first.
+//-------------------------------------------------------------------
+
+void Frame::SetLink(PageID pid, Frame *frame)
+{
+	std::atomic<Frame *> *table = links.load(std::memory_order_acquire);
+
+	if (table == NULL)
+	{
+		std::atomic<Frame *> *fresh = new std::atomic<Frame *>[SWIZZLE_SLOTS];
+		for (int i = 0; i < SWIZZLE_SLOTS; i++)
+			fresh[i].store(NULL, std::memory_order_relaxed);
+		if (links.compare_exchange_strong(table, fresh, std::memory_order_acq_rel))
+			table = fresh;
+		else
+			delete [] fresh;
+	}
+	table[(unsigned int)pid % SWIZZLE_SLOTS].store(frame, std::memory_order_release);
+}
+
+
+void Frame::DirtyIt()
+{
+	dirty = true;
+}
+
+
+// The page is about to be written by the caller.
+void Frame::CleanIt()
+{
+	dirty = false;
+	cleanedAhead = false;
+}
+
+
+// The background writer wrote the page; any other write, or a new page
+// in the frame, forgets it.
+void Frame::MarkCleanedAhead()
+{
+	cleanedAhead = true;
+}
+
+
+bool Frame::WasCleanedAhead()
+{
+	return cleanedAhead;
+}
+
+
+void Frame::SetPageID(PageID pid)
+{
+	this->pid = pid;
+}
+
+
+bool Frame::IsDirty()
+{
+	return dirty;
+}
+
+
+bool Frame::IsValid()
+{
+	return pid != INVALID_PAGE;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::Write
+//
+// Input   : None
+// Output  : None
+// Purpose : Write the page back to the database if it is dirty.
+// Return  : OK if successful, the DB error otherwise.
+//-------------------------------------------------------------------
+
+Status Frame::Write()
+{
+	if (!dirty)
+		return OK;
+
+	// Cleared first, so a change made while the write is under way
+	// leaves the page dirty.
+	dirty = false;
+	Status s = MINIBASE_DB->WritePage(pid, data);
+	if (s != OK)
+		dirty = true;
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::Read
+//
+// Input   : pid - page to read.
+// Output  : None
+// Purpose : Load the page into this frame.
+// Return  : OK if successful, the DB error otherwise.
+//-------------------------------------------------------------------
+
+Status Frame::Read(PageID pid)
+{
+	Status s = MINIBASE_DB->ReadPage(pid, data);
+	if (s == OK)
+	{
+		this->pid = pid;
+		dirty = false;
+	}
+	return s;
+}
+
+
+//-------------------------------------------------------------------
+// Frame::Free
+//
+// Input   : None
+// Output  : None
+// Purpose : Give the page back to the database and empty the frame.
+//           The page may be pinned once, by the caller.  The frame is
+//           left claimed, for the caller to take the page out of the
+//           page table before Release(0).
+// Return  : OK if successful, FAIL if the page is pinned by someone
+//           else, the DB error otherwise.
+//-------------------------------------------------------------------
+
+Status Frame::Free()
+{
+	if (!Claim(1) && !Claim(0))
+		return FAIL;
+
+	Status s = MINIBASE_DB->DeallocatePage(pid);
+	EmptyIt();
+	return s;
+}
+
+
+bool Frame::NotPinned()
+{
+	return pinCount.load(std::memory_order_relaxed) == 0;
+}
+
+
+bool Frame::IsClaimed()
+{
+	return pinCount.load(std::memory_order_acquire) == CLAIMED;
+}
+
+
+bool Frame::HasPageID(PageID pid)
+{
+	return this->pid == pid;
+}
+
+
+PageID Frame::GetPageID()
+{
+	return pid;
+}
+
+
+Page *Frame::GetPage()
+{
+	return data;
+}
+
+
+void Frame::SetPage(Page *page)
+{
+	data = page;
+}
+
+
+void Frame::Latch(LatchMode mode)
+{
+	if (mode == LATCH_SHARED)
+		latch.lock_shared();
+	else if (mode == LATCH_EXCLUSIVE)
+		latch.lock();
+}
+
+
+void Frame::Unlatch(LatchMode mode)
+{
+	if (mode == LATCH_SHARED)
+		latch.unlock_shared();
+	else if (mode == LATCH_EXCLUSIVE)
+		latch.unlock();
+}
+
+
+bool Frame::TryLatchShared()
+{
+	return latch.try_lock_shared();
+}
+
+
+bool Frame::TryLatch(LatchMode mode)
+{
+	if (mode == LATCH_SHARED)
+		return latch.try_lock_shared();
+	if (mode == LATCH_EXCLUSIVE)
+		return latch.try_lock();
+	return true;
+}
@@ -0,0 +1,157 @@
+/*
+ * hash.cpp - the page table of the buffer pool, mapping page ids to
+ *            frame numbers with open addressing.
+ */
+
+#include <new>
+#include "hash.h"
+
+
+//-------------------------------------------------------------------
+// HashTable::HashTable
+//
+// Input   : numOfFrames - number of frames of the buffer pool.
+// Output  : None
+// Purpose : Allocate an empty table of at least two entries per frame,
+//           in whole buckets starting on a cache line.
+//-------------------------------------------------------------------
+
+HashTable::HashTable(int numOfFrames)
+{
+	unsigned int numOfBuckets = 2;
+	int log2 = 1;
+
+	while (numOfBuckets * PAGE_TABLE_BUCKET_SIZE < 2 * (unsigned int)numOfFrames)
+	{
+		numOfBuckets *= 2;
+		log2++;
+	}
+
+	mask = numOfBuckets * PAGE_TABLE_BUCKET_SIZE - 1;
+	shift = 32 - log2;
+
+	space = new char[(mask + 1) * sizeof(Entry) + CACHE_LINE_SIZE];
+	entries = (Entry *)(((uintptr_t)space + CACHE_LINE_SIZE - 1) &
+						~(uintptr_t)(CACHE_LINE_SIZE - 1));
+	for (unsigned int i = 0; i <= mask; i++)
+		new (&entries[i]) Entry(MakeEntry(INVALID_PAGE, INVALID_FRAME));
+}
+
+
+HashTable::~HashTable()
+{
+	delete [] space;
+}
+
+
+//-------------------------------------------------------------------
+// HashTable::Home
+//
+// Input   : pid - a page id.
+// Output  : None
+// Return  : The first entry of the bucket pid hashes to.  Fibonacci
+//           hashing spreads runs of consecutive page ids over the
+//           buckets.
+//-------------------------------------------------------------------
+
+unsigned int HashTable::Home(PageID pid)
+{
+	return (((unsigned int)pid * 2654435769u) >> shift) * PAGE_TABLE_BUCKET_SIZE;
+}
+
+
+//-------------------------------------------------------------------
+// HashTable::Insert
+//
+// Input   : pid - a page id that is not in the table.
+//           frameNo - the frame holding it.
+// Output  : None
+// Purpose : Put (pid, frameNo) in the first free entry from pid's
+//           bucket on.
+//-------------------------------------------------------------------
+
+void HashTable::Insert(PageID pid, int frameNo)
+{
+	unsigned int i = Home(pid);
+
+	while (PidOf(entries[i].load(std::memory_order_relaxed)) != INVALID_PAGE)
+		i = (i + 1) & mask;
+
+	entries[i].store(MakeEntry(pid, frameNo), std::memory_order_release);
+}
+
+
+//-------------------------------------------------------------------
+// HashTable::Delete
+//
+// Input   : pid - a page id.
+// Output  : None
+// Purpose : Remove the entry of pid.  The entries after it in its
+//           probe run are shifted back over the gap, so lookups never
+//           have to step over deleted entries.
+// Return  : OK if successful, FAIL if pid is not in the table.
+//-------------------------------------------------------------------
+
+Status HashTable::Delete(PageID pid)
+{
+	unsigned int i, j;
+	uint64_t entry;
+
+	if (pid == INVALID_PAGE)
+		return FAIL;
+
+	for (i = Home(pid); PidOf(entries[i].load(std::memory_order_relaxed)) != pid;
+		 i = (i + 1) & mask)
+		if (PidOf(entries[i].load(std::memory_order_relaxed)) == INVALID_PAGE)
+			return FAIL;
+
+	for (j = (i + 1) & mask;
+		 PidOf(entry = entries[j].load(std::memory_order_relaxed)) != INVALID_PAGE;
+		 j = (j + 1) & mask)
+	{
+		// The entry at j may fill the gap at i only if its bucket does
+		// not start after i.
+		unsigned int home = Home(PidOf(entry));
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			entries[i].store(entry, std::memory_order_release);
+			i = j;
+		}
+	}
+
+	entries[i].store(MakeEntry(INVALID_PAGE, INVALID_FRAME), std::memory_order_release);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HashTable::LookUp
+//
+// Input   : pid - a page id.
+// Output  : None
+// Return  : The frame holding pid, INVALID_FRAME if none does.  See
+//           hash.h for what a LookUp without the lock can return.
+//-------------------------------------------------------------------
+
+int HashTable::LookUp(PageID pid)
+{
+	uint64_t entry;
+
+	if (pid == INVALID_PAGE)
+		return INVALID_FRAME;
+
+	for (unsigned int i = Home(pid);
+		 PidOf(entry = entries[i].load(std::memory_order_acquire)) != INVALID_PAGE;
+		 i = (i + 1) & mask)
+		if (PidOf(entry) == pid)
+			return FrameOf(entry);
+
+	return INVALID_FRAME;
+}
+
+
+void HashTable::EmptyIt()
+{
+	for (unsigned int i = 0; i <= mask; i++)
+		entries[i].store(MakeEntry(INVALID_PAGE, INVALID_FRAME), std::memory_order_relaxed);
+}
@@ -0,0 +1,141 @@
+/*
+ * lru2.cpp - the LRU-2 replacement policy.
+ *
+ * Time is counted in pins.  The resident pages are kept in a set
+ * ordered by (previous access, last access), so the victim is the
+ * first unpinned page of the set.  There is no correlated reference
+ * period: on B+ tree traces, counting the repeated pins of one
+ * operation as one access lost more hot pages than it saved.
+ */
+
+#include "replacer.h"
+
+
+LRU2::LRU2(int bufSize, ClockFrame **frames)
+	: freeFrames(bufSize), history(bufSize), resident(bufSize, false)
+{
+	numOfBuf = bufSize;
+	this->frames = frames;
+	now = 0;
+}
+
+
+//-------------------------------------------------------------------
+// LRU2::PickVictim
+//
+// Input   : None
+// Output  : None
+// Purpose : Take a free frame, or else the unpinned page with the
+//           oldest second to last access, keeping its history.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int LRU2::PickVictim()
+{
+	int frameNo = freeFrames.Take();
+	if (frameNo != INVALID_FRAME)
+		return frameNo;
+
+	for (Queue::iterator it = queue.begin(); it != queue.end(); ++it)
+	{
+		frameNo = it->second;
+		if (frames[frameNo]->NotPinned())
+		{
+			Retain(frames[frameNo]->GetPageID(), history[frameNo]);
+			queue.erase(it);
+			resident[frameNo] = false;
+			return frameNo;
+		}
+	}
+
+	return INVALID_FRAME;
+}
+
+
+void LRU2::NextVictims(int n, std::vector<int>& frameNos)
+{
+	for (Queue::iterator it = queue.begin(); it != queue.end() && n > 0; ++it)
+	{
+		if (frames[it->second]->NotPinned())
+		{
+			frameNos.push_back(it->second);
+			n--;
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------
+// LRU2::PageAccessed
+//
+// Input   : frameNo - frame of the page.
+//           pid - the page.
+// Output  : None
+// Purpose : Record an access, starting from the retained history of
+//           a page that was evicted not long ago.
+//-------------------------------------------------------------------
+
+void LRU2::PageAccessed(int frameNo, PageID pid)
+{
+	History h(-1, -1);
+
+	now++;
+	if (resident[frameNo])
+	{
+		h = history[frameNo];
+		queue.erase(std::make_pair(h, frameNo));
+	}
+	else
+	{
+		// A frame recycled by an AccessStrategy comes back through
+		// PageFreed, not PickVictim.
+		freeFrames.Remove(frameNo);
+		resident[frameNo] = true;
+		std::unordered_map<PageID, std::pair<History,
+			std::list<PageID>::iterator> >::iterator r = retained.find(pid);
+		if (r != retained.end())
+		{
+			h = r->second.first;
+			retainedOrder.erase(r->second.second);
+			retained.erase(r);
+		}
+	}
+
+	h = History(h.second, now);
+	history[frameNo] = h;
+	queue.insert(std::make_pair(h, frameNo));
+}
+
+
+void LRU2::PageFreed(int frameNo)
+{
+	if (resident[frameNo])
+	{
+		queue.erase(std::make_pair(history[frameNo], frameNo));
+		resident[frameNo] = false;
+	}
+	freeFrames.Add(frameNo);
+}
+
+
+//-------------------------------------------------------------------
+// LRU2::Retain
+//
+// Input   : pid - a page being evicted.
+//           h - its history.
+// Output  : None
+// Purpose : Remember h for pid, forgetting the oldest retained
+//           history if there are already numOfBuf.
+//-------------------------------------------------------------------
+
+void LRU2::Retain(PageID pid, const History& h)
+{
+	if ((int)retained.size() >= numOfBuf)
+	{
+		retained.erase(retainedOrder.front());
+		retainedOrder.pop_front();
+	}
+
+	retainedOrder.push_back(pid);
+	retained[pid] = std::make_pair(h, --retainedOrder.end());
+}
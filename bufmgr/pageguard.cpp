@@ -0,0 +1,52 @@
+/*
+ * pageguard.cpp - pins that drop themselves.
+ */
+
+#include "bufmgr.h"
+
+
+PinGuard::PinGuard(PinGuard&& other) noexcept
+	: pool(other.pool), pid(other.pid), page(other.page), frame(other.frame),
+	  dirty(other.dirty), site(other.site)
+{
+	other.pool = NULL;
+	other.pid = INVALID_PAGE;
+	other.page = NULL;
+	other.frame = NULL;
+	other.dirty = false;
+	other.site = NULL;
+}
+
+
+// Drops the pin this guard held, if any, and takes other's.
+PinGuard& PinGuard::operator=(PinGuard&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	Unpin();
+	pool = other.pool;
+	pid = other.pid;
+	page = other.page;
+	frame = other.frame;
+	dirty = other.dirty;
+	site = other.site;
+	other.pool = NULL;
+	other.pid = INVALID_PAGE;
+	other.page = NULL;
+	other.frame = NULL;
+	other.dirty = false;
+	other.site = NULL;
+	return *this;
+}
+
+
+Status PinGuard::Unpin()
+{
+	return pool == NULL ? OK : pool->ReleaseGuard(*this, false);
+}
+
+
+Status PinGuard::Free()
+{
+	return pool == NULL ? OK : pool->ReleaseGuard(*this, true);
+}
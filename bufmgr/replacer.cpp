@@ -0,0 +1,159 @@
+/*
+ * replacer.cpp - buffer replacement policies: the Replacer interface,
+ *                Clock and the free frame list the other policies share.
+ *                LRU2, TwoQ, ARC and ClockPro have files of their own.
+ */
+
+#include <string.h>
+#include "replacer.h"
+
+
+Replacer::Replacer()
+{
+}
+
+
+Replacer::~Replacer()
+{
+}
+
+
+//-------------------------------------------------------------------
+// Replacer::Create
+//
+// Input   : name - name of the policy.
+//           bufSize - number of frames.
+//           frames - the frames of the pool.
+//           hashTable - the page table of the pool.
+// Output  : None
+// Return  : A new policy, NULL if name is not one.
+//-------------------------------------------------------------------
+
+Replacer *Replacer::Create(const char *name, int bufSize,
+						   ClockFrame **frames, HashTable *hashTable)
+{
+	if (strcmp(name, "Clock") == 0)
+		return new Clock(bufSize, frames, hashTable);
+	if (strcmp(name, "LRU2") == 0)
+		return new LRU2(bufSize, frames);
+	if (strcmp(name, "2Q") == 0)
+		return new TwoQ(bufSize, frames);
+	if (strcmp(name, "ARC") == 0)
+		return new ARC(bufSize, frames);
+	if (strcmp(name, "ClockPro") == 0)
+		return new ClockPro(bufSize, frames);
+	return NULL;
+}
+
+
+Clock::Clock(int bufSize, ClockFrame **frames, HashTable *hashTable)
+{
+	current = 0;
+	numOfBuf = bufSize;
+	this->frames = frames;
+	this->hashTable = hashTable;
+}
+
+
+Clock::~Clock()
+{
+}
+
+
+//-------------------------------------------------------------------
+// Clock::PickVictim
+//
+// Input   : None
+// Output  : None
+// Purpose : Sweep the clock hand, clearing reference bits, until it
+//           finds an empty frame or an unpinned unreferenced one.
+//           Two sweeps clear every bit, so a victim is found then if
+//           any frame is unpinned.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int Clock::PickVictim()
+{
+	for (int i = 0; i < 2 * numOfBuf; i++)
+	{
+		int frameNo = current;
+		ClockFrame *frame = frames[frameNo];
+		current = (current + 1) % numOfBuf;
+
+		if (frame->IsVictim())
+			return frameNo;
+		if (frame->NotPinned())
+			frame->UnsetReferenced();
+	}
+
+	return INVALID_FRAME;
+}
+
+
+// Unpinned unreferenced pages from the hand on, as the next sweep
+// would find them.
+void Clock::NextVictims(int n, std::vector<int>& frameNos)
+{
+	for (int i = 0, frameNo = current; i < numOfBuf && n > 0; i++)
+	{
+		ClockFrame *frame = frames[frameNo];
+		if (frame->IsValid() && frame->NotPinned() && !frame->IsReferenced())
+		{
+			frameNos.push_back(frameNo);
+			n--;
+		}
+		frameNo = (frameNo + 1) % numOfBuf;
+	}
+}
+
+
+FreeFrames::FreeFrames(int bufSize)
+	: isFree(bufSize, true)
+{
+	// Hand out frame 0 first.
+	for (int i = bufSize - 1; i >= 0; i--)
+		frameNos.push_back(i);
+}
+
+
+void FreeFrames::Add(int frameNo)
+{
+	if (!isFree[frameNo])
+	{
+		isFree[frameNo] = true;
+		frameNos.push_back(frameNo);
+	}
+}
+
+
+// A removed frame stays in frameNos until Take comes across it.
+void FreeFrames::Remove(int frameNo)
+{
+	isFree[frameNo] = false;
+}
+
+
+//-------------------------------------------------------------------
+// FreeFrames::Take
+//
+// Input   : None
+// Output  : None
+// Return  : A free frame, now no longer on the list, INVALID_FRAME if
+//           there is none.
+//-------------------------------------------------------------------
+
+int FreeFrames::Take()
+{
+	while (!frameNos.empty())
+	{
+		int frameNo = frameNos.back();
+		frameNos.pop_back();
+		if (isFree[frameNo])
+		{
+			isFree[frameNo] = false;
+			return frameNo;
+		}
+	}
+
+	return INVALID_FRAME;
+}
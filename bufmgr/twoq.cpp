@@ -0,0 +1,169 @@
+/*
+ * twoq.cpp - the 2Q replacement policy (Johnson and Shasha), in its
+ *            full form with A1in, A1out and Am.
+ *
+ * A1in is given a quarter of the frames and A1out remembers as many
+ * pages as half the frames, the sizes the paper suggests.
+ */
+
+#include "replacer.h"
+
+
+TwoQ::TwoQ(int bufSize, ClockFrame **frames)
+	: freeFrames(bufSize), where(bufSize, NOWHERE), position(bufSize)
+{
+	numOfBuf = bufSize;
+	this->frames = frames;
+	kIn = bufSize / 4 > 0 ? bufSize / 4 : 1;
+	kOut = bufSize / 2 > 0 ? bufSize / 2 : 1;
+}
+
+
+//-------------------------------------------------------------------
+// TwoQ::PickVictim
+//
+// Input   : None
+// Output  : None
+// Purpose : Take a free frame, or else the oldest unpinned page of
+//           A1in while it is over its size, or else the least
+//           recently used unpinned page of Am.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int TwoQ::PickVictim()
+{
+	int frameNo = freeFrames.Take();
+	if (frameNo != INVALID_FRAME)
+		return frameNo;
+
+	if ((int)a1in.size() > kIn || am.empty())
+	{
+		frameNo = EvictFrom(a1in);
+		if (frameNo == INVALID_FRAME)
+			frameNo = EvictFrom(am);
+	}
+	else
+	{
+		frameNo = EvictFrom(am);
+		if (frameNo == INVALID_FRAME)
+			frameNo = EvictFrom(a1in);
+	}
+
+	return frameNo;
+}
+
+
+// The tail of A1in, then of Am, whichever PickVictim would take from.
+void TwoQ::NextVictims(int n, std::vector<int>& frameNos)
+{
+	bool fromA1in = (int)a1in.size() > kIn || am.empty();
+	std::list<int> *queues[2] = { fromA1in ? &a1in : &am, fromA1in ? &am : &a1in };
+
+	for (int q = 0; q < 2; q++)
+	{
+		for (std::list<int>::reverse_iterator it = queues[q]->rbegin();
+			 it != queues[q]->rend() && n > 0; ++it)
+		{
+			if (frames[*it]->NotPinned())
+			{
+				frameNos.push_back(*it);
+				n--;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------
+// TwoQ::EvictFrom
+//
+// Input   : queue - a1in or am.
+// Output  : None
+// Purpose : Take the unpinned frame nearest the tail of queue.  A page
+//           leaving A1in goes to the head of A1out.
+// Return  : The frame number, INVALID_FRAME if all are pinned.
+//-------------------------------------------------------------------
+
+int TwoQ::EvictFrom(std::list<int>& queue)
+{
+	for (std::list<int>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
+	{
+		int frameNo = *it;
+		if (!frames[frameNo]->NotPinned())
+			continue;
+
+		queue.erase(position[frameNo]);
+		if (where[frameNo] == A1IN)
+		{
+			if ((int)a1out.size() >= kOut)
+			{
+				inA1out.erase(a1out.back());
+				a1out.pop_back();
+			}
+			a1out.push_front(frames[frameNo]->GetPageID());
+			inA1out[a1out.front()] = a1out.begin();
+		}
+		where[frameNo] = NOWHERE;
+		return frameNo;
+	}
+
+	return INVALID_FRAME;
+}
+
+
+//-------------------------------------------------------------------
+// TwoQ::PageAccessed
+//
+// Input   : frameNo - frame of the page.
+//           pid - the page.
+// Output  : None
+// Purpose : A hit in Am moves the page to its head; a hit in A1in does
+//           nothing.  A page read in goes to Am if A1out remembers it,
+//           to A1in otherwise.
+//-------------------------------------------------------------------
+
+void TwoQ::PageAccessed(int frameNo, PageID pid)
+{
+	switch (where[frameNo])
+	{
+	case AM:
+		am.splice(am.begin(), am, position[frameNo]);
+		break;
+
+	case A1IN:
+		break;
+
+	case NOWHERE:
+		{
+			freeFrames.Remove(frameNo);
+			std::unordered_map<PageID, std::list<PageID>::iterator>::iterator g =
+				inA1out.find(pid);
+			if (g != inA1out.end())
+			{
+				a1out.erase(g->second);
+				inA1out.erase(g);
+				am.push_front(frameNo);
+				position[frameNo] = am.begin();
+				where[frameNo] = AM;
+			}
+			else
+			{
+				a1in.push_front(frameNo);
+				position[frameNo] = a1in.begin();
+				where[frameNo] = A1IN;
+			}
+		}
+		break;
+	}
+}
+
+
+void TwoQ::PageFreed(int frameNo)
+{
+	if (where[frameNo] == A1IN)
+		a1in.erase(position[frameNo]);
+	else if (where[frameNo] == AM)
+		am.erase(position[frameNo]);
+	where[frameNo] = NOWHERE;
+	freeFrames.Add(frameNo);
+}
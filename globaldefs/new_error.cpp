@@ -0,0 +1,194 @@
+/*
+ * new_error.cpp - the global error queue.  See new_error.h for the
+ *                 protocol.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "new_error.h"
+
+
+global_errors minibase_errors;
+
+const char **error_string_table::table[NUM_STATUS_CODES];
+
+
+//-------------------------------------------------------------------
+// error_string_table::get_message
+//
+// Input   : subsystem - the subsystem that registered the messages.
+//           index - index of the message.
+// Output  : None
+// Return  : The message, or NULL if there is none.
+//-------------------------------------------------------------------
+
+const char *error_string_table::get_message(Status subsystem, int index)
+{
+	if (subsystem < 0 || subsystem >= NUM_STATUS_CODES || index < 0)
+		return NULL;
+	if (table[subsystem] == NULL)
+		return NULL;
+	return table[subsystem][index];
+}
+
+
+error_node::error_node(Status subsys, Status prior, int err_index,
+					   const char *extra_msg)
+{
+	next_node = NULL;
+	subsystem = subsys;
+	prior_status = prior;
+	error_index = err_index;
+	msg = NULL;
+
+	if (extra_msg != NULL)
+		msg = strcpy(new char[strlen(extra_msg) + 1], extra_msg);
+}
+
+
+error_node::~error_node()
+{
+	delete [] msg;
+}
+
+
+//-------------------------------------------------------------------
+// error_node::team_name
+//
+// Input   : T1 - a subsystem ID.
+// Output  : None
+// Return  : The printable name of the subsystem.
+//-------------------------------------------------------------------
+
+const char *error_node::team_name(Status T1)
+{
+	switch (T1)
+	{
+	case OK:          return "OK";
+	case TUPLE:       return "Tuple";
+	case BUFMGR:      return "Buffer Manager";
+	case HEAPFILE:    return "Heap File";
+	case SCAN:        return "Scan";
+	case SORTEDPAGE:  return "Sorted Page";
+	case BTINDEXPAGE: return "BTree Index Page";
+	case BTLEAFPAGE:  return "BTree Leaf Page";
+	case BTREE:       return "BTree";
+	case STATHASH:    return "Static Hash";
+	case JOINS:       return "Joins";
+	case CATALOG:     return "Catalog";
+	case DBMGR:       return "DB Manager";
+	case RAWFILE:     return "Raw File";
+	case PLANNER:     return "Planner";
+	case PARSER:      return "Parser";
+	case OPTIMIZER:   return "Optimizer";
+	case FRONTEND:    return "Front End";
+	case DONE:        return "Done";
+	case FAIL:        return "Fail";
+	default:          return "<<Unknown>>";
+	}
+}
+
+
+//-------------------------------------------------------------------
+// error_node::show_error
+//
+// Input   : to - stream to print on.
+// Output  : None
+// Purpose : Print one line for this error: the subsystem, where the
+//           error came from or what it was, and where it was posted.
+//-------------------------------------------------------------------
+
+void error_node::show_error(ostream& to) const
+{
+	to << team_name(subsystem);
+
+	if (prior_status != OK)
+		to << " [from the " << team_name(prior_status) << "]";
+
+	if (get_message() != NULL)
+		to << ": " << get_message();
+
+	if (msg != NULL)
+		to << " [" << msg << "]";
+
+	to << endl;
+}
+
+
+global_errors::global_errors()
+{
+	first = last = NULL;
+}
+
+
+global_errors::~global_errors()
+{
+	clear_errors();
+}
+
+
+//-------------------------------------------------------------------
+// global_errors::add_error
+//
+// Input   : subsystem - the subsystem posting the error.
+//           priorStatus - status of the failed call, OK for a first
+//                         error.
+//           lineno, file - where the error was posted.
+//           error_index - index into the subsystem's messages.
+// Output  : None
+// Return  : subsystem, so that callers can return it directly.
+//-------------------------------------------------------------------
+
+Status global_errors::add_error(Status subsystem, Status priorStatus,
+								int lineno, const char *file, int error_index)
+{
+	char where[256];
+
+	snprintf(where, sizeof(where), "%s:%d", file, lineno);
+	return add_error(new error_node(subsystem, priorStatus, error_index, where));
+}
+
+
+Status global_errors::add_error(error_node *next)
+{
+	if (last == NULL)
+		first = next;
+	else
+		last->set_next(next);
+	last = next;
+
+	return next->get_status();
+}
+
+
+void global_errors::clear_errors()
+{
+	while (first != NULL)
+	{
+		error_node *next = (error_node *)first->get_next();
+		delete first;
+		first = next;
+	}
+	last = NULL;
+}
+
+
+void global_errors::show_errors(ostream& to)
+{
+	if (first == NULL)
+		return;
+
+	to << "First error occurred: ";
+	for (const error_node *e = first; e != NULL; e = e->get_next())
+	{
+		if (e != first)
+			to << "--> ";
+		e->show_error(to);
+	}
+}
+
+
+void global_errors::show_errors()
+{
+	show_errors(cerr);
+}
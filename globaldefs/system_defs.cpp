@@ -0,0 +1,106 @@
+/*
+ * system_defs.cpp - start up and shut down the global database and
+ *                   buffer manager.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "minirel.h"
+#include "db.h"
+#include "bufmgr.h"
+
+
+SystemDefs *minibase_globals = NULL;
+
+// Set by the program before the globals are created: non-zero reopens
+// the existing database instead of creating a new one.
+extern int MINIBASE_RESTART_FLAG;
+
+
+ostream& operator<< (ostream& out, const struct RecordID rid)
+{
+	return out << "[" << rid.pageNo << "/" << rid.slotNo << "]";
+}
+
+
+SystemDefs::SystemDefs(Status& status, const char *dbname, const char *logname,
+					   unsigned dbpages, unsigned maxlogsize,
+					   unsigned bufpoolsize, const char *replacement_policy)
+{
+	init(status, dbname, logname, dbpages, maxlogsize,
+		 bufpoolsize, replacement_policy);
+}
+
+
+//-------------------------------------------------------------------
+// SystemDefs::init
+//
+// Input   : dbname - file holding the database.
+//           logname - name of the log; "<dbname>-log" if NULL.
+//           dbpages - size of a new database in pages, 0 to open an
+//                     existing one.
+//           maxlogsize - unused, there is no log.
+//           bufpoolsize - frames in the buffer pool, NUMBUF if 0.
+//           replacement_policy - name of a Replacer, "Clock" if NULL.
+// Output  : status - OK if successful, the failing subsystem otherwise.
+// Purpose : Create or open the database and its buffer pool, and
+//           start the pool's hot set keeper.
+//-------------------------------------------------------------------
+
+void SystemDefs::init(Status& status, const char *dbname, const char *logname,
+					  unsigned dbpages, unsigned maxlogsize,
+					  unsigned bufpoolsize, const char *replacement_policy)
+{
+	GlobalBufMgr = NULL;
+	GlobalDB = NULL;
+	GlobalCatalogPtr = NULL;
+
+	GlobalDBName = strcpy(new char[strlen(dbname) + 1], dbname);
+	if (logname != NULL)
+	{
+		GlobalLogName = strcpy(new char[strlen(logname) + 1], logname);
+	}
+	else
+	{
+		GlobalLogName = new char[strlen(dbname) + 5];
+		sprintf(GlobalLogName, "%s-log", dbname);
+	}
+
+	GlobalBufMgr = new BufMgr(bufpoolsize ? bufpoolsize : NUMBUF,
+							  replacement_policy ? replacement_policy : "Clock");
+
+	if (MINIBASE_RESTART_FLAG)
+		dbpages = 0;
+
+	GlobalDB = new DB(GlobalDBName, dbpages, status);
+	if (status != OK)
+	{
+		cerr << (dbpages ? "Error creating Database " : "Error opening Database ")
+			 << GlobalDBName << endl;
+		return;
+	}
+
+	// Keep the pool's hot set in "<dbname>-hot", and warm the pool from
+	// it when reopening.  StartHotSetKeeper finds the database through
+	// minibase_globals.
+	minibase_globals = this;
+	char *hotSetName = new char[strlen(dbname) + 5];
+	sprintf(hotSetName, "%s-hot", dbname);
+	GlobalBufMgr->StartHotSetKeeper(hotSetName, dbpages == 0);
+	delete [] hotSetName;
+}
+
+
+SystemDefs::~SystemDefs()
+{
+	if (GlobalBufMgr != NULL && GlobalBufMgr->FlushAllPages() != OK)
+		cerr << "Error flushing buffer pool pages" << endl;
+
+	delete GlobalBufMgr;
+	delete GlobalDB;
+	delete [] GlobalDBName;
+	delete [] GlobalLogName;
+
+	if (minibase_globals == this)
+		minibase_globals = NULL;
+}
@@ -0,0 +1,138 @@
+#ifndef _AIO_H
+#define _AIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "page.h"
+
+// Page reads and writes that are submitted now and completed later, so
+// that many can be in flight at once.  The io_uring backend hands them
+// to the kernel through a submission ring; where io_uring is missing
+// (old kernels, seccomp) a pool of threads runs pread/pwrite instead.
+//
+// Submit and Wait may be called from any thread.  A request belongs to
+// its submitter until it is done, and must not be touched, or freed,
+// before then.
+
+// Requests in flight on one AsyncIO, threads of the thread pool, and
+// pages one request may read or write.
+#define AIO_QUEUE_DEPTH  64
+#define AIO_MAX_THREADS  16
+#define AIO_MAX_RUN      64
+
+// A read or write of numPages consecutive pages from pid on, done as
+// one preadv/pwritev if there are more than one.
+struct IORequest
+{
+	bool write;               // true to write to the file, false to read
+	PageID pid;               // the first page
+	Page *page;               // the page, if numPages is 1
+	Page **pages;             // the pages, if more
+	int numPages;
+	void *context;            // the submitter's, untouched
+
+	Status status;            // OK or FAIL, once done
+	std::atomic<bool> done;
+
+	IORequest() : write(false), pid(INVALID_PAGE), page(NULL), pages(NULL), numPages(1),
+				  context(NULL), status(OK), done(false) {}
+
+	Page *PageAt( int i ) { return numPages == 1 ? page : pages[i]; }
+};
+
+class AsyncIO
+{
+	public :
+
+		virtual ~AsyncIO() {}
+
+		// Start the requests, in order.  Blocks while the queue is full,
+		// until enough earlier requests complete.
+		virtual Status Submit( IORequest **requests, int count ) = 0;
+		Status Submit( IORequest *request ) { return Submit(&request, 1); }
+
+		// Block until a submitted request is done.
+		virtual void Wait( IORequest *request ) = 0;
+
+		bool IsDone( IORequest *request )
+			{ return request->done.load(std::memory_order_acquire); }
+
+		// Mark the requests that have completed done, without blocking,
+		// for backends that only learn of completions when asked.
+		virtual void Poll() {}
+
+		virtual const char *GetName() = 0;
+
+		// An AsyncIO on the pages of fd with up to queueDepth requests
+		// in flight.  backend is "uring" or "threads", or NULL for
+		// io_uring if the kernel has it and threads otherwise.  NULL if
+		// the backend is unknown or cannot be set up.
+		static AsyncIO *Create( int fd, int queueDepth, const char *backend = NULL );
+};
+
+class UringIO : public AsyncIO
+{
+	private :
+
+		int fd;
+		int ringFd;
+		unsigned depth;
+		unsigned sqEntries;
+		std::atomic<unsigned> inFlight;
+
+		// The rings shared with the kernel, and where their fields are.
+		void *sqRing, *cqRing;
+		size_t sqRingSize, cqRingSize;
+		struct io_uring_sqe *sqes;
+		unsigned *sqTail, *sqMask, *sqArray;
+		unsigned *cqHead, *cqTail, *cqMask;
+		struct io_uring_cqe *cqes;
+
+		std::mutex sqMutex;       // guards the submission ring
+		std::mutex cqMutex;       // guards the completion ring; held
+		                          // while waiting in the kernel
+
+		int Enter( unsigned toSubmit, unsigned minComplete, unsigned flags );
+		int Reap();
+		void WaitForRoom();
+		void MakeRoom( unsigned started, unsigned& backoff );
+
+	public :
+
+		UringIO( int fd, int queueDepth, Status& status );
+		~UringIO();
+		Status Submit( IORequest **requests, int count );
+		void Wait( IORequest *request );
+		void Poll();
+		const char *GetName() { return "uring"; }
+};
+
+class ThreadPoolIO : public AsyncIO
+{
+	private :
+
+		int fd;
+		std::vector<std::thread> workers;
+		std::mutex mutex;                  // guards the queue, stopping
+		std::condition_variable work;      // queue not empty, or stopping
+		std::condition_variable finished;  // a request is done
+		std::deque<IORequest *> queue;
+		bool stopping;
+
+		void Run();
+
+	public :
+
+		ThreadPoolIO( int fd, int numThreads );
+		~ThreadPoolIO();
+		Status Submit( IORequest **requests, int count );
+		void Wait( IORequest *request );
+		const char *GetName() { return "threads"; }
+};
+
+#endif // _AIO_H
@@ -0,0 +1,71 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "clockframe.h"
+
+// Whether the pages of the buffer pool are put on huge pages: not at
+// all, on transparent huge pages (madvise MADV_HUGEPAGE), or on huge
+// pages reserved for the purpose (MAP_HUGETLB), falling back to
+// transparent ones if there are not enough reserved.
+enum HugePages { HUGE_PAGES_OFF, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_RESERVED };
+
+#define HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+// The frames of the buffer pool and the memory of their pages, made in
+// blocks: a dense array of frames, and one mapping, aligned to a huge
+// page, with the frames' pages one after the other.  A pool is then a
+// few allocations instead of two per frame, pins and unpins run over
+// frames packed together without touching page bodies, and the page
+// bodies take few TLB entries.
+//
+// The pool gives frames back one at a time when it shrinks.  The
+// memory of their pages goes back to the system as soon as the whole
+// operating system page (or, for reserved huge pages, the whole block)
+// is given back, but the frames themselves are kept until the arena is
+// deleted, for lock-free pins that may still look at them.
+
+class FrameArena
+{
+	private :
+
+		struct Block
+		{
+			ClockFrame *frames;
+			int numOfFrames;
+			char *memory;              // page of frame i at i * MINIBASE_PAGESIZE
+			size_t size;               // of the mapping, 0 once unmapped
+			bool reserved;             // on reserved huge pages
+			bool mapped;               // false if from the heap
+			std::vector<bool> given;   // frames given back
+			int numGiven;
+		};
+
+		HugePages hugePages;
+		std::vector<Block *> blocks;
+		size_t systemPageSize;
+
+		void Map( Block *block );
+		void Unmap( Block *block );
+
+	public :
+
+		FrameArena( HugePages hugePages );
+		~FrameArena();
+
+		// Make n empty frames, with a page each, as one block.
+		void Allocate( int n, ClockFrame **frames );
+
+		// The pool is done with frame, which it has claimed and emptied.
+		void GiveBack( ClockFrame *frame );
+
+		// Bytes of the pages of the frames in use, and how many of them
+		// are on reserved huge pages.
+		void GetStat( long& bytes, long& reservedBytes );
+
+		HugePages GetHugePages() { return hugePages; }
+};
+
+#endif // _ARENA_H
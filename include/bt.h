@@ -42,6 +42,21 @@ typedef enum
 	LEAF_NODE		
 } NodeType;
 
+/*
+* How leaf entries store their first RecordID: RID_RAW copies the 8
+* bytes, RID_VARINT writes pageNo as a zigzag varint of its distance
+* from the leaf's base page number, and slotNo as a varint.  A leaf
+* takes the page of the first RecordID put on it as its base, so RIDs
+* clustered on a few heap pages take a byte or two whatever their page
+* numbers.  The choice is made per index when it is created.
+*/
+
+typedef enum
+{
+	RID_RAW,
+	RID_VARINT
+} RidEncoding;
+
 
 /*
 * A bunch of macros for handling and returning errors.
@@ -58,6 +73,23 @@ typedef enum
 
 #define MAX_KEY_SIZE        220
 
+/*
+ * LONG_KEY_PREFIX: keys this long or longer are stored as that many
+ * bytes inline, a '\0' and the PageID of an overflow chain holding the
+ * rest, which together just fill MAX_KEY_SIZE.  See StoreKey.
+ */
+
+#define LONG_KEY_PREFIX     (MAX_KEY_SIZE - 1 - (int)sizeof(PageID))
+
+/*
+ * PROBE_KEY_SIZE: bytes of a key made by ProbeKey, the form a key is
+ * looked up by.  A long one names PROBE_KEY_PID in place of an overflow
+ * chain, and is followed by a pointer to the rest of the key.
+ */
+
+#define PROBE_KEY_PID       (-2)
+#define PROBE_KEY_SIZE      (MAX_KEY_SIZE + (int)sizeof(const char *))
+
 //#define ATTR_INT  attrInteger
 #define ATTR_STRING attrString
 //#define ATTR_FOO	attrFoo
@@ -68,6 +100,7 @@ typedef enum
 
 
 typedef char KeyType[MAX_KEY_SIZE];
+typedef char ProbeKeyType[PROBE_KEY_SIZE];
 
 //struct KeyType
 //{
@@ -127,14 +160,58 @@ struct KeyDataEntry
 *
 * Finally, get_key_length and get_key_data_length determine the 
 * storage required for given key and key+data. 
+*
+* KeyPrefix packs the first four bytes of a key into an unsigned int
+* (big-endian, zero padded past the end of the key), so comparing two
+* prefixes as integers agrees with KeyCmp on those bytes.  Sorted pages
+* keep the prefixes of their keys together for searches to rank a key
+* among, and only call KeyCmp when the prefixes tie; see sortedpage.h.
+*
+* Keys of any length are accepted at the BTreeFile interface and turned
+* into their stored form by StoreKey; everything below works on stored
+* keys only.  Searches, scans and deletes, which put no key on a page,
+* use ProbeKey instead, whose long keys keep their rest in memory.
+* KeyCmp reads the overflow chains of two long keys only when their
+* inline parts are equal.  Each page record holding a long key owns a
+* reference to its chain (SortedPage::InsertRecord and DeleteRecord
+* call KeyRetain and KeyRelease); key copies must use KeyCopy, not
+* strcpy, to keep the PageID.
 */
 
+/*
+* A leaf entry holds a key and every RecordID indexed under it.  The
+* first RecordID follows the key as in a plain <key,data> pair, so an
+* entry with one RecordID is exactly what make_entry produces.  Further
+* RecordIDs are kept sorted and delta encoded as varints after it; see
+* MakeRidListEntry.  get_rid_list decodes them all.  With RID_VARINT
+* the first RecordID is a pair of varints as well, relative to ridBase.
+*/
+
+#define MAX_RIDS_PER_ENTRY  (MINIBASE_PAGESIZE / 2)
+
 int KeyCmp(const char *key1, const char *key2);
+unsigned int KeyPrefix(const char *key);
 int GetKeyLength(const char *key);
+int IsLongKey(const char *key);
+void KeyCopy(char *dst, const char *src);
+Status StoreKey(char *target, const char *key);
+void ProbeKey(char *target, const char *key);
+Status KeyRetain(const char *key);
+Status KeyRelease(const char *key);
+int GetFullKeyLength(const char *key);
+Status GetFullKey(char *target, const char *key);
 int GetKeyDataLength(const char *key, const NodeType nodeType);
 void MakeEntry (KeyDataEntry *target, const char *key,
-                NodeType nodeType, DataType data,int *len);
-void GetKeyData (char *key, DataType *data, KeyDataEntry *pair, int len, NodeType nodeType);
+                NodeType nodeType, DataType data,int *len,
+                RidEncoding ridEncoding = RID_RAW, PageID ridBase = 0);
+void GetKeyData (char *key, DataType *data, KeyDataEntry *pair,
+                 NodeType nodeType, RidEncoding ridEncoding = RID_RAW,
+                 PageID ridBase = 0);
+int MakeRidListEntry(char *target, const char *key, const RecordID *rids,
+                     int numRids, PageID overflowPid,
+                     RidEncoding ridEncoding = RID_RAW, PageID ridBase = 0);
+int GetRidList(RecordID *rids, PageID& overflowPid, const char *entry, int len,
+               RidEncoding ridEncoding = RID_RAW, PageID ridBase = 0);
 
 #define INSERT(page, key, data, rid) {\
 	if ((page)->Insert(key, data, rid) != OK) {\
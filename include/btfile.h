@@ -1,11 +1,25 @@
 #ifndef _BTFILE_H
 #define _BTFILE_H
 
+#include <set>
+#include <string>
+#include <vector>
+
 #include "btindex.h"
 #include "btleaf.h"
 #include "index.h"
 #include "btfilescan.h"
 #include "bt.h"
+#include "pageguard.h"
+
+class ClockFrame;
+
+// Pages a BTreeFile reserves from the database at a time, for its nodes.
+const int BTREE_EXTENT_PAGES = 64;
+
+// Runs of reserved pages the header page records; a file reserving more
+// gives the shortest back at once.
+const int BTREE_MAX_RESERVED_RUNS = 64;
 
 enum PrintOption
 { SINGLE,
@@ -19,7 +33,8 @@ public:
 	friend class BTreeDriver;
 	friend class BTreeFileScan;
 
-    BTreeFile(Status& status, const char *filename);
+    BTreeFile(Status& status, const char *filename,
+		RidEncoding ridEncoding = RID_RAW, int pinnedLevels = 0);
 
 	~BTreeFile();
 	
@@ -30,6 +45,7 @@ public:
     
 	IndexFileScan *OpenScan(const char *lowKey = NULL, 
 		const char *highKey = NULL);
+	IndexFileScan *OpenPrefixScan(const char *prefix);
 
 	Status Search(const char *key,  PageID& foundPid);
 
@@ -37,6 +53,28 @@ public:
 	Status PrintWhole ();
 	Status DumpStatistics();
 
+	// Keep the index nodes of the top levels levels of the tree pinned
+	// for as long as the file is open; 0 pins none.
+	Status SetPinnedLevels(int levels);
+	int GetNumOfPinnedNodes() { return (int)pinnedNodes.size(); }
+
+	// Follow swizzled links from index nodes to their children, as far
+	// as they hold, instead of looking the children up in the buffer
+	// pool's page table; see BufMgr::PinChild.  The probe of the page
+	// table it saves is a small part of a descent: btbench lookups run
+	// no faster with it, in memory or not.
+	void SetSwizzling(bool on) { swizzling = on; }
+
+	// Rewrite the leaves in key order into pages reserved together,
+	// each filled to targetFill of a page, a batch of at most
+	// batchLeaves siblings at a time.  ReorganizeStep does the next
+	// batch, and returns DONE when it has done the last leaf; inserts,
+	// deletes, searches and scans may run between steps.  A scan open
+	// across a step finds its place again by the last key it returned.
+	// Reorganize does every step.
+	Status Reorganize(float targetFill = 0.9f, int batchLeaves = 16);
+	Status ReorganizeStep(float targetFill, int batchLeaves);
+
 private:
 
     struct BTreeHeaderPage : HeapPage {
@@ -45,6 +83,8 @@ private:
 		void Init(PageID hpid) {
 			HeapPage::Init(hpid);
 			SetRootPageID(INVALID_PAGE);
+			SetRidEncoding(RID_RAW);
+			SetNumOfReservedRuns(0);
 		}
 
 		PageID GetRootPageID() {
@@ -56,11 +96,40 @@ private:
 			PageID *ptr = (PageID *)(HeapPage::data);
 			*ptr = pid;
 		}
+
+		// The RidEncoding of the leaves, stored after the root.
+		RidEncoding GetRidEncoding() {
+			return (RidEncoding)*((int *)(HeapPage::data + sizeof(PageID)));
+		}
+
+		void SetRidEncoding(RidEncoding e) {
+			int *ptr = (int *)(HeapPage::data + sizeof(PageID));
+			*ptr = (int)e;
+		}
+
+		// The runs of pages the file has reserved and not used, stored
+		// after the RidEncoding as their number and then the first page
+		// and length of each, so that a file that was never closed
+		// gets them back when it is opened again.
+		int GetNumOfReservedRuns() {
+			return *((int *)(HeapPage::data + sizeof(PageID) + sizeof(int)));
+		}
+
+		void SetNumOfReservedRuns(int n) {
+			int *ptr = (int *)(HeapPage::data + sizeof(PageID) + sizeof(int));
+			*ptr = n;
+		}
+
+		PageID *ReservedRun(int i) {
+			return (PageID *)(HeapPage::data + sizeof(PageID) + 2 * sizeof(int)) + 2 * i;
+		}
     };
 
-	BTreeHeaderPage *header;   // header page
+	PageGuard<BTreeHeaderPage> header;   // pinned while the file is open
     PageID           headerID; // page number of header page
     char            *dbname;       // copied from arg of the constructor.	
+	int              metricsFile;  // the buffer pool's account for the
+	                               // pins of this index
     
 	int				totalDataPages;
 	int				totalIndexPages;
@@ -74,20 +143,72 @@ private:
 	int				totalNumData;
 	int				hight; // hight of Tree
 
+	// The index nodes of the top pinnedLevels levels, pinned, sorted by
+	// page id, so a descent finds them without going to the buffer pool.
+	std::vector< PageGuard<SortedPage> > pinnedNodes;
+	int              pinnedLevels;
+	bool             pinnedStale;  // the top levels changed since pinned
+	bool             swizzling;
+
+	// Pages reserved from the database in extents of BTREE_EXTENT_PAGES
+	// and not yet made nodes, given back when the file is closed.  The
+	// leaves ReorganizeStep writes come from extents of their own, so
+	// that the nodes split off between steps do not come between them.
+	// The header page keeps a copy, which SaveReserved brings up to
+	// date, for the file to take them back on opening if it was not
+	// closed.
+	std::set<PageID> reserved;
+	std::set<PageID> reorgReserved;
+
+	// Where ReorganizeStep goes on from: the first key of the next leaf
+	// to rewrite, and the last leaf written, while a pass is running.
+	bool             reorgRunning;
+	std::string      reorgNext;
+	PageID           reorgLast;
+
+	// Steps that have rewritten leaves, and deletes that have freed
+	// one, so an open scan can tell that the leaf it was on may be gone.
+	long             reorgEpoch;
+
+	// Inserts, deletes and reorganize steps made through this handle,
+	// so an open scan can tell that the entry it keeps decoded may have
+	// changed.
+	long             updateEpoch;
+
 	Status _Search( const char *key,  PageID, PageID&);
-	Status _SearchIndex (const char *key,  PageID currIndexID, BTIndexPage *currIndex, PageID& foundID);
+	Status _SearchIndex (const char *key,  BTIndexPage *currIndex, PinGuard& pin, PageID& foundID);
 	Status _PrintTree ( PageID pageID);
-	Status _Insert(PageID nodePid, const char *key, const RecordID rid, PageID& newPid, char *newKey);
+	Status _InsertKey(const char *key, const RecordID rid);
+	Status _DeleteKey(const char *key, const RecordID rid);
+	Status _SearchSwizzled(const char *key, PageID currID, PageID& foundID);
+	Status _Insert(PageID nodePid, ClockFrame *parent, const char *key, const RecordID rid, PageID& newPid, char *newKey);
 	Status _Delete(PageID parentPid, PageID nodePid, const char *key, const RecordID rid, PageID& oldPid, bool& rightSibling);
 
-	Status BTreeFile::_DumpStatistics(PageID);
-	Status BTreeFile::__DumpStatistics(PageID);
+	Status _DumpStatistics(PageID);
+	Status __DumpStatistics(PageID);
 
 	// You may add members and methods here.
 	//BTreeFileScan* scan; 
 	Status DestroyNode(PageID pageID);
+	void GetChildren(BTIndexPage *index, std::vector<PageID>& children);
+	void PrefetchChildren(BTIndexPage *index);
+	PageGuard<SortedPage> *FindPinnedNode(PageID pid);
+	Status PinNode(ClockFrame *parent, PageID pid, PageGuard<SortedPage>& page, const char *site);
+	Status PinUpperLevels();
+	void UnpinUpperLevels();
+	Status InitLeafPage(BTLeafPage *page, PageID pid);
+	Status NewNode(std::set<PageID>& pages, PageID after, PageID& pid, PinGuard& page,
+				   const char *site);
+	Status ReserveExtent(std::set<PageID>& pages);
+	void ReleaseReserved(std::set<PageID>& pages);
+	void SaveReserved();
+	void LoadReserved();
+	Status FillLeaves(std::vector< PageGuard<BTLeafPage> >& old, int budget,
+					  std::vector< PageGuard<BTLeafPage> >& fresh);
+	void DiscardLeaves(std::vector< PageGuard<BTLeafPage> >& fresh);
+	Status FindLeafParent(const char *key, PageGuard<SortedPage>& parent, PageID& leafPid);
 	Status Split1LeafNode(PageID leafPageID, PageID& newRootPageID, const char *key, const RecordID rid); //splits leafPageID, returns newRootPageID
-	PageID BTreeFile::GetLeftmostLeaf();
+	PageID GetLeftmostLeaf();
 };
 
 
@@ -1,7 +1,10 @@
 #ifndef _BTREE_FILESCAN_H
 #define _BTREE_FILESCAN_H
 
+#include <string.h>
 #include "btfile.h"
+#include "btleaf.h"
+#include "bufmgr.h"
 
 class BTreeFile;
 
@@ -15,17 +18,37 @@ public:
 
 	~BTreeFileScan();	
 
+	// The whole key last returned by GetNext, for keys longer than
+	// what GetNext copies out (see StoreKey).
+	int GetFullKeyLength();
+	Status GetFullKey(char *key);
+
 private:
 	// You may add members and methods here.
 	bool firstTime;
 	const char *lowKey;
 	const char *highKey;
+	const char *prefix;   // if not NULL, stop at the first key without it
+	int prefixLen;
 	RecordID crid;
 	PageID pid;
+	KeyType curKey;       // stored form of the key last returned
+	bool started;         // GetNext has returned a key, curKey
+	AccessStrategy *strategy;  // BULK_READ ring once past the first leaf
+	int metricsFile;           // of the index, see MetricsScope
+	BTreeFile *file;           // the index, which must outlive the scan
+	long reorgEpoch;           // file's when the scan last found its place
+	long updateEpoch;          // file's when cursor was last good
+	LeafEntryCursor cursor;    // the entry crid is in, decoded
+
+	bool MatchesPrefix(const char *key);
+	Status Reposition();
 
 	void setScanFirstTime(bool ft) {firstTime = ft;}
 	void setScanLowKey(const char *nlowKey) {lowKey=nlowKey;}
 	void setScanHighKey(const char *nhighKey) {highKey=nhighKey;}
+	void setScanPrefix(const char *nprefix) {
+		prefix=nprefix; prefixLen=(nprefix ? strlen(nprefix) : 0);}
 	void setScanPid(PageID npid) {pid=npid;}
 	void setScanCrid(RecordID rid) {crid=rid;}
 };
@@ -8,22 +8,100 @@
 #include "btindex.h"
 
 
+/*
+ * Each key has one entry per leaf holding all of its RecordIDs (see
+ * MakeRidListEntry in bt.h).  Once that list would grow past
+ * MAX_POSTING_SIZE bytes, further RecordIDs go to a chain of overflow
+ * pages hanging off the entry, so one hot key never takes more than a
+ * quarter of a leaf.
+ *
+ * The rid handed out by GetFirst/GetNext/... is a cursor: slotNo packs
+ * the slot of the entry and the position of the RecordID within it.
+ */
+
+#define MAX_POSTING_SIZE  (HEAPPAGE_DATA_SIZE / 4)
+
+#define LEAF_CURSOR(slot, pos)  (((slot) << 21) | (pos))
+#define LEAF_CURSOR_SLOT(c)     ((c) >> 21)
+#define LEAF_CURSOR_POS(c)      ((c) & 0x1FFFFF)
+
+#define RIDS_PER_OVERFLOW_PAGE \
+	((MAX_SPACE - sizeof(PageID) - sizeof(int)) / sizeof(RecordID))
+
+struct RidOverflowPage {
+	PageID   nextPage;
+	int      numOfRids;
+	RecordID rids[RIDS_PER_OVERFLOW_PAGE];
+};
+
+// What a scan keeps of the entry it is in: the entry's own RecordIDs,
+// decoded, and a copy of the overflow page it last read from.  Passed
+// to GetFirst/GetNext/GetCurrent, it lets each step take the next
+// RecordID without decoding the entry or walking its overflow chain
+// again.  The caller must reset leaf to INVALID_PAGE whenever the leaf
+// or its chains may have changed.
+struct LeafEntryCursor {
+	PageID   leaf;              // of the entry, INVALID_PAGE if none
+	int      slot;
+	int      numRids;
+	RecordID rids[MAX_RIDS_PER_ENTRY];
+	PageID   overflowHead;      // first page of the entry's chain
+	PageID   overflowPid;       // the page copied below, INVALID_PAGE if none
+	PageID   overflowNext;      // and the one after it
+	int      overflowPos;       // position in the entry of its first RecordID
+	int      numOverflowRids;
+	RecordID overflowRids[RIDS_PER_OVERFLOW_PAGE];
+};
+
+
 class BTLeafPage : public SortedPage {
 	
 private:
 	
 	// No private variables should be declared.
+
+	Status GetEntry (int slot, int pos, char* key, RecordID & dataRid,
+		LeafEntryCursor *cursor);
+	Status ReplaceEntry (int slot, char *entry, int entryLen);
+	Status AddOverflow (int slot, const char *key, RecordID *rids,
+		int numRids, PageID overflowPid, RecordID dataRid, int& pos);
+	Status DeleteOverflow (int slot, const char *key, RecordID *rids,
+		int numRids, PageID overflowPid, const RecordID& dataRid);
+	Status MoveEntry (int slot, BTLeafPage *dest);
+	PageID *RidBase ()
+		{ return (PageID *)(data + HEAPPAGE_DATA_SIZE - sizeof(PageID)); }
 	
 public:
 		
 	Status Insert (const char *key, RecordID dataRid, RecordID& rid);
 	
-	Status GetFirst (RecordID& rid, char* key, RecordID & dataRid);
-	Status GetNext  (RecordID& rid, char* key, RecordID & dataRid);
-	Status GetCurrent (RecordID rid, char* key, RecordID & dataRid);
+	Status GetFirst (RecordID& rid, char* key, RecordID & dataRid,
+		LeafEntryCursor *cursor = NULL);
+	Status GetNext  (RecordID& rid, char* key, RecordID & dataRid,
+		LeafEntryCursor *cursor = NULL);
+	Status GetCurrent (RecordID rid, char* key, RecordID & dataRid,
+		LeafEntryCursor *cursor = NULL);
 	Status GetLast (RecordID& rid, char* key, RecordID & dataRid);
 	
 	Status Delete (const char* key, const RecordID& dataRid);
+
+	void SetRidEncoding (RidEncoding e)
+		{ type = (short)((type & NODE_TYPE_MASK) | (e << 8)); }
+	RidEncoding GetRidEncoding () { return (RidEncoding)(type >> 8); }
+
+	// The page number RID_VARINT entries code theirs relative to: that
+	// of the first RecordID put on the leaf while it was empty.  It is
+	// kept in the last bytes of the data area, below which the leaf's
+	// records grow; Init sets that room aside.
+	void Init (PageID pageNo);
+	void SetRidBase (PageID base) { *RidBase() = base; }
+	PageID GetRidBase () { return *RidBase(); }
+	static int EmptySpace () { return SortedPage::EmptySpace() - (int)sizeof(PageID); }
+
+	Status CopyEntry (int slot, BTLeafPage *dest);
+	Status MoveFirst (BTLeafPage *dest);
+	Status MoveLast (BTLeafPage *dest);
+	Status FreeOverflow ();
 };
 
 #endif
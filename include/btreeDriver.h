@@ -37,8 +37,11 @@ private:
 										   int pad);
 
 	static PageID GetLeftmostLeaf(BTreeFile *btf);
+	static int CountSequentialLeaves(BTreeFile *btf, int& numLeaves, int *forward = NULL);
 
 	static bool TestScanCount(IndexFileScan* scan, int expected);
+	static bool TestDuplicates(RidEncoding ridEncoding);
+	static bool TestClusteredRids();
 
 
 
@@ -50,6 +53,24 @@ private:
 	bool Test5();
 	bool Test6();
 	bool Test7();
+	bool Test8();
+	bool Test9();
+	bool Test10();
+	bool Test11();
+	bool Test12();
+	bool Test13();
+	bool Test14();
+	bool Test15();
+	bool Test16();
+	bool Test17();
+	bool Test18();
+	bool Test19();
+	bool Test20();
+	bool Test21();
+	bool Test22();
+	bool Test23();
+	bool Test24();
+	bool Test25();
 };
 
 
@@ -2,40 +2,433 @@
 #ifndef _BUF_H
 #define _BUF_H
 
+#include <stdio.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "db.h"
 #include "page.h"
 #include "frame.h"
+#include "arena.h"
 #include "replacer.h"
 #include "hash.h"
+#include "pageguard.h"
+
+// How a caller is going to use the pages it pins.  Pages read with a
+// BULK_READ strategy, by scans that touch many pages once, go through a
+// small ring of frames of their own instead of taking a new frame from
+// the pool each time, so a big scan cannot push the pages everyone else
+// is using out of the pool.
+
+enum AccessType { NORMAL_ACCESS, BULK_READ, NUM_ACCESS_TYPES };
+
+// Frames of a BULK_READ ring: at most 32 pages, and no more than an
+// eighth of the pool.
+#define BULK_READ_RING_SIZE  32
+
+// The pool is split into shards by page id, each with its own frames,
+// page table, replacement policy and mutex, so threads pinning
+// different pages rarely wait for each other.  There are at most
+// MAX_BUF_SHARDS, of at least MIN_SHARD_FRAMES frames each.
+#define MAX_BUF_SHARDS    16
+#define MIN_SHARD_FRAMES  64
+
+// Pages a thread latches at once to write them.  With every shard
+// locked besides, that stays under the 64 locks a thread may hold
+// under ThreadSanitizer; longer runs go out in pieces.
+#define WRITE_MAX_LATCHES 32
+
+// Resize keeps the number of shards and deals the new number of frames
+// out to them.  Pages stay in the frames they are in, but the frames
+// are numbered anew, so pins and unpins without a lock look pages up in
+// a View: the frames and page tables of the pool as they were when the
+// pin began.  Views replaced by Resize are kept until the BufMgr is
+// deleted, as a thread may still be using them, and so are the frames
+// it drops, in the FrameArena, though their pages' memory is freed.
+
+// Counters of the pool that only ever go up, for monitoring: take a
+// snapshot with GetMetrics now and then and Subtract the one before.
+// Pins and misses are counted by file and page type.  A file registers
+// with RegisterMetricsFile, giving a function that tells its page types
+// apart from the pages themselves, and a MetricsScope puts a thread's
+// pins on the file's account.  Pins outside any scope go to file 0.
+// Pin hold times, from a page's first pin to its last unpin, of one in
+// PIN_HOLD_SAMPLE (see frame.h), go in PIN_HOLD_BUCKETS buckets: under
+// 1 us, then under 2, 4, ... us.
+
+#define METRICS_MAX_FILES   16
+#define METRICS_MAX_TYPES   4
+#define METRICS_OTHER_TYPE  (METRICS_MAX_TYPES - 1)
+#define PIN_HOLD_BUCKETS    24
+
+typedef int (*PageTyper)( PageID pid, Page *page );
+
+// The ids of the pages in the pool, hottest first, can be saved to a
+// file, the hot set, and read back into the pool after a restart so it
+// starts warm.  The file holds HOT_SET_MAGIC, the number of pages and
+// their ids.  It is read back in runs of consecutive pages, up to
+// HOT_SET_BATCH runs in flight at once.
+#define HOT_SET_MAGIC     0x484f5453
+#define HOT_SET_BATCH     16
+#define HOT_SET_INTERVAL  60000
+
+struct BufMetrics
+{
+	long pins[METRICS_MAX_FILES][METRICS_MAX_TYPES];
+	long misses[METRICS_MAX_FILES][METRICS_MAX_TYPES];
+	long cleanEvictions;
+	long dirtyEvictions;
+	long aheadEvictions; // clean ones the background writer had written
+	long lockWaits;      // pins that found the shard locked
+	long latchWaits;     // latched pins that found the page latched
+	long readWaits;      // lookups that found a prefetch still reading
+	long reads;          // pages read by misses
+	long readNanos;
+	long writes;         // writes, of one run of pages each
+	long pagesWritten;
+	long writeNanos;
+	long prefetches;
+	long pinHolds[PIN_HOLD_BUCKETS];
+
+	long TotalPins() const;
+	long TotalMisses() const;
+
+	// Turn this snapshot into the change since an earlier one.
+	void Subtract( const BufMetrics& earlier );
+};
+
+// Puts the pins of the thread that makes it on the account of fileNo
+// until it is destroyed.  Scopes nest.
+class MetricsScope
+{
+	private :
+
+		int saved;
+
+	public :
+
+		MetricsScope( int fileNo );
+		~MetricsScope();
+};
+
+class AccessStrategy
+{
+	friend class BufMgr;
+
+	private :
+
+		AccessType type;
+		// A ring per shard: frames, INVALID_FRAME until filled, and the
+		// slot to recycle next.
+		std::vector< std::vector<int> > rings;
+		std::vector<int> current;
+
+		AccessStrategy( AccessType type, int numOfShards, int ringSize );
+
+	public :
+
+		AccessType GetType() { return type; }
+};
 
 class BufMgr 
 {
 	private:
 
-		HashTable *hashTable;
+		struct Shard
+		{
+			std::mutex mutex;        // guards everything below and the
+			                         // state of the shard's frames
+			int firstFrame;
+			int numOfFrames;
+			HashTable *hashTable;    // page id to frame of the shard
+			Replacer *replacer;      // over frames 0..numOfFrames-1
+
+			// Frames each type of access took from the pool and
+			// recycled from its own ring.
+			long framesTaken[NUM_ACCESS_TYPES];
+			long framesRecycled[NUM_ACCESS_TYPES];
+
+			// Victims that held a page, clean and dirty, and those of
+			// the clean ones the background writer had written.
+			long cleanEvictions;
+			long dirtyEvictions;
+			long aheadEvictions;
+
+			int writerCursor;        // where the background writer
+			                         // sweeps on if the policy cannot
+			                         // name its next victims
+
+			std::vector<int> pendingReads;   // frames Prefetch is
+			                                 // reading into
+
+			// For GetMetrics, which reads them without the mutex.
+			struct Counter : std::atomic<long>
+			{
+				Counter() : std::atomic<long>(0) {}
+				void Add( long n = 1 ) { fetch_add(n, std::memory_order_relaxed); }
+			};
+			Counter pins[METRICS_MAX_FILES][METRICS_MAX_TYPES];
+			Counter misses[METRICS_MAX_FILES][METRICS_MAX_TYPES];
+			Counter cleanEvicted, dirtyEvicted, aheadEvicted;
+			Counter lockWaits, latchWaits, readWaits;
+			Counter reads, readNanos, prefetches;
+			Counter linksFollowed, linksMissed;
+			Counter pinHolds[PIN_HOLD_BUCKETS];
+		};
+
+		struct View
+		{
+			ClockFrame **frames;
+			std::atomic<AccessStrategy *> *ringOf;
+			std::vector<HashTable *> hashTables;   // of each shard
+		};
+
+		// Pins and misses of the metrics when ResetStat was last called.
+		long statPins;
+		long statMisses;
+
+		FrameArena *arena;
 		ClockFrame **frames;
-		Replacer *replacer;
-		int   numOfBuf;
+		std::atomic<int> numOfBuf;
+		Shard *shards;
+		int   numOfShards;
+		std::string policyName;
+
+		// The frames, ringOf and page tables above, for lock-free pins,
+		// and those Resize replaced.
+		std::atomic<View *> view;
+		std::vector<View *> oldViews;
+		std::mutex resizeMutex;               // one Resize at a time
+
+		// True if the policy lets hits on pages in the pool be pinned,
+		// and those pins be dropped, without the lock of the shard.
+		bool  lockFreeHits;
+
+		// Ring the page in each frame was read into, if any.
+		std::atomic<AccessStrategy *> *ringOf;
+
+		// The read Prefetch started into each frame, and whether it is
+		// still to be completed.  Until it is, the frame is claimed, and
+		// its page is in the page table.
+		IORequest *reads;
+		bool *readPending;
+		std::atomic<long> prefetched;
+
+		// Writes of dirty pages, and pages written: runs of adjacent
+		// pages go out as one write.
+		std::atomic<long> writeCalls;
+		std::atomic<long> pagesWritten;
+
+		// The same and the time they took, never reset, for GetMetrics.
+		std::atomic<long> totalWrites;
+		std::atomic<long> totalPagesWritten;
+		std::atomic<long> writeNanos;
+
+		// Files registered for metrics, and their page typers.  Entry 0
+		// is for pins outside any MetricsScope.
+		std::mutex metricsMutex;             // guards registration
+		std::atomic<int> numOfMetricsFiles;
+		std::string metricsFileNames[METRICS_MAX_FILES];
+		PageTyper pageTypers[METRICS_MAX_FILES];
+
+		// The background writer.  cleaning counts the CleanAhead calls
+		// under way, whose claimed pages FindFrame may have to wait
+		// out, and Resize waits for; none starts while resizing.
+		std::thread writer;
+		std::mutex writerMutex;              // guards the fields below
+		std::condition_variable writerWake;  // stop, or a dirty eviction
+		std::condition_variable writerIdle;  // a CleanAhead call done
+		bool writerRunning;
+		bool writerStop;
+		bool writerKicked;
+		int cleaning;
+		bool resizing;
+		long cleaned;                        // CleanAhead calls finished
+		int cleanPercent;
+		int writerInterval;                  // in milliseconds
+
+		// The hot set keeper, which loads the hot set and then saves it
+		// every hotSetInterval ms and when it stops.
+		std::thread keeper;
+		std::mutex keeperMutex;              // guards the fields below
+		std::condition_variable keeperWake;  // stop
+		bool keeperRunning;
+		bool keeperStop;
+		std::string hotSetFile;
+		DB *hotSetDB;                        // MINIBASE_DB when it started
+		int hotSetInterval;                  // in milliseconds
+		std::atomic<long> warmed;            // pages LoadHotSet read in
+
+		FILE *traceFile;  // gets the id of every page pinned, if set;
+		                  // set it while no other thread uses the pool
+
+		// Pins held by guards, by the site that made them, while pin
+		// tracking is on.  Guards pinned with tracking on are counted
+		// out even if it has been turned off since.
+		std::atomic<bool> pinTracking;
+		std::mutex pinSitesMutex;            // guards pinSites
+		std::map<std::string, int> pinSites;
+
+		Shard& ShardOf( PageID pid ) { return shards[(unsigned int)pid % numOfShards]; }
+		int FindFrame( Shard& shard, PageID pid );
+		int GetVictim( Shard& shard, AccessStrategy *strategy, bool& recycled );
+		int ClaimVictim( Shard& shard, AccessStrategy *strategy, bool& recycled );
+		void AddToRing( Shard& shard, AccessStrategy *strategy, int frameNo );
+		bool InRing( Shard& shard, AccessStrategy *strategy, int frameNo );
+		Status CompleteRead( Shard& shard, int frameNo );
+		void CompleteReads( Shard& shard, bool wait );
+		Status Pin( PageID pid, Page*& page, bool emptyPage,
+					AccessStrategy *strategy, ClockFrame*& frame );
+		void SumPins( long& pins, long& misses );
+		void CountPin( Shard& shard, PageID pid, Page *page, bool miss );
+		void CountUnpin( Shard& shard, ClockFrame *frame );
+		Status FlushFrame( int frameNo );
+		Status WriteFrames( const std::vector<int>& frameNos );
+		int PinDirtyNeighbour( PageID pid );
+		Status WriteVictim( int frameNo );
+		void RunBackgroundWriter();
+		void KickBackgroundWriter();
+		void WaitForWriter( int frameNo );
+		void CountEviction( Shard& shard, ClockFrame *frame, bool dirty );
+		bool ClaimToDrop( Shard& shard, int n, const std::vector<int>& victims,
+						  std::vector<int>& claimed );
+		void Renumber( int newNumOfBuf, const std::vector<int>& dropped,
+					   const std::vector< std::vector<int> >& victims );
+		Status ReadHotSet( const char *fileName, DB *db );
+		bool WarmPage( PageID pid, Page *data, long written );
+		bool KeeperStopping();
+		void RunHotSetKeeper( bool reload );
+		void TrackPin( PinGuard& guard, PageID pid, Page *page,
+					   ClockFrame *frame, const char *site );
+		Status ReleaseGuard( PinGuard& guard, bool free );
 
-		int FindFrame( PageID pid );
-		long totalCall;
-		long totalHit;
+		friend class PinGuard;
 
 	public:
 
-		BufMgr( int bufsize );
+		BufMgr( int bufsize, const char *replacementPolicy = "Clock",
+				int numOfShards = 0, HugePages hugePages = HUGE_PAGES_TRANSPARENT );
 		~BufMgr();      
-		Status PinPage( PageID pid, Page*& page, bool emptyPage=false );
+		Status PinPage( PageID pid, Page*& page, bool emptyPage=false,
+						AccessStrategy *strategy=NULL );
 		Status UnpinPage( PageID pid, bool dirty=false );
+
+		// Pin a page and latch it in mode, then unlatch and unpin it.
+		// The latch is taken after the pin, so waiting for it blocks
+		// no one else's pins.
+		Status PinPage( PageID pid, Page*& page, LatchMode mode );
+		Status UnpinPage( PageID pid, bool dirty, LatchMode mode );
+
+		// Pins through swizzled links (see Frame::SetLink).  PinPage
+		// also gives the frame of the page.  PinChild pins pid, a page
+		// the page pinned in parent links to, through parent's link to
+		// it if that still holds, without the page table, and sets the
+		// link otherwise.  UnpinFrame unpins the page in frame, without
+		// the page table.  A page pinned through a link stays in any
+		// scan's ring it was read into.
+		Status PinPage( PageID pid, Page*& page, ClockFrame*& frame );
+		Status PinChild( ClockFrame *parent, PageID pid, Page*& page,
+						 ClockFrame*& frame );
+		Status UnpinFrame( ClockFrame *frame, bool dirty=false );
+
+		// The same into a PinGuard, which unpins the page when it goes
+		// out of scope.  site names the caller, PIN_SITE, for
+		// ReportPins; the guard is left empty if the pin fails.
+		Status PinPage( PageID pid, PinGuard& guard, const char *site = NULL,
+						AccessStrategy *strategy = NULL );
+		Status PinChild( ClockFrame *parent, PageID pid, PinGuard& guard,
+						 const char *site = NULL );
+		Status NewPage( PageID& pid, PinGuard& guard, const char *site = NULL );
+
+		// Pin pid, a page the caller has allocated from the database
+		// itself, as NewPage pins the page it allocates: without reading
+		// it, its contents undefined.
+		Status PinNewPage( PageID pid, PinGuard& guard, const char *site = NULL );
+
+		// Count the pins guards hold by site, for finding pins that are
+		// never dropped.  ReportPins writes the sites that hold any, one
+		// per line with their count.
+		void   SetPinTracking( bool on ) { pinTracking = on; }
+		void   ReportPins( std::ostream& out );
+		int    GetNumOfTrackedPins();
+
+		// Start reading the pages into unpinned frames, without waiting
+		// for the reads or for dirty victims to be written, so that
+		// pinning them later does not wait as long.  Pages already in
+		// the pool, and those there is no clean frame for, are skipped.
+		Status Prefetch( const PageID *pids, int n, AccessStrategy *strategy=NULL );
+
 		Status NewPage( PageID& pid, Page*& firstpage,int howmany=1 ); 
 		Status FreePage( PageID pid ); 
 		Status FlushPage( PageID pid );
 		Status FlushAllPages();
-		Status  GetStat(long& pinNo, long& missNo) { pinNo = totalCall; missNo = totalCall-totalHit; return OK;}
-		void   ResetStat() { totalHit = 0; totalCall = 0; }
+		Status GetStat( long& pinNo, long& missNo );
+		void   ResetStat();
+		void   GetStrategyStat( AccessType type, long& taken, long& recycled );
+		void   GetWriteStat( long& writes, long& pages );
+		void   GetEvictionStat( long& clean, long& dirty, long& cleanedAhead );
+		void   GetSwizzleStat( long& followed, long& missed );
+		long   GetPrefetchStat() { return prefetched; }
+		long   GetWarmStat() { return warmed; }
+		void   GetMemoryStat( long& bytes, long& reservedBytes )
+			{ arena->GetStat(bytes, reservedBytes); }
+
+		// A snapshot of the metrics, read without taking any lock.
+		void   GetMetrics( BufMetrics& metrics );
+
+		// Register a file by name, or find it if it is registered,
+		// for MetricsScope.  typer returns a type below
+		// METRICS_OTHER_TYPE for the pages it recognizes.  Returns the
+		// file number, 0 if METRICS_MAX_FILES are registered.
+		int    RegisterMetricsFile( const char *name, PageTyper typer );
+		const char *GetMetricsFileName( int fileNo );
+
+		// Start a thread that writes the dirty pages among the next
+		// cleanPercent percent of each shard's victims, every intervalMs
+		// and whenever a miss had to write its victim itself.
+		Status StartBackgroundWriter( int cleanPercent = 10, int intervalMs = 10 );
+		void   StopBackgroundWriter();
+
+		// One round of the background writer.
+		Status CleanAhead();
+
+		// Write the ids of the pages in the pool to fileName, hottest
+		// first as the policies see it.
+		Status SaveHotSet( const char *fileName );
+
+		// Read the hottest pages listed in fileName, as many as there
+		// are frames, into frames that are free, in page id order.
+		// Pages already in the pool are skipped, and so are pages of a
+		// shard with no free frame left.  FAIL if there is no such file.
+		Status LoadHotSet( const char *fileName )
+			{ return ReadHotSet(fileName, MINIBASE_DB); }
+
+		// Start a thread that loads the hot set from fileName if reload,
+		// then saves it there every intervalMs and when it is stopped,
+		// by StopHotSetKeeper or the BufMgr being deleted.
+		Status StartHotSetKeeper( const char *fileName, bool reload,
+								  int intervalMs = HOT_SET_INTERVAL );
+		void   StopHotSetKeeper();
+		void   SetTraceFile( FILE *file ) { traceFile = file; }
+
+		AccessStrategy *GetAccessStrategy( AccessType type );
+		void FreeAccessStrategy( AccessStrategy *strategy );
+
+		// Grow the pool to newNumOfBuf frames, or shrink it, writing and
+		// evicting pages to free the frames it gives up.  The pool stays
+		// in use meanwhile, though pins that miss wait.  Fails, leaving
+		// the pool as it was, if too many pages are pinned to shrink it
+		// or there would be fewer frames than shards.
+		Status Resize( int newNumOfBuf );
 
 		unsigned int GetNumOfBuffers();
 		unsigned int GetNumOfUnpinnedBuffers();
+		int GetNumOfShards() { return numOfShards; }
 };
 
 
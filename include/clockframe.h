@@ -7,14 +7,14 @@ class ClockFrame : public Frame
 {
 	private :
 		
-		bool referenced;
+		std::atomic<bool> referenced;   // set by lock-free unpins too
 
  	public :
 
 		ClockFrame();
 		~ClockFrame();
 	
-		void Unpin();
+		int Unpin();
 		Status Free();
 		void UnsetReferenced();
 		bool IsReferenced();
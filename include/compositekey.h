@@ -0,0 +1,54 @@
+#ifndef _COMPOSITE_KEY_H
+#define _COMPOSITE_KEY_H
+
+#include "minirel.h"
+#include "tuple.h"
+#include "btfile.h"
+
+/*
+ * CompositeKey turns the leading fields of a Tuple into a single
+ * B+-tree key whose byte order is the order of the fields, compared
+ * left to right.  The schema is the same (types, strSizes) pair that
+ * Tuple::setHdr takes.
+ *
+ * Encoded keys are ordinary '\0' terminated strings, so they go through
+ * KeyCmp/BTreeFile::Insert unchanged:
+ *
+ *   - attrInteger and attrReal fields are mapped to an unsigned 32 bit
+ *     value with the same order and written as five bytes of seven
+ *     bits each, high bit always set.
+ *   - attrString fields are written byte by byte, with 0x01 and 0x02
+ *     escaped as 0x02 0x02 and 0x02 0x03, and terminated by 0x01 so
+ *     that a string sorts before all of its extensions.
+ *   - attrNull fields take no space.
+ *
+ * Since every field is self delimiting, the encoding of the first n
+ * fields is a prefix of the encoding of the whole tuple; OpenPrefixScan
+ * uses that to answer an equality predicate on the leading columns with
+ * one index range scan.
+ */
+
+class CompositeKey {
+
+public:
+
+	CompositeKey(Status& status, short numFlds, AttrType types[],
+		short strSizes[] = 0);
+	~CompositeKey();
+
+	Status MakeKey(Tuple *tuple, char *key);
+	Status MakePrefix(Tuple *tuple, short numPrefixFlds, char *key);
+
+	IndexFileScan *OpenPrefixScan(BTreeFile *btf, Tuple *tuple,
+		short numPrefixFlds);
+
+private:
+
+	short     numFlds;
+	AttrType *types;
+	short    *strSizes;   // per field, 0 for non-string fields
+
+	static void EncodeUnsigned(unsigned int value, char *&p);
+};
+
+#endif
@@ -8,8 +8,14 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
 
 #include "page.h"
+#include "aio.h"
 
 // Each database is basically a UNIX file and consists of several relations
 // (viewed as heapfiles and their indexes) within it.
@@ -59,8 +65,19 @@ class DB {
     // Write the contents of the specified page.
     Status WritePage(PageID pageno, Page* pageptr);
 
+    // Start reads and writes of whole pages without waiting for them,
+    // and wait for one to finish.  See aio.h.
+    Status SubmitIO(IORequest** requests, int count);
+    Status WaitIO(IORequest* request);
+    bool IsIODone(IORequest* request);
+
+    // Name of the async I/O backend in use, "uring" or "threads".
+    const char* GetIOBackend();
+
     // Allocate a set of pages where the run size is taken to be 1 by default.
-    // Gives back the page number of the first page of the allocated run.
+    // Gives back the page number of the first page of the allocated run:
+    // the start of the shortest free run that is long enough, the lowest
+    // of those if there are several.
     Status AllocatePage(PageID& start_page_num, int run_size = 1);
 
     // Deallocate a set of pages starting at the specified page number and
@@ -92,12 +109,21 @@ class DB {
     // pages of the db are currently allocated.
     Status dump_space_map();
 
+    // Pages free, the runs of consecutive free pages they make, and
+    // the length of the longest run.
+    void GetFreeExtentStat(int& freePages, int& numExtents, int& longest);
+
 	//modified by Mingsheng Hong 06.10.22
 	//unpin the header page of the B+ tree that manages database catalog.
 	Status DestroyCatalogBTree();
 
   private:
     int fd;
+    AsyncIO *aio;
+
+    // Serializes the space map and the directory between threads.  Page
+    // reads and writes go through pread/pwrite and need no lock.
+    std::recursive_mutex lock;
     unsigned num_pages;
     char* name;
 
@@ -148,6 +174,22 @@ class DB {
       // Set runsize bits starting from start to value specified
     Status set_bits( PageID start, unsigned runsize, int bit );
 
+      /* The free pages of the space map, as extents of consecutive free
+         pages, by first page and by length, kept in step with the map
+         so that AllocatePage finds a run in O(log n) without reading
+         it.  They are built from the map when the database is opened.
+         If that fails, extentsBuilt is false and AllocatePage scans the
+         map instead, a word of it at a time.
+      */
+    std::map<PageID, unsigned> freeExtents;                 // first -> length
+    std::set< std::pair<unsigned, PageID> > extentsBySize;  // (length, first)
+    bool extentsBuilt;
+
+    Status build_free_extents();
+    Status scan_space_map( const std::function<bool(PageID, unsigned)>& visit );
+    void take_extent( PageID start, unsigned runsize );
+    void add_extent( PageID start, unsigned runsize );
+
       // Initializes the given directory page to contain no entries.
     void init_dir_page( directory_page* dp, unsigned used_bytes );
 };
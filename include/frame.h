@@ -1,27 +1,74 @@
 #ifndef FRAME_H
 #define FRAME_H
 
+#include <atomic>
+#include <shared_mutex>
+
 #include "page.h"
 
 #define INVALID_FRAME -1
 
+// How a caller holds the contents of a page it has pinned: shared to
+// read it, exclusive to change it.  The latch keeps other threads out
+// of the page, the pin keeps it in its frame.
+enum LatchMode { LATCH_NONE, LATCH_SHARED, LATCH_EXCLUSIVE };
+
+// pid, pinCount and dirty are atomic so that pages already in the pool
+// can be pinned and unpinned without the lock of their shard.  Whoever
+// holds that lock claims a frame before changing the page in it: the
+// pin count goes from what the claimer expects to CLAIMED, which a
+// lock-free pin never gets past, and the page id is then safe to
+// change.  A lock-free pin checks the page id after it is in, so it
+// cannot hold on to a frame that was emptied or refilled under it.
+
+#define CLAIMED -1
+
+// One in PIN_HOLD_SAMPLE frames going from no pins to one is timed, for
+// the pin hold times of the buffer pool's metrics; reading the clock
+// on every pin would cost as much as the pin.
+#define PIN_HOLD_SAMPLE 64
+
+// The frame of a page that links to others, like an index node, can
+// keep swizzled links to the frames of those pages: SWIZZLE_SLOTS frame
+// pointers, by page id modulo SWIZZLE_SLOTS, the later link taking the
+// slot.  Frames last as long as the pool, so a link never dangles; one
+// whose frame went to another page fails TryPin, and is set again.
+// The links of a page go when it leaves its frame.
+#define SWIZZLE_SLOTS 128
+
 class Frame 
 {
 	private :
 	
-		PageID pid;
-		Page   *data;
-		int    pinCount;
-		bool    dirty;
+		std::atomic<PageID> pid;
+		Page   *data;                 // in the FrameArena's memory
+		std::atomic<int> pinCount;
+		std::atomic<bool> dirty;
+		std::atomic<bool> cleanedAhead;   // last written by the
+		                                  // background writer
+		std::shared_mutex latch;
+		std::atomic<long> pinnedAt;   // steady_clock time, in ns, of
+		                              // the pin that took it from 0,
+		                              // 0 if that one was not timed
+		std::atomic<std::atomic<Frame *> *> links;   // NULL until the
+		                                             // first SetLink
+
+		void StampPin();
 
 	public :
 		
 		Frame();
 		~Frame();
 		void Pin();
-		void Unpin();
+		bool TryPin(PageID pid);
+		int Unpin();
+		bool Claim(int pins);
+		void Release(int pins);
 		void EmptyIt();
 		void DirtyIt();
+		void CleanIt();
+		void MarkCleanedAhead();
+		bool WasCleanedAhead();
 		void SetPageID(PageID pid);
 		bool IsDirty();
 		bool IsValid();
@@ -29,9 +76,26 @@ class Frame
 		Status Read(PageID pid);
 		Status Free();
 		bool NotPinned();
+		bool IsClaimed();
 		bool HasPageID(PageID pid);
 		PageID GetPageID();
 		Page *GetPage();
+		void SetPage(Page *page);
+
+		// The swizzled link of the page in this frame to pid, which may
+		// be in another frame by now; NULL if there is none.  Only while
+		// the frame is pinned.
+		Frame *GetLink(PageID pid);
+		void SetLink(PageID pid, Frame *frame);
+
+		void Latch(LatchMode mode);
+		void Unlatch(LatchMode mode);
+		bool TryLatchShared();
+		bool TryLatch(LatchMode mode);
+
+		// Nanoseconds since the frame went from no pins to one, -1 if
+		// that pin was not timed.
+		long HeldFor();
 
 };
 
@@ -1,74 +1,53 @@
 #ifndef _HASH_H
 #define _HASH_H
 
+#include <atomic>
+#include <stdint.h>
+
 #include "minirel.h"
 #include "frame.h"
 
-#define NUM_OF_BUCKETS 21
-#define HASH(k)  k % NUM_OF_BUCKETS
-
-	
-class Map
-{
-	friend class MapIterator;
-
-private :
-
-	int pid;
-	int frameNo;
-	class Map *next;
-	class Map *prev;
-
-public :
-	
-	Map(PageID p, int f);
-	~Map();
-	void AddBehind(Map *m);
-	void DeleteMe();
-	bool HasPageID(PageID p);
-	int FrameNo();
-
-};
+// The page table is open addressed: (page id, frame) entries live in
+// cache-line-aligned buckets of PAGE_TABLE_BUCKET_SIZE, a page id hashes
+// to a bucket and probing runs on through the following entries.  The
+// table is sized to at least twice the number of frames, so it is never
+// more than half full and nothing is allocated after construction.
+//
+// Insert, Delete and EmptyIt need the caller to keep other writers out,
+// but LookUp may run alongside them: each entry is one atomic word.  A
+// LookUp racing with a Delete can miss a page that is there, as the
+// Delete shifts entries back, or return a frame the page has just left,
+// so a caller without the lock must check the frame and fall back to a
+// locked LookUp if it comes up empty.
 
+#define CACHE_LINE_SIZE 64
+#define PAGE_TABLE_BUCKET_SIZE 8
 
-class MapIterator
-{
-	Map *head;
-	Map *current;
 
-public :
-
-	MapIterator(Map *maps);
-	Map* operator() ();
-
-};
-
-
-class Bucket
+class HashTable
 {
 private:
 
-	Map *maps;
+	// The page id in the high half, INVALID_PAGE if the entry is free,
+	// and the frame number in the low half.
+	typedef std::atomic<uint64_t> Entry;
 
-public :
+	static uint64_t MakeEntry(PageID pid, int frameNo)
+		{ return ((uint64_t)(uint32_t)pid << 32) | (uint32_t)frameNo; }
+	static PageID PidOf(uint64_t entry) { return (PageID)(entry >> 32); }
+	static int FrameOf(uint64_t entry) { return (int)(uint32_t)entry; }
 
-	Bucket();
-	~Bucket();
-	void Insert(PageID pid, int frameNo);
-	Status Delete(PageID pid);
-	int Find(PageID pid);
-	void EmptyIt();
-};
-
-
-class HashTable
-{
-private:
+	char *space;        // what was allocated; entries is aligned in it
+	Entry *entries;
+	unsigned int mask;  // number of entries - 1, a power of two - 1
+	int shift;          // 32 - log2 of the number of buckets
 
-	Bucket buckets[NUM_OF_BUCKETS];
+	unsigned int Home(PageID pid);
 
 public :
 
+	HashTable(int numOfFrames = NUMBUF);
+	~HashTable();
 	void Insert(PageID pid, int frameNo);
 	Status Delete(PageID pid);
 	int LookUp(PageID pid);
@@ -76,4 +55,4 @@ public :
 };
 
 
-#endif
\ No newline at end of file
+#endif
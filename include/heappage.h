@@ -35,15 +35,21 @@ protected :
 	PageID  nextPage;    // Page ID of the next page in a link list.
 	PageID  prevPage;    // Page ID of the prev page in a link list.
 
-	Slot    slots[1];    // Slots for the page.  May grow towards
+	union {
+	Slot    slots[1 + HEAPPAGE_DATA_SIZE / sizeof(Slot)];
+	                     // Slots for the page.  May grow towards
 	                     // the end of a page.  (May overflow into
-			     // the data area.)
-
+			     // the data area.)  Declared over both so
+			     // the compiler does not assume one slot.
+	struct {
+	Slot    firstSlot;
 	char data[HEAPPAGE_DATA_SIZE];
 
 	                     // Data area for this page.  Actual records
 			     // grows from the back towards to start of 
 			     // a page. 
+	};
+	};
 
 	void CompactSlotDir();
 
@@ -14,8 +14,8 @@ using namespace std;
 
 enum AttrType {
     attrString,
- //   attrInteger,
- //   attrReal,
+    attrInteger,
+    attrReal,
  //   attrSymbol,
 	//attrFoo,
     attrNull
@@ -0,0 +1,84 @@
+#ifndef _PAGEGUARD_H
+#define _PAGEGUARD_H
+
+#include <utility>
+
+#include "page.h"
+
+class BufMgr;
+class ClockFrame;
+
+// A pin of a page in the buffer pool, dropped when the guard goes out
+// of scope: the page is unpinned, dirty if SetDirty was called.  Guards
+// move but do not copy, so a pin has one owner wherever it is passed,
+// and every way out of the owner unpins it.  BufMgr::PinPage and
+// NewPage pin pages into guards; PageGuard<T> gives the page as a T.
+
+class PinGuard
+{
+	protected :
+
+		BufMgr *pool;            // NULL while no page is pinned
+		PageID pid;
+		Page *page;
+		ClockFrame *frame;
+		bool dirty;
+		const char *site;        // where it was pinned, if tracked
+
+		friend class BufMgr;
+
+	public :
+
+		PinGuard() : pool(NULL), pid(INVALID_PAGE), page(NULL), frame(NULL),
+					 dirty(false), site(NULL) {}
+		PinGuard( PinGuard&& other ) noexcept;
+		PinGuard& operator=( PinGuard&& other ) noexcept;
+		PinGuard( const PinGuard& ) = delete;
+		PinGuard& operator=( const PinGuard& ) = delete;
+		~PinGuard() { Unpin(); }
+
+		// Unpin the page now; OK if there is none.
+		Status Unpin();
+
+		// Free the page, which drops the pin.
+		Status Free();
+
+		void SetDirty() { dirty = true; }
+		bool IsPinned() const { return pool != NULL; }
+		PageID GetPageID() const { return pid; }
+		ClockFrame *GetFrame() const { return frame; }
+};
+
+
+template <class T>
+class PageGuard : public PinGuard
+{
+	public :
+
+		PageGuard() {}
+		PageGuard( PageGuard&& other ) noexcept : PinGuard(std::move(other)) {}
+		PageGuard& operator=( PageGuard&& other ) noexcept
+		{
+			PinGuard::operator=(std::move(other));
+			return *this;
+		}
+
+		T *Get() const { return (T *)page; }
+		T *operator->() const { return (T *)page; }
+};
+
+
+// The file and line of a pin, for BufMgr::SetPinTracking.
+#define PIN_SITE_LINE(line)  #line
+#define PIN_SITE_AT(line)    PIN_SITE_LINE(line)
+#define PIN_SITE             __FILE__ ":" PIN_SITE_AT(__LINE__)
+
+// PIN, NEWPAGE and FREEPAGE of heappage.h, for guards.
+#define PIN_GUARD(a, b)      if (MINIBASE_BM->PinPage((a), (b), PIN_SITE) != OK) {\
+						cerr << "Unable to pin page " << a << endl; return FAIL;}
+#define NEWPAGE_GUARD(a, b)  if (MINIBASE_BM->NewPage((a), (b), PIN_SITE) != OK) {\
+						cerr << "Unable to allocate new page " << a << endl; return FAIL;}
+#define FREE_GUARD(a)        if ((a).Free() != OK) {\
+						cerr << "Unable to free page" << endl; return FAIL;}
+
+#endif // _PAGEGUARD_H
@@ -1,28 +1,245 @@
+#ifndef _REPLACER_H
+#define _REPLACER_H
+
+#include <list>
+#include <set>
+#include <vector>
+#include <unordered_map>
+
 #include "clockframe.h"
 #include "hash.h"
 
-class Replacer 
+// A replacement policy.  BufMgr tells it about every pin and about
+// pages that leave the pool other than through PickVictim; PickVictim
+// hands back an empty frame, or an unpinned one whose page the policy
+// has already forgotten or moved to its history.
+
+class Replacer
 {
 	public :
 
 		Replacer();
-		~Replacer();
+		virtual ~Replacer();
 
 		virtual int PickVictim() = 0;
+
+		// pid has just been pinned in frameNo, hit or miss.
+		virtual void PageAccessed(int frameNo, PageID pid) {}
+
+		// False if PageAccessed need not hear about hits, which BufMgr
+		// can then pin without locking the policy.
+		virtual bool WantsHits() { return true; }
+
+		// The page in frameNo was freed, never made it in, or was dropped
+		// by BufMgr itself to recycle the frame.
+		virtual void PageFreed(int frameNo) {}
+
+		// Add to frameNos up to n frames of unpinned pages, those
+		// PickVictim would take first, first, without changing anything.
+		// Adds none if the policy cannot tell, when the background
+		// writer sweeps the frames in order instead.
+		virtual void NextVictims(int n, std::vector<int>& frameNos) {}
+
+		// Make the policy named name ("Clock", "LRU2", "2Q", "ARC" or
+		// "ClockPro"), NULL if there is no such policy.
+		static Replacer *Create(const char *name, int bufSize,
+								ClockFrame **frames, HashTable *hashTable);
 };
 
 class Clock : public Replacer
 {
 	private :
-		
+
 		int current;
 		int numOfBuf;
 		ClockFrame **frames;
 		HashTable *hashTable;
 
 	public :
-		
+
 		Clock( int bufSize, ClockFrame **frames, HashTable *hashTable );
 		~Clock();
 		int PickVictim();
-};
\ No newline at end of file
+		void NextVictims( int n, std::vector<int>& frameNos );
+
+		// The reference bit is set by ClockFrame::Unpin.
+		bool WantsHits() { return false; }
+};
+
+
+// Frames that hold no page, for the policies that keep their own lists
+// of resident pages.
+
+class FreeFrames
+{
+	private :
+
+		std::vector<int> frameNos;
+		std::vector<bool> isFree;
+
+	public :
+
+		FreeFrames( int bufSize );
+		void Add( int frameNo );
+		void Remove( int frameNo );
+		int Take();
+};
+
+
+// LRU-2: evict the page whose second most recent access is oldest.
+// Pages seen once go first, so a scan cannot push out pages that are
+// used again and again.  Access times of evicted pages are kept for as
+// many pages as there are frames.
+
+class LRU2 : public Replacer
+{
+	private :
+
+		// (previous, last): times of the two most recent accesses,
+		// previous -1 for a page seen once.  Ordered victim first.
+		typedef std::pair<long, long> History;
+		typedef std::set< std::pair<History, int> > Queue;
+
+		int numOfBuf;
+		ClockFrame **frames;
+		long now;
+		FreeFrames freeFrames;
+		std::vector<History> history;     // of the page in each frame
+		std::vector<bool> resident;
+		Queue queue;                      // resident pages, victim first
+		std::list<PageID> retainedOrder;  // oldest first
+		std::unordered_map<PageID, std::pair<History,
+			std::list<PageID>::iterator> > retained;
+
+		void Retain( PageID pid, const History& h );
+
+	public :
+
+		LRU2( int bufSize, ClockFrame **frames );
+		int PickVictim();
+		void NextVictims( int n, std::vector<int>& frameNos );
+		void PageAccessed( int frameNo, PageID pid );
+		void PageFreed( int frameNo );
+};
+
+
+// 2Q: pages seen once go through a small FIFO, A1in.  A page evicted
+// from it is remembered in A1out, and only a page found there when it
+// is read again enters the main LRU list, Am.
+
+class TwoQ : public Replacer
+{
+	private :
+
+		enum Where { NOWHERE, A1IN, AM };
+
+		int numOfBuf;
+		ClockFrame **frames;
+		int kIn;       // target size of A1in
+		int kOut;      // size of A1out
+		FreeFrames freeFrames;
+		std::list<int> a1in;              // frames, newest first
+		std::list<int> am;                // frames, most recent first
+		std::vector<Where> where;
+		std::vector<std::list<int>::iterator> position;
+		std::list<PageID> a1out;          // page ids, newest first
+		std::unordered_map<PageID, std::list<PageID>::iterator> inA1out;
+
+		int EvictFrom( std::list<int>& queue );
+
+	public :
+
+		TwoQ( int bufSize, ClockFrame **frames );
+		int PickVictim();
+		void NextVictims( int n, std::vector<int>& frameNos );
+		void PageAccessed( int frameNo, PageID pid );
+		void PageFreed( int frameNo );
+};
+
+
+// ARC: T1 holds pages seen once recently, T2 pages seen at least twice.
+// B1 and B2 remember pages evicted from each, and a hit in either moves
+// the target size of T1 towards the list that would have kept it.
+
+class ARC : public Replacer
+{
+	private :
+
+		enum Where { NOWHERE, T1, T2 };
+
+		typedef std::list<PageID> Ghosts;
+
+		int numOfBuf;
+		ClockFrame **frames;
+		int target;    // target size of T1, "p" in the paper
+		FreeFrames freeFrames;
+		std::list<int> t1, t2;            // frames, most recent first
+		std::vector<Where> where;
+		std::vector<std::list<int>::iterator> position;
+		Ghosts b1, b2;                    // page ids, most recent first
+		std::unordered_map<PageID, std::pair<Ghosts *, Ghosts::iterator> > ghosts;
+
+		int EvictFrom( std::list<int>& list, Ghosts& ghostList );
+		void DropGhost( Ghosts& ghostList );
+
+	public :
+
+		ARC( int bufSize, ClockFrame **frames );
+		int PickVictim();
+		void NextVictims( int n, std::vector<int>& frameNos );
+		void PageAccessed( int frameNo, PageID pid );
+		void PageFreed( int frameNo );
+};
+
+
+// CLOCK-Pro: one clock of hot and cold resident pages and of cold
+// pages recently evicted, which are in their test period.  A cold page
+// referenced again turns hot, and an evicted one that comes back while
+// still remembered comes back hot.  The hands for cold, hot and test
+// pages move around the clock, and the number of frames given to cold
+// pages adapts to how often evicted pages come back.
+
+class ClockPro : public Replacer
+{
+	private :
+
+		struct Entry
+		{
+			PageID pid;
+			int frameNo;      // INVALID_FRAME once evicted
+			bool hot;
+			bool referenced;
+		};
+
+		typedef std::list<Entry> Ring;
+
+		int numOfBuf;
+		ClockFrame **frames;
+		int coldTarget;   // frames for cold pages, "mc" in the paper
+		int numHot;
+		int numCold;      // resident cold pages
+		int numTest;      // evicted cold pages still remembered
+		FreeFrames freeFrames;
+		Ring ring;        // runs clockwise from begin() to end()
+		Ring::iterator handCold, handHot, handTest;
+		std::vector<bool> inRing;              // of each frame
+		std::vector<Ring::iterator> entryOf;   // of each frame in the ring
+		std::unordered_map<PageID, Ring::iterator> nonResident;
+
+		Ring::iterator Next( Ring::iterator it );
+		Ring::iterator Prev( Ring::iterator it );
+		void Remove( Ring::iterator it );
+		void RunHandCold();
+		void RunHandHot();
+		void RunHandTest();
+
+	public :
+
+		ClockPro( int bufSize, ClockFrame **frames );
+		int PickVictim();
+		void NextVictims( int n, std::vector<int>& frameNos );
+		void PageAccessed( int frameNo, PageID pid );
+		void PageFreed( int frameNo );
+};
+
+#endif // _REPLACER_H
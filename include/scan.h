@@ -13,6 +13,7 @@
 
 class HeapFile;
 class HeapPage;
+class AccessStrategy;
 
 class Scan
 {
@@ -37,6 +38,10 @@ private:
 	RecordID currRid;
 
 	bool noMore;
+
+	AccessStrategy *strategy;  // BULK_READ ring the data pages go through
+
+	void PrefetchAhead();
 };
 
 #endif
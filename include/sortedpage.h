@@ -8,21 +8,58 @@
 #include "bt.h"
 
 
+#define NODE_TYPE_MASK  0xFF
+
+
+// The records of a sorted page are in key order, and the packed
+// KeyPrefix of each record's key is kept, in the same order, in an
+// array that follows the slot directory.  A search ranks the key's
+// prefix among them, four or eight at a time where SSE2 or AVX2 is
+// there, and only compares keys whose prefixes tie with it.  Each
+// record takes PREFIX_SIZE bytes more for its prefix.
+
+#define PREFIX_SIZE  ((int)sizeof(unsigned int))
+
 class SortedPage : public HeapPage {
 	
 private:
 	
 	// No private variables should be declared.
+
+	unsigned int *Prefixes() { return (unsigned int *)&slots[numOfSlots]; }
+	int   KeyBound(const char *key, bool upper);
 	
 public:
 		
 	Status InsertRecord(char * recPtr, int recLen, RecordID& rid);	
 	Status DeleteRecord(const RecordID& rid);
+	Status ReleaseKeys();
+
+	int   LowerBound(const char *key);
+	int   UpperBound(const char *key);
 	
+	// The low byte of type is the NodeType; leaf pages keep their
+	// RidEncoding in the byte above it.
 	void  SetType(NodeType t)  { type = (short)t; }
 
-	NodeType GetType()         { return (NodeType)type; }
+	NodeType GetType()         { return (NodeType)(type & NODE_TYPE_MASK); }
 	int   GetNumOfRecords() { return numOfSlots; }
+
+	// The longest record that can be inserted, with its slot and prefix.
+	int   AvailableSpace()
+	{
+		int space = HeapPage::AvailableSpace() - PREFIX_SIZE;
+		return space > 0 ? space : 0;
+	}
+
+	// Room on the page: the bytes free, those the record in slot takes
+	// with its slot and prefix, and those a record of recLen would take.
+	// An empty page has EmptySpace() free.  A record starts with its key.
+	int   GetFreeSpace()            { return freeSpace; }
+	int   GetEntrySpace(int slot)   { return EntrySpace(slots[slot].length); }
+	char *GetEntryKey(int slot)     { return data + slots[slot].offset; }
+	static int EntrySpace(int recLen) { return recLen + (int)sizeof(Slot) + PREFIX_SIZE; }
+	static int EmptySpace()         { return HEAPPAGE_DATA_SIZE + (int)sizeof(Slot); }
 };
 
 #endif
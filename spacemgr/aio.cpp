@@ -0,0 +1,440 @@
+/*
+ * aio.cpp - asynchronous page I/O.
+ *
+ * The io_uring backend talks to the kernel through the system calls
+ * and the shared rings directly, without liburing.  Submitters take
+ * turns at the submission ring and never hold more than depth requests
+ * in flight, so the completion ring, twice that size, cannot overflow.
+ * One waiter at a time holds the completion ring and sleeps in the
+ * kernel for completions when there are none to reap; it marks every
+ * request it reaps done, so the others find theirs done when their
+ * turn comes.  The iovecs of a run of pages need only last until the
+ * kernel has taken the request (IORING_FEAT_SUBMIT_STABLE).
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <chrono>
+
+#include "aio.h"
+
+
+AsyncIO *AsyncIO::Create(int fd, int queueDepth, const char *backend)
+{
+	if (queueDepth < 1)
+		queueDepth = 1;
+
+	if (backend == NULL || strcmp(backend, "uring") == 0)
+	{
+		Status status;
+		UringIO *uring = new UringIO(fd, queueDepth, status);
+		if (status == OK)
+			return uring;
+		delete uring;
+		if (backend != NULL)
+			return NULL;
+	}
+	else if (strcmp(backend, "threads") != 0)
+	{
+		return NULL;
+	}
+
+	return new ThreadPoolIO(fd, queueDepth < AIO_MAX_THREADS ? queueDepth : AIO_MAX_THREADS);
+}
+
+
+//-------------------------------------------------------------------
+// UringIO::UringIO
+//
+// Input   : fd - the file to read and write.
+//           queueDepth - requests in flight at most.
+// Output  : status - OK if successful, FAIL if the kernel has no
+//                    io_uring, or one without IORING_OP_READ/WRITE.
+// Purpose : Set up a ring and map its submission queue, completion
+//           queue and submission entries.
+//-------------------------------------------------------------------
+
+UringIO::UringIO(int fd, int queueDepth, Status& status)
+	: inFlight(0)
+{
+	struct io_uring_params p;
+
+	this->fd = fd;
+	sqRing = cqRing = MAP_FAILED;
+	sqes = (struct io_uring_sqe *)MAP_FAILED;
+	status = FAIL;
+
+	memset(&p, 0, sizeof(p));
+	ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &p);
+	if (ringFd < 0)
+		return;
+	// Read and write opcodes came with the same kernel (5.6) as this
+	// flag, stable submissions with the one before.
+	if (!(p.features & IORING_FEAT_RW_CUR_POS))
+		return;
+	depth = p.sq_entries < (unsigned)queueDepth ? p.sq_entries : (unsigned)queueDepth;
+
+	sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (cqRingSize > sqRingSize)
+			sqRingSize = cqRingSize;
+		cqRingSize = sqRingSize;
+	}
+
+	sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				  ringFd, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED)
+		return;
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		cqRing = sqRing;
+	else
+	{
+		cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					  ringFd, IORING_OFF_CQ_RING);
+		if (cqRing == MAP_FAILED)
+			return;
+	}
+	sqes = (struct io_uring_sqe *)mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+									   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+									   ringFd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		return;
+
+	sqTail = (unsigned *)((char *)sqRing + p.sq_off.tail);
+	sqMask = (unsigned *)((char *)sqRing + p.sq_off.ring_mask);
+	sqArray = (unsigned *)((char *)sqRing + p.sq_off.array);
+	cqHead = (unsigned *)((char *)cqRing + p.cq_off.head);
+	cqTail = (unsigned *)((char *)cqRing + p.cq_off.tail);
+	cqMask = (unsigned *)((char *)cqRing + p.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)((char *)cqRing + p.cq_off.cqes);
+	sqEntries = p.sq_entries;
+
+	status = OK;
+}
+
+
+UringIO::~UringIO()
+{
+	if (sqes != MAP_FAILED)
+	{
+		// The kernel may still be writing into pages of requests in
+		// flight; let them finish.
+		std::lock_guard<std::mutex> guard(cqMutex);
+		while (inFlight > 0)
+			if (Reap() == 0)
+				Enter(0, 1, IORING_ENTER_GETEVENTS);
+		munmap(sqes, sqEntries * sizeof(struct io_uring_sqe));
+	}
+	if (cqRing != MAP_FAILED && cqRing != sqRing)
+		munmap(cqRing, cqRingSize);
+	if (sqRing != MAP_FAILED)
+		munmap(sqRing, sqRingSize);
+	if (ringFd >= 0)
+		close(ringFd);
+}
+
+
+// io_uring_enter, retried if a signal interrupts it.
+int UringIO::Enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+	int n;
+
+	do
+		n = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+	while (n < 0 && errno == EINTR);
+
+	return n;
+}
+
+
+//-------------------------------------------------------------------
+// UringIO::Reap
+//
+// Input   : None, cqMutex held.
+// Output  : None
+// Purpose : Mark every request on the completion ring done.
+// Return  : The number of requests reaped.
+//-------------------------------------------------------------------
+
+int UringIO::Reap()
+{
+	unsigned head = *cqHead;
+	unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	int n = 0;
+
+	// The requests were filled in by their submitters, maybe on other
+	// threads, before Submit counted them in flight.  Only the kernel
+	// orders their completion after that, so acquire inFlight to see
+	// them, as far as the language, and ThreadSanitizer, are concerned.
+	inFlight.load(std::memory_order_acquire);
+
+	for (; head != tail; head++, n++)
+	{
+		struct io_uring_cqe *cqe = &cqes[head & *cqMask];
+		IORequest *request = (IORequest *)(uintptr_t)cqe->user_data;
+		request->status = cqe->res == request->numPages * MINIBASE_PAGESIZE ? OK : FAIL;
+		request->done.store(true, std::memory_order_release);
+	}
+
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	inFlight -= n;
+	return n;
+}
+
+
+// Wait until fewer than depth requests are in flight.
+void UringIO::WaitForRoom()
+{
+	while (inFlight >= depth)
+	{
+		std::lock_guard<std::mutex> guard(cqMutex);
+		if (inFlight >= depth && Reap() == 0)
+			Enter(0, 1, IORING_ENTER_GETEVENTS);
+	}
+}
+
+
+//-------------------------------------------------------------------
+// UringIO::MakeRoom
+//
+// Input   : started - how many requests the kernel has and has not
+//                     completed yet.
+//           backoff - microseconds to sleep if there is nothing to
+//                     reap; doubled, up to a millisecond.
+// Output  : None
+// Purpose : The kernel took none of the queued entries: it is short of
+//           memory or its completion ring is full.  Reap completions,
+//           waiting in the kernel for one if none is there, so that it
+//           can go on; if it has none of ours to complete, back off.
+// Return  : None
+//-------------------------------------------------------------------
+
+void UringIO::MakeRoom(unsigned started, unsigned& backoff)
+{
+	if (started > 0)
+	{
+		std::lock_guard<std::mutex> guard(cqMutex);
+		if (Reap() == 0)
+			Enter(0, 1, IORING_ENTER_GETEVENTS);
+		return;
+	}
+
+	std::this_thread::sleep_for(std::chrono::microseconds(backoff));
+	if (backoff < 1000)
+		backoff *= 2;
+}
+
+
+//-------------------------------------------------------------------
+// UringIO::Submit
+//
+// Input   : requests - requests to start.
+//           count - how many.
+// Output  : None
+// Purpose : Queue a submission entry for each request and hand them
+//           to the kernel, depth at most at a time.
+// Return  : OK if successful, FAIL if the kernel refused them, when
+//           the requests not started are marked done and failed.
+//-------------------------------------------------------------------
+
+Status UringIO::Submit(IORequest **requests, int count)
+{
+	std::lock_guard<std::mutex> guard(sqMutex);
+	std::vector<struct iovec> iovs;
+	unsigned queued = 0;
+	unsigned backoff = 1;
+	size_t numIovs = 0;
+
+	for (int i = 0; i < count; i++)
+		if (requests[i]->numPages > 1)
+			numIovs += requests[i]->numPages;
+	iovs.reserve(numIovs);
+
+	for (int i = 0; i < count; i++)
+	{
+		WaitForRoom();
+
+		IORequest *request = requests[i];
+		unsigned tail = *sqTail;
+		unsigned index = tail & *sqMask;
+		struct io_uring_sqe *sqe = &sqes[index];
+
+		request->done.store(false, std::memory_order_relaxed);
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->fd = fd;
+		sqe->off = (uint64_t)request->pid * MINIBASE_PAGESIZE;
+		if (request->numPages == 1)
+		{
+			sqe->opcode = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+			sqe->addr = (uint64_t)(uintptr_t)request->page;
+			sqe->len = MINIBASE_PAGESIZE;
+		}
+		else
+		{
+			sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->addr = (uint64_t)(uintptr_t)(iovs.data() + iovs.size());
+			sqe->len = request->numPages;
+			for (int j = 0; j < request->numPages; j++)
+			{
+				struct iovec iov = { request->pages[j], MINIBASE_PAGESIZE };
+				iovs.push_back(iov);
+			}
+		}
+		sqe->user_data = (uint64_t)(uintptr_t)request;
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		inFlight++;
+		queued++;
+
+		// The ring is full, or this is the last: let the kernel have
+		// what is queued.
+		if (inFlight >= depth || i == count - 1)
+		{
+			while (queued > 0)
+			{
+				int n = Enter(queued, 0, 0);
+				if (n < 0 && errno != EAGAIN && errno != EBUSY)
+				{
+					// Take back what the kernel did not consume.
+					*sqTail -= queued;
+					inFlight -= queued;
+					for (int j = i - queued + 1; j < count; j++)
+					{
+						requests[j]->status = FAIL;
+						requests[j]->done.store(true, std::memory_order_release);
+					}
+					return FAIL;
+				}
+				if (n > 0)
+				{
+					queued -= n;
+					backoff = 1;
+				}
+				else
+					MakeRoom(inFlight - queued, backoff);
+			}
+		}
+	}
+
+	return OK;
+}
+
+
+void UringIO::Wait(IORequest *request)
+{
+	std::lock_guard<std::mutex> guard(cqMutex);
+
+	while (!IsDone(request))
+		if (Reap() == 0)
+			Enter(0, 1, IORING_ENTER_GETEVENTS);
+}
+
+
+// Someone waiting in the kernel reaps for everyone; no need to wait
+// for them.
+void UringIO::Poll()
+{
+	std::unique_lock<std::mutex> lock(cqMutex, std::try_to_lock);
+
+	if (lock.owns_lock())
+		Reap();
+}
+
+
+ThreadPoolIO::ThreadPoolIO(int fd, int numThreads)
+{
+	this->fd = fd;
+	stopping = false;
+	for (int i = 0; i < numThreads; i++)
+		workers.push_back(std::thread(&ThreadPoolIO::Run, this));
+}
+
+
+ThreadPoolIO::~ThreadPoolIO()
+{
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		stopping = true;
+	}
+	work.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+
+//-------------------------------------------------------------------
+// ThreadPoolIO::Run
+//
+// Input   : None
+// Output  : None
+// Purpose : The loop of a worker: take a request off the queue, do its
+//           I/O and mark it done, until the pool is stopped and the
+//           queue is empty.
+//-------------------------------------------------------------------
+
+void ThreadPoolIO::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;)
+	{
+		work.wait(lock, [this]() { return stopping || !queue.empty(); });
+		if (queue.empty())
+			return;
+
+		IORequest *request = queue.front();
+		queue.pop_front();
+		lock.unlock();
+
+		struct iovec iovs[AIO_MAX_RUN];
+		int numIovs = request->numPages < AIO_MAX_RUN ? request->numPages : AIO_MAX_RUN;
+		for (int i = 0; i < numIovs; i++)
+		{
+			iovs[i].iov_base = request->PageAt(i);
+			iovs[i].iov_len = MINIBASE_PAGESIZE;
+		}
+
+		off_t offset = (off_t)request->pid * MINIBASE_PAGESIZE;
+		ssize_t n = request->write ? pwritev(fd, iovs, numIovs, offset) :
+			preadv(fd, iovs, numIovs, offset);
+		request->status = n == (ssize_t)request->numPages * MINIBASE_PAGESIZE ? OK : FAIL;
+
+		lock.lock();
+		request->done.store(true, std::memory_order_release);
+		finished.notify_all();
+	}
+}
+
+
+Status ThreadPoolIO::Submit(IORequest **requests, int count)
+{
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		for (int i = 0; i < count; i++)
+		{
+			requests[i]->done.store(false, std::memory_order_relaxed);
+			queue.push_back(requests[i]);
+		}
+	}
+
+	if (count == 1)
+		work.notify_one();
+	else
+		work.notify_all();
+	return OK;
+}
+
+
+void ThreadPoolIO::Wait(IORequest *request)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	finished.wait(lock, [this, request]() { return IsDone(request); });
+}
@@ -0,0 +1,900 @@
+/*
+ * db.cpp - the DB class, a database kept in one Unix file.
+ *
+ * Page 0 holds the size of the database and the first directory page
+ * of file entries; more directory pages are chained from it as needed.
+ * Pages SPACE_MAP_START onwards hold the space map, one bit per page.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include "minirel.h"
+#include "db.h"
+
+
+static const char *dbErrMsgs[] = {
+	"Database is full",
+	"Duplicate file entry",
+	"Unix error",
+	"bad page number",
+	"File IO error",
+	"File not found",
+	"File name too long",
+	"Negative run size"
+};
+
+static error_string_table dbTable(DBMGR, dbErrMsgs);
+
+
+#define BITS_PER_PAGE   (MINIBASE_PAGESIZE * 8)
+
+
+// Word i of a space map page: bit k is the bit of its page 64 * i + k.
+// Put together a byte at a time, so it reads the same on any machine.
+static uint64_t MapWord(const unsigned char *map, int i)
+{
+	uint64_t word = 0;
+	for (int b = 7; b >= 0; b--)
+		word = (word << 8) | map[i * 8 + b];
+	return word;
+}
+
+
+//-------------------------------------------------------------------
+// DB::DB
+//
+// Input   : name - Unix file holding the database.
+//           num_pages - size of a new database, or 0 to open an
+//                       existing one.
+//           bCatalogBTree - unused; the catalog is not part of this
+//                           build.
+// Output  : status - OK if successful, DBMGR otherwise.
+// Purpose : Create (or open) the database file.
+//-------------------------------------------------------------------
+
+DB::DB(const char *name, unsigned num_pages, Status& status, bool bCatalogBTree)
+{
+	char buf[MINIBASE_PAGESIZE];
+	first_page *fp = (first_page *)buf;
+
+	this->name = strcpy(new char[strlen(name) + 1], name);
+	this->num_pages = num_pages;
+	btree = NULL;
+	heapFile = NULL;
+	aio = NULL;
+	_bCatalogBTree = false;
+	SPACE_MAP_START = 1;
+	extentsBuilt = false;
+	status = OK;
+
+	if (num_pages == 0)
+	{
+		fd = open(name, O_RDWR);
+		if (fd < 0)
+		{
+			status = MINIBASE_FIRST_ERROR(DBMGR, UNIX_ERROR);
+			return;
+		}
+		if (pread(fd, buf, MINIBASE_PAGESIZE, 0) != MINIBASE_PAGESIZE)
+		{
+			status = MINIBASE_FIRST_ERROR(DBMGR, FILE_IO_ERROR);
+			return;
+		}
+		this->num_pages = fp->num_db_pages;
+		aio = AsyncIO::Create(fd, AIO_QUEUE_DEPTH);
+
+		// Without the extents, AllocatePage scans the map.
+		build_free_extents();
+		return;
+	}
+
+	int numMapPages = (num_pages + BITS_PER_PAGE - 1) / BITS_PER_PAGE;
+	if ((int)num_pages < SPACE_MAP_START + numMapPages + 1)
+	{
+		fd = -1;
+		status = MINIBASE_FIRST_ERROR(DBMGR, DB_FULL);
+		return;
+	}
+
+	fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0 || ftruncate(fd, (off_t)num_pages * MINIBASE_PAGESIZE) != 0)
+	{
+		status = MINIBASE_FIRST_ERROR(DBMGR, UNIX_ERROR);
+		return;
+	}
+	aio = AsyncIO::Create(fd, AIO_QUEUE_DEPTH);
+
+	// The file starts out zeroed, so the space map says every page is
+	// free; mark page 0 and the space map itself as used.
+	memset(buf, 0, sizeof(buf));
+	fp->num_db_pages = num_pages;
+	init_dir_page(&fp->dir, (char *)&fp->dir.entries - buf);
+	if ((status = WritePage(0, (Page *)buf)) != OK)
+		return;
+
+	if ((status = set_bits(0, SPACE_MAP_START + numMapPages, 1)) == OK)
+		build_free_extents();
+}
+
+
+DB::~DB()
+{
+	delete aio;
+	if (fd >= 0)
+		close(fd);
+	delete [] name;
+}
+
+
+//-------------------------------------------------------------------
+// DB::Destroy
+//
+// Input   : None
+// Output  : None
+// Purpose : Close the database and remove its file.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::Destroy()
+{
+	delete aio;
+	aio = NULL;
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+
+	if (unlink(name) != 0)
+		return MINIBASE_FIRST_ERROR(DBMGR, UNIX_ERROR);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::ReadPage
+//
+// Input   : pageno - page to read.
+// Output  : pageptr - filled with the contents of the page.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::ReadPage(PageID pageno, Page *pageptr)
+{
+	if (pageno < 0 || pageno >= (int)num_pages)
+		return MINIBASE_FIRST_ERROR(DBMGR, BAD_PAGE_NO);
+
+	if (pread(fd, pageptr, MINIBASE_PAGESIZE,
+			  (off_t)pageno * MINIBASE_PAGESIZE) != MINIBASE_PAGESIZE)
+		return MINIBASE_FIRST_ERROR(DBMGR, FILE_IO_ERROR);
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::WritePage
+//
+// Input   : pageno - page to write.
+//           pageptr - the new contents of the page.
+// Output  : None
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::WritePage(PageID pageno, Page *pageptr)
+{
+	if (pageno < 0 || pageno >= (int)num_pages)
+		return MINIBASE_FIRST_ERROR(DBMGR, BAD_PAGE_NO);
+
+	if (pwrite(fd, pageptr, MINIBASE_PAGESIZE,
+			   (off_t)pageno * MINIBASE_PAGESIZE) != MINIBASE_PAGESIZE)
+		return MINIBASE_FIRST_ERROR(DBMGR, FILE_IO_ERROR);
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::SubmitIO
+//
+// Input   : requests - page reads and writes to start, of runs of at
+//                      most AIO_MAX_RUN pages.
+//           count - how many.
+// Output  : None
+// Purpose : Start the requests, to be waited for with WaitIO.  None is
+//           started if any page is out of the database.
+// Return  : OK if successful, DBMGR otherwise, when the requests that
+//           were not started are done and failed.
+//-------------------------------------------------------------------
+
+Status DB::SubmitIO(IORequest **requests, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		IORequest *r = requests[i];
+		if (r->pid < 0 || r->numPages < 1 || r->numPages > AIO_MAX_RUN ||
+			r->pid + r->numPages > (int)num_pages)
+		{
+			for (int j = 0; j < count; j++)
+			{
+				requests[j]->status = FAIL;
+				requests[j]->done = true;
+			}
+			return MINIBASE_FIRST_ERROR(DBMGR, BAD_PAGE_NO);
+		}
+	}
+
+	if (aio->Submit(requests, count) != OK)
+		return MINIBASE_FIRST_ERROR(DBMGR, FILE_IO_ERROR);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::WaitIO
+//
+// Input   : request - a request given to SubmitIO.
+// Output  : None
+// Purpose : Wait until the request is done.
+// Return  : OK if it succeeded, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::WaitIO(IORequest *request)
+{
+	if (!aio->IsDone(request))
+		aio->Wait(request);
+
+	if (request->status != OK)
+		return MINIBASE_FIRST_ERROR(DBMGR, FILE_IO_ERROR);
+	return OK;
+}
+
+
+// True if the request is done, and WaitIO will not block.
+bool DB::IsIODone(IORequest *request)
+{
+	if (!aio->IsDone(request))
+		aio->Poll();
+	return aio->IsDone(request);
+}
+
+
+const char *DB::GetIOBackend()
+{
+	return aio->GetName();
+}
+
+
+//-------------------------------------------------------------------
+// DB::AllocatePage
+//
+// Input   : run_size - number of consecutive pages wanted.
+// Output  : start_page_num - first page of the run.
+// Purpose : Take the shortest free run that is long enough, the
+//           lowest of those if there are several, and mark it used.
+//           Best fit keeps the long runs whole for the callers that
+//           want runs.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::AllocatePage(PageID& start_page_num, int run_size)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Status status;
+
+	if (run_size < 0)
+	{
+		cerr << "Allocating a negative run of pages." << endl;
+		return MINIBASE_FIRST_ERROR(DBMGR, NEG_RUN_SIZE);
+	}
+
+	if (!extentsBuilt)
+	{
+		PageID best = INVALID_PAGE;
+		unsigned bestSize = 0;
+
+		status = scan_space_map([&](PageID start, unsigned runsize) {
+			if (runsize >= (unsigned)run_size &&
+				(best == INVALID_PAGE || runsize < bestSize))
+			{
+				best = start;
+				bestSize = runsize;
+			}
+			return true;
+		});
+		if (status != OK)
+			return status;
+		if (best == INVALID_PAGE)
+			return MINIBASE_FIRST_ERROR(DBMGR, DB_FULL);
+
+		start_page_num = best;
+		return set_bits(start_page_num, run_size, 1);
+	}
+
+	std::set< std::pair<unsigned, PageID> >::iterator fit =
+		extentsBySize.lower_bound(std::make_pair((unsigned)run_size, (PageID)0));
+	if (fit == extentsBySize.end())
+		return MINIBASE_FIRST_ERROR(DBMGR, DB_FULL);
+
+	start_page_num = fit->second;
+	if ((status = set_bits(start_page_num, run_size, 1)) != OK)
+		return status;
+
+	take_extent(start_page_num, run_size);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::DeallocatePage
+//
+// Input   : start_page_num - first page of the run.
+//           run_size - number of pages to free.
+// Output  : None
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::DeallocatePage(PageID start_page_num, int run_size)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Status status;
+
+	if (run_size < 0)
+		return MINIBASE_FIRST_ERROR(DBMGR, NEG_RUN_SIZE);
+
+	if (start_page_num < 0 || start_page_num + run_size > (int)num_pages)
+		return MINIBASE_FIRST_ERROR(DBMGR, BAD_PAGE_NO);
+
+	if ((status = set_bits(start_page_num, run_size, 0)) != OK)
+		return status;
+
+	if (extentsBuilt)
+		add_extent(start_page_num, run_size);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::GetFreeExtentStat
+//
+// Input   : None
+// Output  : freePages - pages free.
+//           numExtents - runs of consecutive free pages.
+//           longest - length of the longest run.
+// Purpose : Tell how fragmented the free space is.
+//-------------------------------------------------------------------
+
+void DB::GetFreeExtentStat(int& freePages, int& numExtents, int& longest)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	freePages = numExtents = longest = 0;
+	auto count = [&](PageID, unsigned runsize) {
+		freePages += runsize;
+		numExtents++;
+		longest = std::max(longest, (int)runsize);
+		return true;
+	};
+
+	if (!extentsBuilt)
+	{
+		scan_space_map(count);
+		return;
+	}
+
+	for (std::map<PageID, unsigned>::iterator it = freeExtents.begin();
+		 it != freeExtents.end(); ++it)
+		count(it->first, it->second);
+}
+
+
+//-------------------------------------------------------------------
+// DB::scan_space_map
+//
+// Input   : visit - called with the first page and the length of each
+//                   run of free pages, lowest first; the scan stops
+//                   when it returns false.
+// Output  : None
+// Purpose : Find the free runs of the space map.  The map is read 64
+//           bits at a time, and words all used or all free are
+//           passed over whole.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::scan_space_map(const std::function<bool(PageID, unsigned)>& visit)
+{
+	unsigned char map[MINIBASE_PAGESIZE];
+	PageID runStart = 0;
+	unsigned run = 0;
+	Status status;
+
+	for (PageID base = 0; base < (int)num_pages; base += 64)
+	{
+		if (base % BITS_PER_PAGE == 0 &&
+			(status = ReadPage(SPACE_MAP_START + base / BITS_PER_PAGE,
+							   (Page *)map)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		// Bits past the last page count as used.
+		uint64_t used = MapWord(map, base % BITS_PER_PAGE / 64);
+		if (num_pages - base < 64)
+			used |= ~(uint64_t)0 << (num_pages - base);
+
+		if (used == 0)
+		{
+			if (run == 0)
+				runStart = base;
+			run += 64;
+			continue;
+		}
+		if (used == ~(uint64_t)0)
+		{
+			if (run > 0 && !visit(runStart, run))
+				return OK;
+			run = 0;
+			continue;
+		}
+
+		for (int bit = 0; bit < 64; )
+		{
+			// The zeros shifted in are ones of ~rest, so a run of used
+			// pages stops at the end of the word.
+			uint64_t rest = used >> bit;
+			if (rest & 1)
+			{
+				if (run > 0 && !visit(runStart, run))
+					return OK;
+				run = 0;
+				bit += __builtin_ctzll(~rest);
+			}
+			else
+			{
+				int n = rest == 0 ? 64 - bit : __builtin_ctzll(rest);
+				if (run == 0)
+					runStart = base + bit;
+				run += n;
+				bit += n;
+			}
+		}
+	}
+
+	if (run > 0)
+		visit(runStart, run);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::build_free_extents
+//
+// Input   : None
+// Output  : None
+// Purpose : Index the free runs of the space map, for AllocatePage.
+// Return  : OK if successful, DBMGR otherwise, when the index is
+//           left unbuilt.
+//-------------------------------------------------------------------
+
+Status DB::build_free_extents()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Status status;
+
+	freeExtents.clear();
+	extentsBySize.clear();
+	extentsBuilt = false;
+
+	status = scan_space_map([this](PageID start, unsigned runsize) {
+		add_extent(start, runsize);
+		return true;
+	});
+	if (status != OK)
+	{
+		freeExtents.clear();
+		extentsBySize.clear();
+		return status;
+	}
+
+	extentsBuilt = true;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::take_extent
+//
+// Input   : start - first page of a run that was free.
+//           runsize - number of pages.
+// Output  : None
+// Purpose : Take the run out of the free extent holding it, leaving
+//           what is free on either side.
+//-------------------------------------------------------------------
+
+void DB::take_extent(PageID start, unsigned runsize)
+{
+	std::map<PageID, unsigned>::iterator it = freeExtents.upper_bound(start);
+	if (runsize == 0 || it == freeExtents.begin())
+		return;
+	--it;
+
+	PageID first = it->first;
+	PageID end = first + it->second;
+	extentsBySize.erase(std::make_pair(it->second, first));
+	freeExtents.erase(it);
+
+	if (first < start)
+	{
+		freeExtents[first] = start - first;
+		extentsBySize.insert(std::make_pair((unsigned)(start - first), first));
+	}
+	if (start + (PageID)runsize < end)
+	{
+		PageID next = start + runsize;
+		freeExtents[next] = end - next;
+		extentsBySize.insert(std::make_pair((unsigned)(end - next), next));
+	}
+}
+
+
+//-------------------------------------------------------------------
+// DB::add_extent
+//
+// Input   : start - first page of a run now free.
+//           runsize - number of pages.
+// Output  : None
+// Purpose : Add the run to the free extents, joining it to those it
+//           touches.  Pages already free are allowed, as the space map
+//           allows freeing them again.
+//-------------------------------------------------------------------
+
+void DB::add_extent(PageID start, unsigned runsize)
+{
+	PageID end = start + runsize;
+	if (runsize == 0)
+		return;
+
+	std::map<PageID, unsigned>::iterator it = freeExtents.upper_bound(start);
+	if (it != freeExtents.begin())
+	{
+		std::map<PageID, unsigned>::iterator prev = std::prev(it);
+		if (prev->first + (PageID)prev->second >= start)
+		{
+			start = prev->first;
+			end = std::max(end, prev->first + (PageID)prev->second);
+			extentsBySize.erase(std::make_pair(prev->second, prev->first));
+			freeExtents.erase(prev);
+		}
+	}
+
+	while (it != freeExtents.end() && it->first <= end)
+	{
+		end = std::max(end, it->first + (PageID)it->second);
+		extentsBySize.erase(std::make_pair(it->second, it->first));
+		it = freeExtents.erase(it);
+	}
+
+	freeExtents[start] = end - start;
+	extentsBySize.insert(std::make_pair((unsigned)(end - start), start));
+}
+
+
+//-------------------------------------------------------------------
+// DB::set_bits
+//
+// Input   : start - first page.
+//           runsize - number of pages.
+//           bit - 1 for used, 0 for free.
+// Output  : None
+// Purpose : Update the space map entries of a run of pages.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::set_bits(PageID start, unsigned runsize, int bit)
+{
+	unsigned char map[MINIBASE_PAGESIZE];
+	PageID end = start + runsize;
+	Status status;
+
+	while (start < end)
+	{
+		PageID mapPid = SPACE_MAP_START + start / BITS_PER_PAGE;
+		PageID last = (start / BITS_PER_PAGE + 1) * BITS_PER_PAGE;
+		if (last > end)
+			last = end;
+
+		if ((status = ReadPage(mapPid, (Page *)map)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		for (; start < last; start++)
+		{
+			int b = start % BITS_PER_PAGE;
+			if (bit)
+				map[b / 8] |= (1 << (b % 8));
+			else
+				map[b / 8] &= ~(1 << (b % 8));
+		}
+
+		if ((status = WritePage(mapPid, (Page *)map)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+	}
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::init_dir_page
+//
+// Input   : dp - the directory page.
+//           used_bytes - bytes of the page in front of the entries.
+// Output  : None
+// Purpose : Fill the rest of the page with empty file entries.
+//-------------------------------------------------------------------
+
+void DB::init_dir_page(directory_page *dp, unsigned used_bytes)
+{
+	file_entry *entries = (file_entry *)&dp->entries;
+
+	dp->next_page = INVALID_PAGE;
+	dp->num_entries = (MINIBASE_PAGESIZE - used_bytes) / sizeof(file_entry);
+
+	for (unsigned i = 0; i < dp->num_entries; i++)
+		entries[i].pagenum = INVALID_PAGE;
+}
+
+
+// The directory starts on page 0, after the first_page header, and
+// fills the whole of any further directory page.
+#define DIR_OF(buf, pid) \
+	((pid) == 0 ? &((first_page *)(buf))->dir : (directory_page *)(buf))
+#define ENTRIES_OF(dp)  ((file_entry *)&(dp)->entries)
+
+
+//-------------------------------------------------------------------
+// DB::AddFileEntry
+//
+// Input   : fname - name of the file.
+//           start_page_num - first page of the file.
+// Output  : None
+// Purpose : Record a new file in the directory, adding a directory
+//           page if all are full.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::AddFileEntry(const char *fname, PageID start_page_num)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	char buf[MINIBASE_PAGESIZE];
+	PageID pid = 0, dummy;
+	Status status;
+
+	if (strlen(fname) >= MAX_NAME)
+		return MINIBASE_FIRST_ERROR(DBMGR, FILE_NAME_TOO_LONG);
+
+	if (GetFileEntry(fname, dummy) == OK)
+		return MINIBASE_FIRST_ERROR(DBMGR, DUPLICATE_ENTRY);
+
+	while (true)
+	{
+		if ((status = ReadPage(pid, (Page *)buf)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		directory_page *dp = DIR_OF(buf, pid);
+		file_entry *entries = ENTRIES_OF(dp);
+
+		for (unsigned i = 0; i < dp->num_entries; i++)
+		{
+			if (entries[i].pagenum == INVALID_PAGE)
+			{
+				entries[i].pagenum = start_page_num;
+				strcpy(entries[i].fname, fname);
+				return WritePage(pid, (Page *)buf);
+			}
+		}
+
+		if (dp->next_page != INVALID_PAGE)
+		{
+			pid = dp->next_page;
+			continue;
+		}
+
+		// Every entry is taken: chain on a new directory page.
+		PageID newPid;
+		if ((status = AllocatePage(newPid)) != OK)
+			return status;
+		dp->next_page = newPid;
+		if ((status = WritePage(pid, (Page *)buf)) != OK)
+			return status;
+
+		memset(buf, 0, sizeof(buf));
+		init_dir_page((directory_page *)buf,
+					  (char *)&((directory_page *)buf)->entries - buf);
+		if ((status = WritePage(newPid, (Page *)buf)) != OK)
+			return status;
+		pid = newPid;
+	}
+}
+
+
+//-------------------------------------------------------------------
+// DB::DeleteFileEntry
+//
+// Input   : fname - name of the file.
+// Output  : None
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::DeleteFileEntry(const char *fname)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	char buf[MINIBASE_PAGESIZE];
+	Status status;
+
+	for (PageID pid = 0; pid != INVALID_PAGE; )
+	{
+		if ((status = ReadPage(pid, (Page *)buf)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		directory_page *dp = DIR_OF(buf, pid);
+		file_entry *entries = ENTRIES_OF(dp);
+
+		for (unsigned i = 0; i < dp->num_entries; i++)
+		{
+			if (entries[i].pagenum != INVALID_PAGE &&
+				strcmp(entries[i].fname, fname) == 0)
+			{
+				entries[i].pagenum = INVALID_PAGE;
+				return WritePage(pid, (Page *)buf);
+			}
+		}
+		pid = dp->next_page;
+	}
+
+	return MINIBASE_FIRST_ERROR(DBMGR, FILE_NOT_FOUND);
+}
+
+
+//-------------------------------------------------------------------
+// DB::GetFileEntry
+//
+// Input   : name - name of the file.
+// Output  : start_pg - first page of the file.
+// Purpose : Look a file up in the directory.  Callers use this to
+//           tell whether a file exists, so a missing file is not
+//           logged as an error.
+// Return  : OK if found, FAIL if not, DBMGR on an I/O error.
+//-------------------------------------------------------------------
+
+Status DB::GetFileEntry(const char *name, PageID& start_pg)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	char buf[MINIBASE_PAGESIZE];
+	Status status;
+
+	for (PageID pid = 0; pid != INVALID_PAGE; )
+	{
+		if ((status = ReadPage(pid, (Page *)buf)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		directory_page *dp = DIR_OF(buf, pid);
+		file_entry *entries = ENTRIES_OF(dp);
+
+		for (unsigned i = 0; i < dp->num_entries; i++)
+		{
+			if (entries[i].pagenum != INVALID_PAGE &&
+				strcmp(entries[i].fname, name) == 0)
+			{
+				start_pg = entries[i].pagenum;
+				return OK;
+			}
+		}
+		pid = dp->next_page;
+	}
+
+	return FAIL;
+}
+
+
+const char *DB::GetName() const
+{
+	return name;
+}
+
+
+int DB::GetNumOfPages() const
+{
+	return num_pages;
+}
+
+
+int DB::GetPageSize() const
+{
+	return MINIBASE_PAGESIZE;
+}
+
+
+//-------------------------------------------------------------------
+// DB::GetNumRelations
+//
+// Input   : None
+// Output  : None
+// Return  : The number of files in the directory, -1 on an I/O error.
+//-------------------------------------------------------------------
+
+int DB::GetNumRelations() const
+{
+	char buf[MINIBASE_PAGESIZE];
+	int count = 0;
+
+	for (PageID pid = 0; pid != INVALID_PAGE; )
+	{
+		if (((DB *)this)->ReadPage(pid, (Page *)buf) != OK)
+			return -1;
+
+		directory_page *dp = DIR_OF(buf, pid);
+		file_entry *entries = ENTRIES_OF(dp);
+
+		for (unsigned i = 0; i < dp->num_entries; i++)
+			if (entries[i].pagenum != INVALID_PAGE)
+				count++;
+		pid = dp->next_page;
+	}
+
+	return count;
+}
+
+
+//-------------------------------------------------------------------
+// DB::dump_space_map
+//
+// Input   : None
+// Output  : None
+// Purpose : Print the space map, one character per page, 64 pages to
+//           a line.
+// Return  : OK if successful, DBMGR otherwise.
+//-------------------------------------------------------------------
+
+Status DB::dump_space_map()
+{
+	unsigned char map[MINIBASE_PAGESIZE];
+	int used = 0;
+	Status status;
+
+	cout << "Space map of " << name << ", " << num_pages << " pages:" << endl;
+
+	for (PageID pid = 0; pid < (int)num_pages; pid++)
+	{
+		if (pid % BITS_PER_PAGE == 0 &&
+			(status = ReadPage(SPACE_MAP_START + pid / BITS_PER_PAGE,
+							   (Page *)map)) != OK)
+			return MINIBASE_CHAIN_ERROR(DBMGR, status);
+
+		int bit = pid % BITS_PER_PAGE;
+		bool isUsed = (map[bit / 8] & (1 << (bit % 8))) != 0;
+		used += isUsed;
+
+		cout << (isUsed ? '1' : '0');
+		if (pid % 64 == 63)
+			cout << endl;
+	}
+
+	cout << endl << used << " used, " << num_pages - used << " free" << endl;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DB::DestroyCatalogBTree
+//
+// Input   : None
+// Output  : None
+// Purpose : Nothing to do; the catalog B+ tree is not part of this
+//           build.
+// Return  : OK
+//-------------------------------------------------------------------
+
+Status DB::DestroyCatalogBTree()
+{
+	return OK;
+}
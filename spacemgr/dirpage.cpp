@@ -0,0 +1,283 @@
+/*
+ * dirpage.cpp - directory pages of a HeapFile.
+ *
+ * A directory page holds a packed array of PageInfo, one per data page
+ * of the file, and is linked to the other directory pages of the file.
+ * spaceAvailable counts the unused PageInfo entries.
+ */
+
+#include "dirpage.h"
+#include "bufmgr.h"
+
+
+#define MAX_PAGE_INFO   ((int)(DIR_PAGE_SIZE / sizeof(PageInfo)))
+
+
+//-------------------------------------------------------------------
+// DirPage::Init
+//
+// Input   : pid - page id of this page.
+// Output  : None
+// Purpose : Make this an empty, unlinked directory page.
+// Return  : OK
+//-------------------------------------------------------------------
+
+Status DirPage::Init(PageID pid)
+{
+	numOfEntry = 0;
+	spaceAvailable = MAX_PAGE_INFO;
+	curr = pid;
+	next = INVALID_PAGE;
+	prev = INVALID_PAGE;
+	return OK;
+}
+
+
+PageInfo *DirPage::GetEntry(int entry)
+{
+	if (entry < 0 || entry >= numOfEntry)
+		return NULL;
+	return (PageInfo *)data + entry;
+}
+
+
+PageInfo *DirPage::GetPageInfo(int entry)
+{
+	return GetEntry(entry);
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::FindPageInfoEntry
+//
+// Input   : pid - a data page.
+// Output  : None
+// Return  : The entry of pid on this page, -1 if it is not here.
+//-------------------------------------------------------------------
+
+int DirPage::FindPageInfoEntry(PageID pid)
+{
+	PageInfo *info = (PageInfo *)data;
+
+	for (int i = 0; i < numOfEntry; i++)
+		if (info[i].pid == pid)
+			return i;
+
+	return -1;
+}
+
+
+PageInfo *DirPage::FindPageInfo(PageID pid)
+{
+	return GetEntry(FindPageInfoEntry(pid));
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::InsertPage
+//
+// Input   : pid - a new data page.
+//           page - the page itself.
+// Output  : None
+// Purpose : Add an entry for the page.
+// Return  : OK if successful, FAIL if this directory page is full.
+//-------------------------------------------------------------------
+
+Status DirPage::InsertPage(PageID pid, HeapPage *page)
+{
+	if (!HasFreeSpace())
+		return FAIL;
+
+	PageInfo *info = (PageInfo *)data + numOfEntry;
+	info->pid = pid;
+	info->spaceAvailable = page->AvailableSpace();
+	info->numOfRecords = page->GetNumOfRecords();
+
+	numOfEntry++;
+	spaceAvailable--;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::DeletePage
+//
+// Input   : pid - a data page.
+// Output  : None
+// Purpose : Remove the entry of the page, moving the last entry into
+//           its place.
+// Return  : OK if successful, FAIL if the page is not here.
+//-------------------------------------------------------------------
+
+Status DirPage::DeletePage(PageID pid)
+{
+	int entry = FindPageInfoEntry(pid);
+	PageInfo *info = (PageInfo *)data;
+
+	if (entry < 0)
+		return FAIL;
+
+	info[entry] = info[numOfEntry - 1];
+	numOfEntry--;
+	spaceAvailable++;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::InsertRecordIntoPage
+//
+// Input   : pid - a data page.
+//           page - the page, after a record was inserted.
+// Output  : None
+// Purpose : Bring the entry of the page up to date.
+// Return  : OK if successful, FAIL if the page is not here.
+//-------------------------------------------------------------------
+
+Status DirPage::InsertRecordIntoPage(PageID pid, HeapPage *page)
+{
+	PageInfo *info = FindPageInfo(pid);
+
+	if (info == NULL)
+		return FAIL;
+
+	info->spaceAvailable = page->AvailableSpace();
+	info->numOfRecords++;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::DeleteRecordFromPage
+//
+// Input   : pid - a data page.
+//           page - the page, after a record was deleted.
+// Output  : None
+// Purpose : Bring the entry of the page up to date.
+// Return  : OK if successful, FAIL if the page is not here.
+//-------------------------------------------------------------------
+
+Status DirPage::DeleteRecordFromPage(PageID pid, HeapPage *page)
+{
+	PageInfo *info = FindPageInfo(pid);
+
+	if (info == NULL)
+		return FAIL;
+
+	info->spaceAvailable = page->AvailableSpace();
+	info->numOfRecords--;
+	return OK;
+}
+
+
+PageID DirPage::GetNextPage()
+{
+	return next;
+}
+
+
+bool DirPage::HasFreeSpace()
+{
+	return spaceAvailable > 0;
+}
+
+
+//-------------------------------------------------------------------
+// DirPage::DeleteItSelf
+//
+// Input   : None
+// Output  : None
+// Purpose : Unlink this page from its neighbours.  The caller frees
+//           the page.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status DirPage::DeleteItSelf()
+{
+	DirPage *page;
+
+	if (prev != INVALID_PAGE)
+	{
+		PIN(prev, page);
+		page->next = next;
+		UNPIN(prev, DIRTY);
+	}
+
+	if (next != INVALID_PAGE)
+	{
+		PIN(next, page);
+		page->prev = prev;
+		UNPIN(next, DIRTY);
+	}
+
+	next = prev = INVALID_PAGE;
+	return OK;
+}
+
+
+PageInfoIterator::PageInfoIterator(DirPage *page)
+{
+	this->page = page;
+	currEntry = 0;
+}
+
+
+PageInfoIterator::~PageInfoIterator()
+{
+}
+
+
+//-------------------------------------------------------------------
+// PageInfoIterator::operator()
+//
+// Input   : None
+// Output  : None
+// Return  : The next entry of the directory page, NULL at the end.
+//-------------------------------------------------------------------
+
+PageInfo *PageInfoIterator::operator() ()
+{
+	if (currEntry >= page->numOfEntry)
+		return NULL;
+	return page->GetEntry(currEntry++);
+}
+
+
+DirPageIterator::DirPageIterator(PageID pid)
+{
+	curr = pid;
+}
+
+
+DirPageIterator::~DirPageIterator()
+{
+}
+
+
+//-------------------------------------------------------------------
+// DirPageIterator::operator()
+//
+// Input   : None
+// Output  : None
+// Return  : The next directory page of the file, INVALID_PAGE at the
+//           end or if a page cannot be read.
+//-------------------------------------------------------------------
+
+PageID DirPageIterator::operator() ()
+{
+	PageID pid = curr;
+	DirPage *page;
+
+	if (pid == INVALID_PAGE)
+		return INVALID_PAGE;
+
+	if (MINIBASE_BM->PinPage(pid, (Page *&)page) != OK)
+	{
+		curr = INVALID_PAGE;
+		return INVALID_PAGE;
+	}
+	curr = page->GetNextPage();
+	MINIBASE_BM->UnpinPage(pid, CLEAN);
+
+	return pid;
+}
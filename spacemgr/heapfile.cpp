@@ -0,0 +1,476 @@
+/*
+ * heapfile.cpp - unordered files of records.
+ *
+ * A heap file is a chain of DirPages, the first of which is named in
+ * the DB directory, listing the HeapPages that hold its records.
+ */
+
+#include <stdio.h>
+#include "heapfile.h"
+#include "heappage.h"
+#include "dirpage.h"
+#include "scan.h"
+#include "bufmgr.h"
+#include "db.h"
+
+
+static const char *heapErrMsgs[] = {
+	"Inserting a too-long record",
+	"Invalid Slot No",
+	"Lengthening a record",
+	"Shortening a record",
+	"Error creating new file.",
+	"Page is not part of the file"
+};
+
+enum heapErrCodes {
+	TOO_LONG_RECORD,
+	INVALID_SLOT_NO,
+	LENGTHEN_RECORD,
+	SHORTEN_RECORD,
+	CREATE_FAILED,
+	PAGE_NOT_IN_FILE
+};
+
+static error_string_table heapTable(HEAPFILE, heapErrMsgs);
+
+
+//-------------------------------------------------------------------
+// HeapFile::HeapFile
+//
+// Input   : name - name of the file in the DB directory.
+// Output  : returnStatus - OK if successful, HEAPFILE otherwise.
+// Purpose : Open the named heap file, creating it if it does not
+//           exist.
+//-------------------------------------------------------------------
+
+HeapFile::HeapFile(const char *name, Status& returnStatus)
+{
+	filename = strcpy(new char[strlen(name) + 1], name);
+	type = PERMENANT;
+	dirPid = lastDirPid = INVALID_PAGE;
+	returnStatus = OK;
+
+	if (MINIBASE_DB->GetFileEntry(name, dirPid) != OK)
+	{
+		DirPage *dir;
+
+		if (MINIBASE_BM->NewPage(dirPid, (Page *&)dir) != OK)
+		{
+			dirPid = INVALID_PAGE;
+			returnStatus = MINIBASE_FIRST_ERROR(HEAPFILE, CREATE_FAILED);
+			return;
+		}
+		dir->Init(dirPid);
+		MINIBASE_BM->UnpinPage(dirPid, DIRTY);
+
+		if (MINIBASE_DB->AddFileEntry(name, dirPid) != OK)
+		{
+			MINIBASE_BM->FreePage(dirPid);
+			dirPid = INVALID_PAGE;
+			returnStatus = MINIBASE_CHAIN_ERROR(HEAPFILE, DBMGR);
+			return;
+		}
+	}
+
+	DirPageIterator dirs(dirPid);
+	for (PageID pid = dirs(); pid != INVALID_PAGE; pid = dirs())
+		lastDirPid = pid;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::HeapFile
+//
+// Input   : None
+// Output  : returnStatus - OK if successful, HEAPFILE otherwise.
+// Purpose : Create a temporary heap file.  It has no directory entry
+//           and is deleted with the HeapFile object.
+//-------------------------------------------------------------------
+
+HeapFile::HeapFile(Status& returnStatus)
+{
+	DirPage *dir;
+
+	filename = NULL;
+	type = TEMPORARY;
+	dirPid = lastDirPid = INVALID_PAGE;
+	returnStatus = OK;
+
+	if (MINIBASE_BM->NewPage(dirPid, (Page *&)dir) != OK)
+	{
+		dirPid = INVALID_PAGE;
+		returnStatus = MINIBASE_FIRST_ERROR(HEAPFILE, CREATE_FAILED);
+		return;
+	}
+	dir->Init(dirPid);
+	MINIBASE_BM->UnpinPage(dirPid, DIRTY);
+	lastDirPid = dirPid;
+}
+
+
+HeapFile::~HeapFile()
+{
+	if (type == TEMPORARY && dirPid != INVALID_PAGE)
+		DeleteFile();
+	delete [] filename;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::GetNumOfRecords
+//
+// Input   : None
+// Output  : None
+// Return  : The number of records in the file, -1 on an error.
+//-------------------------------------------------------------------
+
+int HeapFile::GetNumOfRecords()
+{
+	DirPageIterator dirs(dirPid);
+	int count = 0;
+
+	for (PageID pid = dirs(); pid != INVALID_PAGE; pid = dirs())
+	{
+		DirPage *dir;
+		PageInfo *info;
+
+		if (MINIBASE_BM->PinPage(pid, (Page *&)dir) != OK)
+			return -1;
+
+		PageInfoIterator infos(dir);
+		while ((info = infos()) != NULL)
+			count += info->numOfRecords;
+
+		MINIBASE_BM->UnpinPage(pid, CLEAN);
+	}
+
+	return count;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::NewPage
+//
+// Input   : None
+// Output  : pid - a new, empty data page of the file.
+//           dirPid - the directory page that lists it.
+// Purpose : Allocate a data page and enter it in the first directory
+//           page with room, chaining a new directory page if none has.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::NewPage(PageID& pid, PageID& dirPid)
+{
+	HeapPage *page;
+	DirPage *dir = NULL;
+	DirPageIterator dirs(this->dirPid);
+
+	for (dirPid = dirs(); dirPid != INVALID_PAGE; dirPid = dirs())
+	{
+		PIN(dirPid, dir);
+		if (dir->HasFreeSpace())
+			break;
+		UNPIN(dirPid, CLEAN);
+	}
+
+	if (dirPid == INVALID_PAGE)
+	{
+		DirPage *last;
+
+		NEWPAGE(dirPid, dir);
+		dir->Init(dirPid);
+		dir->SetPrevPage(lastDirPid);
+
+		PIN(lastDirPid, last);
+		last->SetNextPage(dirPid);
+		UNPIN(lastDirPid, DIRTY);
+		lastDirPid = dirPid;
+	}
+
+	if (MINIBASE_BM->NewPage(pid, (Page *&)page) != OK)
+	{
+		UNPIN(dirPid, DIRTY);
+		return FAIL;
+	}
+	page->Init(pid);
+	dir->InsertPage(pid, page);
+
+	UNPIN(pid, DIRTY);
+	UNPIN(dirPid, DIRTY);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::NextPage
+//
+// Input   : pid - a data page of the file, or INVALID_PAGE.
+// Output  : None
+// Return  : The data page after pid in directory order (the first
+//           one if pid is INVALID_PAGE), INVALID_PAGE if there is
+//           none.
+//-------------------------------------------------------------------
+
+PageID HeapFile::NextPage(PageID pid)
+{
+	DirPageIterator dirs(dirPid);
+	bool found = (pid == INVALID_PAGE);
+
+	for (PageID d = dirs(); d != INVALID_PAGE; d = dirs())
+	{
+		DirPage *dir;
+		PageInfo *info;
+
+		if (MINIBASE_BM->PinPage(d, (Page *&)dir) != OK)
+			return INVALID_PAGE;
+
+		PageInfoIterator infos(dir);
+		while ((info = infos()) != NULL)
+		{
+			if (found)
+			{
+				PageID next = info->pid;
+				MINIBASE_BM->UnpinPage(d, CLEAN);
+				return next;
+			}
+			found = (info->pid == pid);
+		}
+
+		MINIBASE_BM->UnpinPage(d, CLEAN);
+	}
+
+	return INVALID_PAGE;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::InsertRecord
+//
+// Input   : recPtr - the record.
+//           recLen - its length.
+// Output  : outRid - record id of the new record.
+// Purpose : Put the record on the first data page with room for it,
+//           or on a new page.
+// Return  : OK if successful, HEAPFILE or FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::InsertRecord(char *recPtr, int recLen, RecordID& outRid)
+{
+	PageID pid = INVALID_PAGE, dPid;
+	DirPage *dir;
+	HeapPage *page;
+
+	if (recLen > HEAPPAGE_DATA_SIZE)
+	{
+		cerr << " Attempting to insert records that is larger than size of a page" << endl;
+		return MINIBASE_FIRST_ERROR(HEAPFILE, TOO_LONG_RECORD);
+	}
+
+	DirPageIterator dirs(dirPid);
+	for (dPid = dirs(); dPid != INVALID_PAGE && pid == INVALID_PAGE; dPid = dirs())
+	{
+		PageInfo *info;
+
+		PIN(dPid, dir);
+		PageInfoIterator infos(dir);
+		while ((info = infos()) != NULL)
+		{
+			if (info->spaceAvailable >= recLen)
+			{
+				pid = info->pid;
+				break;
+			}
+		}
+		UNPIN(dPid, CLEAN);
+		if (pid != INVALID_PAGE)
+			break;
+	}
+
+	if (pid == INVALID_PAGE && NewPage(pid, dPid) != OK)
+		return FAIL;
+
+	PIN(dPid, dir);
+	PIN(pid, page);
+
+	if (page->InsertRecord(recPtr, recLen, outRid) != OK)
+	{
+		UNPIN(pid, CLEAN);
+		UNPIN(dPid, CLEAN);
+		return FAIL;
+	}
+	dir->InsertRecordIntoPage(pid, page);
+
+	UNPIN(pid, DIRTY);
+	UNPIN(dPid, DIRTY);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::DeleteRecord
+//
+// Input   : rid - record id of the record.
+// Output  : None
+// Purpose : Delete the record.  A data page left empty is freed, and
+//           so is a directory page left empty, other than the first.
+// Return  : OK if successful, HEAPFILE or FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::DeleteRecord(const RecordID& rid)
+{
+	DirPageIterator dirs(dirPid);
+	PageID dPid;
+	DirPage *dir = NULL;
+	HeapPage *page;
+
+	for (dPid = dirs(); dPid != INVALID_PAGE; dPid = dirs())
+	{
+		PIN(dPid, dir);
+		if (dir->FindPageInfo(rid.pageNo) != NULL)
+			break;
+		UNPIN(dPid, CLEAN);
+	}
+
+	if (dPid == INVALID_PAGE)
+		return MINIBASE_FIRST_ERROR(HEAPFILE, PAGE_NOT_IN_FILE);
+
+	PIN(rid.pageNo, page);
+	if (page->DeleteRecord(rid) != OK)
+	{
+		UNPIN(rid.pageNo, CLEAN);
+		UNPIN(dPid, CLEAN);
+		return MINIBASE_FIRST_ERROR(HEAPFILE, INVALID_SLOT_NO);
+	}
+	dir->DeleteRecordFromPage(rid.pageNo, page);
+
+	if (page->IsEmpty())
+	{
+		dir->DeletePage(rid.pageNo);
+		FREEPAGE(rid.pageNo);
+	}
+	else
+	{
+		UNPIN(rid.pageNo, DIRTY);
+	}
+
+	if (dir->IsEmpty() && !dir->IsHead())
+	{
+		dir->DeleteItSelf();
+		FREEPAGE(dPid);
+
+		DirPageIterator rest(dirPid);
+		for (PageID d = rest(); d != INVALID_PAGE; d = rest())
+			lastDirPid = d;
+		return OK;
+	}
+
+	UNPIN(dPid, DIRTY);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::UpdateRecord
+//
+// Input   : rid - record id of the record.
+//           recPtr - the new contents.
+//           recLen - their length, which must be the old length.
+// Output  : None
+// Return  : OK if successful, HEAPFILE or FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::UpdateRecord(const RecordID& rid, char *recPtr, int recLen)
+{
+	HeapPage *page;
+	char *oldPtr;
+	int oldLen;
+
+	PIN(rid.pageNo, page);
+	if (page->ReturnRecord(rid, oldPtr, oldLen) != OK)
+	{
+		UNPIN(rid.pageNo, CLEAN);
+		return MINIBASE_FIRST_ERROR(HEAPFILE, INVALID_SLOT_NO);
+	}
+
+	if (recLen != oldLen)
+	{
+		UNPIN(rid.pageNo, CLEAN);
+		cerr << " Unable to update records of different length." << endl;
+		return MINIBASE_FIRST_ERROR(HEAPFILE,
+			recLen > oldLen ? LENGTHEN_RECORD : SHORTEN_RECORD);
+	}
+
+	memcpy(oldPtr, recPtr, recLen);
+	UNPIN(rid.pageNo, DIRTY);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::GetRecord
+//
+// Input   : rid - record id of the record.
+// Output  : recPtr - filled with a copy of the record.
+//           recLen - its length.
+// Return  : OK if successful, HEAPFILE or FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::GetRecord(const RecordID& rid, char *recPtr, int& recLen)
+{
+	HeapPage *page;
+
+	PIN(rid.pageNo, page);
+	if (page->GetRecord(rid, recPtr, recLen) != OK)
+	{
+		UNPIN(rid.pageNo, CLEAN);
+		return MINIBASE_FIRST_ERROR(HEAPFILE, INVALID_SLOT_NO);
+	}
+	UNPIN(rid.pageNo, CLEAN);
+	return OK;
+}
+
+
+Scan *HeapFile::OpenScan(Status& status)
+{
+	return new Scan(this, status);
+}
+
+
+//-------------------------------------------------------------------
+// HeapFile::DeleteFile
+//
+// Input   : None
+// Output  : None
+// Purpose : Free every page of the file and remove its directory
+//           entry.
+// Return  : OK if successful, FAIL otherwise.
+//-------------------------------------------------------------------
+
+Status HeapFile::DeleteFile()
+{
+	PageID d = dirPid;
+
+	while (d != INVALID_PAGE)
+	{
+		DirPage *dir;
+		PageInfo *info;
+
+		PIN(d, dir);
+		PageInfoIterator infos(dir);
+		while ((info = infos()) != NULL)
+		{
+			FREEPAGE(info->pid);
+		}
+		PageID next = dir->GetNextPage();
+		FREEPAGE(d);
+		d = next;
+	}
+
+	dirPid = lastDirPid = INVALID_PAGE;
+
+	if (type == PERMENANT && MINIBASE_DB->DeleteFileEntry(filename) != OK)
+		return MINIBASE_CHAIN_ERROR(HEAPFILE, DBMGR);
+
+	return OK;
+}
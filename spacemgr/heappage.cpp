@@ -0,0 +1,314 @@
+/*
+ * heappage.cpp - slotted page of variable length records.
+ *
+ * Records are packed at the end of the data area, growing down from
+ * fillPtr; the slot directory grows up from slots[0] into the start of
+ * the data area.  slots[0] lives in the page header, so an empty page
+ * has HEAPPAGE_DATA_SIZE bytes available and every record costs its
+ * length plus one Slot.  Deleting a record closes the hole it leaves,
+ * so the free space is always contiguous.
+ */
+
+#include <string.h>
+#include "heappage.h"
+
+
+//-------------------------------------------------------------------
+// HeapPage::Init
+//
+// Input   : pageNo - page id of this page.
+// Output  : None
+// Purpose : Make this an empty page.  The type field is left alone;
+//           callers that use it set it themselves.
+//-------------------------------------------------------------------
+
+void HeapPage::Init(PageID pageNo)
+{
+	numOfSlots = 0;
+	fillPtr = HEAPPAGE_DATA_SIZE;
+	freeSpace = HEAPPAGE_DATA_SIZE + sizeof(Slot);
+	pid = pageNo;
+	nextPage = INVALID_PAGE;
+	prevPage = INVALID_PAGE;
+}
+
+
+PageID HeapPage::GetNextPage()
+{
+	return nextPage;
+}
+
+
+PageID HeapPage::GetPrevPage()
+{
+	return prevPage;
+}
+
+
+void HeapPage::SetNextPage(PageID pageNo)
+{
+	nextPage = pageNo;
+}
+
+
+void HeapPage::SetPrevPage(PageID pageNo)
+{
+	prevPage = pageNo;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::InsertRecord
+//
+// Input   : recPtr - the record.
+//           recLen - its length.
+// Output  : rid - record id of the new record.
+// Purpose : Copy the record onto the page, reusing an empty slot if
+//           there is one.
+// Return  : OK if successful, DONE if there is not enough space.
+//-------------------------------------------------------------------
+
+Status HeapPage::InsertRecord(char *recPtr, int recLen, RecordID& rid)
+{
+	int i;
+
+	if (recLen > AvailableSpace())
+		return DONE;
+
+	for (i = 0; i < numOfSlots; i++)
+		if (SLOT_IS_EMPTY(slots[i]))
+			break;
+
+	if (i == numOfSlots)
+	{
+		numOfSlots++;
+		freeSpace -= sizeof(Slot);
+	}
+
+	fillPtr -= recLen;
+	freeSpace -= recLen;
+	memcpy(data + fillPtr, recPtr, recLen);
+	SLOT_FILL(slots[i], fillPtr, recLen);
+
+	rid.pageNo = pid;
+	rid.slotNo = i;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::DeleteRecord
+//
+// Input   : rid - record id of the record.
+// Output  : None
+// Purpose : Remove the record and close the gap it leaves by moving
+//           the records below it up.  Trailing empty slots are given
+//           back; others stay so record ids remain stable.
+// Return  : OK if successful, FAIL if rid is not a record.
+//-------------------------------------------------------------------
+
+Status HeapPage::DeleteRecord(const RecordID& rid)
+{
+	int i = rid.slotNo;
+
+	if (i < 0 || i >= numOfSlots || SLOT_IS_EMPTY(slots[i]))
+		return FAIL;
+
+	int offset = slots[i].offset;
+	int length = slots[i].length;
+
+	memmove(data + fillPtr + length, data + fillPtr, offset - fillPtr);
+	for (int j = 0; j < numOfSlots; j++)
+		if (!SLOT_IS_EMPTY(slots[j]) && slots[j].offset < offset)
+			slots[j].offset += length;
+
+	fillPtr += length;
+	freeSpace += length;
+	SLOT_SET_EMPTY(slots[i]);
+
+	while (numOfSlots > 0 && SLOT_IS_EMPTY(slots[numOfSlots - 1]))
+	{
+		numOfSlots--;
+		freeSpace += sizeof(Slot);
+	}
+
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::CompactSlotDir
+//
+// Input   : None
+// Output  : None
+// Purpose : Drop every empty slot, keeping the others in order.  This
+//           renumbers the records after each empty slot.
+//-------------------------------------------------------------------
+
+void HeapPage::CompactSlotDir()
+{
+	int n = 0;
+
+	for (int i = 0; i < numOfSlots; i++)
+	{
+		if (!SLOT_IS_EMPTY(slots[i]))
+			slots[n++] = slots[i];
+	}
+
+	freeSpace += (numOfSlots - n) * sizeof(Slot);
+	numOfSlots = n;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::FirstRecord
+//
+// Input   : None
+// Output  : firstRid - record id of the first record on the page.
+// Return  : OK if successful, DONE if the page is empty.
+//-------------------------------------------------------------------
+
+Status HeapPage::FirstRecord(RecordID& firstRid)
+{
+	for (int i = 0; i < numOfSlots; i++)
+	{
+		if (!SLOT_IS_EMPTY(slots[i]))
+		{
+			firstRid.pageNo = pid;
+			firstRid.slotNo = i;
+			return OK;
+		}
+	}
+
+	return DONE;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::NextRecord
+//
+// Input   : curRid - record id of a record on the page.
+// Output  : nextRid - record id of the record after it.
+// Return  : OK if successful, DONE if curRid is the last record.
+//-------------------------------------------------------------------
+
+Status HeapPage::NextRecord(RecordID curRid, RecordID& nextRid)
+{
+	if (curRid.slotNo < 0)
+		return FAIL;
+
+	for (int i = curRid.slotNo + 1; i < numOfSlots; i++)
+	{
+		if (!SLOT_IS_EMPTY(slots[i]))
+		{
+			nextRid.pageNo = pid;
+			nextRid.slotNo = i;
+			return OK;
+		}
+	}
+
+	return DONE;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::GetRecord
+//
+// Input   : rid - record id of the record.
+// Output  : recPtr - filled with a copy of the record.
+//           recLen - length of the record.
+// Return  : OK if successful, FAIL if rid is not a record.
+//-------------------------------------------------------------------
+
+Status HeapPage::GetRecord(RecordID rid, char *recPtr, int& recLen)
+{
+	char *p;
+
+	if (ReturnRecord(rid, p, recLen) != OK)
+		return FAIL;
+
+	memcpy(recPtr, p, recLen);
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::ReturnRecord
+//
+// Input   : rid - record id of the record.
+// Output  : recPtr - points at the record, on the page.
+//           recLen - length of the record.
+// Return  : OK if successful, FAIL if rid is not a record.
+//-------------------------------------------------------------------
+
+Status HeapPage::ReturnRecord(RecordID rid, char *&recPtr, int& recLen)
+{
+	int offset;
+
+	if (ReturnOffset(rid, offset) != OK)
+		return FAIL;
+
+	recPtr = data + offset;
+	recLen = slots[rid.slotNo].length;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::ReturnOffset
+//
+// Input   : rid - record id of the record.
+// Output  : offset - where the record starts in the data area.
+// Return  : OK if successful, FAIL if rid is not a record.
+//-------------------------------------------------------------------
+
+Status HeapPage::ReturnOffset(RecordID rid, int& offset)
+{
+	if (rid.slotNo < 0 || rid.slotNo >= numOfSlots ||
+		SLOT_IS_EMPTY(slots[rid.slotNo]))
+		return FAIL;
+
+	offset = slots[rid.slotNo].offset;
+	return OK;
+}
+
+
+//-------------------------------------------------------------------
+// HeapPage::AvailableSpace
+//
+// Input   : None
+// Output  : None
+// Return  : The length of the longest record that can be inserted,
+//           allowing for a new slot when no empty one is left.
+//-------------------------------------------------------------------
+
+int HeapPage::AvailableSpace(void)
+{
+	for (int i = 0; i < numOfSlots; i++)
+		if (SLOT_IS_EMPTY(slots[i]))
+			return freeSpace;
+
+	return freeSpace > (int)sizeof(Slot) ? freeSpace - sizeof(Slot) : 0;
+}
+
+
+bool HeapPage::IsEmpty(void)
+{
+	for (int i = 0; i < numOfSlots; i++)
+		if (!SLOT_IS_EMPTY(slots[i]))
+			return false;
+
+	return true;
+}
+
+
+int HeapPage::GetNumOfRecords()
+{
+	int count = 0;
+
+	for (int i = 0; i < numOfSlots; i++)
+		if (!SLOT_IS_EMPTY(slots[i]))
+			count++;
+
+	return count;
+}
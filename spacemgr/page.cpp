@@ -0,0 +1,15 @@
+/*
+ * page.cpp - a raw page of MINIBASE_PAGESIZE bytes.
+ */
+
+#include "page.h"
+
+
+Page::Page()
+{
+}
+
+
+Page::~Page()
+{
+}
@@ -0,0 +1,182 @@
+/*
+ * scan.cpp - sequential scan of a HeapFile.
+ *
+ * The scan walks the directory pages of the file, and the data pages
+ * listed on each, in order.  No page stays pinned between calls.  Data
+ * pages are read through a BULK_READ ring, so a scan of a file larger
+ * than the pool leaves the rest of the pool alone; directory pages,
+ * pinned again for every data page, are read as ordinary pages.  On
+ * moving to a data page the scan prefetches the next few data pages
+ * into the ring, and on nearing the end of a directory page the next
+ * directory page.
+ */
+
+#include "scan.h"
+#include "heapfile.h"
+#include "bufmgr.h"
+
+
+// Data pages to prefetch ahead of the scan: few enough that no shard's
+// ring recycles one before the scan reaches it.
+#define SCAN_PREFETCH_DEPTH  4
+
+
+//-------------------------------------------------------------------
+// Scan::Scan
+//
+// Input   : hf - the heap file to scan.
+// Output  : status - OK
+// Purpose : Position the scan before the first record of the file.
+//-------------------------------------------------------------------
+
+Scan::Scan(HeapFile *hf, Status& status)
+{
+	firstDirPid = hf->GetFirstDirPage();
+	currDirPid = firstDirPid;
+	currEntry = -1;
+	dirPage = NULL;
+
+	currPid = INVALID_PAGE;
+	page = NULL;
+	currRid.pageNo = INVALID_PAGE;
+	currRid.slotNo = INVALID_SLOT;
+
+	noMore = (firstDirPid == INVALID_PAGE);
+	strategy = MINIBASE_BM->GetAccessStrategy(BULK_READ);
+	status = OK;
+}
+
+
+Scan::~Scan()
+{
+	MINIBASE_BM->FreeAccessStrategy(strategy);
+}
+
+
+//-------------------------------------------------------------------
+// Scan::GetNext
+//
+// Input   : None
+// Output  : rid - record id of the next record.
+//           recPtr - filled with a copy of the record.
+//           recLen - its length.
+// Return  : OK if successful, DONE at the end of the file, FAIL on an
+//           error.
+//-------------------------------------------------------------------
+
+Status Scan::GetNext(RecordID& rid, char *recPtr, int& recLen)
+{
+	while (!noMore)
+	{
+		if (currPid != INVALID_PAGE)
+		{
+			RecordID next;
+			Status s;
+
+			if (MINIBASE_BM->PinPage(currPid, (Page *&)page, false, strategy) != OK)
+			{
+				cerr << "Unable to pin page " << currPid << endl;
+				return FAIL;
+			}
+			if (currRid.pageNo == currPid)
+				s = page->NextRecord(currRid, next);
+			else
+				s = page->FirstRecord(next);
+
+			if (s == OK)
+			{
+				page->GetRecord(next, recPtr, recLen);
+				currRid = rid = next;
+				UNPIN(currPid, CLEAN);
+				return OK;
+			}
+			UNPIN(currPid, CLEAN);
+		}
+
+		// This page is done: move to the next entry of the directory.
+		PIN(currDirPid, dirPage);
+		PageInfo *info = dirPage->GetEntry(++currEntry);
+		PageID nextDirPid = dirPage->GetNextPage();
+		if (info != NULL)
+			PrefetchAhead();
+		UNPIN(currDirPid, CLEAN);
+
+		currRid.pageNo = INVALID_PAGE;
+		if (info != NULL)
+		{
+			currPid = info->pid;
+		}
+		else if (nextDirPid != INVALID_PAGE)
+		{
+			currDirPid = nextDirPid;
+			currEntry = -1;
+			currPid = INVALID_PAGE;
+		}
+		else
+		{
+			noMore = true;
+		}
+	}
+
+	return DONE;
+}
+
+
+// Start reading the data pages listed on dirPage after currEntry, up
+// to SCAN_PREFETCH_DEPTH of them, into the ring, and the directory page
+// after dirPage if they run out.
+void Scan::PrefetchAhead()
+{
+	PageID pids[SCAN_PREFETCH_DEPTH];
+	PageInfo *info;
+	int n;
+
+	for (n = 0; n < SCAN_PREFETCH_DEPTH; n++)
+	{
+		if ((info = dirPage->GetEntry(currEntry + 1 + n)) == NULL)
+			break;
+		pids[n] = info->pid;
+	}
+	MINIBASE_BM->Prefetch(pids, n, strategy);
+
+	if (n < SCAN_PREFETCH_DEPTH)
+	{
+		PageID nextDirPid = dirPage->GetNextPage();
+		MINIBASE_BM->Prefetch(&nextDirPid, 1);
+	}
+}
+
+
+//-------------------------------------------------------------------
+// Scan::MoveTo
+//
+// Input   : rid - record id of a record of the file.
+// Output  : None
+// Purpose : Position the scan on rid, so that GetNext returns the
+//           record after it.
+// Return  : OK if successful, FAIL if rid's page is not in the file.
+//-------------------------------------------------------------------
+
+Status Scan::MoveTo(RecordID rid)
+{
+	DirPageIterator dirs(firstDirPid);
+
+	for (PageID d = dirs(); d != INVALID_PAGE; d = dirs())
+	{
+		PIN(d, dirPage);
+		int entry = dirPage->FindPageInfoEntry(rid.pageNo);
+		UNPIN(d, CLEAN);
+
+		if (entry >= 0)
+		{
+			currDirPid = d;
+			currEntry = entry;
+			currPid = rid.pageNo;
+			currRid = rid;
+			noMore = false;
+			return OK;
+		}
+	}
+
+	return FAIL;
+}